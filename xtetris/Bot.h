@@ -0,0 +1,94 @@
+/**
+* @file Bot.h
+* @author Albert Alibeaj
+* @brief Interfaccia binaria stabile per i giocatori esterni (bot) caricati come librerie dinamiche.
+ * Il file non dipende da altri header del gioco e può essere copiato nei progetti dei bot.
+ *
+ * Un bot è una libreria condivisa che esporta le funzioni xtetris_bot_abi, xtetris_bot_init,
+ * xtetris_bot_choose_move e xtetris_bot_free (vedi i tipi XtetrisBot*Fn). Il gioco la carica con
+ * dlopen e la chiama nello stesso processo, al posto del computer: la posizione viene passata come
+ * puntatore allo stato del motore, senza copie né conversioni.
+ *
+ * Il bot riceve all'avvio le funzioni del motore per elencare le mosse possibili e per provarne una,
+ * così non deve conoscere le forme dei tetramini. Se xtetris_bot_init imposta XTETRIS_BOT_REENTRANT
+ * il bot può essere chiamato da più thread insieme (per esempio in un torneo); altrimenti
+ * le chiamate a xtetris_bot_choose_move di uno stesso bot vengono serializzate dal motore.
+ *
+ * Esempio: <code>bot_lowest.c</code>, compilato da CMake come <code>xtetris-bot-lowest</code>
+*/
+
+#ifndef XTETRIS2_BOT_H
+#define XTETRIS2_BOT_H
+
+/** Versione dell'interfaccia: cambia solo se cambiano tipi o funzioni di questo file */
+#define XTETRIS_BOT_ABI_VERSION 1
+
+/** Righe del campo */
+#define XTETRIS_BOT_ROWS 19
+/** Colonne del campo */
+#define XTETRIS_BOT_COLS 10
+/** Tipi di tetramino */
+#define XTETRIS_BOT_TETS 7
+/** Giocatori massimi */
+#define XTETRIS_BOT_PLAYERS 2
+/** Mosse distinte massime di una posizione */
+#define XTETRIS_BOT_MAX_MOVES (XTETRIS_BOT_TETS * 4 * XTETRIS_BOT_COLS)
+
+/** Opzione di xtetris_bot_init: xtetris_bot_choose_move può essere chiamata da più thread insieme */
+#define XTETRIS_BOT_REENTRANT 1
+
+/** Tipo xtetris_bot_move_t
+*   Mossa: tetramino, rotazioni verso destra dalla forma base e colonna più a sinistra
+*/
+typedef struct XtetrisBotMove
+{
+    int piece;          /**< indice del tetramino (da 0 a XTETRIS_BOT_TETS - 1) */
+    int rotation;       /**< rotazioni verso destra (da 0 a 3) */
+    int column;         /**< colonna della cella più a sinistra */
+
+} xtetris_bot_move_t;
+
+/** Tipo xtetris_bot_position_t
+*   Posizione, con la stessa disposizione in memoria dell'inizio dello stato del motore.
+ *  Le celle valgono 0 se vuote, altrimenti sono occupate
+*/
+typedef struct XtetrisBotPosition
+{
+    int fields[XTETRIS_BOT_PLAYERS][XTETRIS_BOT_ROWS][XTETRIS_BOT_COLS];   /**< campi, la riga 0 è in alto */
+    int scores[XTETRIS_BOT_PLAYERS];                                        /**< punteggi */
+    int quantities[XTETRIS_BOT_TETS];                                       /**< tetramini disponibili, condivisi */
+    int players;                                                            /**< giocatori (1 o 2) */
+    int moves;                                                              /**< mosse giocate finora */
+
+} xtetris_bot_position_t;
+
+/** Tipo xtetris_bot_host_t
+*   Funzioni del motore a disposizione del bot, valide finché il bot non viene liberato
+*/
+typedef struct XtetrisBotHost
+{
+    int abi_version;    /**< XTETRIS_BOT_ABI_VERSION del motore */
+
+    /** Elenca le mosse distinte possibili con i tetramini disponibili; restituisce quante sono */
+    int (*legal_moves)(const xtetris_bot_position_t* pos, xtetris_bot_move_t out[XTETRIS_BOT_MAX_MOVES]);
+
+    /** Applica una mossa a una copia del campo di un giocatore; restituisce i punti o -1 se la mossa fa perdere */
+    int (*try_move)(const xtetris_bot_position_t* pos, int player, xtetris_bot_move_t move,
+                    int out[XTETRIS_BOT_ROWS][XTETRIS_BOT_COLS]);
+
+} xtetris_bot_host_t;
+
+/** Versione dell'interfaccia con cui è stato compilato il bot (simbolo xtetris_bot_abi) */
+typedef int (*XtetrisBotAbiFn)(void);
+
+/** Crea un'istanza del bot (simbolo xtetris_bot_init): restituisce 0 se è pronta.
+ *  args è la stringa passata dopo il percorso della libreria (può essere vuota), flags le opzioni */
+typedef int (*XtetrisBotInitFn)(const xtetris_bot_host_t* host, const char* args, void** bot, int* flags);
+
+/** Sceglie la mossa del giocatore player (simbolo xtetris_bot_choose_move): restituisce 0 se è stata scelta */
+typedef int (*XtetrisBotChooseFn)(void* bot, const xtetris_bot_position_t* pos, int player, xtetris_bot_move_t* move);
+
+/** Libera un'istanza del bot (simbolo xtetris_bot_free) */
+typedef void (*XtetrisBotFreeFn)(void* bot);
+
+#endif /*XTETRIS2_BOT_H*/
@@ -0,0 +1,15 @@
+/**
+* @file Clock.c
+* @author Albert Alibeaj
+* @brief File di implementazione dell'orologio monotono
+*/
+
+#include <time.h>
+#include "Clock.h"
+
+double clock_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
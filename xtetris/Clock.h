@@ -0,0 +1,16 @@
+/**
+* @file Clock.h
+* @author Albert Alibeaj
+* @brief Libreria per misurare il tempo trascorso con un orologio monotono
+*/
+
+#ifndef XTETRIS2_CLOCK_H
+#define XTETRIS2_CLOCK_H
+
+/**
+* Tempo corrente di un orologio monotono (non segue le modifiche dell'ora di sistema)
+ * @return secondi trascorsi da un istante fisso
+*/
+double clock_now();
+
+#endif /*XTETRIS2_CLOCK_H*/
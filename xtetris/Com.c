@@ -0,0 +1,347 @@
+/**
+* @file Com.c
+* @author Albert Alibeaj
+* @brief File di implementazione della valutazione delle mosse del computer
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Com.h"
+#include "Moves.h"
+#include "Net.h"
+#include "Sched.h"
+
+/** Tipo com_split_t
+*   Ricerca divisa tra i thread da com_best_move_parallel
+*/
+typedef struct ComSplit
+{
+    int (*field)[FIELD_COLS];           /**< campo su cui cercare */
+    tet_t* tets;                        /**< tetramini disponibili */
+    const com_weights_t* weights;       /**< pesi della valutazione */
+    placements_t moves;                 /**< mosse distinte */
+    double values[PLACEMENTS_MAX];      /**< valutazione di ogni mossa */
+
+} com_split_t;
+
+const net_t* com_net = NULL;        /**< rete usata per valutare le mosse, NULL per la valutazione lineare */
+net_t com_net_file;                 /**< rete caricata da com_net_init */
+com_weights_t com_game_weights;     /**< pesi caricati da com_weights_init */
+int com_game_weights_loaded = 0;    /**< 1 se com_game_weights è stato caricato */
+
+/** Nomi dei pesi nei file, nell'ordine di com_feature_vector */
+const char* const com_weight_names[COM_WEIGHTS] = {
+    "punti", "altezza_totale", "altezza_massima", "irregolarita",
+    "buchi", "transizioni_riga", "transizioni_colonna", "pozzi"
+};
+
+/**
+* Valuta con la rete tutte le mosse che non fanno perdere
+ * @param field campo su cui cercare la mossa
+ * @param tets tetramini disponibili
+ * @param net rete da usare
+ * @param moves mosse distinte
+ * @param best mossa scelta
+ * @param cancel se diverso da NULL, la ricerca si interrompe appena *cancel diventa diverso da 0
+ * @return valutazione della mossa scelta (COM_LOST se tutte fanno perdere o la ricerca è stata interrotta)
+*/
+double com_search_net(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const net_t* net, const placements_t* moves, placement_t* best, const int* cancel);
+
+/**
+* Compito di com_best_move_parallel: valuta una mossa
+ * @param arg puntatore al com_split_t
+ * @param i indice della mossa
+*/
+void com_split_task(void* arg, int i);
+
+void com_use_net(const struct Net* net)
+{
+    com_net = net;
+}
+
+const struct Net* com_net_used()
+{
+    return com_net;
+}
+
+int com_net_init()
+{
+    const char* path = getenv("XTETRIS_NET");
+
+    if(!path || !*path || net_load(&com_net_file, path) != 0)
+        return 0;
+
+    com_use_net(&com_net_file);
+    return 1;
+}
+
+com_weights_t com_default_weights()
+{
+    com_weights_t weights;
+
+    weights.w[0] = 3.4;     /* punti guadagnati */
+    weights.w[1] = -0.5;    /* altezza totale */
+    weights.w[2] = -0.3;    /* altezza massima */
+    weights.w[3] = -0.2;    /* irregolarità */
+    weights.w[4] = -7.9;    /* buchi */
+    weights.w[5] = -3.2;    /* transizioni di riga */
+    weights.w[6] = -9.3;    /* transizioni di colonna */
+    weights.w[7] = -3.4;    /* pozzi */
+
+    return weights;
+}
+
+com_weights_t com_weights()
+{
+    return com_game_weights_loaded ? com_game_weights : com_default_weights();
+}
+
+int com_weights_init()
+{
+    const char* path = getenv("XTETRIS_WEIGHTS");
+
+    if(!path || !*path || com_weights_load(path, &com_game_weights) != 0)
+        return 0;
+
+    com_game_weights_loaded = 1;
+    return 1;
+}
+
+int com_weights_load(const char* path, com_weights_t* weights)
+{
+    FILE* in = fopen(path, "r");
+    char line[256], name[64];
+    int found = 0, i;
+    double value;
+
+    if(!in)
+        return -1;
+
+    while(fgets(line, sizeof(line), in))
+    {
+        if(line[0] == '#' || sscanf(line, "%63s %lf", name, &value) != 2)
+            continue;
+        for(i = 0; i < COM_WEIGHTS; i++)
+            if(strcmp(name, com_weight_names[i]) == 0)
+            {
+                weights->w[i] = value;
+                found |= 1 << i;
+            }
+    }
+    fclose(in);
+
+    return found == (1 << COM_WEIGHTS) - 1 ? 0 : -1;
+}
+
+int com_weights_save(const char* path, const com_weights_t* weights)
+{
+    FILE* out = fopen(path, "w");
+    int i, ok;
+
+    if(!out)
+        return -1;
+
+    fprintf(out, "# pesi della valutazione del computer (XTETRIS_WEIGHTS)\n");
+    for(i = 0; i < COM_WEIGHTS; i++)
+        fprintf(out, "%s %.17g\n", com_weight_names[i], weights->w[i]);
+
+    ok = ferror(out) ? -1 : 0;
+    if(fclose(out) != 0)
+        ok = -1;
+
+    return ok;
+}
+
+void com_feature_vector(const features_t* f, int score, double out[COM_WEIGHTS])
+{
+    out[0] = score;
+    out[1] = f->aggregate_height;
+    out[2] = f->max_height;
+    out[3] = f->bumpiness;
+    out[4] = f->holes;
+    out[5] = f->row_transitions;
+    out[6] = f->col_transitions;
+    out[7] = f->cumulative_wells;
+}
+
+double com_evaluate(int field[FIELD_ROWS][FIELD_COLS], int score, const com_weights_t* weights)
+{
+    features_t f;
+    double v[COM_WEIGHTS];
+    double value = 0;
+    int i;
+
+    if(score < 0)
+        return COM_LOST;
+
+    if(com_net)
+    {
+        short inputs[NET_INPUTS_PAD];
+        float out;
+
+        net_inputs(field, score, inputs);
+        net_forward(com_net, inputs, 1, &out);
+        return out;
+    }
+
+    features_extract(field, &f);
+    com_feature_vector(&f, score, v);
+
+    for(i = 0; i < COM_WEIGHTS; i++)
+        value += weights->w[i] * v[i];
+
+    return value;
+}
+
+int com_try_move(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placement_t p, int result[FIELD_ROWS][FIELD_COLS])
+{
+    int shape[TET_MAX_LEN * TET_MAX_LEN];
+    tet_t tet = tets[p.id];
+
+    /* insert ruota e decrementa il tetramino: si lavora su una copia con una forma propria */
+    tet.shape = shape;
+    memcpy(result, field, sizeof(int) * FIELD_ROWS * FIELD_COLS);
+
+    return insert(result, &tet, p.col, p.rot);
+}
+
+double com_best_move(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const com_weights_t* weights, placement_t* best)
+{
+    return com_search(field, tets, weights, best, NULL);
+}
+
+double com_search(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const com_weights_t* weights, placement_t* best, const int* cancel)
+{
+    placements_t moves;
+    double best_value = COM_LOST;
+    int i;
+
+    placements_gen(tets, &moves);
+    if(moves.count > 0)
+        *best = moves.moves[0];
+
+    if(com_net)
+        return com_search_net(field, tets, com_net, &moves, best, cancel);
+
+    for(i = 0; i < moves.count; i++)
+    {
+        int result[FIELD_ROWS][FIELD_COLS];
+        int score;
+        double value;
+
+        if(cancel && __atomic_load_n(cancel, __ATOMIC_RELAXED))
+            return COM_LOST;
+
+        score = com_try_move(field, tets, moves.moves[i], result);
+        value = com_evaluate(result, score, weights);
+
+        if(value > best_value)
+        {
+            best_value = value;
+            *best = moves.moves[i];
+        }
+    }
+
+    return best_value;
+}
+
+double com_best_move_net(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const struct Net* net, placement_t* best)
+{
+    placements_t moves;
+
+    placements_gen(tets, &moves);
+    if(moves.count > 0)
+        *best = moves.moves[0];
+
+    return com_search_net(field, tets, net, &moves, best, NULL);
+}
+
+double com_search_net(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const net_t* net, const placements_t* moves, placement_t* best, const int* cancel)
+{
+    short* inputs;
+    float* values;
+    int* index;
+    double best_value = COM_LOST;
+    int i, n = 0;
+
+    if(moves->count == 0)
+        return COM_LOST;
+
+    inputs = (short*)malloc(sizeof(short) * NET_INPUTS_PAD * moves->count);
+    values = (float*)malloc(sizeof(float) * moves->count);
+    index = (int*)malloc(sizeof(int) * moves->count);
+
+    /* Prima si preparano gli ingressi di tutte le mosse, poi un solo passaggio sulla rete */
+    for(i = 0; i < moves->count; i++)
+    {
+        int result[FIELD_ROWS][FIELD_COLS];
+        int score;
+
+        if(cancel && __atomic_load_n(cancel, __ATOMIC_RELAXED))
+            break;
+
+        score = com_try_move(field, tets, moves->moves[i], result);
+        if(score < 0)
+            continue;
+
+        net_inputs(result, score, inputs + (size_t)n * NET_INPUTS_PAD);
+        index[n++] = i;
+    }
+
+    if(i == moves->count)
+    {
+        net_forward(net, inputs, n, values);
+        for(i = 0; i < n; i++)
+            if(values[i] > best_value)
+            {
+                best_value = values[i];
+                *best = moves->moves[index[i]];
+            }
+    }
+
+    free(inputs);
+    free(values);
+    free(index);
+
+    return best_value;
+}
+
+void com_split_task(void* arg, int i)
+{
+    com_split_t* split = (com_split_t*)arg;
+    int result[FIELD_ROWS][FIELD_COLS];
+    int score = com_try_move(split->field, split->tets, split->moves.moves[i], result);
+
+    split->values[i] = com_evaluate(result, score, split->weights);
+}
+
+double com_best_move_parallel(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const com_weights_t* weights, placement_t* best)
+{
+    com_split_t split;
+    double best_value = COM_LOST;
+    int i;
+
+    /* La rete valuta già tutte le mosse in un solo passaggio */
+    if(com_net || sched_threads() < 2)
+        return com_best_move(field, tets, weights, best);
+
+    split.field = field;
+    split.tets = tets;
+    split.weights = weights;
+    placements_gen(tets, &split.moves);
+    if(split.moves.count > 0)
+        *best = split.moves.moves[0];
+
+    sched_for(0, split.moves.count, COM_SPLIT_GRAIN, com_split_task, &split);
+
+    /* Stesso ordine e stesso confronto di com_search: a parità vince la prima mossa */
+    for(i = 0; i < split.moves.count; i++)
+        if(split.values[i] > best_value)
+        {
+            best_value = split.values[i];
+            *best = split.moves.moves[i];
+        }
+
+    return best_value;
+}
@@ -0,0 +1,162 @@
+/**
+* @file Com.h
+* @author Albert Alibeaj
+* @brief Libreria che implementa le scelte del computer:
+ * valuta ogni mossa distinta con le caratteristiche del campo risultante
+*/
+
+#ifndef XTETRIS2_COM_H
+#define XTETRIS2_COM_H
+
+#include "Features.h"
+#include "Placements.h"
+
+/** Numero di caratteristiche (e quindi di pesi) usate nella valutazione */
+#define COM_WEIGHTS 8
+
+/** Mosse valutate da ogni compito di com_best_move_parallel */
+#define COM_SPLIT_GRAIN 16
+
+/** Valutazione di una mossa che fa perdere la partita */
+#define COM_LOST (-1e9)
+
+/** Rete neurale (Net.h) */
+struct Net;
+
+/** Tipo com_weights_t
+*   Pesi della valutazione, nell'ordine di com_feature_vector
+*/
+typedef struct ComWeights
+{
+    double w[COM_WEIGHTS];  /**< pesi: punti, altezza totale, altezza massima, irregolarità, buchi, transizioni di riga e di colonna, pozzi */
+
+} com_weights_t;
+
+/**
+* Pesi predefiniti della valutazione
+ * @return pesi da usare se non ne vengono forniti altri
+*/
+com_weights_t com_default_weights();
+
+/**
+* Pesi usati dal computer in partita: quelli caricati da com_weights_init, altrimenti i predefiniti
+ * @return pesi da usare in partita
+*/
+com_weights_t com_weights();
+
+/**
+* Carica i pesi indicati dalla variabile d'ambiente XTETRIS_WEIGHTS (file scritto da com_weights_save
+ * o da <code>xtetris-tune</code>), se presente. Se il file manca o non è valido restano i predefiniti
+ * @return 1 se i pesi sono stati caricati, 0 altrimenti
+*/
+int com_weights_init();
+
+/**
+* Legge i pesi da un file di testo: una riga per peso con nome e valore, nell'ordine che si preferisce;
+ * le righe vuote e quelle che iniziano con '#' vengono ignorate
+ * @param path file da leggere
+ * @param weights pesi da riempire
+ * @return 0 se il file contiene tutti i pesi, -1 altrimenti
+*/
+int com_weights_load(const char* path, com_weights_t* weights);
+
+/**
+* Scrive i pesi in un file di testo leggibile da com_weights_load
+ * @param path file da scrivere
+ * @param weights pesi da salvare
+ * @return 0 se il file è stato scritto, -1 altrimenti
+*/
+int com_weights_save(const char* path, const com_weights_t* weights);
+
+/**
+* Trasforma le caratteristiche di un campo nel vettore valutato dal computer
+ * @param f caratteristiche del campo dopo la mossa
+ * @param score punti guadagnati con la mossa
+ * @param out vettore da riempire, nell'ordine dei pesi
+*/
+void com_feature_vector(const features_t* f, int score, double out[COM_WEIGHTS]);
+
+/**
+* Sceglie la rete neurale usata al posto dei pesi per valutare le mosse (Net.h)
+ * @param net rete caricata, o NULL per tornare alla valutazione lineare
+*/
+void com_use_net(const struct Net* net);
+
+/**
+* Rete neurale usata per valutare le mosse
+ * @return rete scelta con com_use_net, NULL se si usa la valutazione lineare
+*/
+const struct Net* com_net_used();
+
+/**
+* Carica la rete indicata dalla variabile d'ambiente XTETRIS_NET, se presente, e la usa
+ * per valutare le mosse. Se il file manca o non è valido resta la valutazione lineare
+ * @return 1 se la rete è stata caricata, 0 altrimenti
+*/
+int com_net_init();
+
+/**
+* Valuta il campo ottenuto dopo una mossa (con la rete neurale, se ne è stata scelta una)
+ * @param field campo dopo l'inserimento
+ * @param score punti guadagnati con la mossa (negativo se la mossa fa perdere)
+ * @param weights pesi da usare (ignorati se è stata scelta una rete)
+ * @return valutazione, più alta è migliore
+*/
+double com_evaluate(int field[FIELD_ROWS][FIELD_COLS], int score, const com_weights_t* weights);
+
+/**
+* Sceglie la mossa migliore tra tutte quelle distinte per i tetramini disponibili.
+ * Né il campo né i tetramini vengono modificati
+ * @param field campo su cui cercare la mossa
+ * @param tets tetramini disponibili
+ * @param weights pesi della valutazione
+ * @param best mossa scelta
+ * @return valutazione della mossa scelta (COM_LOST se tutte fanno perdere)
+*/
+double com_best_move(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const com_weights_t* weights, placement_t* best);
+
+/**
+* Come com_best_move, ma la ricerca può essere interrotta da un altro thread.
+ * Con una rete neurale tutte le mosse che non fanno perdere vengono valutate in un solo passaggio
+ * @param field campo su cui cercare la mossa
+ * @param tets tetramini disponibili
+ * @param weights pesi della valutazione
+ * @param best mossa scelta
+ * @param cancel se diverso da NULL, la ricerca si interrompe appena *cancel diventa diverso da 0
+ * @return valutazione della mossa scelta, o COM_LOST se la ricerca è stata interrotta
+*/
+double com_search(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const com_weights_t* weights, placement_t* best, const int* cancel);
+
+/**
+* Come com_best_move, ma valuta tutte le mosse con una rete data in un solo passaggio,
+ * indipendentemente da quella scelta con com_use_net (può essere chiamata da più thread insieme)
+ * @param field campo su cui cercare la mossa
+ * @param tets tetramini disponibili (non vengono modificati)
+ * @param net rete caricata (Net.h)
+ * @param best mossa scelta
+ * @return valutazione della mossa scelta (COM_LOST se tutte fanno perdere)
+*/
+double com_best_move_net(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const struct Net* net, placement_t* best);
+
+/**
+* Come com_best_move, ma le mosse iniziali vengono valutate in parallelo dai thread avviati
+ * con sched_start (Sched.h), a blocchi di COM_SPLIT_GRAIN mosse. Sceglie la stessa mossa di com_best_move
+ * @param field campo su cui cercare la mossa
+ * @param tets tetramini disponibili (non vengono modificati)
+ * @param weights pesi della valutazione
+ * @param best mossa scelta
+ * @return valutazione della mossa scelta (COM_LOST se tutte fanno perdere)
+*/
+double com_best_move_parallel(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const com_weights_t* weights, placement_t* best);
+
+/**
+* Applica una mossa a una copia del campo senza modificare i tetramini
+ * @param field campo di partenza
+ * @param tets tetramini disponibili
+ * @param p mossa da provare
+ * @param result campo in cui scrivere il risultato
+ * @return punti guadagnati, o -1 se la mossa fa perdere la partita
+*/
+int com_try_move(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placement_t p, int result[FIELD_ROWS][FIELD_COLS]);
+
+#endif /*XTETRIS2_COM_H*/
@@ -0,0 +1,255 @@
+/**
+* @file EventLog.c
+* @author Albert Alibeaj
+* @brief File di implementazione del registro binario degli eventi di gioco
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "EventLog.h"
+
+/** Record che possono restare in coda prima di essere scartati */
+#define EVENTLOG_QUEUE 4096
+
+unsigned char eventlog_buffers[2][EVENTLOG_QUEUE * EVENTLOG_RECORD_LEN];   /**< coda e blocco in scrittura, scambiati a ogni giro */
+unsigned char* eventlog_queue = eventlog_buffers[0];    /**< record in attesa del thread di scrittura */
+int eventlog_queued;                    /**< record in coda */
+unsigned long eventlog_dropped;         /**< record scartati perchè la coda era piena */
+
+pthread_mutex_t eventlog_lock = PTHREAD_MUTEX_INITIALIZER;  /**< protegge la coda */
+pthread_cond_t eventlog_ready = PTHREAD_COND_INITIALIZER;   /**< segnala nuovi record o la richiesta di terminare */
+pthread_t eventlog_thread;              /**< thread di scrittura */
+int eventlog_enabled = 0;               /**< 1 se il registro è attivo */
+int eventlog_stopping;                  /**< 1 quando il thread di scrittura deve terminare */
+int eventlog_fd;                        /**< file del registro */
+int eventlog_error;                     /**< errno della scrittura fallita che ha disattivato il registro (0 se nessuna) */
+
+unsigned long eventlog_game = 0;        /**< numero della partita in corso */
+unsigned long eventlog_seq = 0;         /**< eventi registrati nella partita in corso */
+
+/**
+* Scrive un blocco di record e lo rende persistente, riprovando le scritture parziali
+ * @param data record da scrivere
+ * @param len byte da scrivere
+ * @return 0 se tutto è stato scritto, altrimenti errno dell'errore
+*/
+int eventlog_write(const unsigned char* data, long len);
+
+/**
+* Funzione eseguita dal thread di scrittura: prende tutta la coda in una volta e la scrive
+ * @param arg non usato
+ * @return sempre NULL
+*/
+void* eventlog_writer(void* arg);
+
+/**
+* Scrive un intero senza segno in little endian
+ * @param out byte da riempire
+ * @param value valore
+ * @param bytes numero di byte
+*/
+void put_le(unsigned char* out, unsigned long value, int bytes)
+{
+    int i;
+    for(i = 0; i < bytes; i++)
+        out[i] = (unsigned char)((value >> (8 * i)) & 0xFF);
+}
+
+/**
+* Legge un intero senza segno in little endian
+ * @param in byte da leggere
+ * @param bytes numero di byte
+ * @return valore letto
+*/
+unsigned long get_le(const unsigned char* in, int bytes)
+{
+    unsigned long value = 0;
+    int i;
+    for(i = bytes - 1; i >= 0; i--)
+        value = (value << 8) | in[i];
+    return value;
+}
+
+void eventlog_encode(const event_record_t* e, unsigned char out[EVENTLOG_RECORD_LEN])
+{
+    memset(out, 0, EVENTLOG_RECORD_LEN);
+    out[0] = (unsigned char)e->type;
+    out[1] = (unsigned char)e->player;
+    out[2] = (unsigned char)e->a;
+    out[3] = (unsigned char)e->b;
+    out[4] = (unsigned char)e->c;
+    put_le(out + 8, (unsigned long)e->value & 0xFFFFFFFFUL, 4);
+    put_le(out + 12, (unsigned long)e->value2 & 0xFFFFFFFFUL, 4);
+    put_le(out + 16, e->game, 4);
+    put_le(out + 20, e->seq, 4);
+    put_le(out + 24, e->time_us, sizeof(unsigned long) < 8 ? sizeof(unsigned long) : 8);
+}
+
+void eventlog_decode(const unsigned char in[EVENTLOG_RECORD_LEN], event_record_t* e)
+{
+    unsigned long v;
+
+    e->type = in[0];
+    e->player = in[1];
+    e->a = in[2];
+    e->b = in[3];
+    e->c = in[4];
+    v = get_le(in + 8, 4);
+    e->value = v & 0x80000000UL ? -(long)(0xFFFFFFFFUL - v) - 1 : (long)v;
+    v = get_le(in + 12, 4);
+    e->value2 = v & 0x80000000UL ? -(long)(0xFFFFFFFFUL - v) - 1 : (long)v;
+    e->game = get_le(in + 16, 4);
+    e->seq = get_le(in + 20, 4);
+    e->time_us = get_le(in + 24, sizeof(unsigned long) < 8 ? sizeof(unsigned long) : 8);
+}
+
+int eventlog_write(const unsigned char* data, long len)
+{
+    while(len > 0)
+    {
+        ssize_t n = write(eventlog_fd, data, len);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return n < 0 ? errno : EIO;
+        data += n;
+        len -= n;
+    }
+    return fdatasync(eventlog_fd) ? errno : 0;
+}
+
+void* eventlog_writer(void* arg)
+{
+    int current = 0, error;
+    (void)arg;
+
+    pthread_mutex_lock(&eventlog_lock);
+    for(;;)
+    {
+        unsigned char* batch;
+        int count;
+
+        while(!eventlog_queued && !eventlog_stopping)
+            pthread_cond_wait(&eventlog_ready, &eventlog_lock);
+        if(!eventlog_queued && eventlog_stopping)
+            break;
+
+        /* Si scambiano i buffer: il gioco continua ad accodare mentre si scrive */
+        batch = eventlog_queue;
+        count = eventlog_queued;
+        current = 1 - current;
+        eventlog_queue = eventlog_buffers[current];
+        eventlog_queued = 0;
+        pthread_mutex_unlock(&eventlog_lock);
+
+        error = eventlog_write(batch, (long)count * EVENTLOG_RECORD_LEN);
+
+        pthread_mutex_lock(&eventlog_lock);
+        if(error)
+        {
+            /* Un registro con dei buchi non è più affidabile: si smette di scrivere */
+            eventlog_error = error;
+            eventlog_queued = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&eventlog_lock);
+
+    return NULL;
+}
+
+void eventlog_init()
+{
+    const char* path = getenv("XTETRIS_EVENT_LOG");
+
+    if(eventlog_enabled || !path || !*path)
+        return;
+
+    eventlog_fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if(eventlog_fd < 0)
+        return;
+    if(lseek(eventlog_fd, 0, SEEK_END) == 0 && (eventlog_error = eventlog_write((const unsigned char*)EVENTLOG_MAGIC, 8)))
+    {
+        fprintf(stderr, "xtetris: registro degli eventi non scritto: %s\n", strerror(eventlog_error));
+        close(eventlog_fd);
+        return;
+    }
+
+    eventlog_stopping = 0;
+    eventlog_error = 0;
+    if(pthread_create(&eventlog_thread, NULL, eventlog_writer, NULL) != 0)
+    {
+        close(eventlog_fd);
+        return;
+    }
+    eventlog_enabled = 1;
+}
+
+void eventlog_stop()
+{
+    if(!eventlog_enabled)
+        return;
+
+    pthread_mutex_lock(&eventlog_lock);
+    eventlog_stopping = 1;
+    pthread_cond_signal(&eventlog_ready);
+    pthread_mutex_unlock(&eventlog_lock);
+
+    pthread_join(eventlog_thread, NULL);
+    close(eventlog_fd);
+    eventlog_enabled = 0;
+
+    if(eventlog_dropped)
+        fprintf(stderr, "xtetris: %lu eventi non registrati (coda piena)\n", eventlog_dropped);
+    if(eventlog_error)
+        fprintf(stderr, "xtetris: registro degli eventi interrotto: %s\n", strerror(eventlog_error));
+}
+
+void eventlog_add(event_type_t type, int player, int a, int b, int c, long value, long value2)
+{
+    event_record_t e;
+    struct timeval now;
+
+    if(!eventlog_enabled)
+        return;
+
+    gettimeofday(&now, NULL);
+    e.type = type;
+    e.player = player;
+    e.a = a;
+    e.b = b;
+    e.c = c;
+    e.value = value;
+    e.value2 = value2;
+    e.game = eventlog_game;
+    e.seq = eventlog_seq++;
+    e.time_us = (unsigned long)now.tv_sec * 1000000UL + (unsigned long)now.tv_usec;
+
+    pthread_mutex_lock(&eventlog_lock);
+    /* Dopo una scrittura fallita il registro è disattivato: il messaggio arriva con eventlog_stop */
+    if(!eventlog_error)
+    {
+        if(eventlog_queued < EVENTLOG_QUEUE)
+        {
+            eventlog_encode(&e, eventlog_queue + eventlog_queued * EVENTLOG_RECORD_LEN);
+            eventlog_queued++;
+            pthread_cond_signal(&eventlog_ready);
+        }
+        else
+            eventlog_dropped++;
+    }
+    pthread_mutex_unlock(&eventlog_lock);
+}
+
+void eventlog_game_start(int mode)
+{
+    eventlog_game++;
+    eventlog_seq = 0;
+    eventlog_add(EVENT_GAME_START, 0, mode, 0, 0, (long)getpid(), 0);
+}
@@ -0,0 +1,102 @@
+/**
+* @file EventLog.h
+* @author Albert Alibeaj
+* @brief Libreria che registra gli eventi delle partite in un file binario in sola aggiunta.
+ * Il gioco accoda gli eventi in memoria; un thread separato li scrive a blocchi
+ * e li rende persistenti con fdatasync, così il turno non attende mai il disco.
+ * Il registro è attivo solo se la variabile d'ambiente XTETRIS_EVENT_LOG contiene il file da usare.
+ *
+ * Formato: il file inizia con gli 8 byte EVENTLOG_MAGIC, seguiti da record di EVENTLOG_RECORD_LEN byte.
+ * Ogni record, con interi little endian, contiene: tipo (1 byte), giocatore (1), a (1), b (1), c (1),
+ * 3 byte a zero, value (4, con segno), value2 (4, con segno), numero della partita (4),
+ * numero dell'evento nella partita (4), microsecondi dal 1970 (8).
+ * xtetris-events stampa il registro in chiaro
+*/
+
+#ifndef XTETRIS2_EVENTLOG_H
+#define XTETRIS2_EVENTLOG_H
+
+/** Intestazione del file */
+#define EVENTLOG_MAGIC "XTEVLOG1"
+/** Byte di ogni record */
+#define EVENTLOG_RECORD_LEN 32
+
+/** Tipi di evento e significato dei campi */
+typedef enum EventType
+{
+    EVENT_GAME_START = 1,   /**< a: modalità (0 singleplayer, 1 multiplayer, 2 contro il computer), value: pid del processo */
+    EVENT_MOVE,             /**< a: tetramino, b: rotazione, c: colonna, value: punti guadagnati (-1 se perde) */
+    EVENT_ATTACK,           /**< giocatore che attacca, a: righe invertite all'avversario */
+    EVENT_GAME_OVER         /**< a: motivo (event_end_t), b: giocatore uscito, giocatore: vincitore (0 se nessuno), value e value2: punteggi */
+
+} event_type_t;
+
+/** Motivi della fine di una partita */
+typedef enum EventEnd
+{
+    EVENT_END_PIECES = 1,   /**< tetramini terminati */
+    EVENT_END_LOST,         /**< un giocatore ha perso */
+    EVENT_END_BOTH_LOST,    /**< entrambi i giocatori hanno perso nello stesso turno */
+    EVENT_END_EXIT          /**< un giocatore è uscito dalla partita */
+
+} event_end_t;
+
+/** Tipo event_record_t
+*   Evento decodificato
+*/
+typedef struct EventRecord
+{
+    int type;               /**< tipo di evento (event_type_t) */
+    int player;             /**< giocatore a cui si riferisce l'evento */
+    int a, b, c;            /**< campi che dipendono dal tipo */
+    long value, value2;     /**< campi che dipendono dal tipo */
+    unsigned long game;     /**< numero della partita dall'avvio del programma */
+    unsigned long seq;      /**< numero dell'evento nella partita */
+    unsigned long time_us;  /**< microsecondi dal 1970 */
+
+} event_record_t;
+
+/**
+* Avvia il registro se XTETRIS_EVENT_LOG è impostata, altrimenti non fa nulla
+*/
+void eventlog_init();
+
+/**
+* Scrive gli eventi ancora in coda e ferma il thread di scrittura.
+ * Segnala su stderr gli eventi scartati e la scrittura fallita che ha disattivato il registro
+*/
+void eventlog_stop();
+
+/**
+* Registra un evento. Non fa I/O: se la coda è piena l'evento viene scartato e contato
+ * @param type tipo di evento
+ * @param player giocatore
+ * @param a campo a
+ * @param b campo b
+ * @param c campo c
+ * @param value campo value
+ * @param value2 campo value2
+*/
+void eventlog_add(event_type_t type, int player, int a, int b, int c, long value, long value2);
+
+/**
+* Registra l'inizio di una partita, che riceve un nuovo numero
+ * @param mode modalità di gioco
+*/
+void eventlog_game_start(int mode);
+
+/**
+* Codifica un evento nel formato del file
+ * @param e evento
+ * @param out EVENTLOG_RECORD_LEN byte da riempire
+*/
+void eventlog_encode(const event_record_t* e, unsigned char out[EVENTLOG_RECORD_LEN]);
+
+/**
+* Decodifica un record del file
+ * @param in EVENTLOG_RECORD_LEN byte letti dal file
+ * @param e evento da riempire
+*/
+void eventlog_decode(const unsigned char in[EVENTLOG_RECORD_LEN], event_record_t* e);
+
+#endif /*XTETRIS2_EVENTLOG_H*/
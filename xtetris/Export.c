@@ -0,0 +1,521 @@
+/**
+* @file Export.c
+* @author Albert Alibeaj
+* @brief File di implementazione dell'esportazione a colonne delle partite simulate
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <zlib.h>
+#include "Export.h"
+#include "Clock.h"
+
+/** Byte dell'intestazione di un blocco */
+#define EXPORT_CHUNK_HEADER (4 + 8 * EXPORT_COLUMNS)
+
+/** Tipo export_buffer_t
+*   Array di byte che cresce quando serve
+*/
+typedef struct ExportBuffer
+{
+    unsigned char* data;        /**< byte scritti */
+    size_t len;                 /**< byte usati */
+    size_t cap;                 /**< byte allocati */
+
+} export_buffer_t;
+
+FILE* export_file;                              /**< file in scrittura */
+int export_level;                               /**< livello di compressione */
+unsigned long export_chunk_rows;                /**< righe di ogni blocco */
+int export_failed;                              /**< 1 se una scrittura o una compressione è fallita */
+
+sim_game_t** export_queue;                      /**< coda circolare delle partite consegnate */
+int export_queue_cap;                           /**< posti nella coda */
+int export_queue_head;                          /**< prossima partita da scrivere */
+int export_queue_count;                         /**< partite in coda */
+int export_closing;                             /**< 1 quando il thread di scrittura deve terminare */
+pthread_mutex_t export_lock = PTHREAD_MUTEX_INITIALIZER;    /**< protegge coda e contatori di attesa */
+pthread_cond_t export_not_empty = PTHREAD_COND_INITIALIZER; /**< segnala una partita in coda o la chiusura */
+pthread_cond_t export_not_full = PTHREAD_COND_INITIALIZER;  /**< segnala un posto libero nella coda */
+pthread_t export_thread;                        /**< thread di scrittura */
+
+export_stats_t export_totals;                   /**< contatori dell'esportazione in corso */
+export_buffer_t export_columns[EXPORT_COLUMNS]; /**< colonne del blocco in preparazione */
+export_buffer_t export_packed[EXPORT_COLUMNS];  /**< colonne compresse del blocco da scrivere */
+unsigned long export_rows;                      /**< righe del blocco in preparazione */
+unsigned long export_last_game;                 /**< partita dell'ultima riga del blocco in preparazione */
+
+/**
+* Si assicura che un buffer abbia spazio per altri byte
+ * @param b buffer
+ * @param extra byte da aggiungere
+*/
+void export_reserve(export_buffer_t* b, size_t extra);
+
+/**
+* Aggiunge un intero senza segno in formato varint
+ * @param b buffer
+ * @param value valore
+*/
+void export_put_varint(export_buffer_t* b, unsigned long value);
+
+/**
+* Aggiunge un intero con segno in formato varint zigzag
+ * @param b buffer
+ * @param value valore
+*/
+void export_put_signed(export_buffer_t* b, long value);
+
+/**
+* Legge un varint
+ * @param p posizione di lettura, avanzata dopo il valore
+ * @param end fine dei dati
+ * @param value valore letto
+ * @return 0 se il valore è stato letto, -1 se i dati sono finiti
+*/
+int export_get_varint(const unsigned char** p, const unsigned char* end, unsigned long* value);
+
+/**
+* Legge un varint zigzag
+ * @param p posizione di lettura, avanzata dopo il valore
+ * @param end fine dei dati
+ * @param value valore letto
+ * @return 0 se il valore è stato letto, -1 se i dati sono finiti
+*/
+int export_get_signed(const unsigned char** p, const unsigned char* end, long* value);
+
+/**
+* Scrive un intero a 32 bit little endian
+ * @param out 4 byte da riempire
+ * @param value valore
+*/
+void export_put32(unsigned char* out, unsigned long value);
+
+/**
+* Legge un intero a 32 bit little endian
+ * @param in 4 byte da leggere
+ * @return valore
+*/
+unsigned long export_get32(const unsigned char* in);
+
+/**
+* Aggiunge le mosse di una partita alle colonne, scrivendo i blocchi che si riempiono
+ * @param game partita
+*/
+void export_add_game(const sim_game_t* game);
+
+/**
+* Comprime e scrive il blocco in preparazione, se non è vuoto
+*/
+void export_flush_chunk();
+
+/**
+* Funzione eseguita dal thread di scrittura
+ * @param arg non usato
+ * @return sempre NULL
+*/
+void* export_writer(void* arg);
+
+void export_reserve(export_buffer_t* b, size_t extra)
+{
+    if(b->len + extra <= b->cap)
+        return;
+    b->cap = b->cap ? b->cap * 2 : 65536;
+    while(b->cap < b->len + extra)
+        b->cap *= 2;
+    b->data = (unsigned char*)realloc(b->data, b->cap);
+}
+
+void export_put_varint(export_buffer_t* b, unsigned long value)
+{
+    export_reserve(b, 10);
+    while(value >= 0x80)
+    {
+        b->data[b->len++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    b->data[b->len++] = (unsigned char)value;
+}
+
+void export_put_signed(export_buffer_t* b, long value)
+{
+    export_put_varint(b, value >= 0 ? (unsigned long)value << 1 : (((unsigned long)-(value + 1)) << 1) | 1);
+}
+
+int export_get_varint(const unsigned char** p, const unsigned char* end, unsigned long* value)
+{
+    unsigned long v = 0;
+    int shift = 0;
+
+    while(*p < end && shift < 64)
+    {
+        unsigned char c = *(*p)++;
+        v |= (unsigned long)(c & 0x7F) << shift;
+        if(!(c & 0x80))
+        {
+            *value = v;
+            return 0;
+        }
+        shift += 7;
+    }
+    return -1;
+}
+
+int export_get_signed(const unsigned char** p, const unsigned char* end, long* value)
+{
+    unsigned long v;
+
+    if(export_get_varint(p, end, &v) != 0)
+        return -1;
+    *value = v & 1 ? -(long)(v >> 1) - 1 : (long)(v >> 1);
+    return 0;
+}
+
+void export_put32(unsigned char* out, unsigned long value)
+{
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+}
+
+unsigned long export_get32(const unsigned char* in)
+{
+    return (unsigned long)in[0] | (unsigned long)in[1] << 8 | (unsigned long)in[2] << 16 | (unsigned long)in[3] << 24;
+}
+
+void export_add_game(const sim_game_t* game)
+{
+    int i, j;
+
+    for(i = 0; i < game->count; i++)
+    {
+        const sim_sample_t* s = &game->samples[i];
+        export_buffer_t* c = export_columns;
+        int prev = 0;
+
+        export_put_varint(&c[EXPORT_COL_GAME], game->id - export_last_game);
+        export_last_game = game->id;
+
+        export_reserve(&c[EXPORT_COL_PLAYER], 1);
+        c[EXPORT_COL_PLAYER].data[c[EXPORT_COL_PLAYER].len++] = (unsigned char)s->player;
+
+        export_reserve(&c[EXPORT_COL_POSITION], PACK_LEN);
+        memcpy(c[EXPORT_COL_POSITION].data + c[EXPORT_COL_POSITION].len, s->position, PACK_LEN);
+        c[EXPORT_COL_POSITION].len += PACK_LEN;
+
+        export_put_varint(&c[EXPORT_COL_LEGAL_COUNT], (unsigned long)s->legal_count);
+        for(j = 0; j < s->legal_count; j++)
+        {
+            export_put_signed(&c[EXPORT_COL_LEGAL], (long)s->legal[j] - prev);
+            prev = s->legal[j];
+        }
+
+        export_put_varint(&c[EXPORT_COL_CHOSEN], s->chosen);
+        export_put_signed(&c[EXPORT_COL_SCORE], s->score);
+        export_put_signed(&c[EXPORT_COL_RESULT], s->result);
+
+        export_totals.rows++;
+        if(++export_rows >= export_chunk_rows)
+            export_flush_chunk();
+    }
+    export_totals.games++;
+}
+
+void export_flush_chunk()
+{
+    unsigned char header[EXPORT_CHUNK_HEADER];
+    int i;
+
+    if(!export_rows)
+        return;
+
+    export_put32(header, export_rows);
+    for(i = 0; i < EXPORT_COLUMNS; i++)
+    {
+        uLongf len = compressBound((uLong)export_columns[i].len);
+
+        export_packed[i].len = 0;
+        export_reserve(&export_packed[i], len);
+        if(compress2(export_packed[i].data, &len, export_columns[i].data, (uLong)export_columns[i].len, export_level) != Z_OK)
+            export_failed = 1;
+        export_packed[i].len = len;
+
+        export_put32(header + 4 + 8 * i, export_columns[i].len);
+        export_put32(header + 8 + 8 * i, len);
+        export_totals.raw_bytes += export_columns[i].len;
+    }
+
+    if(fwrite(header, sizeof(header), 1, export_file) != 1)
+        export_failed = 1;
+    export_totals.file_bytes += sizeof(header);
+    for(i = 0; i < EXPORT_COLUMNS; i++)
+    {
+        if(export_packed[i].len && fwrite(export_packed[i].data, export_packed[i].len, 1, export_file) != 1)
+            export_failed = 1;
+        export_totals.file_bytes += export_packed[i].len;
+        export_columns[i].len = 0;
+    }
+
+    export_totals.chunks++;
+    export_rows = 0;
+    export_last_game = 0;
+}
+
+void* export_writer(void* arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&export_lock);
+    for(;;)
+    {
+        sim_game_t* game;
+        double start;
+
+        while(!export_queue_count && !export_closing)
+            pthread_cond_wait(&export_not_empty, &export_lock);
+        if(!export_queue_count)
+            break;
+
+        game = export_queue[export_queue_head];
+        export_queue_head = (export_queue_head + 1) % export_queue_cap;
+        export_queue_count--;
+        pthread_cond_signal(&export_not_full);
+        pthread_mutex_unlock(&export_lock);
+
+        start = clock_now();
+        export_add_game(game);
+        free(game);
+        export_totals.writer_seconds += clock_now() - start;
+
+        pthread_mutex_lock(&export_lock);
+    }
+    pthread_mutex_unlock(&export_lock);
+
+    return NULL;
+}
+
+int export_open(const char* path, int level, unsigned long chunk_rows, int queue)
+{
+    export_file = fopen(path, "wb");
+    if(!export_file)
+        return -1;
+    if(fwrite(EXPORT_MAGIC, 8, 1, export_file) != 1)
+    {
+        fclose(export_file);
+        return -1;
+    }
+
+    memset(&export_totals, 0, sizeof(export_totals));
+    export_totals.file_bytes = 8;
+    export_level = level;
+    export_chunk_rows = chunk_rows ? chunk_rows : EXPORT_CHUNK_ROWS;
+    export_failed = 0;
+    export_rows = 0;
+    export_last_game = 0;
+
+    export_queue_cap = queue > 0 ? queue : EXPORT_QUEUE;
+    export_queue = (sim_game_t**)malloc(sizeof(sim_game_t*) * export_queue_cap);
+    export_queue_head = export_queue_count = 0;
+    export_closing = 0;
+
+    if(pthread_create(&export_thread, NULL, export_writer, NULL) != 0)
+    {
+        free(export_queue);
+        fclose(export_file);
+        return -1;
+    }
+    return 0;
+}
+
+void export_push(sim_game_t* game)
+{
+    pthread_mutex_lock(&export_lock);
+    if(export_queue_count == export_queue_cap)
+    {
+        double start = clock_now();
+        while(export_queue_count == export_queue_cap)
+            pthread_cond_wait(&export_not_full, &export_lock);
+        export_totals.wait_seconds += clock_now() - start;
+    }
+
+    export_queue[(export_queue_head + export_queue_count) % export_queue_cap] = game;
+    export_queue_count++;
+    pthread_cond_signal(&export_not_empty);
+    pthread_mutex_unlock(&export_lock);
+}
+
+int export_close(export_stats_t* stats)
+{
+    int i;
+
+    pthread_mutex_lock(&export_lock);
+    export_closing = 1;
+    pthread_cond_signal(&export_not_empty);
+    pthread_mutex_unlock(&export_lock);
+    pthread_join(export_thread, NULL);
+
+    export_flush_chunk();
+    if(fclose(export_file) != 0)
+        export_failed = 1;
+    free(export_queue);
+    for(i = 0; i < EXPORT_COLUMNS; i++)
+    {
+        free(export_columns[i].data);
+        free(export_packed[i].data);
+        memset(&export_columns[i], 0, sizeof(export_buffer_t));
+        memset(&export_packed[i], 0, sizeof(export_buffer_t));
+    }
+
+    if(stats)
+        *stats = export_totals;
+    return export_failed ? -1 : 0;
+}
+
+int export_read_header(FILE* in)
+{
+    char magic[8];
+    return fread(magic, 8, 1, in) == 1 && memcmp(magic, EXPORT_MAGIC, 8) == 0 ? 0 : -1;
+}
+
+int export_read_chunk(FILE* in, export_chunk_t* chunk)
+{
+    unsigned char header[EXPORT_CHUNK_HEADER];
+    unsigned char* raw[EXPORT_COLUMNS];
+    unsigned long raw_len[EXPORT_COLUMNS];
+    const unsigned char *p, *end;
+    unsigned long rows, i, game = 0, legal_total = 0;
+    size_t got;
+    int c, ok = 0;
+
+    memset(chunk, 0, sizeof(*chunk));
+    got = fread(header, 1, sizeof(header), in);
+    if(got == 0)
+        return 0;
+    if(got != sizeof(header))
+        return -1;
+    rows = export_get32(header);
+
+    /* Decompressione delle colonne */
+    for(c = 0; c < EXPORT_COLUMNS; c++)
+    {
+        unsigned long comp_len = export_get32(header + 8 + 8 * c);
+        unsigned char* comp = (unsigned char*)malloc(comp_len ? comp_len : 1);
+        uLongf len;
+
+        raw_len[c] = export_get32(header + 4 + 8 * c);
+        raw[c] = (unsigned char*)malloc(raw_len[c] ? raw_len[c] : 1);
+        len = raw_len[c];
+        if(fread(comp, 1, comp_len, in) != comp_len ||
+           uncompress(raw[c], &len, comp, comp_len) != Z_OK || len != raw_len[c])
+            ok = -1;
+        free(comp);
+    }
+    if(ok == 0 && raw_len[EXPORT_COL_PLAYER] != rows)
+        ok = -1;
+    if(ok == 0 && raw_len[EXPORT_COL_POSITION] != rows * PACK_LEN)
+        ok = -1;
+
+    if(ok == 0)
+    {
+        chunk->rows = rows;
+        chunk->game = (unsigned long*)malloc(sizeof(unsigned long) * rows);
+        chunk->player = raw[EXPORT_COL_PLAYER];
+        chunk->positions = raw[EXPORT_COL_POSITION];
+        raw[EXPORT_COL_PLAYER] = raw[EXPORT_COL_POSITION] = NULL;
+        chunk->legal_start = (unsigned long*)malloc(sizeof(unsigned long) * (rows + 1));
+        chunk->chosen = (unsigned short*)malloc(sizeof(unsigned short) * rows);
+        chunk->score = (int*)malloc(sizeof(int) * rows);
+        chunk->result = (int*)malloc(sizeof(int) * rows);
+
+        /* Colonne a lunghezza variabile: numero di partita, mosse possibili, scelta, punti, esito */
+        p = raw[EXPORT_COL_LEGAL_COUNT];
+        end = p + raw_len[EXPORT_COL_LEGAL_COUNT];
+        for(i = 0; i < rows && ok == 0; i++)
+        {
+            unsigned long n;
+            chunk->legal_start[i] = legal_total;
+            if((ok = export_get_varint(&p, end, &n)) == 0)
+                legal_total += n;
+        }
+        chunk->legal_start[rows] = legal_total;
+        /* Ogni mossa possibile occupa almeno un byte: un conteggio più grande viene da un blocco corrotto */
+        if(ok == 0 && legal_total > raw_len[EXPORT_COL_LEGAL])
+            ok = -1;
+        chunk->legal = (unsigned short*)malloc(sizeof(unsigned short) * (ok == 0 && legal_total ? legal_total : 1));
+
+        p = raw[EXPORT_COL_LEGAL];
+        end = p + raw_len[EXPORT_COL_LEGAL];
+        for(i = 0; i < rows && ok == 0; i++)
+        {
+            unsigned long k;
+            long prev = 0, d;
+            for(k = chunk->legal_start[i]; k < chunk->legal_start[i + 1] && ok == 0; k++)
+            {
+                if((ok = export_get_signed(&p, end, &d)) == 0)
+                {
+                    prev += d;
+                    chunk->legal[k] = (unsigned short)prev;
+                }
+            }
+        }
+
+        for(c = EXPORT_COL_GAME; c < EXPORT_COLUMNS && ok == 0; c++)
+        {
+            if(c == EXPORT_COL_PLAYER || c == EXPORT_COL_POSITION || c == EXPORT_COL_LEGAL_COUNT || c == EXPORT_COL_LEGAL)
+                continue;
+            p = raw[c];
+            end = p + raw_len[c];
+            for(i = 0; i < rows && ok == 0; i++)
+            {
+                unsigned long u;
+                long v;
+                if(c == EXPORT_COL_GAME)
+                {
+                    if((ok = export_get_varint(&p, end, &u)) == 0)
+                    {
+                        game += u;
+                        chunk->game[i] = game;
+                    }
+                }
+                else if(c == EXPORT_COL_CHOSEN)
+                {
+                    if((ok = export_get_varint(&p, end, &u)) == 0)
+                        chunk->chosen[i] = (unsigned short)u;
+                }
+                else
+                {
+                    if((ok = export_get_signed(&p, end, &v)) != 0)
+                        break;
+                    if(c == EXPORT_COL_SCORE)
+                        chunk->score[i] = (int)v;
+                    else
+                        chunk->result[i] = (int)v;
+                }
+            }
+        }
+    }
+
+    for(c = 0; c < EXPORT_COLUMNS; c++)
+        free(raw[c]);
+    if(ok != 0)
+    {
+        export_chunk_free(chunk);
+        return -1;
+    }
+    return 1;
+}
+
+void export_chunk_free(export_chunk_t* chunk)
+{
+    free(chunk->game);
+    free(chunk->player);
+    free(chunk->positions);
+    free(chunk->legal_start);
+    free(chunk->legal);
+    free(chunk->chosen);
+    free(chunk->score);
+    free(chunk->result);
+    memset(chunk, 0, sizeof(*chunk));
+}
@@ -0,0 +1,123 @@
+/**
+* @file Export.h
+* @author Albert Alibeaj
+* @brief Libreria che salva le mosse delle partite simulate in un file a colonne, diviso in blocchi
+ * compressi con zlib, da usare per allenare modelli che ordinano le mosse.
+ *
+ * I thread che simulano consegnano le partite con export_push a una coda limitata; un thread
+ * di scrittura le divide in colonne, comprime ogni blocco e lo scrive, così la compressione
+ * non rallenta la simulazione. Se la coda è piena chi consegna attende (e il tempo viene contato).
+ *
+ * Formato (interi little endian): il file inizia con EXPORT_MAGIC, seguito da blocchi composti da
+ * righe (4 byte), poi per ogni colonna i byte originali (4) e compressi (4), poi i dati compressi
+ * delle colonne nell'ordine di export_column_t. Ogni riga è una mossa. Le colonne codificate
+ * come varint usano 7 bit per byte, con il bit alto a 1 se seguono altri byte; i valori
+ * con segno sono prima trasformati in zigzag (0, -1, 1, -2... diventano 0, 1, 2, 3...)
+*/
+
+#ifndef XTETRIS2_EXPORT_H
+#define XTETRIS2_EXPORT_H
+
+#include <stdio.h>
+#include "Sim.h"
+
+/** Intestazione del file */
+#define EXPORT_MAGIC "XTEXPRT1"
+/** Righe predefinite di un blocco */
+#define EXPORT_CHUNK_ROWS 65536
+/** Partite predefinite nella coda tra simulazione e scrittura */
+#define EXPORT_QUEUE 64
+
+/** Colonne di un blocco */
+typedef enum ExportColumn
+{
+    EXPORT_COL_GAME,        /**< numero della partita: varint della differenza con la riga precedente */
+    EXPORT_COL_PLAYER,      /**< giocatore che muove: 1 byte */
+    EXPORT_COL_POSITION,    /**< posizione prima della mossa: PACK_LEN byte (Pack.h) */
+    EXPORT_COL_LEGAL_COUNT, /**< numero di mosse possibili: varint */
+    EXPORT_COL_LEGAL,       /**< codici delle mosse possibili (Sim.h): per ogni riga, varint zigzag delle differenze */
+    EXPORT_COL_CHOSEN,      /**< codice della mossa scelta: varint */
+    EXPORT_COL_SCORE,       /**< punti guadagnati con la mossa: varint zigzag */
+    EXPORT_COL_RESULT,      /**< esito finale per chi muove (1, 0, -1): varint zigzag */
+    EXPORT_COLUMNS          /**< numero di colonne */
+
+} export_column_t;
+
+/** Tipo export_stats_t
+*   Contatori di un'esportazione
+*/
+typedef struct ExportStats
+{
+    unsigned long games;        /**< partite scritte */
+    unsigned long rows;         /**< mosse scritte */
+    unsigned long chunks;       /**< blocchi scritti */
+    double raw_bytes;           /**< byte delle colonne prima della compressione */
+    double file_bytes;          /**< byte scritti nel file */
+    double wait_seconds;        /**< tempo totale in cui chi consegna ha atteso una coda piena */
+    double writer_seconds;      /**< tempo in cui il thread di scrittura ha lavorato */
+
+} export_stats_t;
+
+/** Tipo export_chunk_t
+*   Blocco letto da un file, con le colonne decodificate
+*/
+typedef struct ExportChunk
+{
+    unsigned long rows;         /**< righe del blocco */
+    unsigned long* game;        /**< numero della partita */
+    unsigned char* player;      /**< giocatore che muove */
+    unsigned char* positions;   /**< posizioni, PACK_LEN byte per riga */
+    unsigned long* legal_start; /**< per ogni riga, primo indice in legal (rows + 1 elementi) */
+    unsigned short* legal;      /**< codici delle mosse possibili di tutte le righe */
+    unsigned short* chosen;     /**< mossa scelta */
+    int* score;                 /**< punti guadagnati */
+    int* result;                /**< esito finale */
+
+} export_chunk_t;
+
+/**
+* Apre il file e avvia il thread di scrittura
+ * @param path file da creare
+ * @param level livello di compressione zlib (da 1 a 9)
+ * @param chunk_rows righe di ogni blocco
+ * @param queue partite che possono restare in coda
+ * @return 0 se l'esportazione è partita, -1 altrimenti
+*/
+int export_open(const char* path, int level, unsigned long chunk_rows, int queue);
+
+/**
+* Consegna una partita al thread di scrittura, attendendo se la coda è piena.
+ * Può essere chiamata da più thread insieme
+ * @param game partita allocata con malloc, che verrà liberata dopo la scrittura
+*/
+void export_push(sim_game_t* game);
+
+/**
+* Scrive le partite ancora in coda, ferma il thread di scrittura e chiude il file
+ * @param stats contatori da riempire (può essere NULL)
+ * @return 0 se tutto è stato scritto, -1 se c'è stato un errore
+*/
+int export_close(export_stats_t* stats);
+
+/**
+* Controlla l'intestazione di un file aperto in lettura
+ * @param in file posizionato all'inizio
+ * @return 0 se il file è un'esportazione, -1 altrimenti
+*/
+int export_read_header(FILE* in);
+
+/**
+* Legge e decodifica il blocco successivo
+ * @param in file posizionato all'inizio di un blocco
+ * @param chunk blocco da riempire (le colonne vanno liberate con export_chunk_free)
+ * @return 1 se è stato letto un blocco, 0 a fine file, -1 se il file è danneggiato
+*/
+int export_read_chunk(FILE* in, export_chunk_t* chunk);
+
+/**
+* Libera le colonne di un blocco letto
+ * @param chunk blocco letto con export_read_chunk
+*/
+void export_chunk_free(export_chunk_t* chunk);
+
+#endif /*XTETRIS2_EXPORT_H*/
@@ -0,0 +1,277 @@
+/**
+* @file Features.c
+* @author Albert Alibeaj
+* @brief File di implementazione dell'estrazione delle caratteristiche del campo,
+ * con versioni vettoriali (AVX2, SSE2) e versione scalare scelte a runtime
+*/
+
+#include "Features.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FEATURES_X86
+#include <immintrin.h>
+#endif
+
+/** Numero di celle del campo */
+#define FIELD_CELLS (FIELD_ROWS * FIELD_COLS)
+/** Parole da 32 bit necessarie per un bit per ogni cella del campo */
+#define FIELD_WORDS ((FIELD_CELLS + 31) / 32)
+
+/** Tipo della funzione che calcola l'occupazione del campo, un bit per cella in ordine di memoria */
+typedef void (*occupancy_fn)(const int* cells, unsigned int words[FIELD_WORDS]);
+
+/**
+* Versione scalare del calcolo dell'occupazione
+ * @param cells celle del campo in ordine di memoria
+ * @param words parole in cui scrivere un bit per cella
+*/
+void occupancy_scalar(const int* cells, unsigned int words[FIELD_WORDS]);
+
+/**
+* Sceglie l'implementazione dell'occupazione in base alla CPU (solo alla prima chiamata)
+ * @return funzione da usare
+*/
+occupancy_fn occupancy_select();
+
+/**
+* Ricompone le maschere delle righe a partire dai bit delle celle
+ * @param words un bit per cella in ordine di memoria
+ * @param rows maschere delle righe da riempire
+*/
+void words_to_rows(const unsigned int words[FIELD_WORDS], unsigned int rows[FIELD_ROWS]);
+
+/**
+* Conta i bit accesi di una maschera
+ * @param x maschera da controllare
+ * @return numero di bit accesi
+*/
+int bit_count(unsigned int x)
+{
+#ifdef __GNUC__
+    return __builtin_popcount(x);
+#else
+    int n = 0;
+    for(; x; x &= x - 1)
+        n++;
+    return n;
+#endif
+}
+
+/**
+* Indice del bit acceso meno significativo di una maschera
+ * @param x maschera da controllare (diversa da 0)
+ * @return indice del primo bit acceso
+*/
+int bit_index(unsigned int x)
+{
+#ifdef __GNUC__
+    return __builtin_ctz(x);
+#else
+    int n = 0;
+    for(; !(x & 1u); x >>= 1)
+        n++;
+    return n;
+#endif
+}
+
+occupancy_fn occupancy = 0;             /**< implementazione scelta, 0 finchè occupancy_select non la pubblica (una volta sola) */
+
+#ifdef FEATURES_X86
+/**
+* Versione AVX2 del calcolo dell'occupazione: 8 celle per istruzione
+ * @param cells celle del campo in ordine di memoria
+ * @param words parole in cui scrivere un bit per cella
+*/
+__attribute__((target("avx2")))
+void occupancy_avx2(const int* cells, unsigned int words[FIELD_WORDS])
+{
+    const __m256i zero = _mm256_setzero_si256();
+    int i, k;
+
+    for(k = 0; k < FIELD_WORDS; k++)
+        words[k] = 0;
+
+    for(i = 0, k = 0; i + 8 <= FIELD_CELLS; i += 8, k++)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(cells + i));
+        __m256i empty = _mm256_cmpeq_epi32(v, zero);
+        unsigned int m = ~(unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(empty)) & 0xFFu;
+        words[k >> 2] |= m << ((k & 3) * 8);
+    }
+
+    for(; i < FIELD_CELLS; i++)
+        if(cells[i])
+            words[i >> 5] |= 1u << (i & 31);
+}
+
+/**
+* Versione SSE2 del calcolo dell'occupazione: 4 celle per istruzione
+ * @param cells celle del campo in ordine di memoria
+ * @param words parole in cui scrivere un bit per cella
+*/
+__attribute__((target("sse2")))
+void occupancy_sse2(const int* cells, unsigned int words[FIELD_WORDS])
+{
+    const __m128i zero = _mm_setzero_si128();
+    int i, k;
+
+    for(k = 0; k < FIELD_WORDS; k++)
+        words[k] = 0;
+
+    for(i = 0, k = 0; i + 4 <= FIELD_CELLS; i += 4, k++)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(cells + i));
+        __m128i empty = _mm_cmpeq_epi32(v, zero);
+        unsigned int m = ~(unsigned int)_mm_movemask_ps(_mm_castsi128_ps(empty)) & 0xFu;
+        words[k >> 3] |= m << ((k & 7) * 4);
+    }
+
+    for(; i < FIELD_CELLS; i++)
+        if(cells[i])
+            words[i >> 5] |= 1u << (i & 31);
+}
+#endif
+
+void occupancy_scalar(const int* cells, unsigned int words[FIELD_WORDS])
+{
+    int i;
+
+    for(i = 0; i < FIELD_WORDS; i++)
+        words[i] = 0;
+
+    for(i = 0; i < FIELD_CELLS; i++)
+        if(cells[i])
+            words[i >> 5] |= 1u << (i & 31);
+}
+
+occupancy_fn occupancy_select()
+{
+    occupancy_fn fn = __atomic_load_n(&occupancy, __ATOMIC_ACQUIRE);
+    occupancy_fn chosen = 0;
+
+    if(fn)
+        return fn;
+
+    fn = occupancy_scalar;
+#ifdef FEATURES_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        fn = occupancy_avx2;
+    else if(__builtin_cpu_supports("sse2"))
+        fn = occupancy_sse2;
+#endif
+
+    /* Può essere chiamata da più thread insieme (Sched.h, suggerimento): vale la prima scelta pubblicata,
+       e occupancy non viene più riscritta */
+    if(!__atomic_compare_exchange_n(&occupancy, &chosen, fn, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        fn = chosen;
+    return fn;
+}
+
+const char* features_backend()
+{
+    occupancy_fn fn = occupancy_select();
+
+#ifdef FEATURES_X86
+    if(fn == occupancy_avx2)
+        return "avx2";
+    if(fn == occupancy_sse2)
+        return "sse2";
+#endif
+    (void)fn;
+    return "scalar";
+}
+
+void words_to_rows(const unsigned int words[FIELD_WORDS], unsigned int rows[FIELD_ROWS])
+{
+    int i;
+    for(i = 0; i < FIELD_ROWS; i++)
+    {
+        int offset = i * FIELD_COLS;
+        int w = offset >> 5, s = offset & 31;
+        unsigned int r = words[w] >> s;
+
+        /* La riga è a cavallo di due parole */
+        if(s + FIELD_COLS > 32)
+            r |= words[w + 1] << (32 - s);
+
+        rows[i] = r & FULL_ROW_MASK;
+    }
+}
+
+void field_rows(int field[FIELD_ROWS][FIELD_COLS], unsigned int rows[FIELD_ROWS])
+{
+    unsigned int words[FIELD_WORDS];
+
+    occupancy_select()(&field[0][0], words);
+    words_to_rows(words, rows);
+}
+
+void features_from_rows(const unsigned int rows[FIELD_ROWS], features_t* f)
+{
+    const unsigned int left_wall = 1u, right_wall = 1u << (FIELD_COLS - 1);
+    unsigned int covered = 0;
+    int i, j;
+
+    for(j = 0; j < FIELD_COLS; j++)
+    {
+        f->heights[j] = 0;
+        f->well_depths[j] = 0;
+    }
+    f->holes = 0;
+    f->row_transitions = 0;
+    f->col_transitions = 0;
+    f->full_rows = 0;
+
+    for(i = 0; i < FIELD_ROWS; i++)
+    {
+        unsigned int r = rows[i];
+        unsigned int fresh = r & ~covered;
+        /* Un pozzo è una cella vuota, non coperta, con entrambi i vicini pieni (i bordi contano come pieni) */
+        unsigned int wells = ~r & ~covered & ((r << 1) | left_wall) & ((r >> 1) | right_wall) & FULL_ROW_MASK;
+
+        /* Le colonne che si riempiono per la prima volta fissano la loro altezza */
+        for(; fresh; fresh &= fresh - 1)
+            f->heights[bit_index(fresh)] = FIELD_ROWS - i;
+
+        for(; wells; wells &= wells - 1)
+            f->well_depths[bit_index(wells)]++;
+
+        f->holes += bit_count(~r & covered & FULL_ROW_MASK);
+        f->row_transitions += bit_count(((r << 1) | 1u) ^ (r | (1u << FIELD_COLS)));
+
+        if(i + 1 < FIELD_ROWS)
+            f->col_transitions += bit_count(r ^ rows[i + 1]);
+        else
+            f->col_transitions += bit_count(~r & FULL_ROW_MASK);
+
+        if(r == FULL_ROW_MASK)
+            f->full_rows |= 1u << i;
+
+        covered |= r;
+    }
+
+    f->aggregate_height = 0;
+    f->max_height = 0;
+    f->bumpiness = 0;
+    f->cumulative_wells = 0;
+    for(j = 0; j < FIELD_COLS; j++)
+    {
+        int h = f->heights[j], d = f->well_depths[j];
+
+        f->aggregate_height += h;
+        if(h > f->max_height)
+            f->max_height = h;
+        if(j > 0)
+            f->bumpiness += h > f->heights[j - 1] ? h - f->heights[j - 1] : f->heights[j - 1] - h;
+        f->cumulative_wells += d * (d + 1) / 2;
+    }
+}
+
+void features_extract(int field[FIELD_ROWS][FIELD_COLS], features_t* f)
+{
+    unsigned int rows[FIELD_ROWS];
+
+    field_rows(field, rows);
+    features_from_rows(rows, f);
+}
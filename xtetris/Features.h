@@ -0,0 +1,63 @@
+/**
+* @file Features.h
+* @author Albert Alibeaj
+* @brief Libreria che estrae le caratteristiche di un campo di gioco
+ * (altezze, buchi, transizioni, pozzi, righe piene) usate per valutare le mosse.
+ * L'estrazione dell'occupazione usa istruzioni AVX2 o SSE2 quando la CPU le supporta
+*/
+
+#ifndef XTETRIS2_FEATURES_H
+#define XTETRIS2_FEATURES_H
+
+#include "Field.h"
+
+/** Maschera di una riga completamente piena (un bit per colonna) */
+#define FULL_ROW_MASK ((1u << FIELD_COLS) - 1)
+
+/** Tipo features_t
+*   Caratteristiche di un campo, calcolate a partire dalle maschere di occupazione
+*/
+typedef struct Features
+{
+    int heights[FIELD_COLS];        /**< altezza di ogni colonna (0 se vuota) */
+    int well_depths[FIELD_COLS];    /**< profondità del pozzo in ogni colonna (0 se non è un pozzo) */
+    int aggregate_height;           /**< somma delle altezze delle colonne */
+    int max_height;                 /**< altezza della colonna più alta */
+    int bumpiness;                  /**< somma delle differenze di altezza tra colonne adiacenti */
+    int holes;                      /**< celle vuote coperte da almeno una cella piena */
+    int row_transitions;            /**< passaggi pieno/vuoto in orizzontale (i bordi contano come pieni) */
+    int col_transitions;            /**< passaggi pieno/vuoto in verticale (il fondo conta come pieno) */
+    int cumulative_wells;           /**< somma di 1 + 2 + ... + profondità per ogni pozzo */
+    unsigned int full_rows;         /**< bit i acceso se la riga i del campo è piena */
+
+} features_t;
+
+/**
+* Calcola la maschera di occupazione di ogni riga del campo.
+ * Il bit j di rows[i] è acceso se field[i][j] non è vuota
+ * @param field campo da convertire
+ * @param rows array in cui scrivere le maschere delle righe
+*/
+void field_rows(int field[FIELD_ROWS][FIELD_COLS], unsigned int rows[FIELD_ROWS]);
+
+/**
+* Calcola le caratteristiche di un campo a partire dalle maschere delle righe
+ * @param rows maschere di occupazione delle righe
+ * @param f struttura da riempire
+*/
+void features_from_rows(const unsigned int rows[FIELD_ROWS], features_t* f);
+
+/**
+* Calcola le caratteristiche di un campo
+ * @param field campo da analizzare
+ * @param f struttura da riempire
+*/
+void features_extract(int field[FIELD_ROWS][FIELD_COLS], features_t* f);
+
+/**
+* Nome dell'implementazione scelta a runtime per l'estrazione dell'occupazione
+ * @return "avx2", "sse2" o "scalar"
+*/
+const char* features_backend();
+
+#endif /*XTETRIS2_FEATURES_H*/
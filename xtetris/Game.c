@@ -6,9 +6,23 @@
 
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "Game.h"
 #include "GameGraphics.h"
 #include "Player.h"
+#include "Com.h"
+#include "State.h"
+#include "Strategy.h"
+#include "Ponder.h"
+#include "Hint.h"
+#include "Profile.h"
+#include "Trace.h"
+#include "Latency.h"
+#include "EventLog.h"
+#include "Results.h"
+#include "Clock.h"
 
 /** Macro che identifica che la partita è stata persa dopo una mossa */
 #define MATCH_LOST (-1)
@@ -16,6 +30,65 @@
 #define BACK_TO_MENU (-2)
 /** Macro che identifica che una mossa è stata annullata e non ci sono state modifiche */
 #define RETRY_TURN (-3)
+/** Macro che identifica che il suggerimento è cambiato e va ristampato, senza tasti da elaborare */
+#define HINT_CHANGED (-4)
+/** Macro che identifica che il turno attende un altro evento per proseguire */
+#define TURN_PENDING (-5)
+
+/** Millisecondi di attesa di un tasto prima di controllare se il suggerimento è migliorato */
+#define HINT_POLL_MS 50
+/** Millisecondi di attesa di un tasto prima di controllare se l'avversario in rete è uscito */
+#define LAN_POLL_MS 200
+
+int hint_enabled = 0;                       /**< 1 se il suggerimento è visibile (si cambia con il tasto H) */
+
+game_result_t game_result;                  /**< esito della partita in corso, salvato a fine partita */
+double game_start_time;                     /**< istante di inizio della partita in corso */
+int (*game_fields[STATE_PLAYERS])[FIELD_COLS];  /**< campi della partita multiplayer in corso, per il bot esterno */
+int* game_scores[STATE_PLAYERS];            /**< punteggi della partita multiplayer in corso, per il bot esterno */
+lan_t* game_lan;                            /**< collegamento della partita in rete in corso (NULL se non in rete) */
+int game_exit_player;                       /**< giocatore uscito durante il turno dell'avversario in rete (0 se nessuno) */
+
+/** Tipo turn_fn
+*   Funzione che gioca il turno di un giocatore (turn, com_turn, lan_local_turn, lan_remote_turn)
+*/
+typedef int (*turn_fn)(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, int *p_score);
+
+/** Tipo turn_phase_t
+*   Fase del turno di un giocatore umano
+*/
+typedef enum TurnPhase
+{
+    TURN_TET,               /**< scelta del tetramino */
+    TURN_ROT,               /**< scelta della rotazione */
+    TURN_COL,               /**< scelta della colonna con anteprima */
+    TURN_EXIT               /**< conferma dell'uscita dalla partita */
+
+} turn_phase_t;
+
+/** Tipo turn_t
+*   Turno di un giocatore umano come macchina a stati: riceve un evento alla volta (tasto o
+ *  suggerimento cambiato), aggiorna la schermata e restituisce subito, senza attendere l'input
+*/
+typedef struct Turn
+{
+    int phase;                      /**< fase in corso (turn_phase_t) */
+    int (*field)[FIELD_COLS];       /**< campo del giocatore */
+    tet_t* tets;                    /**< tetramini da cui scegliere */
+    int player;                     /**< giocatore di turno */
+    int* p_score;                   /**< punteggio del giocatore */
+    int id;                         /**< tetramino mostrato o scelto */
+    int rot;                        /**< rotazione mostrata o scelta */
+    int col;                        /**< colonna mostrata o scelta */
+    placement_t move;               /**< mossa inserita, da inviare all'avversario in rete */
+    lan_t* lan;                     /**< collegamento con l'avversario in rete (NULL se non in rete) */
+    int exit_player;                /**< giocatore uscito durante il turno (0 se nessuno) */
+
+    hint_t hint;                    /**< calcolo in sottofondo del suggerimento */
+    unsigned int hint_shown;        /**< versione del suggerimento mostrata (0 se nessuna) */
+    unsigned int hint_cells[FIELD_ROWS];    /**< celle del suggerimento mostrato, una maschera per riga */
+
+} turn_t;
 
 /**
 * Controlla se ci sono ancora tetramini disponibili da usare
@@ -25,41 +98,118 @@
 int tets_available(tet_t tets[TET_TYPES]);
 
 /**
-* Tramite input da tastiera, fa scegliere il tetramino stampandolo
- * @param tets array di tetramini da cui scegliere
- * @return indice del tetramino all'interno dell'array
+* Inizia il turno di un giocatore umano: avvia il suggerimento, mostra il campo e il primo tetramino
+ * @param t turno da iniziare
+ * @param field campo su cui inserire il tetramino
+ * @param tets array da cui scegliere il tetramino
+ * @param player giocatore di turno
+ * @param p_score punteggio del giocatore, aggiornato a fine turno
+ * @param lan collegamento con l'avversario in rete, controllato durante l'attesa (NULL se non in rete)
+ * @return TURN_PENDING
+*/
+int turn_begin(turn_t* t, int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, int *p_score, lan_t* lan);
+
+/**
+* Gioca un turno di un giocatore umano dall'inizio alla fine. L'attesa degli eventi è solo qui:
+ * le fasi del turno sono elaborate da turn_feed
+ * @param t turno da giocare; a fine turno contiene la mossa inserita e chi è uscito
+ * @param field campo su cui inserire il tetramino
+ * @param tets array da cui scegliere il tetramino
+ * @param player giocatore di turno
+ * @param p_score punteggio del giocatore, aggiornato a fine turno
+ * @param lan collegamento con l'avversario in rete (NULL se non in rete)
+ * @return risultato del turno, come turn
+*/
+int turn_run(turn_t* t, int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, int *p_score, lan_t* lan);
+
+/**
+* Fa avanzare il turno di un evento
+ * @param t turno in corso
+ * @param input tasto premuto, o HINT_CHANGED per ristampare la schermata
+ * @return TURN_PENDING se il turno attende altri eventi, altrimenti il risultato di turn
+*/
+int turn_feed(turn_t* t, int input);
+
+/**
+* Entra in una fase del turno e la mostra
+ * @param t turno in corso
+ * @param phase fase in cui entrare (turn_phase_t)
+ * @return TURN_PENDING, o il risultato del turno se la fase lo conclude subito
+*/
+int turn_enter(turn_t* t, int phase);
+
+/**
+* Stampa il tetramino mostrato e le istruzioni per sceglierlo
+ * @param t turno in corso
+*/
+void turn_show_tet(turn_t* t);
+
+/**
+* Stampa l'anteprima del tetramino nella colonna mostrata, direttamente sul campo e poi annullata
+ * @param t turno in corso
+*/
+void turn_preview(turn_t* t);
+
+/**
+* Inserisce la mossa scelta ed elabora il punteggio
+ * @param t turno in corso
+ * @return valore positivo se ci sono ancora tetramini utilizzabili, MATCH_LOST se si ha perso, 0 altrimenti
+*/
+int turn_place(turn_t* t);
+
+/**
+* Ferma il suggerimento del turno e lo nasconde
+ * @param t turno in corso
+ * @param result risultato del turno
+ * @return result
+*/
+int turn_end(turn_t* t, int result);
+
+/**
+* Attende un tasto del giocatore di turno. Nel frattempo, se il suggerimento è visibile,
+ * aggiorna le sue celle ogni volta che il calcolo in sottofondo lo migliora
+ * @param t turno in corso
+ * @param redraw_field se 1 ristampa il campo quando il suggerimento cambia,
+ * altrimenti la ristampa è lasciata al chiamante
+ * @return valore del tasto premuto, o HINT_CHANGED se il campo va ristampato.
+ * Se l'avversario in rete è uscito restituisce KEY_BACKSPACE, fino alla fine del turno
+*/
+int wait_input(turn_t* t, int redraw_field);
+
+/**
+* Avvia il calcolo del suggerimento per il campo e i tetramini del turno
+ * @param t turno in corso
 */
-int choose_tet(tet_t tets[TET_TYPES]);
+void hint_begin(turn_t* t);
 
 /**
-* Tramite input da tastiera, fa scegliere la rotazione del tetramino stampandola
- * @param tet tetramino da ruotare
- * @return numero di rotazioni verso destra a partire dalla forma base
+* Mostra le celle dell'ultimo suggerimento calcolato per il turno, o le nasconde
+ * @param t turno in corso
+ * @return 1 se le celle mostrate sono cambiate
 */
-int choose_rot(tet_t *tet);
+int hint_refresh(turn_t* t);
 
 /**
-* Tramite input da tastiera, fa scegliere la colonna del campo stampando un'anteprima
- * @param field campo su cui scegliere la colonna
- * @param tet tetramino da inserire
- * @param rot numero rotazioni verso destra dalla forma base
- * @param player giocatore a cui appartiene il campo
- * @return numero di colonna scelto
+* Mostra nella schermata di game over la latenza dei tasti della partita e la salva su file se richiesto
+ * @param label nome della partita
 */
-int choose_col(int field[FIELD_ROWS][FIELD_COLS], tet_t *tet, int rot, int player);
+void latency_report(const char* label);
 
 /**
-* Inverte le ultime righe del campo
- * @param field campo su cui inveritire le righe
- * @param rows numero di righe a partire dal basso da invertire
+* Prepara l'esito di una nuova partita e sceglie il seme del generatore casuale
+ * @param mode modalità di gioco
 */
-void xor_rows(int field[FIELD_ROWS][FIELD_COLS], int rows);
+void result_begin(int mode);
 
 /**
-* Attende l'input dell'utente per confermare l'uscita dalla partita
- * @return valore del tasto premuto
+* Completa l'esito della partita, lo registra nel registro degli eventi e lo salva nell'archivio dei risultati
+ * @param reason motivo della fine (event_end_t)
+ * @param winner giocatore vincitore (0 se nessuno)
+ * @param exited giocatore uscito dalla partita (0 se nessuno)
+ * @param score1 punteggio del giocatore 1
+ * @param score2 punteggio del giocatore 2
 */
-int confirm_exit();
+void result_end(int reason, int winner, int exited, int score1, int score2);
 
 /**
 * Turno completo di un giocatore. Sceglta di tetramino, rotazione, colonna e inserimento
@@ -72,7 +222,7 @@ int confirm_exit();
 int turn(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, int *p_score);
 
 /**
-* Turno completo del computer. Scelta casuale di tetramino, rotazione, colonna e inserimento
+* Turno completo del computer. Scelta della mossa migliore tra quelle distinte e inserimento
  * @param field campo su cui inserire il tetramino
  * @param tets array da cui scegliere il tetramino
  * @param player giocatore a cui attribuire il turno
@@ -81,6 +231,51 @@ int turn(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, i
 */
 int com_turn(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, int *p_score);
 
+/**
+* Sceglie la mossa del computer con la strategia di XTETRIS_BOT (strategy_game), passandole
+ * lo stato della partita multiplayer in corso
+ * @param tets tetramini disponibili
+ * @param player giocatore di turno
+ * @param move mossa scelta
+*/
+void bot_move(tet_t tets[TET_TYPES], int player, placement_t* move);
+
+/**
+* Turno del giocatore locale in una partita in rete: turno normale, poi invio della mossa all'avversario
+ * @param field campo su cui inserire il tetramino
+ * @param tets array da cui scegliere il tetramino
+ * @param player giocatore a cui attribuire il turno
+ * @param p_score punteggio del giocatore, aggiornato a ogni turno
+ * @return come turn
+*/
+int lan_local_turn(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, int *p_score);
+
+/**
+* Turno dell'avversario in una partita in rete: attende la sua mossa e la applica al suo campo.
+ * Backspace esce dalla partita senza attendere
+ * @param field campo dell'avversario
+ * @param tets array da cui l'avversario sceglie il tetramino
+ * @param player giocatore dell'avversario
+ * @param p_score punteggio dell'avversario
+ * @return valore positivo se ci sono ancora tetramini utilizzabili, MATCH_LOST se l'avversario ha perso,
+ * BACK_TO_MENU se uno dei due è uscito o il collegamento si è chiuso
+*/
+int lan_remote_turn(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, int *p_score);
+
+/**
+* Prosegue una partita a due finché non termina e ne mostra l'esito
+ * @param f1 campo del giocatore 1
+ * @param f2 campo del giocatore 2
+ * @param tets array dei tetramini da usare durante la partita
+ * @param p1_turn funzione che gioca i turni del giocatore 1
+ * @param p2_turn funzione che gioca i turni del giocatore 2
+ * @param names nomi dei giocatori nei messaggi di fine partita
+ * @param you giocatore davanti allo schermo (0 se giocano entrambi sullo stesso schermo)
+ * @param label nome della modalità per latency_report
+*/
+void multi_play(int f1[FIELD_ROWS][FIELD_COLS], int f2[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES],
+                turn_fn p1_turn, turn_fn p2_turn, const char* names[STATE_PLAYERS], int you, const char* label);
+
 
 /******************* Singleplayer ****************************/
 /**
@@ -92,6 +287,7 @@ void single_init(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES])
 {
     field_init(field);
     tets_init(tets, 0);
+    latency_reset();
 
     single_graphics_init();
 }
@@ -103,28 +299,42 @@ void single_start_game(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES])
     char *end_msg = (char*)malloc(sizeof (char) * 30);
 
     single_init(field, tets);
+    result_begin(0);
 
     do
     {
+        trace_begin("turn");
         p_res = turn(field, tets, player_one(), &score);
+        trace_end("turn");
         clear_all();
     }
     while(p_res > 0 || p_res == RETRY_TURN);
 
 
     if(p_res == 0)
+    {
         sprintf(end_msg, "Hai vinto! Punteggio: %d", score);
+        result_end(EVENT_END_PIECES, player_one(), 0, score, 0);
+    }
     else if(p_res == MATCH_LOST)
+    {
         sprintf(end_msg, "Hai perso :( Punteggio: %d", score);
+        result_end(EVENT_END_LOST, 0, 0, score, 0);
+    }
     else
+    {
         sprintf(end_msg, "Sei uscito dalla partita");
+        result_end(EVENT_END_EXIT, 0, player_one(), score, 0);
+    }
 
     print_game_over(end_msg);
+    latency_report("singleplayer");
     free(end_msg);
 }
 
 void single_end_game(tet_t tets[TET_TYPES])
 {
+    PROFILE_DUMP("fine partita singleplayer");
     tets_free(tets);
     single_graphics_free();
 
@@ -144,18 +354,57 @@ void multi_init(int f1[FIELD_ROWS][FIELD_COLS], int f2[FIELD_ROWS][FIELD_COLS],
     field_init(f1);
     field_init(f2);
     tets_init(tets, 1);
+    latency_reset();
 
     multi_graphics_init();
 }
 
 void multi_start_game(int f1[FIELD_ROWS][FIELD_COLS], int f2[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int com)
+{
+    const char* names[STATE_PLAYERS];
+
+    names[0] = "Giocatore 1";
+    names[1] = com ? "COM" : "Giocatore 2";
+
+    multi_init(f1, f2, tets);
+    result_begin(com ? 2 : 1);
+    multi_play(f1, f2, tets, turn, com ? com_turn : turn, names, com ? player_one() : 0,
+               com ? "contro il computer" : "multiplayer");
+}
+
+void lan_start_game(int f1[FIELD_ROWS][FIELD_COLS], int f2[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], lan_t* lan, int local)
+{
+    const char* names[STATE_PLAYERS];
+
+    names[0] = local == player_one() ? "Giocatore 1" : "Avversario";
+    names[1] = local == player_two() ? "Giocatore 2" : "Avversario";
+
+    multi_init(f1, f2, tets);
+    result_begin(1);
+    game_lan = lan;
+    lan_watch(lan, 0);
+    multi_play(f1, f2, tets,
+               local == player_one() ? lan_local_turn : lan_remote_turn,
+               local == player_two() ? lan_local_turn : lan_remote_turn,
+               names, local, "in rete");
+    lan_watch(lan, -1);
+    game_lan = NULL;
+}
+
+void multi_play(int f1[FIELD_ROWS][FIELD_COLS], int f2[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES],
+                turn_fn p1_turn, turn_fn p2_turn, const char* names[STATE_PLAYERS], int you, const char* label)
 {
     int p1_res, p2_res;
     int p1_score = 0, p2_score = 0;
-    char *p2_name = com ? "COM" : "Giocatore 2";
+    int com = p2_turn == com_turn;
+    int exited, winner;
     char *end_msg;
 
-    multi_init(f1, f2, tets);
+    game_fields[0] = f1;
+    game_fields[1] = f2;
+    game_scores[0] = &p1_score;
+    game_scores[1] = &p2_score;
+    game_exit_player = 0;
     do
     {
         int p1_score_prec = p1_score;
@@ -166,80 +415,126 @@ void multi_start_game(int f1[FIELD_ROWS][FIELD_COLS], int f2[FIELD_ROWS][FIELD_C
 
         if(!com) print_turn(1);
 
+        /*Mentre il giocatore sceglie, il computer prepara le sue risposte (un bot esterno sceglie solo al suo turno)*/
+        if(com && !strategy_game())
+        {
+            com_weights_t weights = com_weights();
+            ponder_start(f2, tets, &weights);
+        }
+
+        trace_begin("turn");
         do
-            p1_res = turn(f1, tets, player_one(), &p1_score);
+            p1_res = p1_turn(f1, tets, player_one(), &p1_score);
         while(p1_res == RETRY_TURN);
+        trace_end("turn");
 
         if(p1_res != BACK_TO_MENU)
         {
             /*Se si tolgono 3 o più righe si invertono quelle dell'avversario*/
+            trace_begin("score");
             if(p1_score - p1_score_prec == 6)
                 xor_rows(f2, 3);
             if(p1_score - p1_score_prec == 12)
                 xor_rows(f2, 4);
+            if(p1_score - p1_score_prec >= 6)
+                eventlog_add(EVENT_ATTACK, player_one(), p1_score - p1_score_prec == 6 ? 3 : 4, 0, 0, 0, 0);
+            trace_end("score");
 
 
             print_player_field(f1, player_one());
             print_player_score(p1_score, player_one());
 
             if(!com) print_turn(0);
+            trace_begin(com ? "com_turn" : "turn");
             do
-                if(!com)
-                    p2_res = turn(f2, tets, player_two(), &p2_score);
-                else
-                    p2_res = com_turn(f2, tets, player_two(), &p2_score);
+                p2_res = p2_turn(f2, tets, player_two(), &p2_score);
             while(p2_res == RETRY_TURN);
+            trace_end(com ? "com_turn" : "turn");
 
             /*Ancora, controllo per invertire le righe dell'avversario*/
+            trace_begin("score");
             if(p2_score - p2_score_prec == 6)
                 xor_rows(f1, 3);
             if(p2_score - p2_score_prec == 12)
                 xor_rows(f1, 4);
+            if(p2_score - p2_score_prec >= 6)
+                eventlog_add(EVENT_ATTACK, player_two(), p2_score - p2_score_prec == 6 ? 3 : 4, 0, 0, 0, 0);
+            trace_end("score");
         }
 
         clear_all();
     }
     while(p1_res > 0 && p2_res > 0);
 
+    ponder_stop();
+
     /*Partita finita: Controllo risultati*/
 
     /*In caso di pareggio, vale il punteggio più alto*/
     end_msg = (char*)malloc(sizeof(char) * 80);
     if(p1_res == 1 && p2_res == 0)
     {
-        if(p1_score > p2_score)
-            sprintf(end_msg, com ? "Pezzi terminati. Hai vinto! (%d a %d)" : "Pezzi terminati. Vince Giocatore 1! (%d a %d)", p1_score, p2_score);
-        else if(p2_score > p1_score)
-            sprintf(end_msg, "Pezzi terminati. Vince %s! (%d a %d)", p2_name, p1_score, p2_score);
+        winner = p1_score > p2_score ? player_one() : p2_score > p1_score ? player_two() : 0;
+        if(winner && winner == you)
+            sprintf(end_msg, "Pezzi terminati. Hai vinto! (%d a %d)", p1_score, p2_score);
+        else if(winner)
+            sprintf(end_msg, "Pezzi terminati. Vince %s! (%d a %d)", names[winner - 1], p1_score, p2_score);
         else
             sprintf(end_msg, "Pezzi terminati. Pareggio :( (%d a %d)", p1_score, p2_score);
     }
 
-    /*Caso vittoria giocatore 1*/
-    if(p2_res == MATCH_LOST && p1_res >= 0)
-        sprintf(end_msg, com ? "Hai vinto! (%d a %d)" : "Vince Giocatore 1! (%d a %d)", p1_score, p2_score);
-
-    /*Caso vittoria giocatore 2*/
-    if(p1_res == MATCH_LOST && p2_res >= 0)
-        sprintf(end_msg, "Vince %s! (%d a %d)", p2_name, p1_score, p2_score);
+    /*Caso vittoria di uno dei giocatori*/
+    if((p2_res == MATCH_LOST && p1_res >= 0) || (p1_res == MATCH_LOST && p2_res >= 0))
+    {
+        winner = p1_res == MATCH_LOST ? player_two() : player_one();
+        if(winner == you)
+            sprintf(end_msg, "Hai vinto! (%d a %d)", p1_score, p2_score);
+        else
+            sprintf(end_msg, "Vince %s! (%d a %d)", names[winner - 1], p1_score, p2_score);
+    }
 
     /*Entrambi i giocatori hanno perso allo stesso turno*/
     if(p1_res == MATCH_LOST && p2_res == MATCH_LOST)
         sprintf(end_msg, "Tutti hanno perso allo stesso momento. Pareggio :(");
 
-    if(p1_res == BACK_TO_MENU)
-        sprintf(end_msg, com ? "Sei uscito dalla partita" : "Giocatore 1 esce dalla partita");
+    /*Chi esce durante il turno dell'avversario in rete lo indica con game_exit_player*/
+    exited = game_exit_player ? game_exit_player : p1_res == BACK_TO_MENU ? player_one() : player_two();
+    if(p1_res == BACK_TO_MENU || p2_res == BACK_TO_MENU)
+    {
+        if(exited == you)
+            sprintf(end_msg, "Sei uscito dalla partita");
+        else
+            sprintf(end_msg, "%s esce dalla partita", names[exited - 1]);
+    }
 
-    if(p2_res == BACK_TO_MENU)
-        sprintf(end_msg, "%s esce dalla partita", p2_name);
+    if(p1_res == BACK_TO_MENU || p2_res == BACK_TO_MENU)
+        result_end(EVENT_END_EXIT, 0, exited, p1_score, p2_score);
+    else if(p1_res == MATCH_LOST && p2_res == MATCH_LOST)
+        result_end(EVENT_END_BOTH_LOST, 0, 0, p1_score, p2_score);
+    else if(p1_res == MATCH_LOST || p2_res == MATCH_LOST)
+        result_end(EVENT_END_LOST, p1_res == MATCH_LOST ? player_two() : player_one(), 0, p1_score, p2_score);
+    else
+        result_end(EVENT_END_PIECES, p1_score > p2_score ? player_one() : p2_score > p1_score ? player_two() : 0,
+                   0, p1_score, p2_score);
 
     print_game_over(end_msg);
+    if(game_lan)
+    {
+        /*In rete conta più il tempo di andata e ritorno delle mosse della latenza dei tasti*/
+        char summary[64];
+        if(lan_summary(game_lan, summary))
+            print_game_over_note(summary);
+        latency_save(label);
+    }
+    else
+        latency_report(label);
     free(end_msg);
 
 }
 
 void multi_end_game(tet_t tets[TET_TYPES])
 {
+    PROFILE_DUMP("fine partita multiplayer");
     tets_free(tets);
     multi_graphics_free();
 
@@ -250,49 +545,14 @@ void multi_end_game(tet_t tets[TET_TYPES])
 /**************** Funzioni private: implementazione ************************/
 int turn(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, int *p_score)
 {
-    int id, col, rot;
-    int turn_score;
-
-    /*Mostra il campo*/
-    print_player_field(field, player);
-    print_player_score(*p_score, player);
-
-    /*Selezione della mossa*/
-    id = choose_tet(tets);
-    if(id != BACK_TO_MENU && id != RETRY_TURN)
-    {
-        rot = choose_rot(&tets[id]);
-        if(rot != RETRY_TURN)
-        {
-            col = choose_col(field, &tets[id], rot, player);
-            if(col != RETRY_TURN)
-            {
-                /* Inserimento ed elaborazione punteggio */
-                turn_score = insert(field, &tets[id], col, rot);
-
-                if(turn_score >= 0)
-                    *p_score += turn_score;
-                else
-                    return MATCH_LOST;
-
-                return tets_available(tets);
-            }
-            else
-                return RETRY_TURN;
-        }
-        else
-            return RETRY_TURN;
-    }
-    else
-    if(id == BACK_TO_MENU)
-        return confirm_exit();
-    else
-        return RETRY_TURN;
+    turn_t t;
+    return turn_run(&t, field, tets, player, p_score, NULL);
 }
 
 int com_turn(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, int *p_score)
 {
-    int id, col, rot;
+    placement_t move;
+    com_weights_t weights = com_weights();
     int turn_score;
     int tet_choice = 0;
 
@@ -302,16 +562,20 @@ int com_turn(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int playe
 
     print_tet(tets[tet_choice]);
 
-    /*Selezione della mossa*/
-    do
-        id = rand() % TET_TYPES;
-    while(tets[id].quantity <= 0);
-
-    rot = rand() % tets[id].rot_number;
-    col = rand() % FIELD_COLS;
+    /*Selezione della mossa: se è stata preparata durante il turno del giocatore è immediata*/
+    trace_begin("com_move");
+    if(strategy_game())
+        bot_move(tets, player, &move);
+    else if(!ponder_take(field, tets, &move))
+        com_best_move(field, tets, &weights, &move);
+    trace_end("com_move");
 
     /* Inserimento ed elaborazione punteggio */
-    turn_score = insert(field, &tets[id], col, rot);
+    trace_begin("insert");
+    turn_score = placement_apply(field, tets, move);
+    trace_end("insert");
+    eventlog_add(EVENT_MOVE, player, move.id, move.rot, move.col, turn_score, 0);
+    game_result.moves++;
 
     if(turn_score >= 0)
         *p_score += turn_score;
@@ -321,149 +585,324 @@ int com_turn(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int playe
     return tets_available(tets);
 }
 
-int choose_tet(tet_t tets[TET_TYPES])
+void bot_move(tet_t tets[TET_TYPES], int player, placement_t* move)
 {
-    int id = 0, tet_choice = 0;
+    game_state_t state;
+    int i;
 
-    print_info("Usa le frecce per scegliere un tetramino o Backspace per uscire");
-    while(tets[id].quantity <= 0)
+    /* Il gioco tiene i campi separati: si compone lo stato che il bot riceve per puntatore */
+    for(i = 0; i < STATE_PLAYERS; i++)
     {
-        if(id == TET_TYPES - 1) id = -1;
-        id++;
+        memcpy(state.fields[i], game_fields[i], sizeof(state.fields[i]));
+        state.scores[i] = *game_scores[i];
     }
-    print_tet(tets[id]);
+    for(i = 0; i < TET_TYPES; i++)
+        state.quantities[i] = tets[i].quantity;
+    state.players = STATE_PLAYERS;
+    state.moves = game_result.moves;
+    state.rng = game_result.seed;
+
+    strategy_move(strategy_game(), &state, player - 1, tets, move);
+}
 
-    tet_choice = get_input();
-    while(tet_choice != KEY_ENTER && tet_choice != KEY_BACKSPACE)
+int lan_local_turn(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, int *p_score)
+{
+    int before[FIELD_ROWS][FIELD_COLS];
+    int score_prec = *p_score;
+    turn_t t;
+    int res;
+
+    memcpy(before, field, sizeof(before));
+    res = turn_run(&t, field, tets, player, p_score, game_lan);
+    if(t.exit_player)
+        game_exit_player = t.exit_player;
+
+    if(res == BACK_TO_MENU)
+        lan_send_bye(game_lan);
+    else if(res != RETRY_TURN && lan_send_move(game_lan, t.move, res == MATCH_LOST ? -1 : *p_score - score_prec, before, field) != 0)
+        return BACK_TO_MENU;
+    return res;
+}
+
+int lan_remote_turn(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, int *p_score)
+{
+    lan_msg_t msg;
+
+    print_player_field(field, player);
+    print_player_score(*p_score, player);
+    print_info("In attesa dell'avversario (Backspace per uscire)");
+
+    for(;;)
     {
-        if(tet_choice == KEY_DOWN || tet_choice == KEY_LEFT)
-        {
-            do
-            {
-                if(id == TET_TYPES - 1) id = -1;
-                id++;
-            }
-            while(tets[id].quantity <= 0);
-        }
-        else if(tet_choice == KEY_UP || tet_choice == KEY_RIGHT)
+        int type = lan_wait(game_lan, &msg, -1);
+
+        if(type == LAN_INPUT)
         {
-            do
-            {
-                if (id == 0) id = TET_TYPES;
-                id--;
-            }
-            while(tets[id].quantity <= 0);
+            if(get_input_timeout(0) != KEY_BACKSPACE)
+                continue;
+            lan_send_bye(game_lan);
+            game_exit_player = player == player_one() ? player_two() : player_one();
+            return BACK_TO_MENU;
         }
-        print_tet(tets[id]);
+        if(type != LAN_MOVE || tets[msg.move.id].quantity <= 0)
+            return BACK_TO_MENU;
+
+        /* Il campo arriva già aggiornato: basta copiare le righe cambiate */
+        lan_apply(&msg, field);
+        tets[msg.move.id].quantity--;
+        eventlog_add(EVENT_MOVE, player, msg.move.id, msg.move.rot, msg.move.col, msg.score, 0);
+        game_result.moves++;
+
+        if(msg.score < 0)
+            return MATCH_LOST;
+        *p_score += msg.score;
+        return tets_available(tets);
+    }
+}
 
-        if(tets[id].quantity > 0)
-            print_info("Usa le frecce per scegliere un tetramino o Backspace per uscire");
-        else
-            print_info("Non puoi piu' usare questo tetramino");
+int turn_run(turn_t* t, int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, int *p_score, lan_t* lan)
+{
+    int res = turn_begin(t, field, tets, player, p_score, lan);
 
-        tet_choice = get_input();
-    }
+    /*Il turno avanza di un evento alla volta: tasti, suggerimento e rete si attendono solo qui.
+      La conferma dell'uscita legge il tasto direttamente, così ogni tasto diverso da Backspace annulla*/
+    while(res == TURN_PENDING)
+        res = turn_feed(t, t->phase == TURN_EXIT ? get_input() : wait_input(t, t->phase != TURN_COL));
+    hint_free(&t->hint);
 
-    if(tet_choice == KEY_ENTER) /*Tasto invio*/
-    {
-        if(tets[id].quantity > 0)
-            return id;
-        else
-            return RETRY_TURN;
-    }
-    else
-        return BACK_TO_MENU;
+    /*Se l'avversario è uscito, anche un turno annullato termina la partita*/
+    return t->exit_player ? BACK_TO_MENU : res;
 }
 
-int choose_rot(tet_t *tet)
+int turn_begin(turn_t* t, int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int player, int *p_score, lan_t* lan)
 {
-    int rot_choice = 0, rot = 0;
+    t->field = field;
+    t->tets = tets;
+    t->player = player;
+    t->p_score = p_score;
+    t->lan = lan;
+    t->exit_player = 0;
+
+    /*Se visibile, il suggerimento viene calcolato in sottofondo mentre il giocatore sceglie*/
+    hint_init(&t->hint);
+    t->hint_shown = 0;
+    if(hint_enabled)
+        hint_begin(t);
+    hint_refresh(t);
+
+    /*Mostra il campo*/
+    print_player_field(field, player);
+    print_player_score(*p_score, player);
 
-    if(tet->rot_number <= 1) return 0;
+    return turn_enter(t, TURN_TET);
+}
 
-    print_info("Usa le frecce per scegliere la rotazione o Backspace per annullare");
-    rot_choice = get_input();
-    while(rot_choice != KEY_ENTER && rot_choice != KEY_BACKSPACE)
+int turn_feed(turn_t* t, int input)
+{
+    tet_t* tet = &t->tets[t->id];
+
+    switch(t->phase)
     {
-        if(rot_choice == KEY_UP || rot_choice == KEY_RIGHT)
-        {
-            if(rot == tet->rot_number - 1) rot = -1;
-            rot++;
-            rotate_dx(tet, 1);
-        }
-        else if(rot_choice == KEY_DOWN || rot_choice == KEY_LEFT)
-        {
-            if(rot == 0) rot = tet->rot_number;
-            rot--;
-            rotate_sx(tet, 1);
-        }
-        print_tet(*tet);
+        case TURN_TET:
+            if(input == KEY_ENTER || input == KEY_BACKSPACE)
+            {
+                trace_end("choose_tet");
+                if(input == KEY_BACKSPACE)
+                    return turn_enter(t, TURN_EXIT);
+                return tet->quantity > 0 ? turn_enter(t, TURN_ROT) : turn_end(t, RETRY_TURN);
+            }
 
-        rot_choice = get_input();
+            if(input == KEY_DOWN || input == KEY_LEFT)
+            {
+                do
+                {
+                    if(t->id == TET_TYPES - 1) t->id = -1;
+                    t->id++;
+                }
+                while(t->tets[t->id].quantity <= 0);
+            }
+            else if(input == KEY_UP || input == KEY_RIGHT)
+            {
+                do
+                {
+                    if (t->id == 0) t->id = TET_TYPES;
+                    t->id--;
+                }
+                while(t->tets[t->id].quantity <= 0);
+            }
+            turn_show_tet(t);
+            break;
+
+        case TURN_ROT:
+            if(input == KEY_ENTER)
+            {
+                trace_end("choose_rot");
+                return turn_enter(t, TURN_COL);
+            }
+            if(input == KEY_BACKSPACE)
+            {
+                reset_shape(tet);
+                trace_end("choose_rot");
+                return turn_end(t, RETRY_TURN);
+            }
+
+            if(input == KEY_UP || input == KEY_RIGHT)
+            {
+                if(t->rot == tet->rot_number - 1) t->rot = -1;
+                t->rot++;
+                rotate_dx(tet, 1);
+            }
+            else if(input == KEY_DOWN || input == KEY_LEFT)
+            {
+                if(t->rot == 0) t->rot = tet->rot_number;
+                t->rot--;
+                rotate_sx(tet, 1);
+            }
+            print_tet(*tet);
+            break;
+
+        case TURN_COL:
+            if(input == KEY_ENTER)
+            {
+                trace_end("choose_col");
+                return turn_place(t);
+            }
+            if(input == KEY_BACKSPACE)
+            {
+                reset_shape(tet);
+                trace_end("choose_col");
+                return turn_end(t, RETRY_TURN);
+            }
+
+            if(input == KEY_RIGHT)
+            {
+                if(t->col == FIELD_COLS - tet_width(*tet)) t->col = -1;
+                t->col++;
+            }
+            else if(input == KEY_LEFT)
+            {
+                if(t->col == 0) t->col = FIELD_COLS - tet_width(*tet) + 1;
+                t->col--;
+            }
+            turn_preview(t);
+            break;
+
+        default:
+            return input == KEY_BACKSPACE ? BACK_TO_MENU : RETRY_TURN;
     }
 
-    if(rot_choice == KEY_ENTER)
-        return rot;
-    else
+    return TURN_PENDING;
+}
+
+int turn_enter(turn_t* t, int phase)
+{
+    t->phase = phase;
+
+    switch(phase)
     {
-        reset_shape(tet);
-        return RETRY_TURN;
+        case TURN_TET:
+            t->id = 0;
+            while(t->tets[t->id].quantity <= 0)
+            {
+                if(t->id == TET_TYPES - 1) t->id = -1;
+                t->id++;
+            }
+            trace_begin("choose_tet");
+            turn_show_tet(t);
+            break;
+
+        case TURN_ROT:
+            t->rot = 0;
+            trace_begin("choose_rot");
+            if(t->tets[t->id].rot_number <= 1)
+            {
+                trace_end("choose_rot");
+                return turn_enter(t, TURN_COL);
+            }
+            print_info("Usa le frecce per scegliere la rotazione o Backspace per annullare");
+            break;
+
+        case TURN_COL:
+            t->col = 0;
+            trace_begin("choose_col");
+            turn_preview(t);
+            break;
+
+        default:
+            /*Il suggerimento si ferma prima di chiedere conferma, come a fine turno*/
+            turn_end(t, TURN_PENDING);
+            if(t->exit_player)
+                return BACK_TO_MENU;
+            print_info("Premi ancora Backspace per uscire o un altro tasto per annullare");
     }
+
+    return TURN_PENDING;
 }
 
-int choose_col(int field[FIELD_ROWS][FIELD_COLS], tet_t *tet, int rot, int player)
+void turn_show_tet(turn_t* t)
 {
-    int col = 0, col_choice = 0;
+    print_tet(t->tets[t->id]);
 
-    print_info("Usa le frecce per scegliere la colonna o Backspace per annullare");
-    do
-    {
-        int i, j, preview_score;
-        int bkp_value;
+    if(t->tets[t->id].quantity > 0)
+        print_info("Usa le frecce per scegliere un tetramino o Backspace per uscire");
+    else
+        print_info("Non puoi piu' usare questo tetramino");
+}
 
-        int preview_field[FIELD_ROWS][FIELD_COLS];
-        for(i = 0; i < FIELD_ROWS; i++)
-            for(j = 0; j < FIELD_COLS; j++)
-                preview_field[i][j] = field[i][j];
+void turn_preview(turn_t* t)
+{
+    tet_t* tet = &t->tets[t->id];
+    int preview_score;
+    int bkp_value = tet->value;
+    field_undo_t undo;
 
-        if(col_choice == KEY_RIGHT)
-        {
-            if(col == FIELD_COLS - tet_width(*tet)) col = -1;
-            col++;
-        }
-        else if(col_choice == KEY_LEFT)
-        {
-            if(col == 0) col = FIELD_COLS - tet_width(*tet) + 1;
-            col--;
-        }
+    tet->value = 8;
 
-        bkp_value = tet->value;
-        tet->value = 8;
+    /* Anteprima direttamente sul campo, poi annullata */
+    trace_begin("preview");
+    preview_score = field_make(t->field, tet, t->col, t->rot, &undo);
+    print_player_field(t->field, t->player);
+    field_unmake(t->field, tet, &undo);
+    trace_end("preview");
 
-        preview_score = insert(preview_field, tet, col, rot);
+    tet->value = bkp_value;
+    rotate_dx(tet, t->rot);
 
-        tet->quantity++;
-        tet->value = bkp_value;
-        rotate_dx(tet, rot);
+    if(preview_score < 0)
+        print_info("Con questa mossa perderai la partita");
+    else
+        print_info("Usa le frecce per scegliere la colonna o Backspace per annullare");
+}
 
-        print_player_field(preview_field, player);
+int turn_place(turn_t* t)
+{
+    int turn_score;
 
-        if(preview_score < 0)
-            print_info("Con questa mossa perderai la partita");
-        else
-            print_info("Usa le frecce per scegliere la colonna o Backspace per annullare");
+    turn_end(t, 0);
 
-        col_choice = get_input();
-    }
-    while(col_choice != KEY_ENTER && col_choice != KEY_BACKSPACE);
+    /* Inserimento ed elaborazione punteggio */
+    trace_begin("insert");
+    turn_score = insert(t->field, &t->tets[t->id], t->col, t->rot);
+    trace_end("insert");
+    t->move.id = t->id;
+    t->move.rot = t->rot;
+    t->move.col = t->col;
+    eventlog_add(EVENT_MOVE, t->player, t->id, t->rot, t->col, turn_score, 0);
+    game_result.moves++;
 
-    if(col_choice == KEY_ENTER)
-        return col;
+    if(turn_score >= 0)
+        *t->p_score += turn_score;
     else
-    {
-        reset_shape(tet);
-        return RETRY_TURN;
-    }
+        return MATCH_LOST;
+
+    return tets_available(t->tets);
+}
+
+int turn_end(turn_t* t, int result)
+{
+    hint_stop(&t->hint);
+    set_player_hint(NULL, t->player);
+    return result;
 }
 
 int tets_available(tet_t tets[TET_TYPES])
@@ -477,20 +916,108 @@ int tets_available(tet_t tets[TET_TYPES])
     return 0;
 }
 
-void xor_rows(int field[FIELD_ROWS][FIELD_COLS], int rows)
+void hint_begin(turn_t* t)
 {
-    int r, c;
-    for(r = FIELD_ROWS - 1; r > FIELD_ROWS - 1 - rows; r--)
-        for(c = 0; c < FIELD_COLS; c++)
-            field[r][c] = field[r][c] ? 0 : TET_TYPES + 2;
+    com_weights_t weights = com_weights();
+    hint_start(&t->hint, t->field, t->tets, &weights);
 }
 
-int confirm_exit()
+int hint_refresh(turn_t* t)
 {
-    int input;
-    print_info("Premi ancora Backspace per uscire o un altro tasto per annullare");
-    input = get_input();
+    placement_t move;
+    unsigned int version = hint_enabled ? hint_get(&t->hint, &move) : 0;
 
-    return input == KEY_BACKSPACE ? BACK_TO_MENU : RETRY_TURN;
+    if(version == t->hint_shown)
+        return 0;
+
+    t->hint_shown = version;
+    if(version)
+    {
+        hint_mask(t->field, t->tets, move, t->hint_cells);
+        set_player_hint(t->hint_cells, t->player);
+    }
+    else
+        set_player_hint(NULL, t->player);
+
+    return 1;
+}
+
+int wait_input(turn_t* t, int redraw_field)
+{
+    int input = KEY_NONE;
+
+    while(input == KEY_NONE)
+    {
+        /*Finchè il suggerimento può migliorare l'attesa del tasto è a tempo.
+          Si controlla prima di leggere il suggerimento per non perdere l'ultimo miglioramento*/
+        int polling = hint_enabled && !hint_done(&t->hint);
+        lan_msg_t msg;
+
+        /*In rete l'avversario può uscire durante il nostro turno: il turno viene annullato fino al menu*/
+        if(t->exit_player)
+            return KEY_BACKSPACE;
+        if(t->lan)
+        {
+            int type = lan_wait(t->lan, &msg, 0);
+            if(type != LAN_TIMEOUT && type != LAN_INPUT)
+            {
+                t->exit_player = t->player == player_one() ? player_two() : player_one();
+                return KEY_BACKSPACE;
+            }
+        }
+
+        if(hint_refresh(t))
+        {
+            if(redraw_field)
+                print_player_field(t->field, t->player);
+            return HINT_CHANGED;
+        }
+
+        input = get_input_timeout(polling ? HINT_POLL_MS : t->lan ? LAN_POLL_MS : -1);
+        if(input == KEY_HINT)
+        {
+            /*Il calcolo in sottofondo occupa un core solo mentre il suggerimento è visibile*/
+            hint_enabled = !hint_enabled;
+            if(hint_enabled)
+                hint_begin(t);
+            else
+                hint_stop(&t->hint);
+            input = KEY_NONE;
+        }
+    }
+
+    return input;
 }
 
+void latency_report(const char* label)
+{
+    char summary[LATENCY_SUMMARY_LEN];
+
+    if(latency_summary(summary))
+        print_game_over_note(summary);
+    latency_save(label);
+}
+
+void result_begin(int mode)
+{
+    memset(&game_result, 0, sizeof(game_result));
+    game_result.mode = mode;
+
+    /* Il seme viene dal generatore avviato nel main e lo reimposta, così la partita è riproducibile */
+    game_result.seed = (unsigned int)rand();
+    srand(game_result.seed);
+    game_start_time = clock_now();
+}
+
+void result_end(int reason, int winner, int exited, int score1, int score2)
+{
+    eventlog_add(EVENT_GAME_OVER, winner, reason, exited, 0, score1, score2);
+
+    game_result.reason = reason;
+    game_result.winner = winner;
+    game_result.score1 = score1;
+    game_result.score2 = score2;
+    game_result.duration_ms = (unsigned int)((clock_now() - game_start_time) * 1000);
+    game_result.time = (unsigned int)time(NULL);
+    results_save(&game_result);
+}
@@ -9,6 +9,7 @@
 #define XTETRIS2_GAME_H
 
 #include "Moves.h"
+#include "Lan.h"
 
 /**
 * Prepara e inizia una partita singleplayer
@@ -36,6 +37,17 @@ void single_end_game(tet_t tets[TET_TYPES]);
 */
 void multi_start_game(int f1[FIELD_ROWS][FIELD_COLS], int f2[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int com);
 
+/**
+* Prepara e inizia una partita multiplayer in rete, già collegata con lan_host o lan_join,
+ * e la prosegue finchè non termina. Libera le risorse con multi_end_game
+ * @param f1 array che si vuole usare come campo del giocatore 1
+ * @param f2 array che si vuole usare come campo del giocatore 2
+ * @param tets array dei tetramini da usare durante la partita
+ * @param lan collegamento con l'avversario
+ * @param local giocatore che gioca su questo schermo (1 per chi ospita, quello ricevuto da lan_join per chi si unisce)
+*/
+void lan_start_game(int f1[FIELD_ROWS][FIELD_COLS], int f2[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], lan_t* lan, int local);
+
 /**
 * Libera le risorse occupate durante la partita multiplayer
  * e attende un input da tastiera prima di proseguire
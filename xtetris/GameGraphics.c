@@ -10,13 +10,22 @@
 #include <ncurses.h>
 
 #include "Player.h"
+#include "Profile.h"
+#include "Trace.h"
+#include "Latency.h"
 
 #define COLOR_ORANGE 8              /**< identificativo del colore arancione che è stato ridefinito */
 #define COLOR_INV    9              /**< identificativo del colore da usare per le righe invertite (multiplayer) */
+#define GAME_OVER_COLS 60           /**< larghezza della finestra di game over */
+#define GAME_OVER_NOTE_COL 8        /**< colonna della nota nella finestra di game over */
 
 char* char_empty_field = "   ";     /**< codifica cella del campo vuota */
 char* char_value_field = "[#]";     /**< codifica cella del campo piena */
 char* char_value_invalid = "[X]";   /**< codifica cella fuori dal campo */
+char* char_hint_field = "[.]";      /**< codifica cella vuota in cui andrebbe il tetramino suggerito */
+
+const unsigned int* hint_rows = NULL;   /**< celle del suggerimento, una maschera per riga (NULL se nascosto) */
+int hint_player;                        /**< giocatore al cui campo si riferisce il suggerimento */
 
 WINDOW *main_window;                /**< finestra che contiene la sottofinestre per la grafica della partita */
 WINDOW *field_window;               /**< sottofinestra che contiene la grafica del campo 1  */
@@ -39,8 +48,9 @@ void init_colors();
 * Stampa il campo in una finestra specifica (parte della schermata intera)
  * @param field campo da stampare
  * @param win finestra su cui stampare il campo
+ * @param hint celle vuote da evidenziare, una maschera per riga (NULL se nessuna)
 */
-void print_field(int field[FIELD_ROWS][FIELD_COLS], WINDOW *win);
+void print_field(int field[FIELD_ROWS][FIELD_COLS], WINDOW *win, const unsigned int* hint);
 
 /**
 * Stampa il punteggio in una finestra specifica (parte della schermata intera)
@@ -206,10 +216,13 @@ void print_text_helper(char* info, WINDOW *win, int y_start, int x_start, int n_
     }
 }
 
-void print_field(int field[FIELD_ROWS][FIELD_COLS], WINDOW* win)
+void print_field(int field[FIELD_ROWS][FIELD_COLS], WINDOW* win, const unsigned int* hint)
 {
     int i, j;
+    PROFILE_DECL;
 
+    PROFILE_BEGIN();
+    trace_begin("render_field");
     wmove(win, 0, 1);
     for(i = INVALID_ROWS - 1; i < FIELD_ROWS; i++)
     {
@@ -231,6 +244,15 @@ void print_field(int field[FIELD_ROWS][FIELD_COLS], WINDOW* win)
         {
             int val = field[i][j];
 
+            /*Le celle del suggerimento hanno il colore dell'anteprima*/
+            if(!val && hint && (hint[i] >> j & 1u))
+            {
+                wattron(win, COLOR_PAIR(8));
+                wprintw(win, "%s", char_hint_field);
+                wattroff(win, COLOR_PAIR(8));
+                continue;
+            }
+
             wattron(win, COLOR_PAIR(val));
             wprintw(win, "%s", val ? char_value : char_empty_field);
             wattroff(win, COLOR_PAIR(val));
@@ -241,13 +263,19 @@ void print_field(int field[FIELD_ROWS][FIELD_COLS], WINDOW* win)
 
     refresh();
     wrefresh(win);
+    latency_frame();
+    trace_end("render_field");
+    PROFILE_END(PROFILE_PRINT_FIELD);
 }
 
 void print_tet(tet_t tet)
 {
     int i, j;
     int qdigits;
+    PROFILE_DECL;
 
+    PROFILE_BEGIN();
+    trace_begin("render_tet");
     /*wclear(tet_window);*/
     for(i = 0; i < 4; i++)
     {
@@ -279,7 +307,9 @@ void print_tet(tet_t tet)
 
     refresh();
     wrefresh(tet_window);
-
+    latency_frame();
+    trace_end("render_tet");
+    PROFILE_END(PROFILE_PRINT_TET);
 }
 
 void print_score(int value, WINDOW *win)
@@ -289,6 +319,7 @@ void print_score(int value, WINDOW *win)
 
     refresh();
     wrefresh(win);
+    latency_frame();
 }
 
 void print_info(char* info)
@@ -310,11 +341,12 @@ void print_info(char* info)
 
     refresh();
     wrefresh(info_window);
+    latency_frame();
 }
 
 void print_game_over(char* info)
 {
-    game_over_window = newwin(15, 60, 7, 27);
+    game_over_window = newwin(15, GAME_OVER_COLS, 7, 27);
     mvwprintw(game_over_window, 0, 0,
                                       "   _____                         ____                 \n"
                                       "  / ____|                       / __ \\                \n"
@@ -335,6 +367,15 @@ void print_game_over(char* info)
     wrefresh(game_over_window);
 }
 
+void print_game_over_note(char* note)
+{
+    /* La nota può superare la cornice: le latenze oltre i 10 ms non ci stanno in 38 colonne */
+    mvwprintw(game_over_window, 12, GAME_OVER_NOTE_COL, "%.*s", GAME_OVER_COLS - GAME_OVER_NOTE_COL, note);
+
+    refresh();
+    wrefresh(game_over_window);
+}
+
 void single_graphics_free()
 {
     delwin(field_window);
@@ -366,10 +407,18 @@ void game_over_graphics_free()
 /*Funzioni che nascondono la parte grafica*/
 void print_player_field(int field[FIELD_ROWS][FIELD_COLS], int player)
 {
+    const unsigned int* hint = player == hint_player ? hint_rows : NULL;
+
     if(player == player_one())
-        print_field(field, field_window);
+        print_field(field, field_window, hint);
     if(player == player_two())
-        print_field(field, second_field_window);
+        print_field(field, second_field_window, hint);
+}
+
+void set_player_hint(const unsigned int rows[FIELD_ROWS], int player)
+{
+    hint_rows = rows;
+    hint_player = player;
 }
 void print_player_score(int score, int player)
 {
@@ -401,6 +450,7 @@ void print_turn(int direction_sx)
 
     refresh();
     wrefresh(turn_window);
+    latency_frame();
 }
 
 void clear_all()
@@ -409,7 +459,37 @@ void clear_all()
 }
 int get_input()
 {
-    return getch();
+    int input;
+    PROFILE_DECL;
+
+    PROFILE_BEGIN();
+    trace_begin("input");
+    latency_wait();
+    input = getch();
+    latency_key();
+    trace_end("input");
+    PROFILE_END(PROFILE_GET_INPUT);
+
+    return input;
+}
+
+int get_input_timeout(int ms)
+{
+    int input;
+    PROFILE_DECL;
+
+    PROFILE_BEGIN();
+    trace_begin("input");
+    latency_wait();
+    timeout(ms);
+    input = getch();
+    timeout(-1);
+    if(input != ERR)
+        latency_key();
+    trace_end("input");
+    PROFILE_END(PROFILE_GET_INPUT);
+
+    return input == ERR ? KEY_NONE : input;
 }
 
 
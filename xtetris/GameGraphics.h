@@ -17,6 +17,8 @@
 #define KEY_RIGHT (261)     /**< valore del tasto freccia destra */
 #define KEY_ENTER (10)      /**< valore del tasto INVIO */
 #define KEY_BACKSPACE (127) /**< valore del tasto BACKSPACE */
+#define KEY_HINT ('h')      /**< valore del tasto che mostra o nasconde il suggerimento */
+#define KEY_NONE (-1)       /**< nessun tasto premuto entro il tempo di attesa */
 
 
 
@@ -53,6 +55,15 @@ void print_info(char* info);
 */
 void print_player_field(int field[FIELD_ROWS][FIELD_COLS], int player);
 
+/**
+* Imposta le celle del suggerimento, mostrate da print_player_field
+ * sulle celle vuote del campo del giocatore con il colore dell'anteprima
+ * @param rows una maschera per riga, il bit j acceso evidenzia la colonna j (NULL per nascondere).
+ * Non viene copiato: deve restare valido finchè è impostato
+ * @param player giocatore al cui campo si riferisce il suggerimento
+*/
+void set_player_hint(const unsigned int rows[FIELD_ROWS], int player);
+
 /**
 * Stampa il punteggio di un giocatore nel suo riquadro.
  * @param score valore da stampare
@@ -73,6 +84,12 @@ void print_turn(int direction_sx);
 */
 void print_game_over(char* info);
 
+/**
+* Stampa una riga aggiuntiva nella schermata di game over, sotto al messaggio
+ * @param note stringa da stampare (al più 52 caratteri, fino al bordo della finestra)
+*/
+void print_game_over_note(char* note);
+
 /**
 * Libera la memoria allocata per la grafica di una partita singleplayer
 */
@@ -99,4 +116,11 @@ void clear_all();
 */
 int get_input();
 
+/**
+* Attende l'input da tastiera dell'utente per un tempo massimo
+ * @param ms millisecondi di attesa (negativo per attendere senza limite)
+ * @return valore del tasto premuto, o KEY_NONE se il tempo è scaduto
+*/
+int get_input_timeout(int ms);
+
 #endif /*XTETRIS2_GRAPHICS_H*/
@@ -0,0 +1,226 @@
+/**
+* @file Hint.c
+* @author Albert Alibeaj
+* @brief File di implementazione del suggerimento della mossa al giocatore
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "Hint.h"
+#include "Moves.h"
+#include "Trace.h"
+
+/**
+* Confronto per qsort: mosse con valutazione più alta prima
+ * @param a primo candidato
+ * @param b secondo candidato
+ * @return negativo se a va prima di b
+*/
+int hint_compare(const void* a, const void* b);
+
+/**
+* Rende disponibile un nuovo suggerimento, se diverso dal precedente
+ * @param h suggerimento in calcolo
+ * @param move mossa consigliata
+*/
+void hint_publish(hint_t* h, placement_t move);
+
+/**
+* Valuta una mossa guardando anche la migliore mossa successiva
+ * @param h suggerimento in calcolo
+ * @param move mossa da valutare
+ * @return valutazione della coppia di mosse (COM_LOST se il calcolo è stato interrotto)
+*/
+double hint_lookahead(hint_t* h, placement_t move);
+
+/**
+* Funzione eseguita dal thread: ordina le mosse con una valutazione immediata,
+ * poi le rivaluta in quell'ordine guardando anche la mossa successiva
+ * @param arg suggerimento da calcolare (hint_t)
+ * @return sempre NULL
+*/
+void* hint_worker(void* arg);
+
+int hint_compare(const void* a, const void* b)
+{
+    double va = ((const hint_candidate_t*)a)->value;
+    double vb = ((const hint_candidate_t*)b)->value;
+
+    return (va < vb) - (va > vb);
+}
+
+void hint_publish(hint_t* h, placement_t move)
+{
+    pthread_mutex_lock(&h->lock);
+    if(!h->version || h->move.id != move.id || h->move.rot != move.rot || h->move.col != move.col)
+    {
+        h->move = move;
+        h->version++;
+    }
+    pthread_mutex_unlock(&h->lock);
+}
+
+double hint_lookahead(hint_t* h, placement_t move)
+{
+    int result[FIELD_ROWS][FIELD_COLS];
+    tet_t tets[TET_TYPES];
+    placement_t next;
+    double value;
+    int score, id, left = 0;
+
+    score = com_try_move(h->field, h->tets, move, result);
+    if(score < 0)
+        return COM_LOST;
+
+    memcpy(tets, h->tets, sizeof(tets));
+    tets[move.id].quantity--;
+    for(id = 0; id < TET_TYPES; id++)
+        left += tets[id].quantity > 0;
+
+    /* Senza altri tetramini conta solo la mossa corrente */
+    if(!left)
+        return com_evaluate(result, score, &h->weights);
+
+    value = com_search(result, tets, &h->weights, &next, &h->cancel);
+    if(value == COM_LOST)
+        return COM_LOST;
+
+    /* Con i pesi la valutazione è lineare e i punti della prima mossa si sommano come in com_evaluate.
+     * La rete restituisce già il valore del campo finale, come nel ramo senza tetramini: sommare i punti mescolerebbe due scale */
+    if(com_net_used())
+        return value;
+    return value + h->weights.w[0] * score;
+}
+
+void* hint_worker(void* arg)
+{
+    hint_t* h = (hint_t*)arg;
+    placements_t moves;
+    double best = COM_LOST;
+    int i;
+
+    trace_thread_name("hint");
+
+    trace_begin("hint_rank");
+    placements_gen(h->tets, &moves);
+    for(i = 0; i < moves.count; i++)
+    {
+        int result[FIELD_ROWS][FIELD_COLS];
+        int score = com_try_move(h->field, h->tets, moves.moves[i], result);
+
+        h->candidates[i].value = com_evaluate(result, score, &h->weights);
+        h->candidates[i].move = moves.moves[i];
+    }
+    qsort(h->candidates, moves.count, sizeof(hint_candidate_t), hint_compare);
+    trace_end("hint_rank");
+
+    if(moves.count > 0)
+        hint_publish(h, h->candidates[0].move);
+
+    /* Le mosse che fanno perdere sono in fondo e restano perdenti */
+    trace_begin("hint_lookahead");
+    for(i = 0; i < moves.count && h->candidates[i].value > COM_LOST; i++)
+    {
+        double value = hint_lookahead(h, h->candidates[i].move);
+
+        if(__atomic_load_n(&h->cancel, __ATOMIC_RELAXED))
+        {
+            trace_end("hint_lookahead");
+            return NULL;
+        }
+
+        if(value > best)
+        {
+            best = value;
+            hint_publish(h, h->candidates[i].move);
+        }
+    }
+
+    trace_end("hint_lookahead");
+
+    __atomic_store_n(&h->finished, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+void hint_init(hint_t* h)
+{
+    pthread_mutex_init(&h->lock, NULL);
+    h->version = 0;
+    h->finished = 1;
+    h->running = 0;
+}
+
+void hint_free(hint_t* h)
+{
+    hint_stop(h);
+    pthread_mutex_destroy(&h->lock);
+}
+
+void hint_start(hint_t* h, int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const com_weights_t* weights)
+{
+    hint_stop(h);
+
+    memcpy(h->field, field, sizeof(h->field));
+    memcpy(h->tets, tets, sizeof(h->tets));
+    h->weights = *weights;
+    h->version = 0;
+    h->finished = 0;
+    h->cancel = 0;
+
+    if(pthread_create(&h->thread, NULL, hint_worker, h) == 0)
+        h->running = 1;
+    else
+        h->finished = 1;
+}
+
+unsigned int hint_get(hint_t* h, placement_t* move)
+{
+    unsigned int version;
+
+    pthread_mutex_lock(&h->lock);
+    version = h->version;
+    if(version)
+        *move = h->move;
+    pthread_mutex_unlock(&h->lock);
+
+    return version;
+}
+
+int hint_done(hint_t* h)
+{
+    return __atomic_load_n(&h->finished, __ATOMIC_ACQUIRE);
+}
+
+void hint_stop(hint_t* h)
+{
+    if(!h->running)
+        return;
+
+    __atomic_store_n(&h->cancel, 1, __ATOMIC_RELAXED);
+    pthread_join(h->thread, NULL);
+    h->running = 0;
+    h->finished = 1;
+}
+
+void hint_mask(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placement_t move, unsigned int rows[FIELD_ROWS])
+{
+    int shape[TET_MAX_LEN * TET_MAX_LEN];
+    tet_t tet = tets[move.id];
+    int col = move.col, row, r, c;
+
+    /* Stessa forma e colonna di insert, su una copia del tetramino */
+    tet.shape = shape;
+    reset_shape(&tet);
+    rotate_dx(&tet, move.rot);
+    if(FIELD_COLS - col < tet_width(tet))
+        col = FIELD_COLS - tet_width(tet);
+
+    memset(rows, 0, sizeof(unsigned int) * FIELD_ROWS);
+    row = drop_row(field, &tet, col);
+
+    for(r = 0; r < tet.shape_len; r++)
+        for(c = 0; c < tet.shape_len; c++)
+            if(tet.shape[r * tet.shape_len + c] && row + r >= 0)
+                rows[row + r] |= 1u << (col + c);
+}
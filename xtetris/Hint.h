@@ -0,0 +1,96 @@
+/**
+* @file Hint.h
+* @author Albert Alibeaj
+* @brief Libreria che calcola, su un thread separato, la mossa consigliata al giocatore.
+ * Il suggerimento viene prima scelto guardando solo la mossa corrente e poi
+ * migliorato guardando anche la mossa successiva; ogni miglioramento è subito disponibile
+*/
+
+#ifndef XTETRIS2_HINT_H
+#define XTETRIS2_HINT_H
+
+#include <pthread.h>
+#include "Com.h"
+
+/** Tipo hint_candidate_t
+*   Mossa valutata guardando solo il campo che produce
+*/
+typedef struct HintCandidate
+{
+    double value;           /**< valutazione della mossa */
+    placement_t move;       /**< mossa valutata */
+
+} hint_candidate_t;
+
+/** Tipo hint_t
+*   Calcolo del suggerimento di un turno, con il suo thread
+*/
+typedef struct Hint
+{
+    int field[FIELD_ROWS][FIELD_COLS];          /**< campo del giocatore */
+    tet_t tets[TET_TYPES];                      /**< tetramini disponibili */
+    com_weights_t weights;                      /**< pesi della valutazione */
+    hint_candidate_t candidates[PLACEMENTS_MAX];/**< mosse ordinate dalla migliore alla peggiore */
+
+    pthread_mutex_t lock;                       /**< protegge move e version */
+    placement_t move;                           /**< suggerimento migliore trovato finora */
+    unsigned int version;                       /**< 0 se non c'è suggerimento, cresce a ogni miglioramento */
+    int finished;                               /**< 1 se il thread ha terminato il calcolo */
+    int cancel;                                 /**< diverso da 0 quando il thread deve fermarsi */
+    int running;                                /**< 1 se il thread è stato avviato e non ancora atteso */
+    pthread_t thread;                           /**< thread che calcola il suggerimento */
+
+} hint_t;
+
+/**
+* Prepara un suggerimento, senza avviare il calcolo
+ * @param h suggerimento da inizializzare
+*/
+void hint_init(hint_t* h);
+
+/**
+* Ferma il calcolo e libera le risorse del suggerimento
+ * @param h suggerimento inizializzato
+*/
+void hint_free(hint_t* h);
+
+/**
+* Avvia il calcolo del suggerimento, fermando quello precedente. Campo e quantità vengono copiati
+ * @param h suggerimento inizializzato
+ * @param field campo del giocatore
+ * @param tets tetramini disponibili
+ * @param weights pesi della valutazione
+*/
+void hint_start(hint_t* h, int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const com_weights_t* weights);
+
+/**
+* Legge il suggerimento migliore trovato finora
+ * @param h suggerimento inizializzato
+ * @param move mossa consigliata, se presente
+ * @return versione del suggerimento: 0 se non è ancora pronto, cresce a ogni miglioramento
+*/
+unsigned int hint_get(hint_t* h, placement_t* move);
+
+/**
+* Controlla se il calcolo del suggerimento è terminato
+ * @param h suggerimento inizializzato
+ * @return 1 se il suggerimento non cambierà più, 0 altrimenti
+*/
+int hint_done(hint_t* h);
+
+/**
+* Ferma il calcolo del suggerimento
+ * @param h suggerimento inizializzato
+*/
+void hint_stop(hint_t* h);
+
+/**
+* Celle che il tetramino occuperebbe dopo la caduta, senza modificare il campo
+ * @param field campo del giocatore
+ * @param tets tetramini disponibili
+ * @param move mossa da mostrare
+ * @param rows maschere da riempire: il bit j di rows[i] è acceso se il tetramino occupa field[i][j]
+*/
+void hint_mask(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placement_t move, unsigned int rows[FIELD_ROWS]);
+
+#endif /*XTETRIS2_HINT_H*/
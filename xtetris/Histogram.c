@@ -0,0 +1,127 @@
+/**
+* @file Histogram.c
+* @author Albert Alibeaj
+* @brief File di implementazione dell'istogramma log-lineare
+*/
+
+#include <string.h>
+#include "Histogram.h"
+
+/** Valore massimo registrabile */
+#define HISTOGRAM_MAX 0xFFFFFFFFUL
+
+/**
+* Intervallo in cui cade un valore
+ * @param value valore (al massimo HISTOGRAM_MAX)
+ * @return indice dell'intervallo
+*/
+int histogram_index(unsigned long value);
+
+/**
+* Limiti di un intervallo
+ * @param index indice dell'intervallo
+ * @param low limite inferiore (incluso)
+ * @param high limite superiore (incluso)
+*/
+void histogram_bounds(int index, unsigned long* low, unsigned long* high);
+
+int histogram_index(unsigned long value)
+{
+    int msb = 0, shift;
+
+    if(value < 2 * HISTOGRAM_HALF)
+        return (int)value;
+
+    while(value >> (msb + 1))
+        msb++;
+
+    /* Si tengono i HISTOGRAM_SUB_BITS bit più significativi */
+    shift = msb - HISTOGRAM_SUB_BITS + 1;
+    return shift * HISTOGRAM_HALF + (int)(value >> shift);
+}
+
+void histogram_bounds(int index, unsigned long* low, unsigned long* high)
+{
+    int shift = index < 2 * HISTOGRAM_HALF ? 0 : index / HISTOGRAM_HALF - 1;
+    unsigned long sub = index - shift * HISTOGRAM_HALF;
+
+    *low = sub << shift;
+    *high = ((sub + 1) << shift) - 1;
+}
+
+void histogram_clear(histogram_t* h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+void histogram_record(histogram_t* h, unsigned long value)
+{
+    if(value > HISTOGRAM_MAX)
+        value = HISTOGRAM_MAX;
+
+    h->counts[histogram_index(value)]++;
+    if(!h->total || value < h->min)
+        h->min = value;
+    if(value > h->max)
+        h->max = value;
+    h->total++;
+}
+
+unsigned long histogram_percentile(const histogram_t* h, double percent)
+{
+    unsigned long target, seen = 0, low, high;
+    int i;
+
+    if(!h->total)
+        return 0;
+
+    target = (unsigned long)(percent / 100.0 * h->total + 0.999999);
+    if(target < 1)
+        target = 1;
+    if(target > h->total)
+        target = h->total;
+
+    for(i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += h->counts[i];
+        if(seen >= target)
+        {
+            histogram_bounds(i, &low, &high);
+            return high < h->max ? high : h->max;
+        }
+    }
+
+    return h->max;
+}
+
+void histogram_add(histogram_t* dst, const histogram_t* src)
+{
+    int i;
+
+    if(!src->total)
+        return;
+
+    for(i = 0; i < HISTOGRAM_BUCKETS; i++)
+        dst->counts[i] += src->counts[i];
+    if(!dst->total || src->min < dst->min)
+        dst->min = src->min;
+    if(src->max > dst->max)
+        dst->max = src->max;
+    dst->total += src->total;
+}
+
+void histogram_write(const histogram_t* h, FILE* out)
+{
+    int i;
+
+    for(i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        unsigned long low, high;
+
+        if(!h->counts[i])
+            continue;
+
+        histogram_bounds(i, &low, &high);
+        fprintf(out, "%lu %lu %lu\n", low, high, h->counts[i]);
+    }
+}
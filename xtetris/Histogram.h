@@ -0,0 +1,68 @@
+/**
+* @file Histogram.h
+* @author Albert Alibeaj
+* @brief Libreria che implementa un istogramma log-lineare (in stile HDR) di valori interi positivi:
+ * i valori piccoli sono contati esattamente, gli altri con un errore relativo al più del 6,25%
+ * e memoria costante, qualunque sia il numero di campioni
+*/
+
+#ifndef XTETRIS2_HISTOGRAM_H
+#define XTETRIS2_HISTOGRAM_H
+
+#include <stdio.h>
+
+/** Bit di precisione di ogni ordine di grandezza: 2^(HISTOGRAM_SUB_BITS-1) intervalli per raddoppio */
+#define HISTOGRAM_SUB_BITS 5
+/** Intervalli di ogni ordine di grandezza */
+#define HISTOGRAM_HALF (1 << (HISTOGRAM_SUB_BITS - 1))
+/** Numero di intervalli per valori fino a 2^32 - 1 */
+#define HISTOGRAM_BUCKETS ((32 - HISTOGRAM_SUB_BITS + 2) * HISTOGRAM_HALF)
+
+/** Tipo histogram_t
+*   Conteggi dei campioni per intervallo di valori
+*/
+typedef struct Histogram
+{
+    unsigned long counts[HISTOGRAM_BUCKETS];    /**< campioni in ogni intervallo */
+    unsigned long total;                        /**< numero di campioni */
+    unsigned long min;                          /**< valore minimo registrato */
+    unsigned long max;                          /**< valore massimo registrato */
+
+} histogram_t;
+
+/**
+* Svuota un istogramma
+ * @param h istogramma da svuotare
+*/
+void histogram_clear(histogram_t* h);
+
+/**
+* Registra un campione (i valori oltre 2^32 - 1 vengono limitati)
+ * @param h istogramma
+ * @param value valore del campione
+*/
+void histogram_record(histogram_t* h, unsigned long value);
+
+/**
+* Valore sotto il quale cade una certa percentuale dei campioni
+ * @param h istogramma
+ * @param percent percentuale, tra 0 e 100
+ * @return limite superiore dell'intervallo che contiene il percentile (0 se vuoto)
+*/
+unsigned long histogram_percentile(const histogram_t* h, double percent);
+
+/**
+* Aggiunge i campioni di un istogramma a un altro
+ * @param dst istogramma da aggiornare
+ * @param src istogramma da aggiungere
+*/
+void histogram_add(histogram_t* dst, const histogram_t* src);
+
+/**
+* Scrive gli intervalli non vuoti, uno per riga: limite inferiore, limite superiore, campioni
+ * @param h istogramma
+ * @param out file su cui scrivere
+*/
+void histogram_write(const histogram_t* h, FILE* out);
+
+#endif /*XTETRIS2_HISTOGRAM_H*/
@@ -0,0 +1,532 @@
+/**
+* @file Lan.c
+* @author Albert Alibeaj
+* @brief File di implementazione delle partite in rete
+*/
+
+/* getaddrinfo e struct addrinfo non sono dichiarate con -ansi senza questa richiesta */
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "Lan.h"
+#include "Clock.h"
+
+#if defined(__linux__)
+#define LAN_EPOLL
+#include <sys/epoll.h>
+#endif
+
+/**
+* Divide un indirizzo in host e porta, o riconosce il percorso di un socket Unix
+ * @param address indirizzo
+ * @param host host (vuoto se manca)
+ * @param port porta
+ * @return 1 se è un socket Unix, 0 se è TCP, -1 se non è valido
+*/
+int lan_parse(const char* address, char host[256], char port[16]);
+
+/**
+* Apre un socket per un indirizzo, in ascolto o collegato
+ * @param address indirizzo
+ * @param listening 1 per ascoltare, 0 per collegarsi
+ * @return descrittore del socket, -1 in caso di errore
+*/
+int lan_socket(const char* address, int listening);
+
+/**
+* Invia un messaggio
+ * @param lan collegamento
+ * @param msg messaggio
+ * @return 0 se il messaggio è stato inviato, -1 altrimenti
+*/
+int lan_send(lan_t* lan, const lan_msg_t* msg);
+
+int lan_parse(const char* address, char host[256], char port[16])
+{
+    const char* colon = strrchr(address, ':');
+
+    if(strchr(address, '/'))
+        return strlen(address) < sizeof(((struct sockaddr_un*)0)->sun_path) ? 1 : -1;
+    if(!colon || colon - address >= 256 || strlen(colon + 1) == 0 || strlen(colon + 1) >= 16)
+        return -1;
+
+    memcpy(host, address, (size_t)(colon - address));
+    host[colon - address] = '\0';
+    strcpy(port, colon + 1);
+    return 0;
+}
+
+int lan_socket(const char* address, int listening)
+{
+    char host[256], port[16];
+    struct addrinfo hints, *list, *ai;
+    int kind = lan_parse(address, host, port), fd = -1, one = 1;
+
+    if(kind < 0)
+        return -1;
+
+    if(kind == 1)
+    {
+        struct sockaddr_un sun;
+
+        memset(&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        strcpy(sun.sun_path, address);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd < 0)
+            return -1;
+        if(listening)
+            unlink(address);
+        if((listening ? bind(fd, (struct sockaddr*)&sun, sizeof(sun)) : connect(fd, (struct sockaddr*)&sun, sizeof(sun))) != 0
+           || (listening && listen(fd, 128) != 0))
+        {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    if(getaddrinfo(host[0] ? host : NULL, port, &hints, &list) != 0)
+        return -1;
+
+    for(ai = list; ai && fd < 0; ai = ai->ai_next)
+    {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if(fd < 0)
+            continue;
+        /* Le mosse sono messaggi piccoli: vanno inviati subito, senza attendere di riempire un pacchetto
+           (i socket accettati ereditano l'opzione da quello in ascolto) */
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if(listening)
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if((listening ? bind(fd, ai->ai_addr, ai->ai_addrlen) : connect(fd, ai->ai_addr, ai->ai_addrlen)) != 0
+           || (listening && listen(fd, 128) != 0))
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(list);
+    return fd;
+}
+
+int lan_listen(const char* address)
+{
+    return lan_socket(address, 1);
+}
+
+int lan_connect(const char* address)
+{
+    return lan_socket(address, 0);
+}
+
+int lan_attach(lan_t* lan, int fd)
+{
+    int one = 1;
+
+    memset(lan, 0, sizeof(*lan));
+    lan->fd = fd;
+    lan->input_fd = -1;
+    lan->poll_fd = -1;
+    histogram_clear(&lan->rtt);
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    signal(SIGPIPE, SIG_IGN);
+
+#ifdef LAN_EPOLL
+    {
+        struct epoll_event ev;
+
+        lan->poll_fd = epoll_create(2);
+        if(lan->poll_fd < 0)
+            return -1;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if(epoll_ctl(lan->poll_fd, EPOLL_CTL_ADD, fd, &ev) != 0)
+            return -1;
+    }
+#endif
+    return 0;
+}
+
+void lan_watch(lan_t* lan, int fd)
+{
+#ifdef LAN_EPOLL
+    struct epoll_event ev;
+
+    if(lan->input_fd >= 0)
+        epoll_ctl(lan->poll_fd, EPOLL_CTL_DEL, lan->input_fd, &ev);
+    if(fd >= 0)
+    {
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(lan->poll_fd, EPOLL_CTL_ADD, fd, &ev);
+    }
+#endif
+    lan->input_fd = fd;
+}
+
+int lan_host(lan_t* lan, const char* address, unsigned long seed)
+{
+    lan_msg_t msg;
+    int listen_fd = lan_listen(address), fd;
+
+    memset(lan, 0, sizeof(*lan));
+    lan->fd = lan->poll_fd = lan->input_fd = -1;
+    if(listen_fd < 0)
+        return -1;
+
+    do
+        fd = accept(listen_fd, NULL, NULL);
+    while(fd < 0 && errno == EINTR);
+    close(listen_fd);
+    if(strchr(address, '/'))
+        unlink(address);
+
+    if(fd < 0 || lan_attach(lan, fd) != 0 || lan_send_hello(lan, seed, 2) != 0)
+        return -1;
+
+    /* L'avversario conferma con il proprio LAN_HELLO */
+    if(lan_wait(lan, &msg, 10000) != LAN_HELLO || msg.version != LAN_VERSION)
+        return -1;
+    return 0;
+}
+
+int lan_join(lan_t* lan, const char* address, unsigned long* seed, int* player)
+{
+    lan_msg_t msg;
+    int fd = lan_connect(address);
+
+    memset(lan, 0, sizeof(*lan));
+    lan->fd = lan->poll_fd = lan->input_fd = -1;
+    if(fd < 0 || lan_attach(lan, fd) != 0)
+        return -1;
+
+    if(lan_wait(lan, &msg, 10000) != LAN_HELLO || msg.version != LAN_VERSION)
+        return -1;
+    if(msg.player < 1 || msg.player > 2)
+        return -1;
+    *seed = msg.seed;
+    *player = msg.player;
+    return lan_send_hello(lan, msg.seed, 3 - msg.player);
+}
+
+void lan_close(lan_t* lan)
+{
+    if(lan->fd >= 0)
+        close(lan->fd);
+    if(lan->poll_fd >= 0)
+        close(lan->poll_fd);
+    lan->fd = lan->poll_fd = -1;
+}
+
+int lan_send(lan_t* lan, const lan_msg_t* msg)
+{
+    unsigned char frame[LAN_FRAME];
+    int len = lan_encode(msg, frame), done = 0;
+
+    /* Il socket non blocca: se il buffer di invio è pieno si attende che si liberi */
+    while(done < len)
+    {
+        ssize_t n = send(lan->fd, frame + done, (size_t)(len - done), 0);
+        if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            struct pollfd pfd;
+            pfd.fd = lan->fd;
+            pfd.events = POLLOUT;
+            poll(&pfd, 1, 100);
+            continue;
+        }
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return -1;
+        done += (int)n;
+    }
+    lan->bytes_out += (unsigned long)len;
+    return 0;
+}
+
+int lan_send_hello(lan_t* lan, unsigned long seed, int player)
+{
+    lan_msg_t msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.type = LAN_HELLO;
+    msg.version = LAN_VERSION;
+    msg.seed = seed;
+    msg.player = player;
+    return lan_send(lan, &msg);
+}
+
+int lan_send_move(lan_t* lan, placement_t move, int score, int before[FIELD_ROWS][FIELD_COLS], int after[FIELD_ROWS][FIELD_COLS])
+{
+    lan_msg_t msg;
+
+    msg.type = LAN_MOVE;
+    msg.seq = lan->next_seq++ & 0xFFFF;
+    msg.move = move;
+    msg.score = score;
+    lan_diff(&msg, before, after);
+
+    lan->sent[msg.seq % LAN_PENDING] = clock_now();
+    return lan_send(lan, &msg);
+}
+
+void lan_send_bye(lan_t* lan)
+{
+    lan_msg_t msg;
+
+    msg.type = LAN_BYE;
+    lan_send(lan, &msg);
+}
+
+void lan_diff(lan_msg_t* msg, int before[FIELD_ROWS][FIELD_COLS], int after[FIELD_ROWS][FIELD_COLS])
+{
+    int r;
+
+    msg->rows = 0;
+    for(r = 0; r < FIELD_ROWS; r++)
+        if(memcmp(before[r], after[r], sizeof(int) * FIELD_COLS) != 0)
+        {
+            msg->rows |= 1UL << r;
+            memcpy(msg->cells[r], after[r], sizeof(int) * FIELD_COLS);
+        }
+}
+
+int lan_encode(const lan_msg_t* msg, unsigned char frame[LAN_FRAME])
+{
+    unsigned char* p = frame + 2;
+    int len = 0, r, c;
+
+    switch(msg->type)
+    {
+        case LAN_HELLO:
+            p[0] = (unsigned char)msg->version;
+            p[1] = (unsigned char)(msg->seed & 0xFF);
+            p[2] = (unsigned char)(msg->seed >> 8 & 0xFF);
+            p[3] = (unsigned char)(msg->seed >> 16 & 0xFF);
+            p[4] = (unsigned char)(msg->seed >> 24 & 0xFF);
+            p[5] = (unsigned char)msg->player;
+            len = 6;
+            break;
+
+        case LAN_MOVE:
+            p[0] = (unsigned char)(msg->seq & 0xFF);
+            p[1] = (unsigned char)(msg->seq >> 8 & 0xFF);
+            p[2] = (unsigned char)msg->move.id;
+            p[3] = (unsigned char)msg->move.rot;
+            p[4] = (unsigned char)msg->move.col;
+            p[5] = (unsigned char)(signed char)msg->score;
+            p[6] = (unsigned char)(msg->rows & 0xFF);
+            p[7] = (unsigned char)(msg->rows >> 8 & 0xFF);
+            p[8] = (unsigned char)(msg->rows >> 16 & 0xFF);
+            len = 9;
+
+            /* Solo le righe cambiate, due celle per byte */
+            for(r = 0; r < FIELD_ROWS; r++)
+            {
+                if(!(msg->rows >> r & 1))
+                    continue;
+                for(c = 0; c < FIELD_COLS; c += 2)
+                    p[len++] = (unsigned char)((msg->cells[r][c] & 0xF) | (c + 1 < FIELD_COLS ? (msg->cells[r][c + 1] & 0xF) << 4 : 0));
+            }
+            break;
+
+        case LAN_ACK:
+            p[0] = (unsigned char)(msg->seq & 0xFF);
+            p[1] = (unsigned char)(msg->seq >> 8 & 0xFF);
+            len = 2;
+            break;
+    }
+
+    frame[0] = (unsigned char)msg->type;
+    frame[1] = (unsigned char)len;
+    return len + 2;
+}
+
+int lan_decode(const unsigned char* buf, int size, lan_msg_t* msg)
+{
+    const unsigned char* p = buf + 2;
+    int len, r, c, i;
+
+    if(size < 2 || size < 2 + buf[1])
+        return 0;
+    len = buf[1];
+
+    msg->type = buf[0];
+    msg->rows = 0;
+    switch(msg->type)
+    {
+        case LAN_HELLO:
+            if(len < 6)
+                return -1;
+            msg->version = p[0];
+            msg->seed = (unsigned long)p[1] | (unsigned long)p[2] << 8 | (unsigned long)p[3] << 16 | (unsigned long)p[4] << 24;
+            msg->player = p[5];
+            break;
+
+        case LAN_MOVE:
+            if(len < 9)
+                return -1;
+            msg->seq = (unsigned int)p[0] | (unsigned int)p[1] << 8;
+            msg->move.id = p[2];
+            msg->move.rot = p[3];
+            msg->move.col = p[4];
+            msg->score = (signed char)p[5];
+            msg->rows = (unsigned long)p[6] | (unsigned long)p[7] << 8 | (unsigned long)p[8] << 16;
+            if(msg->move.id >= TET_TYPES)
+                return -1;
+            for(r = 0, i = 9; r < FIELD_ROWS; r++)
+            {
+                if(!(msg->rows >> r & 1))
+                    continue;
+                if(i + (FIELD_COLS + 1) / 2 > len)
+                    return -1;
+                for(c = 0; c < FIELD_COLS; c++)
+                    msg->cells[r][c] = c % 2 ? p[i + c / 2] >> 4 : p[i + c / 2] & 0xF;
+                i += (FIELD_COLS + 1) / 2;
+            }
+            break;
+
+        case LAN_ACK:
+            if(len < 2)
+                return -1;
+            msg->seq = (unsigned int)p[0] | (unsigned int)p[1] << 8;
+            break;
+
+        case LAN_BYE:
+            break;
+
+        default:
+            return -1;
+    }
+
+    return 2 + len;
+}
+
+int lan_wait(lan_t* lan, lan_msg_t* msg, int timeout_ms)
+{
+    double deadline = clock_now() + timeout_ms / 1e3;
+
+    for(;;)
+    {
+        int ready_socket = 0, ready_input = 0, wait_ms = timeout_ms, res;
+        ssize_t n;
+
+        /* Prima i messaggi già ricevuti */
+        while((res = lan_decode(lan->in, lan->in_len, msg)) > 0)
+        {
+            lan->in_len -= res;
+            memmove(lan->in, lan->in + res, (size_t)lan->in_len);
+            if(msg->type == LAN_ACK)
+            {
+                histogram_record(&lan->rtt, (unsigned long)((clock_now() - lan->sent[msg->seq % LAN_PENDING]) * 1e9));
+                continue;
+            }
+            if(msg->type == LAN_MOVE)
+            {
+                lan_msg_t ack;
+                ack.type = LAN_ACK;
+                ack.seq = msg->seq;
+                lan_send(lan, &ack);
+            }
+            return msg->type;
+        }
+        if(res < 0)
+            return LAN_CLOSED;
+
+        if(timeout_ms >= 0)
+        {
+            wait_ms = (int)((deadline - clock_now()) * 1000 + 0.5);
+            if(wait_ms < 0)
+                return LAN_TIMEOUT;
+        }
+
+#ifdef LAN_EPOLL
+        {
+            struct epoll_event events[2];
+            int i, count = epoll_wait(lan->poll_fd, events, 2, wait_ms);
+
+            if(count < 0 && errno != EINTR)
+                return LAN_CLOSED;
+            for(i = 0; i < count; i++)
+            {
+                if(events[i].data.fd == lan->fd)
+                    ready_socket = 1;
+                else
+                    ready_input = 1;
+            }
+        }
+#else
+        {
+            struct pollfd pfd[2];
+            int count;
+
+            pfd[0].fd = lan->fd;
+            pfd[0].events = POLLIN;
+            pfd[1].fd = lan->input_fd;
+            pfd[1].events = POLLIN;
+            count = poll(pfd, lan->input_fd >= 0 ? 2 : 1, wait_ms);
+            if(count < 0 && errno != EINTR)
+                return LAN_CLOSED;
+            ready_socket = count > 0 && pfd[0].revents;
+            ready_input = count > 0 && lan->input_fd >= 0 && pfd[1].revents;
+        }
+#endif
+
+        if(ready_socket)
+        {
+            n = recv(lan->fd, lan->in + lan->in_len, (size_t)(LAN_BUF - lan->in_len), 0);
+            if(n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                return LAN_CLOSED;
+            if(n > 0)
+            {
+                lan->in_len += (int)n;
+                lan->bytes_in += (unsigned long)n;
+            }
+        }
+        else if(ready_input)
+            return LAN_INPUT;
+        else if(timeout_ms >= 0 && clock_now() >= deadline)
+            return LAN_TIMEOUT;
+    }
+}
+
+void lan_apply(const lan_msg_t* msg, int field[FIELD_ROWS][FIELD_COLS])
+{
+    int r;
+
+    for(r = 0; r < FIELD_ROWS; r++)
+        if(msg->rows >> r & 1)
+            memcpy(field[r], msg->cells[r], sizeof(int) * FIELD_COLS);
+}
+
+unsigned long lan_summary(const lan_t* lan, char* out)
+{
+    sprintf(out, "Rete ms: p50 %.1f p99 %.1f max %.1f",
+            histogram_percentile(&lan->rtt, 50) / 1e6,
+            histogram_percentile(&lan->rtt, 99) / 1e6,
+            lan->rtt.max / 1e6);
+
+    return lan->rtt.total;
+}
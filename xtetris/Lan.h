@@ -0,0 +1,216 @@
+/**
+* @file Lan.h
+* @author Albert Alibeaj
+* @brief Libreria per le partite in rete tra due giochi, su TCP o socket Unix.
+ *
+ * Chi ospita ascolta su un indirizzo (<code>host:porta</code>, <code>:porta</code> per tutte le interfacce,
+ * o il percorso di un socket Unix se contiene '/'), chi si unisce si collega allo stesso indirizzo.
+ * Entrambi applicano le stesse regole di multi_start_game; ognuno gioca i propri turni e invia
+ * all'altro solo quanto serve per aggiornare la propria metà dello schermo.
+ *
+ * Protocollo: messaggi binari con un byte di tipo, un byte di lunghezza e il contenuto (interi little endian):
+ *  - LAN_HELLO: versione (1), seme della partita (4), giocatore di chi riceve (1)
+ *  - LAN_MOVE: numero (2), tetramino (1), rotazione (1), colonna (1), punti (1, -1 se la mossa fa perdere),
+ *    righe cambiate del campo di chi ha mosso (3, una per bit) e per ognuna le FIELD_COLS celle (4 bit ciascuna)
+ *  - LAN_ACK: numero della mossa ricevuta (2), inviato appena arriva, per misurare il tempo di andata e ritorno
+ *  - LAN_BYE: chi lo invia esce dalla partita
+ *
+ * L'attesa dei messaggi usa epoll (poll dove non esiste) e può controllare insieme un altro descrittore,
+ * per esempio la tastiera
+*/
+
+#ifndef XTETRIS2_LAN_H
+#define XTETRIS2_LAN_H
+
+#include "Histogram.h"
+#include "Placements.h"
+
+/** Versione del protocollo */
+#define LAN_VERSION 1
+/** Byte del buffer di ricezione */
+#define LAN_BUF 1024
+/** Byte massimi di un messaggio: tipo, lunghezza e contenuto */
+#define LAN_FRAME (2 + 255)
+/** Mosse in attesa di conferma di cui si ricorda l'istante di invio */
+#define LAN_PENDING 64
+
+/** Tipi di messaggio, e risultati di lan_wait */
+typedef enum LanType
+{
+    LAN_CLOSED = -1,    /**< collegamento chiuso o errore (solo lan_wait) */
+    LAN_TIMEOUT = 0,    /**< tempo scaduto (solo lan_wait) */
+    LAN_HELLO = 1,      /**< inizio partita */
+    LAN_MOVE,           /**< mossa */
+    LAN_ACK,            /**< conferma di una mossa */
+    LAN_BYE,            /**< uscita dalla partita */
+    LAN_INPUT           /**< il descrittore aggiuntivo è pronto (solo lan_wait) */
+
+} lan_type_t;
+
+/** Tipo lan_msg_t
+*   Messaggio ricevuto
+*/
+typedef struct LanMsg
+{
+    int type;                           /**< tipo (lan_type_t) */
+    unsigned int seq;                   /**< numero della mossa */
+    int version;                        /**< versione del protocollo (LAN_HELLO) */
+    unsigned long seed;                 /**< seme della partita (LAN_HELLO) */
+    int player;                         /**< giocatore di chi riceve (LAN_HELLO) */
+    placement_t move;                   /**< mossa (LAN_MOVE) */
+    int score;                          /**< punti della mossa, -1 se fa perdere (LAN_MOVE) */
+    unsigned long rows;                 /**< righe cambiate, una per bit (LAN_MOVE) */
+    int cells[FIELD_ROWS][FIELD_COLS];  /**< nuovo contenuto delle righe cambiate (LAN_MOVE) */
+
+} lan_msg_t;
+
+/** Tipo lan_t
+*   Collegamento con l'altro gioco
+*/
+typedef struct Lan
+{
+    int fd;                             /**< socket collegato */
+    int poll_fd;                        /**< descrittore di epoll (-1 senza epoll) */
+    int input_fd;                       /**< descrittore aggiuntivo controllato da lan_wait (-1 nessuno) */
+    unsigned char in[LAN_BUF];          /**< byte ricevuti non ancora elaborati */
+    int in_len;                         /**< byte validi in in */
+    unsigned int next_seq;              /**< numero della prossima mossa inviata */
+    double sent[LAN_PENDING];           /**< istante di invio delle ultime mosse, per numero */
+
+    histogram_t rtt;                    /**< tempo di andata e ritorno delle mosse, in nanosecondi */
+    unsigned long bytes_out;            /**< byte inviati */
+    unsigned long bytes_in;             /**< byte ricevuti */
+
+} lan_t;
+
+/**
+* Ascolta su un indirizzo, accetta il primo avversario e gli invia LAN_HELLO
+ * @param lan collegamento da inizializzare
+ * @param address indirizzo su cui ascoltare
+ * @param seed seme della partita, inviato all'avversario
+ * @return 0 se l'avversario ha risposto con LAN_HELLO, -1 altrimenti
+*/
+int lan_host(lan_t* lan, const char* address, unsigned long seed);
+
+/**
+* Si collega a chi ospita e ne attende LAN_HELLO
+ * @param lan collegamento da inizializzare
+ * @param address indirizzo di chi ospita
+ * @param seed seme della partita ricevuto
+ * @param player giocatore assegnato da chi ospita (2 con xtetris -l, 1 o 2 con xtetris-server)
+ * @return 0 se il collegamento è pronto, -1 altrimenti
+*/
+int lan_join(lan_t* lan, const char* address, unsigned long* seed, int* player);
+
+/**
+* Chiude il collegamento
+ * @param lan collegamento
+*/
+void lan_close(lan_t* lan);
+
+/**
+* Apre un socket in ascolto (usato anche da xtetris-server)
+ * @param address indirizzo su cui ascoltare
+ * @return descrittore del socket, -1 in caso di errore
+*/
+int lan_listen(const char* address);
+
+/**
+* Si collega a un indirizzo (usato anche dal generatore di carico di xtetris-server)
+ * @param address indirizzo a cui collegarsi
+ * @return descrittore del socket, -1 in caso di errore
+*/
+int lan_connect(const char* address);
+
+/**
+* Prepara un collegamento su un socket già collegato
+ * @param lan collegamento da inizializzare
+ * @param fd socket collegato
+ * @return 0 se il collegamento è pronto, -1 altrimenti
+*/
+int lan_attach(lan_t* lan, int fd);
+
+/**
+* Imposta il descrittore aggiuntivo controllato da lan_wait
+ * @param lan collegamento
+ * @param fd descrittore (-1 per nessuno)
+*/
+void lan_watch(lan_t* lan, int fd);
+
+/**
+* Invia LAN_HELLO
+ * @param lan collegamento
+ * @param seed seme della partita
+ * @param player giocatore di chi riceve
+ * @return 0 se il messaggio è stato inviato, -1 altrimenti
+*/
+int lan_send_hello(lan_t* lan, unsigned long seed, int player);
+
+/**
+* Invia una mossa con le righe del campo che ha cambiato
+ * @param lan collegamento
+ * @param move mossa giocata
+ * @param score punti della mossa, -1 se fa perdere
+ * @param before campo prima della mossa
+ * @param after campo dopo la mossa
+ * @return 0 se il messaggio è stato inviato, -1 altrimenti
+*/
+int lan_send_move(lan_t* lan, placement_t move, int score, int before[FIELD_ROWS][FIELD_COLS], int after[FIELD_ROWS][FIELD_COLS]);
+
+/**
+* Invia LAN_BYE
+ * @param lan collegamento
+*/
+void lan_send_bye(lan_t* lan);
+
+/**
+* Attende il prossimo messaggio. Risponde da sola alle mosse con LAN_ACK e registra
+ * il tempo di andata e ritorno delle conferme ricevute, senza restituirle
+ * @param lan collegamento
+ * @param msg messaggio ricevuto
+ * @param timeout_ms millisecondi di attesa al massimo (-1 senza limite)
+ * @return tipo del messaggio, LAN_INPUT, LAN_TIMEOUT o LAN_CLOSED
+*/
+int lan_wait(lan_t* lan, lan_msg_t* msg, int timeout_ms);
+
+/**
+* Riempie le righe cambiate di un messaggio LAN_MOVE confrontando il campo prima e dopo la mossa
+ * @param msg messaggio da completare
+ * @param before campo prima della mossa
+ * @param after campo dopo la mossa
+*/
+void lan_diff(lan_msg_t* msg, int before[FIELD_ROWS][FIELD_COLS], int after[FIELD_ROWS][FIELD_COLS]);
+
+/**
+* Scrive un messaggio nel formato del protocollo, per chi gestisce da sé i socket (xtetris-server)
+ * @param msg messaggio (per LAN_MOVE contano solo le righe indicate in rows)
+ * @param frame byte del messaggio
+ * @return byte scritti
+*/
+int lan_encode(const lan_msg_t* msg, unsigned char frame[LAN_FRAME]);
+
+/**
+* Legge il primo messaggio di un buffer di byte ricevuti
+ * @param buf byte ricevuti
+ * @param size byte validi in buf
+ * @param msg messaggio letto (per LAN_MOVE sono valide solo le righe indicate in rows)
+ * @return byte del messaggio da togliere dal buffer, 0 se il messaggio non è completo, -1 se non è valido
+*/
+int lan_decode(const unsigned char* buf, int size, lan_msg_t* msg);
+
+/**
+* Applica a un campo le righe cambiate da una mossa ricevuta
+ * @param msg messaggio LAN_MOVE
+ * @param field campo di chi ha mosso
+*/
+void lan_apply(const lan_msg_t* msg, int field[FIELD_ROWS][FIELD_COLS]);
+
+/**
+* Riassume il tempo di andata e ritorno delle mosse
+ * @param lan collegamento
+ * @param out stringa di almeno 64 caratteri
+ * @return numero di mosse confermate
+*/
+unsigned long lan_summary(const lan_t* lan, char* out);
+
+#endif /*XTETRIS2_LAN_H*/
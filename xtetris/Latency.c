@@ -0,0 +1,78 @@
+/**
+* @file Latency.c
+* @author Albert Alibeaj
+* @brief File di implementazione della misura della latenza dei tasti
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Latency.h"
+#include "Clock.h"
+
+histogram_t latency_hist;           /**< latenze registrate, in microsecondi */
+int latency_pending = 0;            /**< 1 se l'ultimo tasto letto non è ancora stato registrato */
+double latency_key_time;            /**< istante di lettura dell'ultimo tasto */
+double latency_frame_time;          /**< istante dell'ultima schermata inviata dopo il tasto (0 se nessuna) */
+
+void latency_reset()
+{
+    histogram_clear(&latency_hist);
+    latency_pending = 0;
+}
+
+void latency_key()
+{
+    latency_key_time = clock_now();
+    latency_frame_time = 0;
+    latency_pending = 1;
+}
+
+void latency_frame()
+{
+    if(latency_pending)
+        latency_frame_time = clock_now();
+}
+
+void latency_wait()
+{
+    /* I tasti che non cambiano la schermata non vengono contati */
+    if(latency_pending && latency_frame_time > 0)
+        histogram_record(&latency_hist, (unsigned long)((latency_frame_time - latency_key_time) * 1e6));
+
+    latency_pending = 0;
+}
+
+const histogram_t* latency_histogram()
+{
+    return &latency_hist;
+}
+
+unsigned long latency_summary(char* out)
+{
+    sprintf(out, "Latenza ms: p50 %.1f p99 %.1f p999 %.1f",
+            histogram_percentile(&latency_hist, 50) / 1000.0,
+            histogram_percentile(&latency_hist, 99) / 1000.0,
+            histogram_percentile(&latency_hist, 99.9) / 1000.0);
+
+    return latency_hist.total;
+}
+
+void latency_save(const char* label)
+{
+    const char* path = getenv("XTETRIS_LATENCY_FILE");
+    FILE* out;
+
+    if(!path || !*path || !(out = fopen(path, "a")))
+        return;
+
+    fprintf(out, "# %s: %lu tasti, latenza in us min %lu p50 %lu p99 %lu p999 %lu max %lu\n",
+            label, latency_hist.total, latency_hist.min,
+            histogram_percentile(&latency_hist, 50),
+            histogram_percentile(&latency_hist, 99),
+            histogram_percentile(&latency_hist, 99.9),
+            latency_hist.max);
+    fprintf(out, "# da_us a_us tasti\n");
+    histogram_write(&latency_hist, out);
+
+    fclose(out);
+}
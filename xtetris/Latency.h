@@ -0,0 +1,58 @@
+/**
+* @file Latency.h
+* @author Albert Alibeaj
+* @brief Libreria che misura la latenza tra la lettura di un tasto e l'invio al terminale
+ * dell'ultima schermata che ne deriva, prima che venga atteso il tasto successivo.
+ * Va usata solo dal thread che gestisce la grafica
+*/
+
+#ifndef XTETRIS2_LATENCY_H
+#define XTETRIS2_LATENCY_H
+
+#include "Histogram.h"
+
+/** Lunghezza massima del riepilogo restituito da latency_summary */
+#define LATENCY_SUMMARY_LEN 64
+
+/**
+* Azzera le misure (da chiamare all'inizio di ogni partita)
+*/
+void latency_reset();
+
+/**
+* Segnala che è stato letto un tasto
+*/
+void latency_key();
+
+/**
+* Segnala che una schermata è stata inviata al terminale
+*/
+void latency_frame();
+
+/**
+* Segnala che si sta per attendere un tasto: se l'ultimo tasto ha prodotto
+ * delle schermate, la latenza fino all'ultima viene registrata
+*/
+void latency_wait();
+
+/**
+* Latenze registrate dall'ultimo azzeramento, in microsecondi
+ * @return istogramma delle latenze
+*/
+const histogram_t* latency_histogram();
+
+/**
+* Riepilogo delle latenze registrate, da mostrare a fine partita
+ * @param out stringa di almeno LATENCY_SUMMARY_LEN caratteri da riempire
+ * @return numero di latenze registrate
+*/
+unsigned long latency_summary(char* out);
+
+/**
+* Se la variabile d'ambiente XTETRIS_LATENCY_FILE è impostata, aggiunge a quel file
+ * i percentili e gli intervalli dell'istogramma
+ * @param label nome della partita da scrivere nell'intestazione
+*/
+void latency_save(const char* label);
+
+#endif /*XTETRIS2_LATENCY_H*/
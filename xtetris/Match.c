@@ -0,0 +1,76 @@
+/**
+* @file Match.c
+* @author Albert Alibeaj
+* @brief File di implementazione dell'arbitro delle partite a due
+*/
+
+#include <string.h>
+#include "Match.h"
+#include "EventLog.h"
+
+/**
+* Conclude il giro dopo la mossa del giocatore 2, come il controllo a fine ciclo di multi_start_game
+ * @param match partita
+*/
+void match_round(match_t* match);
+
+void match_init(match_t* match, unsigned long seed)
+{
+    memset(match, 0, sizeof(*match));
+    state_init(&match->state, STATE_PLAYERS, seed);
+}
+
+int match_move(match_t* match, const tet_t tets[TET_TYPES], int player, placement_t move)
+{
+    state_undo_t undo;
+    int score;
+
+    if(player != match->turn || move.id < 0 || move.id >= TET_TYPES || match->state.quantities[move.id] <= 0
+       || move.rot < 0 || move.rot >= 4 || move.col < 0 || move.col >= FIELD_COLS)
+        return -2;
+
+    score = state_make(&match->state, tets, player, move, &undo);
+    match->lost[player] = score < 0;
+
+    if(player == 0)
+        match->turn = 1;
+    else
+        match_round(match);
+    return score;
+}
+
+void match_round(match_t* match)
+{
+    int i, left = 0;
+
+    for(i = 0; i < TET_TYPES; i++)
+        left += match->state.quantities[i];
+
+    match->turn = 0;
+    if(match->lost[0] && match->lost[1])
+        match->reason = EVENT_END_BOTH_LOST;
+    else if(match->lost[0] || match->lost[1])
+    {
+        match->reason = EVENT_END_LOST;
+        match->winner = match->lost[0] ? 2 : 1;
+    }
+    else if(left == 0)
+    {
+        /* Pezzi terminati: vale il punteggio più alto */
+        match->reason = EVENT_END_PIECES;
+        match->winner = match->state.scores[0] > match->state.scores[1] ? 1 : match->state.scores[1] > match->state.scores[0] ? 2 : 0;
+    }
+
+    if(match->reason)
+        match->turn = -1;
+}
+
+void match_leave(match_t* match, int player)
+{
+    if(match->reason)
+        return;
+    match->reason = EVENT_END_EXIT;
+    match->winner = 0;
+    match->exited = player + 1;
+    match->turn = -1;
+}
@@ -0,0 +1,54 @@
+/**
+* @file Match.h
+* @author Albert Alibeaj
+* @brief Libreria che arbitra una partita a due come macchina a stati: riceve una mossa alla volta,
+ * la controlla, la applica e dice di chi è il turno o come è finita la partita, senza attendere
+ * nulla. Le regole sono quelle di multi_start_game: il giocatore 1 muove per primo, il giocatore 2
+ * risponde sempre, e a fine giro la partita termina se qualcuno ha perso o i tetramini sono finiti.
+ * Le funzioni non usano dati globali: xtetris-server ne tiene migliaia insieme
+*/
+
+#ifndef XTETRIS2_MATCH_H
+#define XTETRIS2_MATCH_H
+
+#include "State.h"
+
+/** Tipo match_t
+*   Partita arbitrata
+*/
+typedef struct Match
+{
+    game_state_t state;                 /**< stato della partita */
+    int turn;                           /**< indice del giocatore di turno (0 o 1), -1 a partita finita */
+    int lost[STATE_PLAYERS];            /**< 1 se il giocatore ha perso nel giro in corso */
+    int reason;                         /**< motivo della fine (event_end_t), 0 se la partita è in corso */
+    int winner;                         /**< giocatore vincitore (1 o 2, 0 se nessuno) */
+    int exited;                         /**< giocatore uscito dalla partita (0 se nessuno) */
+
+} match_t;
+
+/**
+* Inizia una partita
+ * @param match partita da inizializzare
+ * @param seed seme della partita
+*/
+void match_init(match_t* match, unsigned long seed);
+
+/**
+* Applica la mossa del giocatore di turno
+ * @param match partita in corso
+ * @param tets tetramini da cui prendere le forme (non vengono modificati)
+ * @param player indice del giocatore che muove (0 o 1)
+ * @param move mossa
+ * @return punti guadagnati, -1 se la mossa fa perdere, -2 se non è il turno del giocatore o la mossa non è valida
+*/
+int match_move(match_t* match, const tet_t tets[TET_TYPES], int player, placement_t move);
+
+/**
+* Termina la partita perché un giocatore è uscito
+ * @param match partita
+ * @param player indice del giocatore uscito (0 o 1)
+*/
+void match_leave(match_t* match, int player);
+
+#endif /*XTETRIS2_MATCH_H*/
@@ -5,6 +5,7 @@
 */
 
 #include "Moves.h"
+#include "Profile.h"
 
 /**
 * Sposta il tetramino in basso e a sinistra (toglie le prime colonne e le ultime righe vuote)
@@ -58,10 +59,11 @@ int tet_last_solid(tet_t tet, int col)
 int insert(int field[FIELD_ROWS][FIELD_COLS], tet_t* tet, int column, int rotation)
 {
     int width;
-    int collision = 0, collision_row = FIELD_ROWS - 1;
-    int i, insert_row;
+    int insert_row;
     int score;
+    PROFILE_DECL;
 
+    PROFILE_BEGIN();
     reset_shape(tet);
     rotate_dx(tet, rotation);
 
@@ -70,6 +72,28 @@ int insert(int field[FIELD_ROWS][FIELD_COLS], tet_t* tet, int column, int rotati
     if(FIELD_COLS - column < width)
         column = FIELD_COLS - width;
 
+    insert_row = drop_row(field, tet, column);
+    insert_at_pos(field, *tet, insert_row, column);
+
+    tet->quantity--;
+    reset_shape(tet);
+
+    score = getscore(field, insert_row, tet->shape_len); /* Rimuove le righe piene */
+
+    /* Viene ritornato un valore positivo solo se la mossa è valida */
+    if(!is_empty_row(field, INVALID_ROWS - 1))
+        score = -1;
+
+    PROFILE_END(PROFILE_INSERT);
+    return score;
+}
+
+int drop_row(int field[FIELD_ROWS][FIELD_COLS], const tet_t* tet, int column)
+{
+    int width = tet_width(*tet);
+    int collision = 0, collision_row = FIELD_ROWS - 1;
+    int i;
+
     for(i = tet->shape_len; i < FIELD_ROWS && !collision; i++)
     {
         int j;
@@ -89,25 +113,15 @@ int insert(int field[FIELD_ROWS][FIELD_COLS], tet_t* tet, int column, int rotati
         }
     }
 
-    insert_row = collision_row - (tet->shape_len - 1);
-    insert_at_pos(field, *tet, insert_row, column);
-
-    tet->quantity--;
-    reset_shape(tet);
-
-    score = getscore(field, insert_row, tet->shape_len); /* Rimuove le righe piene */
-
-    /* Viene ritornato un valore positivo solo se la mossa è valida */
-    if(is_empty_row(field, INVALID_ROWS - 1))
-        return score;
-    else
-        return -1;
+    return collision_row - (tet->shape_len - 1);
 }
 
 void rotate_dx(tet_t* tet, int n)
 {
     int count;
+    PROFILE_DECL;
 
+    PROFILE_BEGIN();
     n %= tet->rot_number;
     for(count = 0; count < n; count++)
     {
@@ -144,6 +158,7 @@ void rotate_dx(tet_t* tet, int n)
     }
 
     tet_adjust(tet);
+    PROFILE_END(PROFILE_ROTATE_DX);
 }
 
 void rotate_sx(tet_t* tet, int n)
@@ -174,6 +189,9 @@ void tet_adjust(tet_t* tet)
     /* spostamento a sinistra */
     /* si controlla la prima colonna e se è vuota si shifta la matrice a sinistra e si riparte finchè non è più vuota */
     int i, r, c;
+    PROFILE_DECL;
+
+    PROFILE_BEGIN();
     for(i = 0; i < tet->shape_len; i++)
     {
         int first_col = 0;
@@ -231,6 +249,8 @@ void tet_adjust(tet_t* tet)
             }
         }
     }
+
+    PROFILE_END(PROFILE_TET_ADJUST);
 }
 
 /**
@@ -241,19 +261,26 @@ void tet_adjust(tet_t* tet)
 void deleterow(int field[FIELD_ROWS][FIELD_COLS], int row)
 {
     int i, j;
+    PROFILE_DECL;
 
+    PROFILE_BEGIN();
     for(i = row; i > 0; i--)
         for(j = 0; j < FIELD_COLS; j++)
             field[i][j] = field[i - 1][j];
 
     for(j = 0; j < FIELD_COLS; j++)
         field[0][j] = 0;
+
+    PROFILE_END(PROFILE_DELETEROW);
 }
 
 int getscore(int field[FIELD_ROWS][FIELD_COLS], int row, int len)
 {
    int i, j;
    int score = 0;
+   PROFILE_DECL;
+
+   PROFILE_BEGIN();
    for(i = 0; i < len; i++)
    {
        int filled = 1;
@@ -279,9 +306,18 @@ int getscore(int field[FIELD_ROWS][FIELD_COLS], int row, int len)
        default: score = 12; break;
    }
 
+   PROFILE_END(PROFILE_GETSCORE);
    return score;
 }
 
+void xor_rows(int field[FIELD_ROWS][FIELD_COLS], int rows)
+{
+    int r, c;
+    for(r = FIELD_ROWS - 1; r > FIELD_ROWS - 1 - rows; r--)
+        for(c = 0; c < FIELD_COLS; c++)
+            field[r][c] = field[r][c] ? 0 : TET_TYPES + 2;
+}
+
 void reset_shape(tet_t* tet)
 {
     int i, j;
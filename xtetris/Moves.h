@@ -22,6 +22,15 @@
 */
 int insert(int field[FIELD_ROWS][FIELD_COLS], tet_t* tet, int column, int rotation);
 
+/**
+* Calcola dove si ferma la caduta di un tetramino, senza modificare il campo
+ * @param field campo su cui far cadere il tetramino
+ * @param tet tetramino, già ruotato
+ * @param column colonna del campo in cui cade il tetramino (già corretta in base alla larghezza)
+ * @return riga del campo in cui va la prima riga della forma
+*/
+int drop_row(int field[FIELD_ROWS][FIELD_COLS], const tet_t* tet, int column);
+
 
 /**
 * Ruota un tetramino a destra (90°) a partire dalla forma corrente
@@ -38,6 +47,13 @@ void rotate_dx(tet_t* tet, int n);
 void rotate_sx(tet_t* tet, int n);
 
 
+/**
+* Inverte le ultime righe del campo
+ * @param field campo su cui inveritire le righe
+ * @param rows numero di righe a partire dal basso da invertire
+*/
+void xor_rows(int field[FIELD_ROWS][FIELD_COLS], int rows);
+
 /**
 * Riporta la forma corrente di un tetramino alla forma base ruotandolo
  * @param tet array di cui ripristinare la forma iniziale
@@ -0,0 +1,371 @@
+/**
+* @file Net.c
+* @author Albert Alibeaj
+* @brief File di implementazione della valutazione con rete neurale,
+ * con primo strato in versione AVX2 e versione scalare scelte a runtime
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Net.h"
+#include "Features.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NET_X86
+#include <immintrin.h>
+#endif
+
+/** Campi valutati insieme da ogni passaggio sugli strati (limita la memoria delle attivazioni) */
+#define NET_BLOCK 32
+
+/** Tipo della funzione che calcola il primo strato per un blocco di campi */
+typedef void (*layer0_fn)(const net_t* net, const short* inputs, int n, float* out);
+
+layer0_fn layer0 = NULL;            /**< implementazione del primo strato, NULL finchè layer0_select non la pubblica (una volta sola) */
+
+/**
+* Versione scalare del primo strato
+ * @param net rete
+ * @param inputs n righe di NET_INPUTS_PAD ingressi
+ * @param n numero di campi (al massimo NET_BLOCK)
+ * @param out n righe di NET_MAX_WIDTH attivazioni da riempire
+*/
+void layer0_scalar(const net_t* net, const short* inputs, int n, float* out);
+
+/**
+* Sceglie l'implementazione del primo strato in base alla CPU (solo alla prima chiamata)
+ * @return funzione da usare
+*/
+layer0_fn layer0_select();
+
+/**
+* Legge un intero a 32 bit little endian
+ * @param in 4 byte da leggere
+ * @return valore
+*/
+unsigned long net_get32(const unsigned char* in);
+
+/**
+* Scrive un intero a 32 bit little endian
+ * @param out 4 byte da riempire
+ * @param value valore
+*/
+void net_put32(unsigned char* out, unsigned long value);
+
+unsigned long net_get32(const unsigned char* in)
+{
+    return (unsigned long)in[0] | (unsigned long)in[1] << 8 | (unsigned long)in[2] << 16 | (unsigned long)in[3] << 24;
+}
+
+void net_put32(unsigned char* out, unsigned long value)
+{
+    out[0] = (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    out[3] = (unsigned char)(value >> 24);
+}
+
+int net_load(net_t* net, const char* path)
+{
+    const unsigned char* base;
+    const unsigned one = 1;
+    struct stat st;
+    size_t offset;
+    int fd, l;
+
+    memset(net, 0, sizeof(*net));
+
+    /* I float del file vengono letti direttamente: serve una macchina little endian */
+    if(*(const unsigned char*)&one != 1)
+        return -1;
+
+    fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return -1;
+    if(fstat(fd, &st) != 0 || st.st_size < NET_HEADER_LEN)
+    {
+        close(fd);
+        return -1;
+    }
+    net->map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(net->map == MAP_FAILED)
+    {
+        net->map = NULL;
+        return -1;
+    }
+    net->len = (size_t)st.st_size;
+    base = (const unsigned char*)net->map;
+
+    net->layers = (int)net_get32(base + 12);
+    net->sizes[0] = (int)net_get32(base + 8);
+    if(memcmp(base, NET_MAGIC, 8) != 0 || net->sizes[0] != NET_INPUTS || net->layers < 1 || net->layers > NET_MAX_LAYERS)
+    {
+        net_free(net);
+        return -1;
+    }
+
+    /* Dimensioni degli strati e posizione di ogni blocco di pesi */
+    offset = NET_HEADER_LEN;
+    for(l = 0; l < net->layers; l++)
+    {
+        int in = net->sizes[l], out = (int)net_get32(base + 16 + 4 * l);
+
+        if(out < 1 || out > NET_MAX_WIDTH || (l == net->layers - 1 && out != 1))
+        {
+            net_free(net);
+            return -1;
+        }
+        net->sizes[l + 1] = out;
+
+        if(l == 0)
+        {
+            net->scale = (const float*)(base + offset);
+            net->bias[0] = net->scale + out;
+            offset += sizeof(float) * 2 * out;
+            net->w0 = (const signed char*)(base + offset);
+            offset += (size_t)NET_INPUTS_PAD * out;
+        }
+        else
+        {
+            net->bias[l] = (const float*)(base + offset);
+            net->w[l] = net->bias[l] + out;
+            offset += sizeof(float) * ((size_t)out + (size_t)out * in);
+        }
+    }
+    if(offset > net->len)
+    {
+        net_free(net);
+        return -1;
+    }
+
+    return 0;
+}
+
+void net_free(net_t* net)
+{
+    if(net->map)
+        munmap(net->map, net->len);
+    memset(net, 0, sizeof(*net));
+}
+
+void net_inputs(int field[FIELD_ROWS][FIELD_COLS], int score, short out[NET_INPUTS_PAD])
+{
+    features_t f;
+    double v[COM_WEIGHTS];
+    const int* cells = &field[0][0];
+    int i, k = 0;
+
+    features_extract(field, &f);
+    com_feature_vector(&f, score, v);
+
+    for(i = 0; i < COM_WEIGHTS; i++)
+        out[k++] = (short)v[i];
+    for(i = 0; i < FIELD_COLS; i++)
+        out[k++] = (short)f.heights[i];
+    for(i = 0; i < FIELD_ROWS * FIELD_COLS; i++)
+        out[k + i] = cells[i] != 0;
+    for(i = NET_INPUTS; i < NET_INPUTS_PAD; i++)
+        out[i] = 0;
+}
+
+void layer0_scalar(const net_t* net, const short* inputs, int n, float* out)
+{
+    int j, k, i;
+
+    for(k = 0; k < n; k++)
+    {
+        const short* x = inputs + (size_t)k * NET_INPUTS_PAD;
+        for(j = 0; j < net->sizes[1]; j++)
+        {
+            const signed char* w = net->w0 + (size_t)j * NET_INPUTS_PAD;
+            long acc = 0;
+            float h;
+
+            for(i = 0; i < NET_INPUTS; i++)
+                acc += (long)w[i] * x[i];
+            h = (float)acc * net->scale[j] + net->bias[0][j];
+            out[k * NET_MAX_WIDTH + j] = h > 0 ? h : 0;
+        }
+    }
+}
+
+#ifdef NET_X86
+/**
+* Versione AVX2 del primo strato: ogni riga di pesi viene estesa a 16 bit e moltiplicata
+ * per quattro campi alla volta, 16 prodotti per istruzione
+ * @param net rete
+ * @param inputs n righe di NET_INPUTS_PAD ingressi
+ * @param n numero di campi (al massimo NET_BLOCK)
+ * @param out n righe di NET_MAX_WIDTH attivazioni da riempire
+*/
+__attribute__((target("avx2")))
+void layer0_avx2(const net_t* net, const short* inputs, int n, float* out)
+{
+    static const short zero[NET_INPUTS_PAD] = {0};
+    int j, k, i, q;
+
+    for(k = 0; k < n; k += 4)
+    {
+        const short* x[4];
+        int count = n - k < 4 ? n - k : 4;
+
+        /* L'ultimo gruppo viene completato con righe nulle, così il ciclo interno ha sempre quattro campi */
+        for(q = 0; q < 4; q++)
+            x[q] = q < count ? inputs + (size_t)(k + q) * NET_INPUTS_PAD : zero;
+
+        for(j = 0; j < net->sizes[1]; j++)
+        {
+            const signed char* w = net->w0 + (size_t)j * NET_INPUTS_PAD;
+            __m256i acc0 = _mm256_setzero_si256(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+            __m256i h;
+            __m128i s;
+            __m128 v;
+            float r[4];
+
+            for(i = 0; i < NET_INPUTS_PAD; i += 16)
+            {
+                __m256i wv = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(w + i)));
+                acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(wv, _mm256_loadu_si256((const __m256i*)(x[0] + i))));
+                acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(wv, _mm256_loadu_si256((const __m256i*)(x[1] + i))));
+                acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(wv, _mm256_loadu_si256((const __m256i*)(x[2] + i))));
+                acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(wv, _mm256_loadu_si256((const __m256i*)(x[3] + i))));
+            }
+
+            /* Somme orizzontali dei quattro accumulatori insieme, poi scala, bias e ReLU */
+            h = _mm256_hadd_epi32(_mm256_hadd_epi32(acc0, acc1), _mm256_hadd_epi32(acc2, acc3));
+            s = _mm_add_epi32(_mm256_castsi256_si128(h), _mm256_extracti128_si256(h, 1));
+            v = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(s), _mm_set1_ps(net->scale[j])), _mm_set1_ps(net->bias[0][j]));
+            _mm_storeu_ps(r, _mm_max_ps(v, _mm_setzero_ps()));
+            for(q = 0; q < count; q++)
+                out[(k + q) * NET_MAX_WIDTH + j] = r[q];
+        }
+    }
+}
+#endif
+
+layer0_fn layer0_select()
+{
+    layer0_fn fn = __atomic_load_n(&layer0, __ATOMIC_ACQUIRE);
+    layer0_fn chosen = NULL;
+
+    if(fn)
+        return fn;
+
+    fn = layer0_scalar;
+#ifdef NET_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        fn = layer0_avx2;
+#endif
+
+    /* Le reti valutano anche dai thread di Sched.h e del suggerimento: vale la prima scelta pubblicata */
+    if(!__atomic_compare_exchange_n(&layer0, &chosen, fn, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        fn = chosen;
+    return fn;
+}
+
+const char* net_backend()
+{
+#ifdef NET_X86
+    if(layer0_select() == layer0_avx2)
+        return "avx2";
+#else
+    layer0_select();
+#endif
+    return "scalar";
+}
+
+void net_forward(const net_t* net, const short* inputs, int n, float* out)
+{
+    float a[NET_BLOCK * NET_MAX_WIDTH], b[NET_BLOCK * NET_MAX_WIDTH];
+    layer0_fn first = layer0_select();
+    int start, k, j, i, l;
+
+    for(start = 0; start < n; start += NET_BLOCK)
+    {
+        int count = n - start < NET_BLOCK ? n - start : NET_BLOCK;
+        float* cur = a;
+        float* next = b;
+
+        first(net, inputs + (size_t)start * NET_INPUTS_PAD, count, cur);
+
+        for(l = 1; l < net->layers; l++)
+        {
+            int in = net->sizes[l], outs = net->sizes[l + 1];
+            float* tmp;
+
+            for(k = 0; k < count; k++)
+                for(j = 0; j < outs; j++)
+                {
+                    const float* w = net->w[l] + (size_t)j * in;
+                    const float* x = cur + k * NET_MAX_WIDTH;
+                    float s = net->bias[l][j];
+
+                    for(i = 0; i < in; i++)
+                        s += w[i] * x[i];
+                    /* ReLU su tutti gli strati tranne l'ultimo */
+                    next[k * NET_MAX_WIDTH + j] = l < net->layers - 1 && s < 0 ? 0 : s;
+                }
+
+            tmp = cur;
+            cur = next;
+            next = tmp;
+        }
+
+        for(k = 0; k < count; k++)
+            out[start + k] = cur[k * NET_MAX_WIDTH];
+    }
+}
+
+int net_write_linear(const char* path, const com_weights_t* weights, int hidden)
+{
+    size_t len = NET_HEADER_LEN + sizeof(float) * 2 * hidden + (size_t)NET_INPUTS_PAD * hidden
+                 + sizeof(float) * (1 + hidden);
+    unsigned char* buf;
+    float* scale;
+    float* bias0;
+    signed char* w0;
+    float* bias1;
+    float* w1;
+    FILE* out;
+    int i, ok;
+
+    if(hidden < COM_WEIGHTS || hidden > NET_MAX_WIDTH)
+        return -1;
+
+    buf = (unsigned char*)calloc(1, len);
+    memcpy(buf, NET_MAGIC, 8);
+    net_put32(buf + 8, NET_INPUTS);
+    net_put32(buf + 12, 2);
+    net_put32(buf + 16, (unsigned long)hidden);
+    net_put32(buf + 20, 1);
+
+    scale = (float*)(buf + NET_HEADER_LEN);
+    bias0 = scale + hidden;
+    w0 = (signed char*)(bias0 + hidden);
+    bias1 = (float*)(w0 + (size_t)NET_INPUTS_PAD * hidden);
+    w1 = bias1 + 1;
+
+    /* Le caratteristiche non sono mai negative: ReLU le lascia passare invariate */
+    for(i = 0; i < hidden; i++)
+        scale[i] = 1;
+    for(i = 0; i < COM_WEIGHTS; i++)
+    {
+        w0[(size_t)i * NET_INPUTS_PAD + i] = 1;
+        w1[i] = (float)weights->w[i];
+    }
+
+    out = fopen(path, "wb");
+    ok = out && fwrite(buf, len, 1, out) == 1 ? 0 : -1;
+    if(out && fclose(out) != 0)
+        ok = -1;
+    free(buf);
+
+    return ok;
+}
@@ -0,0 +1,101 @@
+/**
+* @file Net.h
+* @author Albert Alibeaj
+* @brief Libreria che valuta i campi con una piccola rete neurale (percettrone multistrato)
+ * letta da un file mappato in memoria, in alternativa alla valutazione lineare del computer.
+ *
+ * Ingressi (NET_INPUTS valori interi non negativi): le caratteristiche di com_feature_vector,
+ * le altezze delle colonne e un bit per ogni cella del campo (riga per riga).
+ * Il primo strato usa pesi a 8 bit con una scala per ogni uscita ed è calcolato con AVX2
+ * quando la CPU lo supporta; gli strati successivi usano pesi float. Gli strati nascosti
+ * usano ReLU, l'ultimo ha una sola uscita lineare: la valutazione.
+ *
+ * Formato del file (little endian): intestazione di NET_HEADER_LEN byte con NET_MAGIC,
+ * ingressi (4 byte), strati (4), uscite di ogni strato (4 x NET_MAX_LAYERS); poi per il primo
+ * strato scale e bias (float per uscita) e pesi (int8, NET_INPUTS_PAD per uscita, zeri in fondo);
+ * poi per ogni altro strato bias (float per uscita) e pesi (float, ingressi per uscita)
+*/
+
+#ifndef XTETRIS2_NET_H
+#define XTETRIS2_NET_H
+
+#include <stddef.h>
+#include "Com.h"
+
+/** Intestazione del file */
+#define NET_MAGIC "XTNET001"
+/** Byte dell'intestazione del file */
+#define NET_HEADER_LEN 64
+/** Strati massimi */
+#define NET_MAX_LAYERS 4
+/** Uscite massime di uno strato */
+#define NET_MAX_WIDTH 256
+/** Ingressi della rete */
+#define NET_INPUTS (COM_WEIGHTS + FIELD_COLS + FIELD_ROWS * FIELD_COLS)
+/** Ingressi arrotondati a un multiplo di 16 (un registro AVX2 di interi a 16 bit) */
+#define NET_INPUTS_PAD ((NET_INPUTS + 15) / 16 * 16)
+
+/** Tipo net_t
+*   Rete caricata
+*/
+typedef struct Net
+{
+    void* map;                              /**< file mappato in memoria */
+    size_t len;                             /**< byte mappati */
+    int layers;                             /**< strati */
+    int sizes[NET_MAX_LAYERS + 1];          /**< ingressi del primo strato e uscite di ogni strato */
+    const float* scale;                     /**< scala dei pesi del primo strato, per uscita */
+    const signed char* w0;                  /**< pesi del primo strato */
+    const float* bias[NET_MAX_LAYERS];      /**< bias di ogni strato */
+    const float* w[NET_MAX_LAYERS];         /**< pesi degli strati successivi al primo */
+
+} net_t;
+
+/**
+* Carica una rete mappando il file in memoria
+ * @param net rete da inizializzare
+ * @param path file della rete
+ * @return 0 se la rete è stata caricata, -1 se il file manca o non è valido
+*/
+int net_load(net_t* net, const char* path);
+
+/**
+* Rilascia una rete caricata
+ * @param net rete
+*/
+void net_free(net_t* net);
+
+/**
+* Calcola gli ingressi della rete per un campo
+ * @param field campo dopo la mossa
+ * @param score punti guadagnati con la mossa (non negativi)
+ * @param out NET_INPUTS_PAD ingressi da riempire
+*/
+void net_inputs(int field[FIELD_ROWS][FIELD_COLS], int score, short out[NET_INPUTS_PAD]);
+
+/**
+* Valuta un blocco di campi con un solo passaggio per strato
+ * @param net rete caricata
+ * @param inputs n righe di NET_INPUTS_PAD ingressi
+ * @param n numero di campi
+ * @param out n valutazioni da riempire
+*/
+void net_forward(const net_t* net, const short* inputs, int n, float* out);
+
+/**
+* Scrive una rete che riproduce la valutazione lineare con i pesi dati: le prime COM_WEIGHTS
+ * unità nascoste copiano le caratteristiche, le altre hanno pesi nulli
+ * @param path file da scrivere
+ * @param weights pesi della valutazione lineare
+ * @param hidden unità nascoste (almeno COM_WEIGHTS)
+ * @return 0 se il file è stato scritto, -1 altrimenti
+*/
+int net_write_linear(const char* path, const com_weights_t* weights, int hidden);
+
+/**
+* Nome dell'implementazione scelta a runtime per il primo strato
+ * @return "avx2" o "scalar"
+*/
+const char* net_backend();
+
+#endif /*XTETRIS2_NET_H*/
@@ -0,0 +1,310 @@
+/**
+* @file Pack.c
+* @author Albert Alibeaj
+* @brief File di implementazione della codifica compatta delle posizioni
+*/
+
+#include <string.h>
+#include "Pack.h"
+
+/** Parole da 32 bit di una posizione senza colori */
+#define PACK_WORDS (PACK_LEN / 4)
+/** Maschera di una riga */
+#define ROW_MASK ((1u << FIELD_COLS) - 1)
+
+/* Le funzioni di codifica di una posizione sono scritte per queste dimensioni */
+#if FIELD_ROWS != 19 || FIELD_COLS != 10 || TET_TYPES != 7 || PACK_QUANTITY_BITS != 6 || PACK_SCORE_BITS != 12
+#error "Pack.c: aggiornare pack_encode_one e pack_decode_one per le nuove dimensioni"
+#endif
+
+/**
+* Codifica una posizione senza colori. I campi hanno posizioni fisse, quindi ogni parola
+ * si costruisce con scorrimenti costanti e senza cicli
+ * @param pos posizione
+ * @param out PACK_LEN byte da riempire
+*/
+void pack_encode_one(const pack_position_t* pos, unsigned char out[PACK_LEN]);
+
+/**
+* Decodifica una posizione senza colori (i colori non vengono toccati)
+ * @param in PACK_LEN byte da leggere
+ * @param pos posizione da riempire
+*/
+void pack_decode_one(const unsigned char in[PACK_LEN], pack_position_t* pos);
+
+/**
+* Scrive una parola da 32 bit in little endian, indipendentemente dalla macchina
+ * (il compilatore riconosce la sequenza e la scrive con una sola istruzione)
+ * @param out 4 byte da riempire
+ * @param w parola
+*/
+void pack_store(unsigned char* out, unsigned int w);
+
+/**
+* Legge una parola da 32 bit in little endian
+ * @param in 4 byte da leggere
+ * @return parola letta
+*/
+unsigned int pack_load(const unsigned char* in);
+
+/**
+* Codifica i colori delle celle occupate di una posizione
+ * @param pos posizione
+ * @param out byte da riempire
+ * @return byte scritti
+*/
+size_t pack_encode_colours(const pack_position_t* pos, unsigned char* out);
+
+/**
+* Decodifica i colori delle celle occupate, che devono essere già state lette
+ * @param in byte da leggere
+ * @param pos posizione di cui riempire i colori
+ * @return byte letti
+*/
+size_t pack_decode_colours(const unsigned char* in, pack_position_t* pos);
+
+/**
+* Limita un valore tra 0 e un massimo
+ * @param value valore
+ * @param max massimo
+ * @return valore limitato
+*/
+unsigned int pack_clamp(int value, int max);
+
+void pack_store(unsigned char* out, unsigned int w)
+{
+    out[0] = (unsigned char)w;
+    out[1] = (unsigned char)(w >> 8);
+    out[2] = (unsigned char)(w >> 16);
+    out[3] = (unsigned char)(w >> 24);
+}
+
+unsigned int pack_load(const unsigned char* in)
+{
+    return (unsigned int)in[0] | (unsigned int)in[1] << 8 | (unsigned int)in[2] << 16 | (unsigned int)in[3] << 24;
+}
+
+unsigned int pack_clamp(int value, int max)
+{
+    return value < 0 ? 0 : value > max ? (unsigned int)max : (unsigned int)value;
+}
+
+void pack_from_field(const int field[FIELD_ROWS][FIELD_COLS], const int quantities[TET_TYPES],
+                     int score, int opponent_score, pack_position_t* pos)
+{
+    int i, j;
+
+    for(i = 0; i < FIELD_ROWS; i++)
+    {
+        unsigned int row = 0, colours = 0;
+        for(j = 0; j < FIELD_COLS; j++)
+        {
+            int v = field[i][j];
+            if(v)
+            {
+                row |= 1u << j;
+                colours |= (unsigned int)(v >= 1 && v <= TET_TYPES ? v - 1 : PACK_COLOUR_OTHER) << (3 * j);
+            }
+        }
+        pos->rows[i] = (unsigned short)row;
+        pos->colours[i] = colours;
+    }
+
+    for(i = 0; i < TET_TYPES; i++)
+        pos->quantities[i] = (unsigned char)pack_clamp(quantities[i], PACK_QUANTITY_MAX);
+    pos->scores[0] = (unsigned short)pack_clamp(score, PACK_SCORE_MAX);
+    pos->scores[1] = (unsigned short)pack_clamp(opponent_score, PACK_SCORE_MAX);
+}
+
+void pack_from_state(const game_state_t* state, int player, pack_position_t* pos)
+{
+    int opponent = state->players > 1 ? state->scores[1 - player] : 0;
+    pack_from_field(state->fields[player], state->quantities, state->scores[player], opponent, pos);
+}
+
+void pack_to_field(const pack_position_t* pos, int field[FIELD_ROWS][FIELD_COLS], int quantities[TET_TYPES], int scores[2])
+{
+    int i, j;
+
+    for(i = 0; i < FIELD_ROWS; i++)
+        for(j = 0; j < FIELD_COLS; j++)
+        {
+            int code = (int)(pos->colours[i] >> (3 * j)) & 7;
+            if(!(pos->rows[i] >> j & 1))
+                field[i][j] = 0;
+            else
+                field[i][j] = code == PACK_COLOUR_OTHER ? TET_TYPES + 2 : code + 1;
+        }
+
+    for(i = 0; i < TET_TYPES; i++)
+        quantities[i] = pos->quantities[i];
+    scores[0] = pos->scores[0];
+    scores[1] = pos->scores[1];
+}
+
+size_t pack_encode_colours(const pack_position_t* pos, unsigned char* out)
+{
+    unsigned int acc = 0;
+    int bits = 0, i, j;
+    size_t len = 0;
+
+    for(i = 0; i < FIELD_ROWS; i++)
+    {
+        unsigned int row = pos->rows[i];
+        for(j = 0; row; j++, row >>= 1)
+            if(row & 1)
+            {
+                acc |= ((pos->colours[i] >> (3 * j)) & 7) << bits;
+                bits += 3;
+                if(bits >= 8)
+                {
+                    out[len++] = (unsigned char)acc;
+                    acc >>= 8;
+                    bits -= 8;
+                }
+            }
+    }
+    if(bits)
+        out[len++] = (unsigned char)acc;
+
+    return len;
+}
+
+size_t pack_decode_colours(const unsigned char* in, pack_position_t* pos)
+{
+    unsigned int acc = 0;
+    int bits = 0, i, j;
+    size_t len = 0;
+
+    for(i = 0; i < FIELD_ROWS; i++)
+    {
+        unsigned int row = pos->rows[i], colours = 0;
+        for(j = 0; row; j++, row >>= 1)
+            if(row & 1)
+            {
+                if(bits < 3)
+                {
+                    acc |= (unsigned int)in[len++] << bits;
+                    bits += 8;
+                }
+                colours |= (acc & 7) << (3 * j);
+                acc >>= 3;
+                bits -= 3;
+            }
+        pos->colours[i] = colours;
+    }
+
+    return len;
+}
+
+void pack_encode_one(const pack_position_t* pos, unsigned char out[PACK_LEN])
+{
+    const unsigned short* r = pos->rows;
+    const unsigned char* q = pos->quantities;
+    unsigned int r3 = r[3] & ROW_MASK, r6 = r[6] & ROW_MASK, r9 = r[9] & ROW_MASK, r12 = r[12] & ROW_MASK;
+    unsigned int q0 = q[0] & PACK_QUANTITY_MAX, q5 = q[5] & PACK_QUANTITY_MAX;
+
+    /* Riga r al bit 10r, quantità dal bit 190, punteggi dal bit 232 */
+    pack_store(out, (r[0] & ROW_MASK) | (r[1] & ROW_MASK) << 10 | (r[2] & ROW_MASK) << 20 | r3 << 30);
+    pack_store(out + 4, r3 >> 2 | (r[4] & ROW_MASK) << 8 | (r[5] & ROW_MASK) << 18 | r6 << 28);
+    pack_store(out + 8, r6 >> 4 | (r[7] & ROW_MASK) << 6 | (r[8] & ROW_MASK) << 16 | r9 << 26);
+    pack_store(out + 12, r9 >> 6 | (r[10] & ROW_MASK) << 4 | (r[11] & ROW_MASK) << 14 | r12 << 24);
+    pack_store(out + 16, r12 >> 8 | (r[13] & ROW_MASK) << 2 | (r[14] & ROW_MASK) << 12 | (r[15] & ROW_MASK) << 22);
+    pack_store(out + 20, (r[16] & ROW_MASK) | (r[17] & ROW_MASK) << 10 | (r[18] & ROW_MASK) << 20 | q0 << 30);
+    pack_store(out + 24, q0 >> 2 | (q[1] & PACK_QUANTITY_MAX) << 4 | (q[2] & PACK_QUANTITY_MAX) << 10 |
+                         (q[3] & PACK_QUANTITY_MAX) << 16 | (q[4] & PACK_QUANTITY_MAX) << 22 | q5 << 28);
+    pack_store(out + 28, q5 >> 4 | (q[6] & PACK_QUANTITY_MAX) << 2 |
+                         (pos->scores[0] & PACK_SCORE_MAX) << 8 | (pos->scores[1] & PACK_SCORE_MAX) << 20);
+}
+
+void pack_decode_one(const unsigned char in[PACK_LEN], pack_position_t* pos)
+{
+    unsigned short* r = pos->rows;
+    unsigned char* q = pos->quantities;
+    unsigned int w[PACK_WORDS];
+
+    w[0] = pack_load(in);
+    w[1] = pack_load(in + 4);
+    w[2] = pack_load(in + 8);
+    w[3] = pack_load(in + 12);
+    w[4] = pack_load(in + 16);
+    w[5] = pack_load(in + 20);
+    w[6] = pack_load(in + 24);
+    w[7] = pack_load(in + 28);
+
+    r[0] = (unsigned short)(w[0] & ROW_MASK);
+    r[1] = (unsigned short)(w[0] >> 10 & ROW_MASK);
+    r[2] = (unsigned short)(w[0] >> 20 & ROW_MASK);
+    r[3] = (unsigned short)((w[0] >> 30 | w[1] << 2) & ROW_MASK);
+    r[4] = (unsigned short)(w[1] >> 8 & ROW_MASK);
+    r[5] = (unsigned short)(w[1] >> 18 & ROW_MASK);
+    r[6] = (unsigned short)((w[1] >> 28 | w[2] << 4) & ROW_MASK);
+    r[7] = (unsigned short)(w[2] >> 6 & ROW_MASK);
+    r[8] = (unsigned short)(w[2] >> 16 & ROW_MASK);
+    r[9] = (unsigned short)((w[2] >> 26 | w[3] << 6) & ROW_MASK);
+    r[10] = (unsigned short)(w[3] >> 4 & ROW_MASK);
+    r[11] = (unsigned short)(w[3] >> 14 & ROW_MASK);
+    r[12] = (unsigned short)((w[3] >> 24 | w[4] << 8) & ROW_MASK);
+    r[13] = (unsigned short)(w[4] >> 2 & ROW_MASK);
+    r[14] = (unsigned short)(w[4] >> 12 & ROW_MASK);
+    r[15] = (unsigned short)(w[4] >> 22 & ROW_MASK);
+    r[16] = (unsigned short)(w[5] & ROW_MASK);
+    r[17] = (unsigned short)(w[5] >> 10 & ROW_MASK);
+    r[18] = (unsigned short)(w[5] >> 20 & ROW_MASK);
+    q[0] = (unsigned char)((w[5] >> 30 | w[6] << 2) & PACK_QUANTITY_MAX);
+    q[1] = (unsigned char)(w[6] >> 4 & PACK_QUANTITY_MAX);
+    q[2] = (unsigned char)(w[6] >> 10 & PACK_QUANTITY_MAX);
+    q[3] = (unsigned char)(w[6] >> 16 & PACK_QUANTITY_MAX);
+    q[4] = (unsigned char)(w[6] >> 22 & PACK_QUANTITY_MAX);
+    q[5] = (unsigned char)((w[6] >> 28 | w[7] << 4) & PACK_QUANTITY_MAX);
+    q[6] = (unsigned char)(w[7] >> 2 & PACK_QUANTITY_MAX);
+    pos->scores[0] = (unsigned short)(w[7] >> 8 & PACK_SCORE_MAX);
+    pos->scores[1] = (unsigned short)(w[7] >> 20 & PACK_SCORE_MAX);
+}
+
+size_t pack_encode(const pack_position_t* in, size_t n, int colours, unsigned char* out)
+{
+    unsigned char* start = out;
+    size_t k;
+
+    if(!colours)
+    {
+        for(k = 0; k < n; k++)
+            pack_encode_one(&in[k], out + k * PACK_LEN);
+        return n * PACK_LEN;
+    }
+
+    for(k = 0; k < n; k++)
+    {
+        pack_encode_one(&in[k], out);
+        out += PACK_LEN;
+        out += pack_encode_colours(&in[k], out);
+    }
+
+    return (size_t)(out - start);
+}
+
+size_t pack_decode(const unsigned char* in, size_t n, int colours, pack_position_t* out)
+{
+    const unsigned char* start = in;
+    size_t k;
+
+    if(!colours)
+    {
+        for(k = 0; k < n; k++)
+        {
+            pack_decode_one(in + k * PACK_LEN, &out[k]);
+            memset(out[k].colours, 0, sizeof(out[k].colours));
+        }
+        return n * PACK_LEN;
+    }
+
+    for(k = 0; k < n; k++)
+    {
+        pack_decode_one(in, &out[k]);
+        in += PACK_LEN;
+        in += pack_decode_colours(in, &out[k]);
+    }
+
+    return (size_t)(in - start);
+}
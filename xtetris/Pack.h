@@ -0,0 +1,101 @@
+/**
+* @file Pack.h
+* @author Albert Alibeaj
+* @brief Libreria che codifica una posizione di gioco in un formato binario compatto,
+ * per salvare grandi quantità di posizioni (dataset, aperture) occupando poco spazio.
+ *
+ * Ogni posizione occupa PACK_LEN byte, letti come una sequenza di bit little endian:
+ *  - FIELD_ROWS righe da FIELD_COLS bit (bit c della riga r: cella occupata), dalla riga 0 in giù;
+ *  - TET_TYPES quantità da PACK_QUANTITY_BITS bit;
+ *  - il punteggio del giocatore e quello dell'avversario, da PACK_SCORE_BITS bit ciascuno.
+ *
+ * Se richiesti, i colori seguono la posizione: 3 bit per ogni cella occupata, nello stesso
+ * ordine delle celle, fino a completare l'ultimo byte. I codici da 0 a TET_TYPES - 1 sono i
+ * tetramini (valore - 1); PACK_COLOUR_OTHER indica qualsiasi altro valore (righe invertite).
+*/
+
+#ifndef XTETRIS2_PACK_H
+#define XTETRIS2_PACK_H
+
+#include <stddef.h>
+#include "Field.h"
+#include "Pieces.h"
+#include "State.h"
+
+/** Byte di una posizione senza colori */
+#define PACK_LEN 32
+/** Byte massimi di una posizione con i colori (tutte le celle occupate) */
+#define PACK_MAX_LEN (PACK_LEN + (FIELD_ROWS * FIELD_COLS * 3 + 7) / 8)
+/** Bit di ogni quantità */
+#define PACK_QUANTITY_BITS 6
+/** Bit di ogni punteggio */
+#define PACK_SCORE_BITS 12
+/** Quantità massima rappresentabile: le quantità maggiori vengono limitate */
+#define PACK_QUANTITY_MAX ((1 << PACK_QUANTITY_BITS) - 1)
+/** Punteggio massimo rappresentabile: i punteggi maggiori vengono limitati */
+#define PACK_SCORE_MAX ((1 << PACK_SCORE_BITS) - 1)
+/** Codice colore delle celle che non appartengono a un tetramino */
+#define PACK_COLOUR_OTHER 7
+
+/** Tipo pack_position_t
+*   Posizione in forma compatta ma direttamente leggibile, da cui si codifica e in cui si decodifica
+*/
+typedef struct PackPosition
+{
+    unsigned short rows[FIELD_ROWS];        /**< bit c della riga r: cella occupata */
+    unsigned char quantities[TET_TYPES];    /**< quantità dei tetramini */
+    unsigned short scores[2];               /**< punteggio del giocatore e dell'avversario */
+    unsigned int colours[FIELD_ROWS];       /**< 3 bit per colonna: codice colore della cella (0 se vuota) */
+
+} pack_position_t;
+
+/**
+* Prepara una posizione a partire da un campo
+ * @param field campo del giocatore
+ * @param quantities quantità dei tetramini
+ * @param score punteggio del giocatore
+ * @param opponent_score punteggio dell'avversario (0 in singleplayer)
+ * @param pos posizione da riempire
+*/
+void pack_from_field(const int field[FIELD_ROWS][FIELD_COLS], const int quantities[TET_TYPES],
+                     int score, int opponent_score, pack_position_t* pos);
+
+/**
+* Prepara la posizione vista da un giocatore di una partita
+ * @param state stato della partita
+ * @param player indice del giocatore (0 o 1)
+ * @param pos posizione da riempire
+*/
+void pack_from_state(const game_state_t* state, int player, pack_position_t* pos);
+
+/**
+* Ricostruisce campo, quantità e punteggi da una posizione. Senza colori
+ * le celle occupate prendono il valore del primo tetramino
+ * @param pos posizione
+ * @param field campo da riempire
+ * @param quantities quantità da riempire
+ * @param scores punteggi del giocatore e dell'avversario da riempire
+*/
+void pack_to_field(const pack_position_t* pos, int field[FIELD_ROWS][FIELD_COLS], int quantities[TET_TYPES], int scores[2]);
+
+/**
+* Codifica un blocco di posizioni una dopo l'altra
+ * @param in posizioni
+ * @param n numero di posizioni
+ * @param colours 1 per aggiungere i colori a ogni posizione
+ * @param out byte da riempire (almeno n * PACK_LEN, o n * PACK_MAX_LEN con i colori)
+ * @return byte scritti
+*/
+size_t pack_encode(const pack_position_t* in, size_t n, int colours, unsigned char* out);
+
+/**
+* Decodifica un blocco di posizioni scritte da pack_encode
+ * @param in byte da leggere
+ * @param n numero di posizioni
+ * @param colours 1 se le posizioni sono state codificate con i colori
+ * @param out posizioni da riempire
+ * @return byte letti
+*/
+size_t pack_decode(const unsigned char* in, size_t n, int colours, pack_position_t* out);
+
+#endif /*XTETRIS2_PACK_H*/
@@ -0,0 +1,247 @@
+/**
+* @file Perft.c
+* @author Albert Alibeaj
+* @brief File di implementazione del conteggio delle posizioni raggiungibili
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "Perft.h"
+#include "Com.h"
+#include "Placements.h"
+#include "Sched.h"
+#include "Symmetry.h"
+
+/** Tipo perft_worker_t
+*   Dati di un singolo thread
+*/
+typedef struct PerftWorker
+{
+    tet_t tets[TET_TYPES];      /**< copia dei tetramini, di cui il thread modifica le quantità */
+    perft_table_t table;        /**< tabella delle posizioni del thread */
+    perft_stats_t stats;        /**< contatori del thread, sommati alla fine */
+    int ready;                  /**< 1 dopo che il thread ha preparato tetramini e tabella */
+
+} perft_worker_t;
+
+/** Tipo perft_job_t
+*   Lavoro condiviso tra i thread: ogni mossa iniziale è un compito (Sched.h)
+*/
+typedef struct PerftJob
+{
+    int (*field)[FIELD_COLS];   /**< campo di partenza */
+    tet_t* tets;                /**< tetramini di partenza */
+    int depth;                  /**< profondità totale */
+    placements_t moves;         /**< mosse iniziali da dividere tra i thread */
+    int weights[PLACEMENTS_MAX];/**< posizioni equivalenti contate da ogni mossa iniziale (placements_mirror_fold) */
+    unsigned long table_bytes;  /**< memoria della tabella delle posizioni di ogni thread */
+    perft_worker_t* workers;    /**< dati di ogni thread */
+
+} perft_job_t;
+
+/**
+* Somma dei contatori
+ * @param dst contatori a cui sommare
+ * @param src contatori da sommare
+*/
+void perft_stats_add(perft_stats_t* dst, const perft_stats_t* src);
+
+/**
+* Conta le posizioni dopo una mossa, moltiplicate per il numero di mosse speculari equivalenti
+ * @param field campo di partenza (non viene modificato)
+ * @param tets tetramini disponibili (la quantità viene ripristinata al termine)
+ * @param p mossa da giocare per prima
+ * @param weight mosse equivalenti rappresentate da p (placements_mirror_fold)
+ * @param depth numero di mosse da giocare, compresa p
+ * @param table tabella delle posizioni già contate (può essere NULL)
+ * @param stats contatori a cui sommare i risultati
+*/
+void perft_move_weighted(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placement_t p, int weight, int depth,
+                         perft_table_t* table, perft_stats_t* stats);
+
+/**
+* Compito di perft_parallel: conta le posizioni dopo una mossa iniziale
+ * @param arg puntatore al perft_job_t
+ * @param i indice della mossa iniziale
+*/
+void perft_task(void* arg, int i);
+
+void perft_stats_clear(perft_stats_t* stats)
+{
+    stats->nodes = 0;
+    stats->lost = 0;
+    stats->cleared = 0;
+}
+
+void perft_stats_add(perft_stats_t* dst, const perft_stats_t* src)
+{
+    dst->nodes += src->nodes;
+    dst->lost += src->lost;
+    dst->cleared += src->cleared;
+}
+
+int perft_table_init(perft_table_t* table, unsigned long bytes)
+{
+    unsigned long count = 1;
+
+    table->entries = NULL;
+    table->mask = 0;
+    table->hits = 0;
+    if(bytes < sizeof(perft_entry_t))
+        return 0;
+
+    while(count * 2 * sizeof(perft_entry_t) <= bytes)
+        count *= 2;
+
+    table->entries = (perft_entry_t*)calloc(count, sizeof(perft_entry_t));
+    if(!table->entries)
+        return 0;
+    table->mask = count - 1;
+    return 1;
+}
+
+void perft_table_free(perft_table_t* table)
+{
+    free(table->entries);
+    table->entries = NULL;
+}
+
+void perft_move(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placement_t p, int depth, perft_table_t* table, perft_stats_t* stats)
+{
+    int child[FIELD_ROWS][FIELD_COLS];
+    int score = com_try_move(field, tets, p, child);
+
+    if(score < 0)
+    {
+        /* La partita finisce qui: conta come posizione solo se è l'ultima mossa */
+        stats->lost++;
+        if(depth == 1)
+            stats->nodes++;
+        return;
+    }
+    if(score > 0)
+        stats->cleared++;
+
+    tets[p.id].quantity--;
+    perft_hashed(child, tets, depth - 1, table, stats);
+    tets[p.id].quantity++;
+}
+
+void perft_move_weighted(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placement_t p, int weight, int depth,
+                         perft_table_t* table, perft_stats_t* stats)
+{
+    perft_stats_t sub;
+
+    if(weight == 1)
+    {
+        perft_move(field, tets, p, depth, table, stats);
+        return;
+    }
+
+    perft_stats_clear(&sub);
+    perft_move(field, tets, p, depth, table, &sub);
+    while(weight-- > 0)
+        perft_stats_add(stats, &sub);
+}
+
+void perft(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int depth, perft_stats_t* stats)
+{
+    perft_hashed(field, tets, depth, NULL, stats);
+}
+
+void perft_hashed(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int depth, perft_table_t* table, perft_stats_t* stats)
+{
+    placements_t moves;
+    perft_stats_t sub;
+    perft_entry_t* entry = NULL;
+    unsigned long hash = 0;
+    position_key_t key;
+    int weights[PLACEMENTS_MAX];
+    int i;
+
+    if(depth <= 0)
+    {
+        stats->nodes++;
+        return;
+    }
+
+    /* Con una sola mossa rimanente contare è più veloce che cercare nella tabella */
+    if(table && table->entries && depth > 1)
+    {
+        position_canonical(field, tets, &key);
+        hash = position_hash(&key) | 1UL;
+        entry = &table->entries[hash & table->mask];
+
+        if(entry->hash == hash && entry->depth == depth && !memcmp(&entry->key, &key, sizeof(key)))
+        {
+            table->hits++;
+            perft_stats_add(stats, &entry->stats);
+            return;
+        }
+    }
+
+    perft_stats_clear(&sub);
+    placements_gen(tets, &moves);
+    placements_mirror_fold(field, tets, &moves, weights);
+    for(i = 0; i < moves.count; i++)
+        perft_move_weighted(field, tets, moves.moves[i], weights[i], depth, table, &sub);
+
+    if(entry)
+    {
+        entry->hash = hash;
+        entry->key = key;
+        entry->depth = depth;
+        entry->stats = sub;
+    }
+    perft_stats_add(stats, &sub);
+}
+
+void perft_task(void* arg, int i)
+{
+    perft_job_t* job = (perft_job_t*)arg;
+    perft_worker_t* worker = &job->workers[sched_worker() < 0 ? 0 : sched_worker()];
+
+    /* Ogni thread modifica le quantità solo nella propria copia e ha una propria tabella */
+    if(!worker->ready)
+    {
+        memcpy(worker->tets, job->tets, sizeof(worker->tets));
+        perft_table_init(&worker->table, job->table_bytes);
+        worker->ready = 1;
+    }
+
+    perft_move_weighted(job->field, worker->tets, job->moves.moves[i], job->weights[i], job->depth, &worker->table, &worker->stats);
+}
+
+unsigned long perft_parallel(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int depth, unsigned long table_bytes, perft_stats_t* stats)
+{
+    perft_job_t job;
+    unsigned long hits = 0;
+    int slots = sched_threads() > 0 ? sched_threads() : 1, i;
+
+    if(depth <= 0)
+    {
+        stats->nodes++;
+        return 0;
+    }
+
+    job.field = field;
+    job.tets = tets;
+    job.depth = depth;
+    job.table_bytes = table_bytes;
+    job.workers = (perft_worker_t*)calloc((size_t)slots, sizeof(perft_worker_t));
+    placements_gen(tets, &job.moves);
+    placements_mirror_fold(field, tets, &job.moves, job.weights);
+
+    sched_for(0, job.moves.count, 1, perft_task, &job);
+
+    for(i = 0; i < slots; i++)
+        if(job.workers[i].ready)
+        {
+            perft_stats_add(stats, &job.workers[i].stats);
+            hits += job.workers[i].table.hits;
+            perft_table_free(&job.workers[i].table);
+        }
+
+    free(job.workers);
+    return hits;
+}
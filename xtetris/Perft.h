@@ -0,0 +1,115 @@
+/**
+* @file Perft.h
+* @author Albert Alibeaj
+* @brief Libreria che conta tutte le posizioni raggiungibili da un campo
+ * fino a una certa profondità, usando la stessa semantica di insert.
+ * Serve sia come verifica della correttezza di Moves.c sia come misura della sua velocità
+*/
+
+#ifndef XTETRIS2_PERFT_H
+#define XTETRIS2_PERFT_H
+
+#include "Field.h"
+#include "Pieces.h"
+#include "Placements.h"
+#include "Symmetry.h"
+
+/** Tipo perft_stats_t
+*   Contatori raccolti durante la visita dell'albero delle mosse
+*/
+typedef struct PerftStats
+{
+    unsigned long nodes;    /**< posizioni raggiunte alla profondità richiesta */
+    unsigned long lost;     /**< mosse (a qualsiasi profondità) che fanno perdere la partita */
+    unsigned long cleared;  /**< mosse (a qualsiasi profondità) che eliminano almeno una riga */
+
+} perft_stats_t;
+
+/** Tipo perft_entry_t
+*   Elemento della tabella delle posizioni già contate
+*/
+typedef struct PerftEntry
+{
+    unsigned long hash;     /**< hash della forma canonica della posizione (0 se l'elemento è vuoto) */
+    position_key_t key;     /**< forma canonica completa, confrontata per escludere le collisioni dell'hash */
+    int depth;              /**< profondità rimanente per cui sono stati contati i risultati */
+    perft_stats_t stats;    /**< contatori del sottoalbero */
+
+} perft_entry_t;
+
+/** Tipo perft_table_t
+*   Tabella delle posizioni già contate. Le posizioni speculari condividono lo stesso elemento
+*/
+typedef struct PerftTable
+{
+    perft_entry_t* entries;     /**< elementi della tabella */
+    unsigned long mask;         /**< numero di elementi - 1 (il numero è una potenza di 2) */
+    unsigned long hits;         /**< sottoalberi ritrovati nella tabella invece di essere ricontati */
+
+} perft_table_t;
+
+/**
+* Azzera i contatori
+ * @param stats contatori da azzerare
+*/
+void perft_stats_clear(perft_stats_t* stats);
+
+/**
+* Alloca una tabella delle posizioni già contate
+ * @param table tabella da inizializzare
+ * @param bytes memoria massima da usare (0 per nessuna tabella)
+ * @return 1 se la tabella è stata allocata, 0 altrimenti
+*/
+int perft_table_init(perft_table_t* table, unsigned long bytes);
+
+/**
+* Libera la memoria di una tabella
+ * @param table tabella da liberare
+*/
+void perft_table_free(perft_table_t* table);
+
+/**
+* Conta le posizioni raggiungibili su un solo thread.
+ * Una mossa che fa perdere chiude la partita e non viene espansa oltre.
+ * Il campo non viene modificato, le quantità dei tetramini vengono ripristinate al termine
+ * @param field campo di partenza
+ * @param tets tetramini con le quantità di partenza
+ * @param depth numero di mosse da giocare
+ * @param stats contatori a cui sommare i risultati
+*/
+void perft(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int depth, perft_stats_t* stats);
+
+/**
+* Come perft, ma i sottoalberi già contati (anche in forma speculare) vengono presi dalla tabella
+ * @param field campo di partenza
+ * @param tets tetramini con le quantità di partenza
+ * @param depth numero di mosse da giocare
+ * @param table tabella delle posizioni già contate (se NULL equivale a perft)
+ * @param stats contatori a cui sommare i risultati
+*/
+void perft_hashed(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int depth, perft_table_t* table, perft_stats_t* stats);
+
+/**
+* Conta le posizioni raggiungibili dopo una singola mossa (utile per confrontare i conteggi mossa per mossa)
+ * @param field campo di partenza (non viene modificato)
+ * @param tets tetramini disponibili (la quantità viene ripristinata al termine)
+ * @param p mossa da giocare per prima
+ * @param depth numero di mosse da giocare, compresa p
+ * @param table tabella delle posizioni già contate (può essere NULL)
+ * @param stats contatori a cui sommare i risultati
+*/
+void perft_move(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placement_t p, int depth, perft_table_t* table, perft_stats_t* stats);
+
+/**
+* Conta le posizioni raggiungibili dividendo le mosse iniziali tra i thread avviati con sched_start
+ * (su un solo thread se non ne sono stati avviati)
+ * @param field campo di partenza (non viene modificato)
+ * @param tets tetramini con le quantità di partenza (non vengono modificati)
+ * @param depth numero di mosse da giocare
+ * @param table_bytes memoria della tabella delle posizioni di ogni thread (0 per nessuna tabella)
+ * @param stats contatori a cui sommare i risultati
+ * @return sottoalberi ritrovati nelle tabelle
+*/
+unsigned long perft_parallel(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], int depth, unsigned long table_bytes, perft_stats_t* stats);
+
+#endif /*XTETRIS2_PERFT_H*/
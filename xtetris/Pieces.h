@@ -12,6 +12,7 @@
 
 #define DEFAULT_TET_QUANTITY 20     /**< quantità iniziale per ogni tetramino (singleplayer) */
 #define TET_TYPES 7                 /**< tipi di tetramino distiniti */
+#define TET_MAX_LEN 4               /**< lato massimo dell'array forma di un tetramino */
 
 /** Tipo tet_t
 *   Struttura di un tetramino
@@ -0,0 +1,326 @@
+/**
+* @file PipeBot.c
+* @author Albert Alibeaj
+* @brief File di implementazione dei bot esterni su standard input e standard output
+*/
+
+/* usleep e pthread_condattr_setclock non sono dichiarate con -ansi senza questa richiesta */
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "PipeBot.h"
+#include "Clock.h"
+
+/**
+* Scrive tutti i byte di un buffer
+ * @param fd descrittore su cui scrivere
+ * @param buf byte da scrivere
+ * @param len numero di byte
+ * @return 0 se sono stati scritti tutti, -1 altrimenti
+*/
+int pipebot_write_all(int fd, const char* buf, size_t len);
+
+/**
+* Legge le risposte disponibili entro un istante e le consegna alle richieste in attesa.
+ * Va chiamata con il mutex preso e reading a 1: il mutex viene rilasciato durante la lettura
+ * @param pb bot avviato
+ * @param deadline istante (clock_now) oltre il quale non attendere
+*/
+void pipebot_read(pipebot_t* pb, double deadline);
+
+/**
+* Consegna una riga di risposta alla richiesta con lo stesso ID. Va chiamata con il mutex preso
+ * @param pb bot avviato
+ * @param line riga terminata da '\\0'
+ * @param now istante di arrivo
+*/
+void pipebot_answer(pipebot_t* pb, const char* line, double now);
+
+int pipebot_write_all(int fd, const char* buf, size_t len)
+{
+    while(len > 0)
+    {
+        ssize_t n = write(fd, buf, len);
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n <= 0)
+            return -1;
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+int pipebot_open(pipebot_t* pb, const char* command, int timeout_ms)
+{
+    pthread_condattr_t attr;
+    int to_bot[2], from_bot[2];
+    char header[32];
+
+    memset(pb, 0, sizeof(*pb));
+    pb->timeout_ms = timeout_ms > 0 ? timeout_ms : PIPEBOT_TIMEOUT_MS;
+    pb->next_id = 1;
+    histogram_clear(&pb->latency);
+
+    if(pipe(to_bot) != 0)
+        return -1;
+    if(pipe(from_bot) != 0)
+    {
+        close(to_bot[0]);
+        close(to_bot[1]);
+        return -1;
+    }
+
+    /* Le estremità del motore non devono finire negli altri bot avviati dopo:
+     * altrimenti un bot non vedrebbe mai la fine del proprio standard input */
+    fcntl(to_bot[1], F_SETFD, FD_CLOEXEC);
+    fcntl(from_bot[0], F_SETFD, FD_CLOEXEC);
+    signal(SIGPIPE, SIG_IGN);
+
+    pb->pid = fork();
+    if(pb->pid == 0)
+    {
+        dup2(to_bot[0], STDIN_FILENO);
+        dup2(from_bot[1], STDOUT_FILENO);
+        close(to_bot[0]);
+        close(from_bot[1]);
+        execl("/bin/sh", "sh", "-c", command, (char*)NULL);
+        _exit(127);
+    }
+    close(to_bot[0]);
+    close(from_bot[1]);
+    if(pb->pid < 0)
+    {
+        close(to_bot[1]);
+        close(from_bot[0]);
+        return -1;
+    }
+    pb->to_bot = to_bot[1];
+    pb->from_bot = from_bot[0];
+
+    /* Le scadenze sono istanti di clock_now, cioè dell'orologio monotono */
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pb->changed, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&pb->lock, NULL);
+
+    sprintf(header, "xtetris %d\n", PIPEBOT_VERSION);
+    if(pipebot_write_all(pb->to_bot, header, strlen(header)) != 0)
+        pb->dead = 1;
+    return 0;
+}
+
+void pipebot_close(pipebot_t* pb)
+{
+    int i, status;
+
+    if(pb->pid <= 0)
+        return;
+
+    pipebot_write_all(pb->to_bot, "quit\n", 5);
+    close(pb->to_bot);
+    close(pb->from_bot);
+
+    for(i = 0; i < 100 && waitpid(pb->pid, &status, WNOHANG) == 0; i++)
+        usleep(10000);
+    if(i == 100)
+    {
+        kill(pb->pid, SIGKILL);
+        waitpid(pb->pid, &status, 0);
+    }
+
+    pthread_cond_destroy(&pb->changed);
+    pthread_mutex_destroy(&pb->lock);
+    pb->pid = 0;
+}
+
+unsigned long pipebot_send(pipebot_t* pb, const game_state_t* state, int player)
+{
+    char line[PIPEBOT_LINE];
+    pipebot_slot_t* slot;
+    unsigned long id;
+    int len, p, r, c, i;
+
+    pthread_mutex_lock(&pb->lock);
+    for(;;)
+    {
+        if(pb->dead)
+        {
+            pthread_mutex_unlock(&pb->lock);
+            return 0;
+        }
+        if(pb->slots[pb->next_id % PIPEBOT_SLOTS].id == 0)
+            break;
+        pthread_cond_wait(&pb->changed, &pb->lock);
+    }
+
+    id = pb->next_id++;
+    slot = &pb->slots[id % PIPEBOT_SLOTS];
+    slot->id = id;
+    slot->answered = 0;
+
+    len = sprintf(line, "position %lu %d %d %d %d", id, player, state->moves, state->scores[0], state->scores[1]);
+    for(i = 0; i < TET_TYPES; i++)
+        len += sprintf(line + len, " %d", state->quantities[i]);
+    for(p = 0; p < STATE_PLAYERS; p++)
+    {
+        line[len++] = ' ';
+        for(r = 0; r < FIELD_ROWS; r++)
+            for(c = 0; c < FIELD_COLS; c++)
+                line[len++] = state->fields[p][r][c] ? '1' : '0';
+    }
+    line[len++] = '\n';
+
+    /* La scrittura resta sotto il mutex: le righe di thread diversi non si mescolano */
+    slot->sent = clock_now();
+    if(pipebot_write_all(pb->to_bot, line, (size_t)len) != 0)
+    {
+        slot->id = 0;
+        pb->dead = 1;
+        pthread_cond_broadcast(&pb->changed);
+        pthread_mutex_unlock(&pb->lock);
+        return 0;
+    }
+
+    pb->requests++;
+    if(++pb->inflight > pb->max_inflight)
+        pb->max_inflight = pb->inflight;
+    pthread_mutex_unlock(&pb->lock);
+    return id;
+}
+
+void pipebot_answer(pipebot_t* pb, const char* line, double now)
+{
+    pipebot_slot_t* slot;
+    unsigned long id;
+    int piece, rotation, column;
+
+    if(sscanf(line, "%lu %d %d %d", &id, &piece, &rotation, &column) != 4 || id == 0)
+        return;
+
+    slot = &pb->slots[id % PIPEBOT_SLOTS];
+    if(slot->id != id || slot->answered)
+    {
+        pb->late++;
+        return;
+    }
+
+    slot->move.id = piece;
+    slot->move.rot = rotation;
+    slot->move.col = column;
+    slot->answered = 1;
+    histogram_record(&pb->latency, (unsigned long)((now - slot->sent) * 1e9));
+}
+
+void pipebot_read(pipebot_t* pb, double deadline)
+{
+    struct pollfd pfd;
+    ssize_t n = -2;     /* -2: niente da leggere entro la scadenza */
+    int wait_ms = (int)((deadline - clock_now()) * 1000) + 1;
+
+    pthread_mutex_unlock(&pb->lock);
+    pfd.fd = pb->from_bot;
+    pfd.events = POLLIN;
+    if(poll(&pfd, 1, wait_ms > 0 ? wait_ms : 0) > 0)
+    {
+        /* Solo il thread che legge tocca il buffer */
+        n = read(pb->from_bot, pb->buf + pb->len, sizeof(pb->buf) - pb->len);
+        if(n < 0 && errno == EINTR)
+            n = -2;
+    }
+    pthread_mutex_lock(&pb->lock);
+
+    if(n == 0 || n == -1)
+        pb->dead = 1;
+    else if(n > 0)
+    {
+        double now = clock_now();
+        char* start = pb->buf;
+        char* end;
+
+        pb->len += (size_t)n;
+        while((end = (char*)memchr(start, '\n', pb->len - (size_t)(start - pb->buf))) != NULL)
+        {
+            *end = '\0';
+            pipebot_answer(pb, start, now);
+            start = end + 1;
+        }
+        pb->len -= (size_t)(start - pb->buf);
+        memmove(pb->buf, start, pb->len);
+
+        /* Una riga più lunga del buffer non è una risposta: viene scartata */
+        if(pb->len == sizeof(pb->buf))
+            pb->len = 0;
+    }
+}
+
+int pipebot_wait(pipebot_t* pb, unsigned long id, placement_t* move)
+{
+    pipebot_slot_t* slot = &pb->slots[id % PIPEBOT_SLOTS];
+    double deadline;
+    int res = -1;
+
+    if(id == 0)
+        return -1;
+
+    pthread_mutex_lock(&pb->lock);
+    deadline = slot->sent + pb->timeout_ms / 1e3;
+    for(;;)
+    {
+        if(slot->answered)
+        {
+            *move = slot->move;
+            res = 0;
+            break;
+        }
+        if(pb->dead || clock_now() >= deadline)
+        {
+            if(!pb->dead)
+                pb->timeouts++;
+            break;
+        }
+
+        if(!pb->reading)
+        {
+            /* Nessuno sta leggendo: legge questo thread, consegnando anche le risposte degli altri */
+            pb->reading = 1;
+            pipebot_read(pb, deadline);
+            pb->reading = 0;
+            pthread_cond_broadcast(&pb->changed);
+        }
+        else
+        {
+            struct timespec ts;
+            ts.tv_sec = (time_t)deadline;
+            ts.tv_nsec = (long)((deadline - (double)ts.tv_sec) * 1e9);
+            pthread_cond_timedwait(&pb->changed, &pb->lock, &ts);
+        }
+    }
+
+    slot->id = 0;
+    slot->answered = 0;
+    pb->inflight--;
+    pthread_cond_broadcast(&pb->changed);
+    pthread_mutex_unlock(&pb->lock);
+    return res;
+}
+
+void pipebot_report(const pipebot_t* pb, const char* name, FILE* out)
+{
+    fprintf(out, "%s: %lu richieste, %lu scadute, %lu risposte in ritardo, pipeline massima %d\n",
+            name, pb->requests, pb->timeouts, pb->late, pb->max_inflight);
+    if(pb->latency.total > 0)
+        fprintf(out, "%s: risposta mediana %.1f us, 99%% %.1f us, 99,9%% %.1f us, massimo %.1f us\n", name,
+                histogram_percentile(&pb->latency, 50) / 1e3, histogram_percentile(&pb->latency, 99) / 1e3,
+                histogram_percentile(&pb->latency, 99.9) / 1e3, pb->latency.max / 1e3);
+}
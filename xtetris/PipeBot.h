@@ -0,0 +1,125 @@
+/**
+* @file PipeBot.h
+* @author Albert Alibeaj
+* @brief Libreria che fa giocare come computer un qualsiasi programma esterno, avviato come processo
+ * figlio e interrogato su standard input e standard output con un protocollo a righe di testo.
+ *
+ * All'avvio il motore scrive <code>xtetris 1</code> (versione del protocollo); poi per ogni mossa:
+ *
+ * <code>position ID GIOCATORE MOSSE P0 P1 Q0 Q1 Q2 Q3 Q4 Q5 Q6 CAMPO0 CAMPO1</code>
+ *
+ * dove ID è un numero crescente, GIOCATORE l'indice del giocatore che muove (0 o 1), MOSSE
+ * le mosse giocate finora, P i punteggi, Q le quantità dei tetramini e ogni CAMPO una stringa
+ * di FIELD_ROWS x FIELD_COLS caratteri '0' o '1', riga per riga dall'alto.
+ * Il bot risponde con <code>ID TETRAMINO ROTAZIONE COLONNA</code> (come in Bot.h). Alla chiusura riceve
+ * <code>quit</code> e la fine dello standard input. Le righe che il bot non conosce vanno ignorate.
+ *
+ * Le richieste sono in pipeline: si possono inviare più posizioni senza attendere le risposte
+ * precedenti, dallo stesso thread (ad esempio le partite intercalate di xtetris-tournament)
+ * o da thread diversi. Chi attende per primo legge e consegna ogni risposta alla richiesta con
+ * lo stesso ID. Una richiesta senza risposta entro il tempo limite fallisce;
+ * la risposta arrivata in ritardo viene scartata
+*/
+
+#ifndef XTETRIS2_PIPEBOT_H
+#define XTETRIS2_PIPEBOT_H
+
+#include <pthread.h>
+#include <sys/types.h>
+#include "Histogram.h"
+#include "State.h"
+
+/** Versione del protocollo */
+#define PIPEBOT_VERSION 1
+/** Richieste in attesa di risposta al massimo: le successive aspettano che se ne liberi una */
+#define PIPEBOT_SLOTS 64
+/** Tempo limite predefinito per una mossa, in millisecondi */
+#define PIPEBOT_TIMEOUT_MS 1000
+/** Byte massimi di una riga */
+#define PIPEBOT_LINE 512
+
+/** Tipo pipebot_slot_t
+*   Richiesta in attesa di risposta
+*/
+typedef struct PipeBotSlot
+{
+    unsigned long id;       /**< ID della richiesta (0 se libera) */
+    int answered;           /**< 1 se la risposta è arrivata */
+    double sent;            /**< istante di invio */
+    placement_t move;       /**< mossa ricevuta */
+
+} pipebot_slot_t;
+
+/** Tipo pipebot_t
+*   Bot esterno avviato
+*/
+typedef struct PipeBot
+{
+    pid_t pid;                          /**< processo del bot */
+    int to_bot;                         /**< standard input del bot */
+    int from_bot;                       /**< standard output del bot */
+    int timeout_ms;                     /**< tempo limite per una mossa */
+    int dead;                           /**< 1 se il bot ha chiuso lo standard output */
+    int reading;                        /**< 1 se un thread sta leggendo le risposte */
+    unsigned long next_id;              /**< ID della prossima richiesta */
+    pthread_mutex_t lock;               /**< protegge tutti i campi */
+    pthread_cond_t changed;             /**< segnalata a ogni risposta, slot liberato o fine lettura */
+    pipebot_slot_t slots[PIPEBOT_SLOTS];/**< richieste in attesa, indicizzate da ID % PIPEBOT_SLOTS */
+    char buf[PIPEBOT_LINE * 8];         /**< risposte lette ma non ancora complete */
+    size_t len;                         /**< byte validi in buf */
+
+    histogram_t latency;                /**< tempo tra invio e risposta, in nanosecondi */
+    unsigned long requests;             /**< richieste inviate */
+    unsigned long timeouts;             /**< richieste scadute */
+    unsigned long late;                 /**< risposte arrivate dopo la scadenza (scartate) */
+    int inflight;                       /**< richieste in attesa ora */
+    int max_inflight;                   /**< massimo di richieste in attesa insieme */
+
+} pipebot_t;
+
+/**
+* Avvia un bot esterno con /bin/sh e gli invia l'intestazione del protocollo.
+ * SIGPIPE viene ignorato dal processo, così un bot terminato fa solo fallire le richieste
+ * @param pb bot da inizializzare
+ * @param command comando da eseguire
+ * @param timeout_ms tempo limite per una mossa (PIPEBOT_TIMEOUT_MS se minore di 1)
+ * @return 0 se il processo è stato avviato, -1 altrimenti
+*/
+int pipebot_open(pipebot_t* pb, const char* command, int timeout_ms);
+
+/**
+* Chiude il bot: invia quit, chiude lo standard input e attende il processo (al più un secondo,
+ * poi lo termina)
+ * @param pb bot avviato
+*/
+void pipebot_close(pipebot_t* pb);
+
+/**
+* Invia una posizione senza attendere la risposta. Se lo slot del prossimo ID è ancora occupato
+ * attende che venga liberato: chi invia più di PIPEBOT_SLOTS richieste senza attenderle si blocca
+ * @param pb bot avviato
+ * @param state stato della partita
+ * @param player indice del giocatore che muove
+ * @return ID della richiesta da passare a pipebot_wait, 0 se il bot non è raggiungibile
+*/
+unsigned long pipebot_send(pipebot_t* pb, const game_state_t* state, int player);
+
+/**
+* Attende la risposta a una richiesta, entro il tempo limite dall'invio, e ne libera lo slot.
+ * Ogni ID restituito da pipebot_send va atteso una volta
+ * @param pb bot avviato
+ * @param id ID restituito da pipebot_send (0 fallisce subito)
+ * @param move mossa ricevuta (non controllata: può non essere valida)
+ * @return 0 se la risposta è arrivata, -1 se è scaduta o il bot è terminato
+*/
+int pipebot_wait(pipebot_t* pb, unsigned long id, placement_t* move);
+
+/**
+* Stampa le statistiche del bot: richieste, scadute, pipeline massima e percentili della latenza
+ * @param pb bot avviato
+ * @param name nome da stampare
+ * @param out file su cui stampare
+*/
+void pipebot_report(const pipebot_t* pb, const char* name, FILE* out);
+
+#endif /*XTETRIS2_PIPEBOT_H*/
@@ -0,0 +1,80 @@
+/**
+* @file Placements.c
+* @author Albert Alibeaj
+* @brief File di implementazione del generatore di mosse distinte
+*/
+
+#include "Placements.h"
+#include "Moves.h"
+
+/**
+* Controlla se due forme dello stesso tetramino occupano le stesse celle
+ * @param a prima forma
+ * @param b seconda forma
+ * @param len lato delle forme
+ * @return 1 se le forme sono uguali, 0 altrimenti
+*/
+int same_shape(const int* a, const int* b, int len)
+{
+    int i;
+    for(i = 0; i < len * len; i++)
+        if((a[i] != 0) != (b[i] != 0))
+            return 0;
+    return 1;
+}
+
+int placements_gen_tet(const tet_t* tet, int id, placements_t* out)
+{
+    int seen[4][TET_MAX_LEN * TET_MAX_LEN];
+    int distinct = 0, added = 0;
+    int rot;
+
+    for(rot = 0; rot < tet->rot_number && rot < 4; rot++)
+    {
+        tet_t tmp = *tet;
+        int i, col, width;
+        int duplicate = 0;
+
+        /* Si ruota una copia locale della forma: il tetramino originale resta intatto */
+        tmp.shape = seen[distinct];
+        for(i = 0; i < tet->shape_len * tet->shape_len; i++)
+            tmp.shape[i] = tet->base_shape[i];
+        rotate_dx(&tmp, rot);
+
+        for(i = 0; i < distinct && !duplicate; i++)
+            duplicate = same_shape(seen[i], tmp.shape, tet->shape_len);
+        if(duplicate)
+            continue;
+        distinct++;
+
+        /* insert sposta le colonne oltre FIELD_COLS - width su quest'ultima */
+        width = tet_width(tmp);
+        for(col = 0; col <= FIELD_COLS - width; col++)
+        {
+            placement_t *p = &out->moves[out->count++];
+            p->id = id;
+            p->rot = rot;
+            p->col = col;
+            added++;
+        }
+    }
+
+    return added;
+}
+
+int placements_gen(tet_t tets[TET_TYPES], placements_t* out)
+{
+    int id;
+
+    out->count = 0;
+    for(id = 0; id < TET_TYPES; id++)
+        if(tets[id].quantity > 0)
+            placements_gen_tet(&tets[id], id, out);
+
+    return out->count;
+}
+
+int placement_apply(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placement_t p)
+{
+    return insert(field, &tets[p.id], p.col, p.rot);
+}
@@ -0,0 +1,68 @@
+/**
+* @file Placements.h
+* @author Albert Alibeaj
+* @brief Libreria che genera tutte le posizioni finali distinte
+ * in cui è possibile inserire i tetramini disponibili
+*/
+
+#ifndef XTETRIS2_PLACEMENTS_H
+#define XTETRIS2_PLACEMENTS_H
+
+#include "Field.h"
+#include "Pieces.h"
+
+/** Numero massimo di posizioni distinte (tipi x rotazioni x colonne) */
+#define PLACEMENTS_MAX (TET_TYPES * 4 * FIELD_COLS)
+
+/** Tipo placement_t
+*   Una mossa: tetramino, rotazione e colonna da passare a insert
+*/
+typedef struct Placement
+{
+    int id;     /**< indice del tetramino nell'array dei tetramini */
+    int rot;    /**< numero di rotazioni verso destra a partire dalla forma base */
+    int col;    /**< colonna in cui inserire il tetramino (mai oltre FIELD_COLS - larghezza) */
+
+} placement_t;
+
+/** Tipo placements_t
+*   Elenco di mosse di dimensione fissa, pensato per stare sullo stack
+*/
+typedef struct Placements
+{
+    int count;                              /**< numero di mosse valide nell'array */
+    placement_t moves[PLACEMENTS_MAX];      /**< mosse generate */
+
+} placements_t;
+
+/**
+* Genera tutte le posizioni finali distinte per i tetramini ancora disponibili.
+ * Le rotazioni che occupano le stesse celle e le colonne che insert
+ * riporterebbe alla stessa posizione vengono generate una volta sola.
+ * I tetramini non vengono modificati
+ * @param tets array dei tetramini (si considerano solo quelli con quantità positiva)
+ * @param out elenco da riempire
+ * @return numero di mosse generate
+*/
+int placements_gen(tet_t tets[TET_TYPES], placements_t* out);
+
+/**
+* Aggiunge a un elenco le posizioni finali distinte di un singolo tetramino,
+ * indipendentemente dalla sua quantità
+ * @param tet tetramino di cui generare le posizioni (non viene modificato)
+ * @param id indice del tetramino da salvare nelle mosse
+ * @param out elenco a cui aggiungere le mosse
+ * @return numero di mosse aggiunte
+*/
+int placements_gen_tet(const tet_t* tet, int id, placements_t* out);
+
+/**
+* Applica una mossa a un campo, come farebbe insert
+ * @param field campo su cui inserire il tetramino
+ * @param tets array dei tetramini (la quantità del tetramino usato viene decrementata)
+ * @param p mossa da applicare
+ * @return punti guadagnati, o -1 se la mossa fa perdere la partita
+*/
+int placement_apply(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placement_t p);
+
+#endif /*XTETRIS2_PLACEMENTS_H*/
@@ -0,0 +1,205 @@
+/**
+* @file Plugin.c
+* @author Albert Alibeaj
+* @brief File di implementazione del caricamento dei bot esterni
+*/
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Plugin.h"
+#include "Com.h"
+
+/** Lo stato del motore viene passato al bot senza copie: i campi comuni devono coincidere */
+typedef char plugin_layout_check[(FIELD_ROWS == XTETRIS_BOT_ROWS && FIELD_COLS == XTETRIS_BOT_COLS
+        && TET_TYPES == XTETRIS_BOT_TETS && STATE_PLAYERS == XTETRIS_BOT_PLAYERS
+        && PLACEMENTS_MAX == XTETRIS_BOT_MAX_MOVES
+        && offsetof(game_state_t, fields) == offsetof(xtetris_bot_position_t, fields)
+        && offsetof(game_state_t, scores) == offsetof(xtetris_bot_position_t, scores)
+        && offsetof(game_state_t, quantities) == offsetof(xtetris_bot_position_t, quantities)
+        && offsetof(game_state_t, players) == offsetof(xtetris_bot_position_t, players)
+        && offsetof(game_state_t, moves) == offsetof(xtetris_bot_position_t, moves)
+        && sizeof(game_state_t) >= sizeof(xtetris_bot_position_t)) ? 1 : -1];
+
+/**
+* Funzione del motore per il bot: elenca le mosse distinte possibili
+ * @param pos posizione
+ * @param out mosse possibili
+ * @return numero di mosse
+*/
+int plugin_legal_moves(const xtetris_bot_position_t* pos, xtetris_bot_move_t out[XTETRIS_BOT_MAX_MOVES]);
+
+/**
+* Funzione del motore per il bot: applica una mossa a una copia del campo di un giocatore
+ * @param pos posizione
+ * @param player indice del giocatore
+ * @param move mossa da provare
+ * @param out campo in cui scrivere il risultato
+ * @return punti guadagnati, -1 se la mossa fa perdere o non è valida
+*/
+int plugin_try_move(const xtetris_bot_position_t* pos, int player, xtetris_bot_move_t move,
+                    int out[XTETRIS_BOT_ROWS][XTETRIS_BOT_COLS]);
+
+tet_t plugin_tets[TET_TYPES];           /**< forme dei tetramini usate dalle funzioni per i bot, in sola lettura */
+int plugin_tets_ready = 0;              /**< 1 se plugin_tets è stato inizializzato */
+int plugin_open_count = 0;              /**< bot caricati: all'ultima chiusura plugin_tets viene liberato */
+
+/** Funzioni del motore passate a ogni bot */
+const xtetris_bot_host_t plugin_host = { XTETRIS_BOT_ABI_VERSION, plugin_legal_moves, plugin_try_move };
+
+/**
+* Legge un simbolo di funzione dalla libreria
+ * @param handle libreria aperta
+ * @param name nome del simbolo
+ * @param fn puntatore a funzione da impostare
+ * @return 0 se il simbolo esiste, -1 altrimenti
+*/
+int plugin_symbol(void* handle, const char* name, void* fn)
+{
+    void* sym = dlsym(handle, name);
+
+    if(!sym)
+        return -1;
+
+    /* In C90 un puntatore a dato non si converte in puntatore a funzione: si copia la rappresentazione,
+     * che POSIX garantisce uguale */
+    memcpy(fn, &sym, sizeof(sym));
+    return 0;
+}
+
+/**
+* Controlla che una mossa del bot si possa giocare con i tetramini disponibili
+ * @param tets tetramini con le quantità della posizione
+ * @param move mossa del bot
+ * @return 1 se la mossa è valida, 0 altrimenti
+*/
+int plugin_valid(const tet_t tets[TET_TYPES], xtetris_bot_move_t move)
+{
+    /* Le colonne oltre il bordo destro vengono spostate da insert, come nel gioco */
+    return move.piece >= 0 && move.piece < TET_TYPES && tets[move.piece].quantity > 0
+           && move.rotation >= 0 && move.rotation < 4 && move.column >= 0 && move.column < FIELD_COLS;
+}
+
+int plugin_legal_moves(const xtetris_bot_position_t* pos, xtetris_bot_move_t out[XTETRIS_BOT_MAX_MOVES])
+{
+    tet_t tets[TET_TYPES];
+    placements_t legal;
+    int i;
+
+    memcpy(tets, plugin_tets, sizeof(tets));
+    state_to_tets((const game_state_t*)pos, tets);
+    placements_gen(tets, &legal);
+
+    for(i = 0; i < legal.count; i++)
+    {
+        out[i].piece = legal.moves[i].id;
+        out[i].rotation = legal.moves[i].rot;
+        out[i].column = legal.moves[i].col;
+    }
+    return legal.count;
+}
+
+int plugin_try_move(const xtetris_bot_position_t* pos, int player, xtetris_bot_move_t move,
+                    int out[XTETRIS_BOT_ROWS][XTETRIS_BOT_COLS])
+{
+    tet_t tets[TET_TYPES];
+    placement_t p;
+
+    memcpy(tets, plugin_tets, sizeof(tets));
+    state_to_tets((const game_state_t*)pos, tets);
+    if(player < 0 || player >= pos->players || !plugin_valid(tets, move))
+        return -1;
+
+    p.id = move.piece;
+    p.rot = move.rotation;
+    p.col = move.column;
+    return com_try_move((int (*)[FIELD_COLS])pos->fields[player], tets, p, out);
+}
+
+int plugin_open(plugin_t* plugin, const char* path, const char* args)
+{
+    XtetrisBotAbiFn abi;
+    XtetrisBotInitFn init;
+
+    memset(plugin, 0, sizeof(*plugin));
+
+    plugin->handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if(!plugin->handle)
+        return -1;
+
+    if(plugin_symbol(plugin->handle, "xtetris_bot_abi", &abi) != 0
+       || plugin_symbol(plugin->handle, "xtetris_bot_init", &init) != 0
+       || plugin_symbol(plugin->handle, "xtetris_bot_choose_move", &plugin->choose) != 0
+       || plugin_symbol(plugin->handle, "xtetris_bot_free", &plugin->free_bot) != 0
+       || abi() != XTETRIS_BOT_ABI_VERSION)
+    {
+        dlclose(plugin->handle);
+        plugin->handle = NULL;
+        return -1;
+    }
+
+    if(!plugin_tets_ready)
+    {
+        tets_init(plugin_tets, 1);
+        plugin_tets_ready = 1;
+    }
+    plugin_open_count++;
+
+    if(init(&plugin_host, args ? args : "", &plugin->bot, &plugin->flags) != 0)
+    {
+        plugin->free_bot = NULL;
+        plugin_close(plugin);
+        return -1;
+    }
+
+    if(!(plugin->flags & XTETRIS_BOT_REENTRANT))
+    {
+        plugin->lock = malloc(sizeof(pthread_mutex_t));
+        pthread_mutex_init((pthread_mutex_t*)plugin->lock, NULL);
+    }
+    return 0;
+}
+
+void plugin_close(plugin_t* plugin)
+{
+    if(!plugin->handle)
+        return;
+
+    if(plugin->free_bot)
+        plugin->free_bot(plugin->bot);
+    if(plugin->lock)
+    {
+        pthread_mutex_destroy((pthread_mutex_t*)plugin->lock);
+        free(plugin->lock);
+    }
+    dlclose(plugin->handle);
+    memset(plugin, 0, sizeof(*plugin));
+
+    if(--plugin_open_count == 0 && plugin_tets_ready)
+    {
+        tets_free(plugin_tets);
+        plugin_tets_ready = 0;
+    }
+}
+
+int plugin_move(const plugin_t* plugin, const game_state_t* state, int player, tet_t tets[TET_TYPES], placement_t* move)
+{
+    xtetris_bot_move_t choice;
+    int res;
+
+    if(plugin->lock)
+        pthread_mutex_lock((pthread_mutex_t*)plugin->lock);
+    res = plugin->choose(plugin->bot, (const xtetris_bot_position_t*)state, player, &choice);
+    if(plugin->lock)
+        pthread_mutex_unlock((pthread_mutex_t*)plugin->lock);
+
+    if(res != 0 || !plugin_valid(tets, choice))
+        return -1;
+
+    move->id = choice.piece;
+    move->rot = choice.rotation;
+    move->col = choice.column;
+    return 0;
+}
@@ -0,0 +1,56 @@
+/**
+* @file Plugin.h
+* @author Albert Alibeaj
+* @brief Libreria che carica con dlopen i bot esterni che implementano l'interfaccia di Bot.h
+ * e li fa giocare nello stesso processo: a ogni mossa il bot riceve un puntatore allo stato
+ * della partita, senza copie né serializzazione
+*/
+
+#ifndef XTETRIS2_PLUGIN_H
+#define XTETRIS2_PLUGIN_H
+
+#include "Bot.h"
+#include "State.h"
+
+/** Tipo plugin_t
+*   Bot caricato
+*/
+typedef struct Plugin
+{
+    void* handle;                   /**< libreria aperta con dlopen */
+    void* bot;                      /**< istanza creata da xtetris_bot_init */
+    int flags;                      /**< opzioni impostate da xtetris_bot_init (XTETRIS_BOT_REENTRANT) */
+    XtetrisBotChooseFn choose;      /**< xtetris_bot_choose_move */
+    XtetrisBotFreeFn free_bot;      /**< xtetris_bot_free */
+    void* lock;                     /**< mutex che serializza le mosse se il bot non è rientrante */
+
+} plugin_t;
+
+/**
+* Carica un bot e ne crea un'istanza
+ * @param plugin bot da inizializzare
+ * @param path percorso della libreria condivisa
+ * @param args argomenti passati a xtetris_bot_init (NULL equivale a stringa vuota)
+ * @return 0 se il bot è pronto, -1 se la libreria non si apre, non esporta l'interfaccia,
+ * ha un'altra versione dell'interfaccia o xtetris_bot_init fallisce
+*/
+int plugin_open(plugin_t* plugin, const char* path, const char* args);
+
+/**
+* Libera l'istanza del bot e chiude la libreria
+ * @param plugin bot caricato
+*/
+void plugin_close(plugin_t* plugin);
+
+/**
+* Chiede la mossa al bot
+ * @param plugin bot caricato
+ * @param state stato della partita, passato al bot così com'è (non viene modificato)
+ * @param player indice del giocatore che muove
+ * @param tets tetramini con le quantità dello stato
+ * @param move mossa scelta
+ * @return 0 se il bot ha scelto una mossa valida, -1 altrimenti
+*/
+int plugin_move(const plugin_t* plugin, const game_state_t* state, int player, tet_t tets[TET_TYPES], placement_t* move);
+
+#endif /*XTETRIS2_PLUGIN_H*/
@@ -0,0 +1,157 @@
+/**
+* @file Ponder.c
+* @author Albert Alibeaj
+* @brief File di implementazione del calcolo in anticipo delle risposte del computer
+*/
+
+#include <string.h>
+#include <pthread.h>
+#include "Ponder.h"
+#include "Moves.h"
+#include "Trace.h"
+
+/** Numero di varianti di attacco considerate: nessuna, 3 righe invertite, 4 righe invertite */
+#define PONDER_ATTACKS 3
+
+/** Tipo ponder_result_t
+*   Risposta del computer preparata per una possibile mossa del giocatore
+*/
+typedef struct PonderResult
+{
+    int done;               /**< 1 se la risposta è stata calcolata per intero */
+    placement_t move;       /**< risposta del computer */
+
+} ponder_result_t;
+
+const int ponder_attacks[PONDER_ATTACKS] = {0, 3, 4};  /**< righe invertite in ogni variante */
+
+int ponder_field[FIELD_ROWS][FIELD_COLS];       /**< campo del computer prima della mossa del giocatore */
+tet_t ponder_tets[TET_TYPES];                   /**< tetramini prima della mossa del giocatore */
+com_weights_t ponder_weights;                   /**< pesi della valutazione */
+ponder_result_t ponder_results[TET_TYPES][PONDER_ATTACKS];  /**< risposte per tetramino usato dal giocatore e attacco */
+int ponder_cancel;                              /**< diverso da 0 quando il thread deve fermarsi */
+int ponder_running = 0;                         /**< 1 se il thread è stato avviato e non ancora atteso */
+pthread_t ponder_thread;                        /**< thread che calcola le risposte */
+
+/**
+* Campo del computer in una variante di attacco
+ * @param attack indice della variante in ponder_attacks
+ * @param field campo da riempire
+*/
+void ponder_variant_field(int attack, int field[FIELD_ROWS][FIELD_COLS]);
+
+/**
+* Funzione eseguita dal thread: calcola le risposte dalla variante più probabile
+ * (nessun attacco) alla meno probabile, finchè non viene fermato
+ * @param arg non usato
+ * @return sempre NULL
+*/
+void* ponder_worker(void* arg);
+
+void ponder_variant_field(int attack, int field[FIELD_ROWS][FIELD_COLS])
+{
+    memcpy(field, ponder_field, sizeof(ponder_field));
+    xor_rows(field, ponder_attacks[attack]);
+}
+
+void* ponder_worker(void* arg)
+{
+    int attack, id;
+    (void)arg;
+
+    trace_thread_name("ponder");
+
+    for(attack = 0; attack < PONDER_ATTACKS; attack++)
+    {
+        int field[FIELD_ROWS][FIELD_COLS];
+        ponder_variant_field(attack, field);
+
+        for(id = 0; id < TET_TYPES; id++)
+        {
+            tet_t tets[TET_TYPES];
+            placement_t move;
+
+            if(__atomic_load_n(&ponder_cancel, __ATOMIC_RELAXED))
+                return NULL;
+            if(ponder_tets[id].quantity <= 0)
+                continue;
+
+            /* Quantità come saranno dopo che il giocatore ha usato il tetramino id */
+            memcpy(tets, ponder_tets, sizeof(tets));
+            tets[id].quantity--;
+
+            trace_begin("ponder_search");
+            com_search(field, tets, &ponder_weights, &move, &ponder_cancel);
+            trace_end("ponder_search");
+            if(__atomic_load_n(&ponder_cancel, __ATOMIC_RELAXED))
+                return NULL;
+
+            ponder_results[id][attack].move = move;
+            ponder_results[id][attack].done = 1;
+        }
+    }
+
+    return NULL;
+}
+
+void ponder_start(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const com_weights_t* weights)
+{
+    ponder_stop();
+
+    memcpy(ponder_field, field, sizeof(ponder_field));
+    memcpy(ponder_tets, tets, sizeof(ponder_tets));
+    ponder_weights = *weights;
+    memset(ponder_results, 0, sizeof(ponder_results));
+    ponder_cancel = 0;
+
+    if(pthread_create(&ponder_thread, NULL, ponder_worker, NULL) == 0)
+        ponder_running = 1;
+}
+
+void ponder_stop()
+{
+    if(!ponder_running)
+        return;
+
+    __atomic_store_n(&ponder_cancel, 1, __ATOMIC_RELAXED);
+    pthread_join(ponder_thread, NULL);
+    ponder_running = 0;
+}
+
+int ponder_take(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placement_t* move)
+{
+    int used = -1, id, attack;
+
+    if(!ponder_running)
+        return 0;
+    ponder_stop();
+
+    /* Il giocatore ha usato esattamente un tetramino */
+    for(id = 0; id < TET_TYPES; id++)
+    {
+        int diff = ponder_tets[id].quantity - tets[id].quantity;
+        if(diff == 1 && used < 0)
+            used = id;
+        else if(diff != 0)
+            return 0;
+    }
+    if(used < 0)
+        return 0;
+
+    for(attack = 0; attack < PONDER_ATTACKS; attack++)
+    {
+        int variant[FIELD_ROWS][FIELD_COLS];
+
+        if(!ponder_results[used][attack].done)
+            continue;
+
+        ponder_variant_field(attack, variant);
+        if(memcmp(variant, field, sizeof(variant)) == 0)
+        {
+            *move = ponder_results[used][attack].move;
+            return 1;
+        }
+    }
+
+    return 0;
+}
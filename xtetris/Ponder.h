@@ -0,0 +1,38 @@
+/**
+* @file Ponder.h
+* @author Albert Alibeaj
+* @brief Libreria che calcola in anticipo, su un thread separato, la risposta
+ * del computer mentre il giocatore sta ancora scegliendo la sua mossa.
+ * Per ogni tetramino che il giocatore può usare (e per ogni possibile attacco
+ * con le righe invertite) viene preparata la mossa migliore del computer
+*/
+
+#ifndef XTETRIS2_PONDER_H
+#define XTETRIS2_PONDER_H
+
+#include "Com.h"
+
+/**
+* Avvia il calcolo in anticipo delle risposte del computer.
+ * Campo e quantità vengono copiati: il chiamante può continuare a modificarli
+ * @param field campo del computer prima della mossa del giocatore
+ * @param tets tetramini con le quantità prima della mossa del giocatore
+ * @param weights pesi della valutazione del computer
+*/
+void ponder_start(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], const com_weights_t* weights);
+
+/**
+* Ferma il calcolo in corso e cerca una risposta già pronta per la posizione reale
+ * @param field campo del computer dopo la mossa del giocatore
+ * @param tets tetramini con le quantità dopo la mossa del giocatore
+ * @param move mossa da giocare, se trovata
+ * @return 1 se la risposta era già pronta, 0 se va calcolata
+*/
+int ponder_take(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placement_t* move);
+
+/**
+* Ferma il calcolo in corso e scarta i risultati (per esempio se la partita termina)
+*/
+void ponder_stop();
+
+#endif /*XTETRIS2_PONDER_H*/
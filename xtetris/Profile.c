@@ -0,0 +1,154 @@
+/**
+* @file Profile.c
+* @author Albert Alibeaj
+* @brief File di implementazione della strumentazione delle funzioni più usate
+*/
+
+/* sigaction e SA_RESTART sono POSIX: vanno richiesti anche compilando con -ansi */
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include "Profile.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+/** 1 se i tempi sono in cicli di clock, 0 se in nanosecondi */
+#define PROFILE_CYCLES 1
+#else
+#define PROFILE_CYCLES 0
+#endif
+
+/** Lunghezza massima del percorso del file dei dati */
+#define PROFILE_PATH_LEN 256
+
+const char* profile_names[PROFILE_COUNT] = {
+    "insert", "rotate_dx", "tet_adjust", "getscore",
+    "deleterow", "print_field", "print_tet", "get_input"
+};
+
+unsigned long profile_calls[PROFILE_COUNT];     /**< chiamate di ogni funzione */
+unsigned long profile_total[PROFILE_COUNT];     /**< tempo totale di ogni funzione */
+char profile_path[PROFILE_PATH_LEN] = "xtetris-profile.txt";   /**< file su cui salvare i dati */
+
+/**
+* Gestore di SIGUSR1: salva i dati senza interrompere la partita
+ * @param sig segnale ricevuto
+*/
+void profile_signal(int sig);
+
+/**
+* Scrive una stringa su un file descriptor
+ * @param fd file descriptor
+ * @param s stringa da scrivere
+*/
+void profile_write(int fd, const char* s);
+
+/**
+* Scrive un numero allineato a destra su un file descriptor, senza usare printf
+ * @param fd file descriptor
+ * @param value numero da scrivere
+ * @param width larghezza minima del campo
+*/
+void profile_write_number(int fd, unsigned long value, int width);
+
+unsigned long profile_ticks()
+{
+#if PROFILE_CYCLES
+    return (unsigned long)__rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long)ts.tv_sec * 1000000000UL + (unsigned long)ts.tv_nsec;
+#endif
+}
+
+void profile_add(profile_id_t id, unsigned long ticks)
+{
+    __atomic_fetch_add(&profile_calls[id], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&profile_total[id], ticks, __ATOMIC_RELAXED);
+}
+
+void profile_init()
+{
+    struct sigaction action;
+    const char* path = getenv("XTETRIS_PROFILE_FILE");
+
+    if(path && *path)
+    {
+        strncpy(profile_path, path, PROFILE_PATH_LEN - 1);
+        profile_path[PROFILE_PATH_LEN - 1] = '\0';
+    }
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = profile_signal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, NULL);
+}
+
+void profile_signal(int sig)
+{
+    (void)sig;
+    profile_dump("SIGUSR1");
+}
+
+void profile_write(int fd, const char* s)
+{
+    ssize_t unused = write(fd, s, strlen(s));
+    (void)unused;
+}
+
+void profile_write_number(int fd, unsigned long value, int width)
+{
+    char buf[24];
+    int i = sizeof(buf) - 1;
+
+    buf[i] = '\0';
+    do
+    {
+        buf[--i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+    while(value && i > 0);
+
+    while(i > 0 && (int)sizeof(buf) - 1 - i < width)
+        buf[--i] = ' ';
+
+    profile_write(fd, buf + i);
+}
+
+void profile_dump(const char* reason)
+{
+    int fd = open(profile_path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    int i;
+
+    if(fd < 0)
+        return;
+
+    profile_write(fd, "# xtetris profile: ");
+    profile_write(fd, reason);
+    profile_write(fd, PROFILE_CYCLES ? " (tempi in cicli)\n" : " (tempi in ns)\n");
+    profile_write(fd, "# funzione          chiamate              totale       media\n");
+
+    for(i = 0; i < PROFILE_COUNT; i++)
+    {
+        unsigned long calls = __atomic_load_n(&profile_calls[i], __ATOMIC_RELAXED);
+        unsigned long total = __atomic_load_n(&profile_total[i], __ATOMIC_RELAXED);
+        int pad = 14 - (int)strlen(profile_names[i]);
+
+        profile_write(fd, profile_names[i]);
+        while(pad-- > 0)
+            profile_write(fd, " ");
+        profile_write_number(fd, calls, 14);
+        profile_write_number(fd, total, 20);
+        profile_write_number(fd, calls ? total / calls : 0, 12);
+        profile_write(fd, "\n");
+    }
+
+    close(fd);
+}
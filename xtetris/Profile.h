@@ -0,0 +1,81 @@
+/**
+* @file Profile.h
+* @author Albert Alibeaj
+* @brief Libreria di strumentazione delle funzioni più usate: numero di chiamate e tempo speso.
+ * È attiva solo se il programma è compilato con XTETRIS_PROFILE definita
+ * (opzione CMake XTETRIS_PROFILE), altrimenti le macro non generano codice.
+ *
+ * Uso in una funzione: PROFILE_DECL; tra le dichiarazioni, PROFILE_BEGIN(); all'inizio
+ * e PROFILE_END(id); prima di ogni uscita. I tempi sono inclusivi: insert comprende
+ * anche rotate_dx, tet_adjust, getscore e deleterow che richiama
+*/
+
+#ifndef XTETRIS2_PROFILE_H
+#define XTETRIS2_PROFILE_H
+
+/** Funzioni misurate */
+typedef enum ProfileId
+{
+    PROFILE_INSERT,         /**< insert */
+    PROFILE_ROTATE_DX,      /**< rotate_dx */
+    PROFILE_TET_ADJUST,     /**< tet_adjust */
+    PROFILE_GETSCORE,       /**< getscore */
+    PROFILE_DELETEROW,      /**< deleterow */
+    PROFILE_PRINT_FIELD,    /**< print_field */
+    PROFILE_PRINT_TET,      /**< print_tet */
+    PROFILE_GET_INPUT,      /**< attesa di un tasto in get_input e get_input_timeout */
+    PROFILE_COUNT           /**< numero di funzioni misurate */
+
+} profile_id_t;
+
+#ifdef XTETRIS_PROFILE
+
+/** Dichiara l'istante di inizio della misura (va messa tra le dichiarazioni) */
+#define PROFILE_DECL unsigned long profile_start
+/** Inizia la misura */
+#define PROFILE_BEGIN() (profile_start = profile_ticks())
+/** Termina la misura e la attribuisce alla funzione id */
+#define PROFILE_END(id) profile_add((id), profile_ticks() - profile_start)
+/** Prepara il salvataggio dei dati (anche alla ricezione di SIGUSR1) */
+#define PROFILE_INIT() profile_init()
+/** Salva i dati raccolti finora */
+#define PROFILE_DUMP(reason) profile_dump(reason)
+
+#else
+
+/* La variabile resta dichiarata e viene solo nominata, per non generare avvisi con -Wall */
+#define PROFILE_DECL unsigned long profile_start
+#define PROFILE_BEGIN() ((void)&profile_start)
+#define PROFILE_END(id) ((void)0)
+#define PROFILE_INIT() ((void)0)
+#define PROFILE_DUMP(reason) ((void)0)
+
+#endif /*XTETRIS_PROFILE*/
+
+/**
+* Contatore che avanza a ogni ciclo di clock se disponibile (rdtsc), altrimenti ogni nanosecondo
+ * @return valore corrente del contatore
+*/
+unsigned long profile_ticks();
+
+/**
+* Attribuisce una chiamata e il suo tempo a una funzione. Può essere chiamata da più thread
+ * @param id funzione misurata
+ * @param ticks durata della chiamata
+*/
+void profile_add(profile_id_t id, unsigned long ticks);
+
+/**
+* Legge il file su cui salvare i dati (variabile d'ambiente XTETRIS_PROFILE_FILE,
+ * predefinito xtetris-profile.txt) e installa il gestore di SIGUSR1 che li salva
+*/
+void profile_init();
+
+/**
+* Aggiunge al file i dati raccolti dall'avvio del programma.
+ * Usa solo funzioni sicure nei gestori di segnale
+ * @param reason motivo del salvataggio, scritto nell'intestazione
+*/
+void profile_dump(const char* reason);
+
+#endif /*XTETRIS2_PROFILE_H*/
@@ -0,0 +1,467 @@
+/**
+* @file Results.c
+* @author Albert Alibeaj
+* @brief File di implementazione dell'archivio dei risultati
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "Results.h"
+
+/** Risultati per cui c'è spazio in un archivio appena creato */
+#define RESULTS_INITIAL 1024
+/** Voci che possono restare nella coda dell'indice prima di essere fuse con la parte principale */
+#define RESULTS_TAIL_MAX 256
+
+/** Tipo results_header_t
+*   Intestazione del file dei risultati
+*/
+typedef struct ResultsHeader
+{
+    char magic[8];              /**< RESULTS_MAGIC */
+    unsigned int count;         /**< risultati salvati */
+    unsigned int record_len;    /**< byte di ogni risultato */
+
+} results_header_t;
+
+/** Tipo results_index_header_t
+*   Intestazione del file dell'indice
+*/
+typedef struct ResultsIndexHeader
+{
+    char magic[8];              /**< RESULTS_INDEX_MAGIC */
+    unsigned int count;         /**< risultati indicizzati */
+    unsigned int sorted;        /**< voci della parte principale; le seguenti sono la coda, ordinata a parte */
+
+} results_index_header_t;
+
+/** Tipo results_entry_t
+*   Voce dell'indice
+*/
+typedef struct ResultsEntry
+{
+    int mode;                   /**< modalità del risultato */
+    int score;                  /**< punteggio in classifica */
+    unsigned int record;        /**< posizione del risultato nel file dei risultati */
+
+} results_entry_t;
+
+/** Intestazione del file dei risultati di un archivio aperto */
+#define DB_HEADER(db) ((results_header_t*)(db)->data)
+/** Risultati di un archivio aperto */
+#define DB_RECORDS(db) ((game_result_t*)((db)->data + sizeof(results_header_t)))
+/** Intestazione dell'indice di un archivio aperto */
+#define DB_INDEX_HEADER(db) ((results_index_header_t*)(db)->idx)
+/** Voci dell'indice di un archivio aperto */
+#define DB_ENTRIES(db) ((results_entry_t*)((db)->idx + sizeof(results_index_header_t)))
+
+/**
+* Adegua la mappatura di un file alla sua dimensione attuale, che un altro processo può aver cambiato
+ * @param fd file
+ * @param map mappatura da aggiornare
+ * @param len byte mappati da aggiornare
+ * @param writable 1 se la mappatura deve essere scrivibile
+ * @return 0 se il file è mappato, -1 altrimenti
+*/
+int results_map(int fd, unsigned char** map, size_t* len, int writable);
+
+/**
+* Allarga un file, raddoppiandolo, finché non contiene almeno un certo numero di byte
+ * @param fd file
+ * @param map mappatura da aggiornare
+ * @param len byte mappati da aggiornare
+ * @param needed byte necessari
+ * @return 0 se il file è abbastanza grande, -1 altrimenti
+*/
+int results_reserve(int fd, unsigned char** map, size_t* len, size_t needed);
+
+/**
+* Aggiorna le mappature di entrambi i file (da chiamare dopo aver preso il lock)
+ * @param db archivio aperto
+ * @return 0 se i file sono mappati e validi, -1 altrimenti
+*/
+int results_sync(results_db_t* db);
+
+/**
+* Ricostruisce l'indice; il chiamante deve avere il lock esclusivo
+ * @param db archivio aperto in scrittura
+ * @return 0 se l'indice è stato ricostruito, -1 altrimenti
+*/
+int results_reindex_locked(results_db_t* db);
+
+/**
+* Confronta due voci secondo l'ordine dell'indice (per qsort)
+ * @param a prima voce
+ * @param b seconda voce
+ * @return negativo se a viene prima di b, positivo se viene dopo, 0 se sono uguali
+*/
+int results_compare(const void* a, const void* b);
+
+/**
+* Prima posizione di un tratto ordinato dell'indice la cui voce non viene prima di quella data
+ * @param entries voci dell'indice
+ * @param lo inizio del tratto
+ * @param hi fine del tratto (esclusa)
+ * @param key voce da cercare
+ * @return posizione trovata (hi se sono tutte precedenti)
+*/
+unsigned long results_lower_bound(const results_entry_t* entries, unsigned long lo, unsigned long hi, const results_entry_t* key);
+
+/**
+* Fonde la coda dell'indice con la parte principale, partendo dalla fine così che ogni voce
+ * principale si sposti al più una volta; il chiamante deve avere il lock esclusivo.
+ * Se manca la memoria la coda resta com'è
+ * @param db archivio aperto in scrittura
+*/
+void results_merge(results_db_t* db);
+
+int results_map(int fd, unsigned char** map, size_t* len, int writable)
+{
+    struct stat st;
+    void* p;
+
+    if(fstat(fd, &st) != 0)
+        return -1;
+    if(*map && (size_t)st.st_size == *len)
+        return 0;
+
+    if(*map)
+        munmap(*map, *len);
+    *map = NULL;
+    *len = 0;
+
+    if(st.st_size == 0)
+        return -1;
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED, fd, 0);
+    if(p == MAP_FAILED)
+        return -1;
+
+    *map = (unsigned char*)p;
+    *len = (size_t)st.st_size;
+    return 0;
+}
+
+int results_reserve(int fd, unsigned char** map, size_t* len, size_t needed)
+{
+    size_t size = *len;
+
+    if(needed <= size)
+        return 0;
+    while(size < needed)
+        size *= 2;
+    if(ftruncate(fd, (off_t)size) != 0)
+        return -1;
+
+    return results_map(fd, map, len, 1);
+}
+
+int results_sync(results_db_t* db)
+{
+    if(results_map(db->fd, &db->data, &db->data_len, db->writable) != 0 ||
+       results_map(db->idx_fd, &db->idx, &db->idx_len, db->writable) != 0)
+        return -1;
+
+    if(db->data_len < sizeof(results_header_t) || memcmp(DB_HEADER(db)->magic, RESULTS_MAGIC, 8) != 0 ||
+       DB_HEADER(db)->record_len != sizeof(game_result_t) ||
+       db->idx_len < sizeof(results_index_header_t) || memcmp(DB_INDEX_HEADER(db)->magic, RESULTS_INDEX_MAGIC, 8) != 0)
+        return -1;
+
+    return 0;
+}
+
+int results_compare(const void* a, const void* b)
+{
+    const results_entry_t* x = (const results_entry_t*)a;
+    const results_entry_t* y = (const results_entry_t*)b;
+
+    if(x->mode != y->mode)
+        return x->mode < y->mode ? -1 : 1;
+    if(x->score != y->score)
+        return x->score > y->score ? -1 : 1;
+    if(x->record != y->record)
+        return x->record < y->record ? -1 : 1;
+    return 0;
+}
+
+unsigned long results_lower_bound(const results_entry_t* entries, unsigned long lo, unsigned long hi, const results_entry_t* key)
+{
+    while(lo < hi)
+    {
+        unsigned long mid = lo + (hi - lo) / 2;
+        if(results_compare(&entries[mid], key) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+void results_merge(results_db_t* db)
+{
+    results_index_header_t* h = DB_INDEX_HEADER(db);
+    results_entry_t* entries = DB_ENTRIES(db);
+    unsigned long n = h->sorted, m = h->count - h->sorted, k = h->count;
+    results_entry_t* tail = (results_entry_t*)malloc(m * sizeof(results_entry_t) + 1);
+
+    if(!tail)
+        return;
+    memcpy(tail, entries + n, m * sizeof(results_entry_t));
+
+    while(m > 0)
+    {
+        if(n > 0 && results_compare(&entries[n - 1], &tail[m - 1]) > 0)
+            entries[--k] = entries[--n];
+        else
+            entries[--k] = tail[--m];
+    }
+    h->sorted = h->count;
+    free(tail);
+}
+
+int results_reindex_locked(results_db_t* db)
+{
+    unsigned long n = DB_HEADER(db)->count, i;
+    results_entry_t* entries;
+    game_result_t* records;
+
+    if(results_reserve(db->idx_fd, &db->idx, &db->idx_len,
+                       sizeof(results_index_header_t) + n * sizeof(results_entry_t)) != 0)
+        return -1;
+
+    entries = DB_ENTRIES(db);
+    records = DB_RECORDS(db);
+    for(i = 0; i < n; i++)
+    {
+        entries[i].mode = records[i].mode;
+        entries[i].score = results_score(&records[i]);
+        entries[i].record = (unsigned int)i;
+    }
+    qsort(entries, n, sizeof(results_entry_t), results_compare);
+    DB_INDEX_HEADER(db)->count = (unsigned int)n;
+    DB_INDEX_HEADER(db)->sorted = (unsigned int)n;
+
+    return 0;
+}
+
+int results_open(results_db_t* db, const char* path, int writable)
+{
+    char* idx_path = (char*)malloc(strlen(path) + 5);
+    int flags = writable ? O_RDWR | O_CREAT : O_RDONLY;
+    int ok = -1, created = 0;
+
+    memset(db, 0, sizeof(*db));
+    db->writable = writable;
+    sprintf(idx_path, "%s.idx", path);
+    db->fd = open(path, flags, 0644);
+    db->idx_fd = open(idx_path, flags, 0644);
+    free(idx_path);
+
+    if(db->fd < 0 || db->idx_fd < 0)
+    {
+        if(db->fd >= 0) close(db->fd);
+        if(db->idx_fd >= 0) close(db->idx_fd);
+        return -1;
+    }
+
+    flock(db->fd, writable ? LOCK_EX : LOCK_SH);
+    if(writable)
+    {
+        struct stat st;
+
+        /* Archivio nuovo: si scrivono le intestazioni e si riserva lo spazio iniziale */
+        if(fstat(db->fd, &st) == 0 && st.st_size == 0)
+        {
+            results_header_t h;
+            memset(&h, 0, sizeof(h));
+            memcpy(h.magic, RESULTS_MAGIC, 8);
+            h.record_len = sizeof(game_result_t);
+            if(write(db->fd, &h, sizeof(h)) != (ssize_t)sizeof(h) ||
+               ftruncate(db->fd, (off_t)(sizeof(h) + RESULTS_INITIAL * sizeof(game_result_t))) != 0)
+                created = -1;
+        }
+        if(fstat(db->idx_fd, &st) == 0 && st.st_size == 0)
+        {
+            results_index_header_t h;
+            memset(&h, 0, sizeof(h));
+            memcpy(h.magic, RESULTS_INDEX_MAGIC, 8);
+            if(write(db->idx_fd, &h, sizeof(h)) != (ssize_t)sizeof(h) ||
+               ftruncate(db->idx_fd, (off_t)(sizeof(h) + RESULTS_INITIAL * sizeof(results_entry_t))) != 0)
+                created = -1;
+        }
+    }
+
+    /* Come in results_reserve: se lo spazio non è stato riservato l'archivio non si apre */
+    if(created == 0 && results_sync(db) == 0)
+    {
+        ok = 0;
+        if(writable && DB_INDEX_HEADER(db)->count != DB_HEADER(db)->count)
+            ok = results_reindex_locked(db);
+    }
+    flock(db->fd, LOCK_UN);
+
+    if(ok != 0)
+        results_close(db);
+    return ok;
+}
+
+void results_close(results_db_t* db)
+{
+    if(db->data)
+        munmap(db->data, db->data_len);
+    if(db->idx)
+        munmap(db->idx, db->idx_len);
+    if(db->fd >= 0)
+        close(db->fd);
+    if(db->idx_fd >= 0)
+        close(db->idx_fd);
+
+    memset(db, 0, sizeof(*db));
+    db->fd = db->idx_fd = -1;
+}
+
+unsigned long results_count(results_db_t* db)
+{
+    unsigned long count = 0;
+
+    flock(db->fd, LOCK_SH);
+    if(results_sync(db) == 0)
+        count = DB_HEADER(db)->count;
+    flock(db->fd, LOCK_UN);
+
+    return count;
+}
+
+int results_append(results_db_t* db, const game_result_t* results, unsigned long n)
+{
+    int ok = -1;
+
+    flock(db->fd, LOCK_EX);
+    if(results_sync(db) == 0 &&
+       results_reserve(db->fd, &db->data, &db->data_len,
+                       sizeof(results_header_t) + (DB_HEADER(db)->count + n) * sizeof(game_result_t)) == 0)
+    {
+        memcpy(DB_RECORDS(db) + DB_HEADER(db)->count, results, n * sizeof(game_result_t));
+        /* Il conteggio si aggiorna per ultimo: chi legge vede solo risultati completi */
+        DB_HEADER(db)->count += (unsigned int)n;
+        ok = 0;
+    }
+    flock(db->fd, LOCK_UN);
+
+    return ok;
+}
+
+int results_add(results_db_t* db, const game_result_t* result)
+{
+    results_entry_t entry;
+    results_entry_t* entries;
+    results_index_header_t* h;
+    unsigned long pos;
+    int ok = -1;
+
+    flock(db->fd, LOCK_EX);
+    if(results_sync(db) == 0 &&
+       results_reserve(db->fd, &db->data, &db->data_len,
+                       sizeof(results_header_t) + (DB_HEADER(db)->count + 1) * sizeof(game_result_t)) == 0 &&
+       results_reserve(db->idx_fd, &db->idx, &db->idx_len,
+                       sizeof(results_index_header_t) + (DB_INDEX_HEADER(db)->count + 1) * sizeof(results_entry_t)) == 0)
+    {
+        entry.mode = result->mode;
+        entry.score = results_score(result);
+        entry.record = DB_HEADER(db)->count;
+
+        DB_RECORDS(db)[entry.record] = *result;
+        DB_HEADER(db)->count++;
+
+        /* Inserimento ordinato nella coda: si spostano al più RESULTS_TAIL_MAX voci */
+        h = DB_INDEX_HEADER(db);
+        if(h->count - h->sorted >= RESULTS_TAIL_MAX)
+            results_merge(db);
+        entries = DB_ENTRIES(db);
+        pos = results_lower_bound(entries, h->sorted, h->count, &entry);
+        memmove(&entries[pos + 1], &entries[pos], (h->count - pos) * sizeof(results_entry_t));
+        entries[pos] = entry;
+        h->count++;
+        ok = 0;
+    }
+    flock(db->fd, LOCK_UN);
+
+    return ok;
+}
+
+int results_reindex(results_db_t* db)
+{
+    int ok = -1;
+
+    flock(db->fd, LOCK_EX);
+    if(results_sync(db) == 0)
+        ok = results_reindex_locked(db);
+    flock(db->fd, LOCK_UN);
+
+    return ok;
+}
+
+int results_top(results_db_t* db, int mode, game_result_t* out, int n)
+{
+    results_entry_t key;
+    unsigned long a, b, sorted, count;
+    int found = 0;
+
+    flock(db->fd, LOCK_SH);
+    if(results_sync(db) == 0)
+    {
+        const results_entry_t* entries = DB_ENTRIES(db);
+        const game_result_t* records = DB_RECORDS(db);
+
+        /* Prima voce della modalità: quella con il punteggio più alto */
+        key.mode = mode;
+        key.score = INT_MAX;
+        key.record = 0;
+        sorted = DB_INDEX_HEADER(db)->sorted;
+        count = DB_INDEX_HEADER(db)->count;
+        a = results_lower_bound(entries, 0, sorted, &key);
+        b = results_lower_bound(entries, sorted, count, &key);
+
+        /* Fusione al volo della parte principale con la coda */
+        while(found < n)
+        {
+            int in_a = a < sorted && entries[a].mode == mode;
+            int in_b = b < count && entries[b].mode == mode;
+
+            if(!in_a && !in_b)
+                break;
+            if(in_a && (!in_b || results_compare(&entries[a], &entries[b]) < 0))
+                out[found++] = records[entries[a++].record];
+            else
+                out[found++] = records[entries[b++].record];
+        }
+    }
+    flock(db->fd, LOCK_UN);
+
+    return found;
+}
+
+int results_score(const game_result_t* result)
+{
+    return result->score1 > result->score2 ? result->score1 : result->score2;
+}
+
+void results_save(const game_result_t* result)
+{
+    const char* path = getenv("XTETRIS_RESULTS");
+    results_db_t db;
+
+    /* L'archivio si usa solo se richiesto: una partita non scrive file nella cartella corrente */
+    if(!path || !*path || results_open(&db, path, 1) != 0)
+        return;
+
+    results_add(&db, result);
+    results_close(&db);
+}
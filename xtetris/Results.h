@@ -0,0 +1,137 @@
+/**
+* @file Results.h
+* @author Albert Alibeaj
+* @brief Libreria che conserva i risultati delle partite in un archivio mappato in memoria,
+ * con un indice ordinato per modalità e punteggio che permette di leggere la classifica
+ * senza caricare l'intero archivio.
+ *
+ * L'archivio è composto da due file:
+ *  - <code>percorso</code>: intestazione (RESULTS_MAGIC, numero di risultati, dimensione di un risultato)
+ *    seguita dai risultati nell'ordine in cui sono stati aggiunti;
+ *  - <code>percorso.idx</code>: intestazione (RESULTS_INDEX_MAGIC, risultati indicizzati, voci della parte principale)
+ *    seguita da una voce per risultato, ordinata per modalità, punteggio decrescente e ordine di arrivo.
+ *    Le voci nuove entrano in una breve coda, ordinata a parte dopo la parte principale, che viene fusa
+ *    con quest'ultima quando si allunga: un inserimento non sposta tutto l'indice.
+ *
+ * I file usano l'ordine dei byte della macchina. Più processi possono usare lo stesso archivio:
+ * le scritture sono serializzate con flock. Se l'indice è rimasto indietro (ad esempio per
+ * un'interruzione tra le due scritture) viene ricostruito alla prima apertura in scrittura.
+*/
+
+#ifndef XTETRIS2_RESULTS_H
+#define XTETRIS2_RESULTS_H
+
+#include <stddef.h>
+
+/** Intestazione del file dei risultati */
+#define RESULTS_MAGIC "XTRESDB1"
+/** Intestazione del file dell'indice */
+#define RESULTS_INDEX_MAGIC "XTRESIX1"
+/** File letto da xtetris-results se XTETRIS_RESULTS non è impostata */
+#define RESULTS_DEFAULT_FILE "xtetris-results.db"
+
+/** Tipo game_result_t
+*   Esito di una partita così come viene salvato nell'archivio
+*/
+typedef struct GameResult
+{
+    int mode;                   /**< modalità (0 singleplayer, 1 multiplayer, 2 contro il computer) */
+    int reason;                 /**< motivo della fine (event_end_t) */
+    int winner;                 /**< giocatore vincitore (0 se nessuno) */
+    int score1;                 /**< punteggio del giocatore 1 */
+    int score2;                 /**< punteggio del giocatore 2 (0 in singleplayer) */
+    int moves;                  /**< tetramini inseriti da tutti i giocatori */
+    unsigned int duration_ms;   /**< durata della partita in millisecondi */
+    unsigned int seed;          /**< seme del generatore casuale della partita */
+    unsigned int time;          /**< fine della partita, in secondi dal 1970 */
+    unsigned int reserved;      /**< non usato, sempre 0 */
+
+} game_result_t;
+
+/** Tipo results_db_t
+*   Archivio aperto
+*/
+typedef struct ResultsDb
+{
+    int fd;                     /**< file dei risultati */
+    int idx_fd;                 /**< file dell'indice */
+    int writable;               /**< 1 se l'archivio è aperto in scrittura */
+    unsigned char* data;        /**< file dei risultati mappato in memoria */
+    size_t data_len;            /**< byte mappati del file dei risultati */
+    unsigned char* idx;         /**< file dell'indice mappato in memoria */
+    size_t idx_len;             /**< byte mappati del file dell'indice */
+
+} results_db_t;
+
+/**
+* Apre un archivio, creandolo se è aperto in scrittura e non esiste
+ * @param db archivio da inizializzare
+ * @param path percorso del file dei risultati
+ * @param writable 1 per aggiungere risultati, 0 per la sola lettura
+ * @return 0 se l'archivio è stato aperto, -1 altrimenti
+*/
+int results_open(results_db_t* db, const char* path, int writable);
+
+/**
+* Chiude un archivio
+ * @param db archivio aperto
+*/
+void results_close(results_db_t* db);
+
+/**
+* Numero di risultati nell'archivio
+ * @param db archivio aperto
+ * @return risultati salvati
+*/
+unsigned long results_count(results_db_t* db);
+
+/**
+* Aggiunge un risultato e lo inserisce nell'indice
+ * @param db archivio aperto in scrittura
+ * @param result risultato da aggiungere
+ * @return 0 se il risultato è stato salvato, -1 altrimenti
+*/
+int results_add(results_db_t* db, const game_result_t* result);
+
+/**
+* Aggiunge molti risultati senza aggiornare l'indice, da ricostruire poi con results_reindex
+ * @param db archivio aperto in scrittura
+ * @param results risultati da aggiungere
+ * @param n numero di risultati
+ * @return 0 se i risultati sono stati salvati, -1 altrimenti
+*/
+int results_append(results_db_t* db, const game_result_t* results, unsigned long n);
+
+/**
+* Ricostruisce l'indice ordinando tutti i risultati
+ * @param db archivio aperto in scrittura
+ * @return 0 se l'indice è stato ricostruito, -1 altrimenti
+*/
+int results_reindex(results_db_t* db);
+
+/**
+* Migliori risultati di una modalità, in ordine di punteggio decrescente.
+ * Legge solo le voci dell'indice e i risultati restituiti
+ * @param db archivio aperto
+ * @param mode modalità
+ * @param out risultati da riempire
+ * @param n numero massimo di risultati
+ * @return risultati trovati
+*/
+int results_top(results_db_t* db, int mode, game_result_t* out, int n);
+
+/**
+* Punteggio con cui un risultato compare in classifica: il più alto tra i due giocatori
+ * @param result risultato
+ * @return punteggio in classifica
+*/
+int results_score(const game_result_t* result);
+
+/**
+* Salva un risultato nell'archivio indicato da XTETRIS_RESULTS (nessuno se non impostata o vuota),
+ * aprendolo e chiudendolo
+ * @param result risultato da salvare
+*/
+void results_save(const game_result_t* result);
+
+#endif /*XTETRIS2_RESULTS_H*/
@@ -0,0 +1,343 @@
+/**
+* @file Ring.c
+* @author Albert Alibeaj
+* @brief File di implementazione del collegamento in memoria condivisa con i bot esterni
+*/
+
+/* syscall, usleep e putenv non sono dichiarate con -ansi senza questa richiesta */
+#define _DEFAULT_SOURCE
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "Ring.h"
+#include "Clock.h"
+
+#if defined(__linux__)
+#define RING_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+/** La posizione del record viene copiata dallo stato del motore: i campi comuni devono coincidere */
+typedef char ring_layout_check[(sizeof(xtetris_bot_position_t) <= sizeof(game_state_t)
+        && offsetof(game_state_t, moves) == offsetof(xtetris_bot_position_t, moves)
+        && FIELD_ROWS == XTETRIS_BOT_ROWS && FIELD_COLS == XTETRIS_BOT_COLS && TET_TYPES == XTETRIS_BOT_TETS
+        && sizeof(ring_queue_t) == 192 && (RING_SLOTS & (RING_SLOTS - 1)) == 0) ? 1 : -1];
+
+int ring_spin = -1;     /**< giri di attesa attiva (0 con una sola CPU, dove toglierebbero tempo all'altro processo) */
+
+/**
+* Attende che il produttore scriva un record nella coda, entro un istante
+ * @param q coda da controllare (si è il consumatore)
+ * @param deadline istante (clock_now) oltre il quale non attendere, al più 100 ms dopo ora
+ * @return 1 se c'è un record da leggere, 0 altrimenti
+*/
+int ring_wait_data(ring_queue_t* q, double deadline);
+
+/**
+* Segnala che un record è stato scritto e sveglia il consumatore se sta dormendo
+ * @param q coda (si è il produttore)
+ * @param head nuovo valore di head
+*/
+void ring_publish(ring_queue_t* q, unsigned int head);
+
+int ring_wait_data(ring_queue_t* q, double deadline)
+{
+    unsigned int tail = q->tail, seq;
+    int i;
+#ifdef RING_FUTEX
+    struct timespec ts;
+    double left;
+#endif
+
+    if(ring_spin < 0)
+        ring_spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? RING_SPIN : 0;
+    for(i = 0; i < ring_spin; i++)
+        if(__atomic_load_n(&q->head, __ATOMIC_ACQUIRE) != tail)
+            return 1;
+
+    /* Prima si annuncia il sonno, poi si ricontrolla: il produttore scrive head prima di leggere sleeping */
+    __atomic_store_n(&q->sleeping, 1, __ATOMIC_SEQ_CST);
+    seq = __atomic_load_n(&q->seq, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&q->head, __ATOMIC_SEQ_CST) == tail && clock_now() < deadline)
+    {
+#ifdef RING_FUTEX
+        left = deadline - clock_now();
+        if(left < 0)
+            left = 0;
+        ts.tv_sec = (time_t)left;
+        ts.tv_nsec = (long)((left - (double)ts.tv_sec) * 1e9);
+        syscall(SYS_futex, &q->seq, FUTEX_WAIT, seq, &ts, NULL, 0);
+#else
+        (void)seq;
+        usleep(50);
+#endif
+    }
+    __atomic_store_n(&q->sleeping, 0, __ATOMIC_RELAXED);
+
+    return __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) != tail;
+}
+
+void ring_publish(ring_queue_t* q, unsigned int head)
+{
+    __atomic_store_n(&q->head, head, __ATOMIC_SEQ_CST);
+    __atomic_fetch_add(&q->seq, 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&q->sleeping, __ATOMIC_SEQ_CST))
+    {
+#ifdef RING_FUTEX
+        syscall(SYS_futex, &q->seq, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+    }
+}
+
+int ring_open(ring_t* ring, const char* command, int timeout_ms)
+{
+    char env[96];
+    int fd = -1;
+
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+    ring->timeout_ms = timeout_ms > 0 ? timeout_ms : RING_TIMEOUT_MS;
+    ring->next_id = 1;
+    histogram_clear(&ring->latency);
+
+    /* Con memfd il bot eredita il descrittore, altrimenti apre la regione per nome */
+#if defined(RING_FUTEX) && defined(SYS_memfd_create)
+    fd = (int)syscall(SYS_memfd_create, "xtetris-ring", 0);
+    if(fd >= 0)
+        sprintf(env, "%s=%d", RING_ENV, fd);
+#endif
+    if(fd < 0)
+    {
+        sprintf(ring->name, "/xtetris-ring-%ld-%p", (long)getpid(), (void*)ring);
+        fd = shm_open(ring->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if(fd < 0)
+            return -1;
+        sprintf(env, "%s=%s", RING_ENV, ring->name);
+    }
+    ring->fd = fd;
+
+    if(ftruncate(fd, sizeof(ring_shared_t)) != 0)
+        ring->shared = (ring_shared_t*)MAP_FAILED;
+    else
+        ring->shared = (ring_shared_t*)mmap(NULL, sizeof(ring_shared_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(ring->shared == MAP_FAILED)
+    {
+        ring->shared = NULL;
+        ring_close(ring);
+        return -1;
+    }
+    memset(ring->shared, 0, sizeof(ring_shared_t));
+    memcpy(ring->shared->magic, RING_MAGIC, 8);
+
+    ring->pid = fork();
+    if(ring->pid == 0)
+    {
+        putenv(env);
+        execl("/bin/sh", "sh", "-c", command, (char*)NULL);
+        _exit(127);
+    }
+    /* Solo questo bot eredita la regione */
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    if(ring->pid < 0)
+    {
+        ring->pid = 0;
+        ring_close(ring);
+        return -1;
+    }
+
+    ring->lock = malloc(sizeof(pthread_mutex_t));
+    pthread_mutex_init((pthread_mutex_t*)ring->lock, NULL);
+    return 0;
+}
+
+void ring_close(ring_t* ring)
+{
+    int i, status;
+
+    if(ring->shared && ring->pid > 0 && !ring->dead)
+    {
+        /* Sveglia il bot se dorme in attesa di posizioni: ring_next vede closed e termina */
+        __atomic_store_n(&ring->shared->closed, 1, __ATOMIC_SEQ_CST);
+        ring_publish(&ring->shared->requests, ring->shared->requests.head);
+
+        for(i = 0; i < 100 && waitpid(ring->pid, &status, WNOHANG) == 0; i++)
+            usleep(10000);
+        if(i == 100)
+        {
+            kill(ring->pid, SIGKILL);
+            waitpid(ring->pid, &status, 0);
+        }
+    }
+
+    if(ring->shared)
+        munmap(ring->shared, sizeof(ring_shared_t));
+    if(ring->fd >= 0)
+        close(ring->fd);
+    if(ring->name[0])
+        shm_unlink(ring->name);
+    if(ring->lock)
+    {
+        pthread_mutex_destroy((pthread_mutex_t*)ring->lock);
+        free(ring->lock);
+    }
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+int ring_move(ring_t* ring, const game_state_t* state, int player, placement_t* move)
+{
+    ring_queue_t* requests = &ring->shared->requests;
+    ring_queue_t* replies = &ring->shared->replies;
+    ring_request_t* request;
+    double sent, deadline;
+    unsigned int id, head;
+    int res = -1, status;
+
+    pthread_mutex_lock((pthread_mutex_t*)ring->lock);
+    if(ring->dead)
+    {
+        ring->timeouts++;
+        pthread_mutex_unlock((pthread_mutex_t*)ring->lock);
+        return -1;
+    }
+    sent = clock_now();
+    deadline = sent + ring->timeout_ms / 1e3;
+
+    /* Dopo una richiesta scaduta il bot può essere indietro: si attende un record libero */
+    head = requests->head;
+    while(head - __atomic_load_n(&requests->tail, __ATOMIC_ACQUIRE) >= RING_SLOTS)
+    {
+        if(clock_now() >= deadline)
+        {
+            ring->timeouts++;
+            pthread_mutex_unlock((pthread_mutex_t*)ring->lock);
+            return -1;
+        }
+        usleep(50);
+    }
+
+    id = ring->next_id++;
+    request = &ring->shared->request_slots[head & (RING_SLOTS - 1)];
+    request->id = id;
+    request->player = player;
+    memcpy(&request->position, state, sizeof(request->position));
+    ring_publish(requests, head + 1);
+    ring->requests++;
+
+    while(res != 0)
+    {
+        double slice = clock_now() + 0.1;
+
+        if(ring_wait_data(replies, slice < deadline ? slice : deadline))
+        {
+            /* Le risposte arrivano in ordine: quelle a richieste scadute vengono scartate */
+            const ring_reply_t* reply = &ring->shared->reply_slots[replies->tail & (RING_SLOTS - 1)];
+            if(reply->id == id)
+            {
+                move->id = reply->move.piece;
+                move->rot = reply->move.rotation;
+                move->col = reply->move.column;
+                res = 0;
+            }
+            __atomic_store_n(&replies->tail, replies->tail + 1, __ATOMIC_RELEASE);
+        }
+        else if(waitpid(ring->pid, &status, WNOHANG) != 0)
+        {
+            ring->dead = 1;
+            break;
+        }
+        else if(clock_now() >= deadline)
+            break;
+    }
+
+    if(res == 0)
+        histogram_record(&ring->latency, (unsigned long)((clock_now() - sent) * 1e9));
+    else
+        ring->timeouts++;
+    pthread_mutex_unlock((pthread_mutex_t*)ring->lock);
+    return res;
+}
+
+void ring_report(const ring_t* ring, const char* name, FILE* out)
+{
+    fprintf(out, "%s: %lu richieste, %lu scadute\n", name, ring->requests, ring->timeouts);
+    if(ring->latency.total > 0)
+        fprintf(out, "%s: risposta mediana %.1f us, 99%% %.1f us, 99,9%% %.1f us, massimo %.1f us\n", name,
+                histogram_percentile(&ring->latency, 50) / 1e3, histogram_percentile(&ring->latency, 99) / 1e3,
+                histogram_percentile(&ring->latency, 99.9) / 1e3, ring->latency.max / 1e3);
+}
+
+int ring_attach(ring_t* ring)
+{
+    const char* where = getenv(RING_ENV);
+    void* map;
+    int fd;
+
+    memset(ring, 0, sizeof(*ring));
+    if(!where || !*where)
+        return -1;
+
+    fd = where[0] == '/' ? shm_open(where, O_RDWR, 0) : atoi(where);
+    if(fd < 0)
+        return -1;
+    map = mmap(NULL, sizeof(ring_shared_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+        return -1;
+
+    ring->shared = (ring_shared_t*)map;
+    if(memcmp(ring->shared->magic, RING_MAGIC, 8) != 0)
+    {
+        munmap(map, sizeof(ring_shared_t));
+        ring->shared = NULL;
+        return -1;
+    }
+    ring->parent = getppid();
+    return 0;
+}
+
+int ring_next(ring_t* ring, unsigned int* id, int* player, game_state_t* state)
+{
+    ring_queue_t* requests = &ring->shared->requests;
+    const ring_request_t* request;
+
+    /* Si controlla ogni 100 ms che il motore sia ancora vivo */
+    while(!ring_wait_data(requests, clock_now() + 0.1))
+        if(__atomic_load_n(&ring->shared->closed, __ATOMIC_ACQUIRE) || getppid() != ring->parent)
+            return -1;
+
+    request = &ring->shared->request_slots[requests->tail & (RING_SLOTS - 1)];
+    *id = request->id;
+    *player = request->player;
+    memset(state, 0, sizeof(*state));
+    memcpy(state, &request->position, sizeof(request->position));
+    __atomic_store_n(&requests->tail, requests->tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void ring_reply(ring_t* ring, unsigned int id, placement_t move)
+{
+    ring_queue_t* replies = &ring->shared->replies;
+    ring_reply_t* reply;
+    unsigned int head = replies->head;
+
+    while(head - __atomic_load_n(&replies->tail, __ATOMIC_ACQUIRE) >= RING_SLOTS)
+        usleep(50);
+
+    reply = &ring->shared->reply_slots[head & (RING_SLOTS - 1)];
+    reply->id = id;
+    reply->move.piece = move.id;
+    reply->move.rotation = move.rot;
+    reply->move.column = move.col;
+    ring_publish(replies, head + 1);
+}
@@ -0,0 +1,167 @@
+/**
+* @file Ring.h
+* @author Albert Alibeaj
+* @brief Libreria che fa giocare come computer un programma esterno attraverso la memoria condivisa:
+ * due code circolari senza lock con un solo produttore e un solo consumatore (posizioni dal motore
+ * al bot, mosse dal bot al motore) in una regione creata con memfd_create (shm_open dove non esiste).
+ *
+ * Il motore avvia il bot con la variabile d'ambiente RING_ENV, che contiene il descrittore
+ * della regione (o il suo nome, con '/' iniziale). Il bot chiama ring_attach, poi ripete
+ * ring_next e ring_reply finché ring_next non restituisce -1 (motore chiuso o terminato).
+ *
+ * Chi attende un record lo controlla per alcuni giri senza dormire, poi si addormenta su un futex
+ * della coda (su Linux; altrove dorme a brevi intervalli); chi scrive sveglia l'altro solo se sta
+ * dormendo. I record hanno dimensione fissa: la posizione ha la disposizione di Bot.h
+*/
+
+#ifndef XTETRIS2_RING_H
+#define XTETRIS2_RING_H
+
+#include <stdio.h>
+#include <sys/types.h>
+#include "Bot.h"
+#include "Histogram.h"
+#include "State.h"
+
+/** Intestazione della regione */
+#define RING_MAGIC "XTRING01"
+/** Variabile d'ambiente con cui il bot trova la regione */
+#define RING_ENV "XTETRIS_RING"
+/** Record di ogni coda (potenza di 2) */
+#define RING_SLOTS 16
+/** Giri di attesa attiva prima di dormire */
+#define RING_SPIN 4000
+/** Tempo limite predefinito per una mossa, in millisecondi */
+#define RING_TIMEOUT_MS 1000
+
+/** Tipo ring_queue_t
+*   Indici di una coda, ognuno sulla propria linea di cache
+*/
+typedef struct RingQueue
+{
+    unsigned int head;          /**< record scritti (solo il produttore lo modifica) */
+    char pad0[60];              /**< separa head e tail su linee di cache diverse */
+    unsigned int tail;          /**< record letti (solo il consumatore lo modifica) */
+    char pad1[60];              /**< separa tail dal futex */
+    unsigned int seq;           /**< futex: incrementato a ogni record scritto */
+    unsigned int sleeping;      /**< 1 se il consumatore dorme sul futex */
+    char pad2[56];              /**< completa la linea di cache */
+
+} ring_queue_t;
+
+/** Tipo ring_request_t
+*   Posizione inviata al bot
+*/
+typedef struct RingRequest
+{
+    unsigned int id;                    /**< numero della richiesta */
+    int player;                         /**< indice del giocatore che muove */
+    xtetris_bot_position_t position;    /**< posizione */
+
+} ring_request_t;
+
+/** Tipo ring_reply_t
+*   Mossa inviata dal bot
+*/
+typedef struct RingReply
+{
+    unsigned int id;                    /**< numero della richiesta a cui risponde */
+    xtetris_bot_move_t move;            /**< mossa scelta */
+
+} ring_reply_t;
+
+/** Tipo ring_shared_t
+*   Contenuto della regione condivisa
+*/
+typedef struct RingShared
+{
+    char magic[8];                              /**< RING_MAGIC */
+    unsigned int closed;                        /**< 1 quando il motore chiude il bot */
+    char pad[52];                               /**< completa la linea di cache */
+    ring_queue_t requests;                      /**< indici delle posizioni */
+    ring_queue_t replies;                       /**< indici delle mosse */
+    ring_request_t request_slots[RING_SLOTS];   /**< posizioni */
+    ring_reply_t reply_slots[RING_SLOTS];       /**< mosse */
+
+} ring_shared_t;
+
+/** Tipo ring_t
+*   Estremità di un collegamento in memoria condivisa
+*/
+typedef struct Ring
+{
+    ring_shared_t* shared;      /**< regione mappata */
+    int fd;                     /**< descrittore della regione (solo nel motore, -1 se chiuso) */
+    char name[64];              /**< nome della regione aperta con shm_open, da rimuovere alla chiusura */
+    pid_t pid;                  /**< processo del bot (solo nel motore) */
+    pid_t parent;               /**< processo del motore (solo nel bot) */
+    int dead;                   /**< 1 se il processo del bot è terminato (solo nel motore) */
+    int timeout_ms;             /**< tempo limite per una mossa */
+    unsigned int next_id;       /**< numero della prossima richiesta */
+    void* lock;                 /**< mutex: le code hanno un solo produttore, i thread del motore si alternano */
+
+    histogram_t latency;        /**< tempo tra invio e risposta, in nanosecondi */
+    unsigned long requests;     /**< richieste inviate */
+    unsigned long timeouts;     /**< richieste scadute o senza risposta */
+
+} ring_t;
+
+/**
+* Crea la regione condivisa e avvia il bot con /bin/sh
+ * @param ring collegamento da inizializzare
+ * @param command comando da eseguire
+ * @param timeout_ms tempo limite per una mossa (RING_TIMEOUT_MS se minore di 1)
+ * @return 0 se il bot è stato avviato, -1 altrimenti
+*/
+int ring_open(ring_t* ring, const char* command, int timeout_ms);
+
+/**
+* Chiude il bot (al più un secondo di attesa, poi viene terminato) e libera la regione
+ * @param ring collegamento aperto con ring_open
+*/
+void ring_close(ring_t* ring);
+
+/**
+* Invia una posizione al bot e ne attende la mossa. Può essere chiamata da più thread
+ * @param ring collegamento aperto con ring_open
+ * @param state stato della partita
+ * @param player indice del giocatore che muove
+ * @param move mossa ricevuta (non controllata: può non essere valida)
+ * @return 0 se la mossa è arrivata in tempo, -1 altrimenti
+*/
+int ring_move(ring_t* ring, const game_state_t* state, int player, placement_t* move);
+
+/**
+* Stampa le statistiche del collegamento: richieste, scadute e percentili della latenza
+ * @param ring collegamento aperto con ring_open
+ * @param name nome da stampare
+ * @param out file su cui stampare
+*/
+void ring_report(const ring_t* ring, const char* name, FILE* out);
+
+/**
+* Lato bot: apre la regione indicata dalla variabile RING_ENV
+ * @param ring collegamento da inizializzare
+ * @return 0 se la regione è stata aperta, -1 se la variabile manca o la regione non è valida
+*/
+int ring_attach(ring_t* ring);
+
+/**
+* Lato bot: attende la prossima posizione
+ * @param ring collegamento aperto con ring_attach
+ * @param id numero della richiesta, da restituire con ring_reply
+ * @param player indice del giocatore che muove
+ * @param state stato da riempire (rng a 0)
+ * @return 0 se è arrivata una posizione, -1 se il motore ha chiuso o è terminato
+*/
+int ring_next(ring_t* ring, unsigned int* id, int* player, game_state_t* state);
+
+/**
+* Lato bot: invia la mossa scelta
+ * @param ring collegamento aperto con ring_attach
+ * @param id numero della richiesta
+ * @param move mossa scelta
+*/
+void ring_reply(ring_t* ring, unsigned int id, placement_t move);
+
+#endif /*XTETRIS2_RING_H*/
@@ -0,0 +1,513 @@
+/**
+* @file Sched.c
+* @author Albert Alibeaj
+* @brief File di implementazione dei thread con furto di lavoro
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <pthread.h>
+#include "Sched.h"
+
+/** Giri senza trovare lavoro prima di addormentarsi */
+#define SCHED_SPINS 64
+/** Byte di una linea di cache, per separare i dati scritti da thread diversi */
+#define SCHED_CACHE_LINE 64
+
+/** Tipo sched_deque_t
+*   Coda doppia di Chase-Lev: il proprietario aggiunge e prende dal fondo, gli altri rubano dalla cima
+*/
+typedef struct SchedDeque
+{
+    long top;                                   /**< prossimo compito da rubare */
+    char pad1[SCHED_CACHE_LINE - sizeof(long)]; /**< separa top (scritto da chi ruba) da bottom */
+    long bottom;                                /**< prossima posizione libera (scritta solo dal proprietario) */
+    char pad2[SCHED_CACHE_LINE - sizeof(long)]; /**< separa bottom dai compiti */
+    sched_task_t* tasks[SCHED_DEQUE_SIZE];      /**< array circolare dei compiti */
+
+} sched_deque_t;
+
+/** Tipo sched_thread_t
+*   Dati di un thread
+*/
+typedef struct SchedThread
+{
+    sched_deque_t deque;            /**< compiti del thread */
+    pthread_t id;                   /**< thread */
+    unsigned long rng;              /**< generatore per scegliere da chi rubare */
+    int index;                      /**< indice del thread */
+
+} sched_thread_t;
+
+/** Tipo sched_for_t
+*   Ciclo eseguito da sched_for
+*/
+typedef struct SchedFor
+{
+    void (*fn)(void* arg, int i);   /**< funzione da eseguire per ogni indice */
+    void* arg;                      /**< argomento della funzione */
+    int grain;                      /**< indici massimi di un compito */
+
+} sched_for_t;
+
+/** Tipo sched_range_t
+*   Parte di un ciclo di sched_for
+*/
+typedef struct SchedRange
+{
+    const sched_for_t* loop;        /**< ciclo */
+    int begin;                      /**< primo indice */
+    int end;                        /**< indice successivo all'ultimo */
+
+} sched_range_t;
+
+sched_thread_t* sched_pool = NULL;      /**< thread avviati */
+int sched_count = 0;                    /**< numero di thread avviati */
+__thread int sched_self = -1;           /**< indice del thread corrente, -1 fuori dai thread */
+
+pthread_mutex_t sched_lock = PTHREAD_MUTEX_INITIALIZER;     /**< protegge coda comune, sonno e attese esterne */
+pthread_cond_t sched_wake = PTHREAD_COND_INITIALIZER;       /**< sveglia un thread addormentato */
+pthread_cond_t sched_done = PTHREAD_COND_INITIALIZER;       /**< segnala la fine di un gruppo a chi attende da fuori */
+sched_task_t* sched_inject_head = NULL; /**< primo compito della coda comune */
+sched_task_t* sched_inject_tail = NULL; /**< ultimo compito della coda comune */
+int sched_injected = 0;                 /**< compiti nella coda comune */
+int sched_sleeping = 0;                 /**< thread addormentati */
+unsigned long sched_epoch = 0;          /**< incrementato (sotto lock) a ogni sveglia */
+int sched_waiters = 0;                  /**< thread esterni in attesa di un gruppo */
+int sched_stopping = 0;                 /**< 1 quando i thread devono terminare */
+
+/**
+* Aggiunge un compito in fondo alla coda del proprietario
+ * @param d coda
+ * @param task compito
+ * @return 1 se il compito è stato aggiunto, 0 se la coda è piena
+*/
+int sched_push(sched_deque_t* d, sched_task_t* task);
+
+/**
+* Prende l'ultimo compito aggiunto dal proprietario
+ * @param d coda
+ * @return compito, o NULL se la coda è vuota
+*/
+sched_task_t* sched_pop(sched_deque_t* d);
+
+/**
+* Ruba il compito più vecchio di una coda
+ * @param d coda
+ * @return compito, o NULL se la coda è vuota o un altro thread l'ha preso prima
+*/
+sched_task_t* sched_steal(sched_deque_t* d);
+
+/**
+* Cerca un compito: prima nella propria coda, poi nella coda comune, poi nelle code degli altri
+ * @param self indice del thread che cerca (-1 per un thread esterno)
+ * @return compito, o NULL se non ne è stato trovato nessuno
+*/
+sched_task_t* sched_find(int self);
+
+/**
+* Esegue un compito e lo conta come finito nel suo gruppo
+ * @param task compito
+*/
+void sched_run(sched_task_t* task);
+
+/**
+* Sveglia un thread addormentato, se ce n'è uno, dopo aver reso visibile un nuovo compito
+*/
+void sched_notify();
+
+/**
+* Funzione eseguita da ogni thread
+ * @param arg puntatore al sched_thread_t del thread
+ * @return sempre NULL
+*/
+void* sched_loop(void* arg);
+
+/**
+* Esegue una parte di un ciclo, dividendola a metà finché è più grande di grain
+ * @param loop ciclo
+ * @param begin primo indice
+ * @param end indice successivo all'ultimo
+*/
+void sched_for_range(const sched_for_t* loop, int begin, int end);
+
+/**
+* Compito che esegue una parte di un ciclo
+ * @param arg puntatore a sched_range_t
+*/
+void sched_for_task(void* arg);
+
+int sched_push(sched_deque_t* d, sched_task_t* task)
+{
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+
+    if(b - t >= SCHED_DEQUE_SIZE)
+        return 0;
+
+    __atomic_store_n(&d->tasks[b & (SCHED_DEQUE_SIZE - 1)], task, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+
+    return 1;
+}
+
+sched_task_t* sched_pop(sched_deque_t* d)
+{
+    long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    long t;
+    sched_task_t* task = NULL;
+
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+
+    if(t <= b)
+    {
+        task = __atomic_load_n(&d->tasks[b & (SCHED_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+        if(t == b)
+        {
+            /* Ultimo compito: chi ruba potrebbe volerlo, lo prende chi incrementa top per primo */
+            if(!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+                task = NULL;
+            __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        }
+    }
+    else
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+
+    return task;
+}
+
+sched_task_t* sched_steal(sched_deque_t* d)
+{
+    long t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    long b;
+    sched_task_t* task;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+    if(t >= b)
+        return NULL;
+
+    task = __atomic_load_n(&d->tasks[t & (SCHED_DEQUE_SIZE - 1)], __ATOMIC_RELAXED);
+    if(!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        return NULL;
+
+    return task;
+}
+
+sched_task_t* sched_find(int self)
+{
+    sched_task_t* task;
+    int start, i;
+
+    if(self >= 0 && (task = sched_pop(&sched_pool[self].deque)) != NULL)
+        return task;
+
+    if(__atomic_load_n(&sched_injected, __ATOMIC_ACQUIRE) > 0)
+    {
+        pthread_mutex_lock(&sched_lock);
+        task = sched_inject_head;
+        if(task)
+        {
+            sched_inject_head = task->next;
+            if(!sched_inject_head)
+                sched_inject_tail = NULL;
+            __atomic_fetch_sub(&sched_injected, 1, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&sched_lock);
+        if(task)
+            return task;
+    }
+
+    if(self < 0)
+        return NULL;
+
+    /* Si parte da un thread a caso, così chi ruba non si concentra sempre sulla stessa coda */
+    sched_pool[self].rng = sched_pool[self].rng * 1103515245UL + 12345UL;
+    start = (int)((sched_pool[self].rng >> 16) % (unsigned long)sched_count);
+    for(i = 0; i < sched_count; i++)
+    {
+        int victim = (start + i) % sched_count;
+        if(victim != self && (task = sched_steal(&sched_pool[victim].deque)) != NULL)
+            return task;
+    }
+
+    return NULL;
+}
+
+void sched_run(sched_task_t* task)
+{
+    sched_group_t* group = task->group;
+
+    task->fn(task->arg);
+
+    /* Dopo il decremento il gruppo può non esistere più: si usano solo dati globali */
+    if(__atomic_sub_fetch(&group->pending, 1, __ATOMIC_SEQ_CST) == 0
+       && __atomic_load_n(&sched_waiters, __ATOMIC_SEQ_CST) > 0)
+    {
+        pthread_mutex_lock(&sched_lock);
+        pthread_cond_broadcast(&sched_done);
+        pthread_mutex_unlock(&sched_lock);
+    }
+}
+
+void sched_notify()
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(__atomic_load_n(&sched_sleeping, __ATOMIC_SEQ_CST) > 0)
+    {
+        pthread_mutex_lock(&sched_lock);
+        sched_epoch++;
+        pthread_cond_signal(&sched_wake);
+        pthread_mutex_unlock(&sched_lock);
+    }
+}
+
+void* sched_loop(void* arg)
+{
+    sched_thread_t* me = (sched_thread_t*)arg;
+    int spins = 0;
+
+    sched_self = me->index;
+
+    for(;;)
+    {
+        sched_task_t* task = sched_find(me->index);
+        unsigned long epoch;
+
+        if(task)
+        {
+            sched_run(task);
+            spins = 0;
+            continue;
+        }
+        if(++spins < SCHED_SPINS)
+        {
+            sched_yield();
+            continue;
+        }
+
+        /* Prima di dormire si cerca ancora una volta, dopo essersi contati tra chi dorme:
+         * chi consegna un compito dopo questo punto vede il contatore e sveglia qualcuno */
+        pthread_mutex_lock(&sched_lock);
+        __atomic_fetch_add(&sched_sleeping, 1, __ATOMIC_SEQ_CST);
+        epoch = sched_epoch;
+        pthread_mutex_unlock(&sched_lock);
+
+        task = sched_find(me->index);
+
+        pthread_mutex_lock(&sched_lock);
+        while(!task && sched_epoch == epoch && !sched_stopping)
+            pthread_cond_wait(&sched_wake, &sched_lock);
+        __atomic_fetch_sub(&sched_sleeping, 1, __ATOMIC_SEQ_CST);
+        if(!task && sched_stopping)
+        {
+            pthread_mutex_unlock(&sched_lock);
+            break;
+        }
+        pthread_mutex_unlock(&sched_lock);
+
+        if(task)
+            sched_run(task);
+        spins = 0;
+    }
+
+    return NULL;
+}
+
+int sched_start(int threads)
+{
+    int i;
+
+    if(sched_count > 0)
+        return 0;
+    if(threads < 1 || threads > SCHED_MAX_THREADS)
+        return -1;
+
+    sched_pool = (sched_thread_t*)calloc((size_t)threads, sizeof(sched_thread_t));
+    if(!sched_pool)
+        return -1;
+
+    sched_stopping = 0;
+    sched_count = threads;
+    for(i = 0; i < threads; i++)
+    {
+        sched_pool[i].index = i;
+        sched_pool[i].rng = 2463534242UL + (unsigned long)i * 2654435761UL;
+    }
+    for(i = 0; i < threads; i++)
+        if(pthread_create(&sched_pool[i].id, NULL, sched_loop, &sched_pool[i]) != 0)
+            break;
+
+    if(i < threads)
+    {
+        /* Senza tutti i thread si fermano quelli avviati: i compiti verranno eseguiti da chi li consegna */
+        fprintf(stderr, "xtetris: avviati %d thread su %d, i compiti vengono eseguiti senza thread\n", i, threads);
+        __atomic_store_n(&sched_count, i, __ATOMIC_SEQ_CST);
+        if(i > 0)
+            sched_stop();
+        free(sched_pool);
+        sched_pool = NULL;
+        sched_count = 0;
+        return -1;
+    }
+
+    return 0;
+}
+
+void sched_stop()
+{
+    int i;
+
+    if(sched_count == 0)
+        return;
+
+    pthread_mutex_lock(&sched_lock);
+    sched_stopping = 1;
+    pthread_cond_broadcast(&sched_wake);
+    pthread_mutex_unlock(&sched_lock);
+
+    for(i = 0; i < sched_count; i++)
+        pthread_join(sched_pool[i].id, NULL);
+
+    free(sched_pool);
+    sched_pool = NULL;
+    sched_count = 0;
+}
+
+int sched_threads()
+{
+    return sched_count;
+}
+
+int sched_worker()
+{
+    return sched_self;
+}
+
+void sched_group_init(sched_group_t* group)
+{
+    group->pending = 0;
+}
+
+void sched_spawn(sched_group_t* group, sched_task_t* task, void (*fn)(void* arg), void* arg)
+{
+    if(sched_count == 0)
+    {
+        fn(arg);
+        return;
+    }
+
+    task->fn = fn;
+    task->arg = arg;
+    task->group = group;
+    task->next = NULL;
+    __atomic_fetch_add(&group->pending, 1, __ATOMIC_RELAXED);
+
+    if(sched_self >= 0)
+    {
+        /* Coda piena: il compito viene eseguito subito da chi lo consegna */
+        if(!sched_push(&sched_pool[sched_self].deque, task))
+        {
+            sched_run(task);
+            return;
+        }
+    }
+    else
+    {
+        pthread_mutex_lock(&sched_lock);
+        if(sched_inject_tail)
+            sched_inject_tail->next = task;
+        else
+            sched_inject_head = task;
+        sched_inject_tail = task;
+        __atomic_fetch_add(&sched_injected, 1, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&sched_lock);
+    }
+
+    sched_notify();
+}
+
+void sched_wait(sched_group_t* group)
+{
+    if(sched_self >= 0)
+    {
+        /* Chi attende è uno dei thread: esegue altri compiti finché il gruppo non è finito */
+        while(__atomic_load_n(&group->pending, __ATOMIC_ACQUIRE) > 0)
+        {
+            sched_task_t* task = sched_find(sched_self);
+            if(task)
+                sched_run(task);
+            else
+                sched_yield();
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&sched_lock);
+    __atomic_fetch_add(&sched_waiters, 1, __ATOMIC_SEQ_CST);
+    while(__atomic_load_n(&group->pending, __ATOMIC_SEQ_CST) > 0)
+        pthread_cond_wait(&sched_done, &sched_lock);
+    __atomic_fetch_sub(&sched_waiters, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&sched_lock);
+}
+
+void sched_for_range(const sched_for_t* loop, int begin, int end)
+{
+    sched_range_t half;
+    sched_task_t task;
+    sched_group_t group;
+    int i;
+
+    if(end - begin <= loop->grain)
+    {
+        for(i = begin; i < end; i++)
+            loop->fn(loop->arg, i);
+        return;
+    }
+
+    /* La seconda metà può essere rubata, la prima viene eseguita subito (e divisa ancora) */
+    half.loop = loop;
+    half.begin = begin + (end - begin) / 2;
+    half.end = end;
+    sched_group_init(&group);
+    sched_spawn(&group, &task, sched_for_task, &half);
+    sched_for_range(loop, begin, half.begin);
+    sched_wait(&group);
+}
+
+void sched_for_task(void* arg)
+{
+    const sched_range_t* range = (const sched_range_t*)arg;
+    sched_for_range(range->loop, range->begin, range->end);
+}
+
+void sched_for(int begin, int end, int grain, void (*fn)(void* arg, int i), void* arg)
+{
+    sched_for_t loop;
+    sched_range_t all;
+    sched_task_t task;
+    sched_group_t group;
+
+    loop.fn = fn;
+    loop.arg = arg;
+    loop.grain = grain > 0 ? grain : 1;
+    if(end <= begin)
+        return;
+
+    /* Da fuori dai thread l'intero ciclo diventa un compito, così le divisioni avvengono nei thread */
+    if(sched_self < 0 && sched_count > 0)
+    {
+        all.loop = &loop;
+        all.begin = begin;
+        all.end = end;
+        sched_group_init(&group);
+        sched_spawn(&group, &task, sched_for_task, &all);
+        sched_wait(&group);
+    }
+    else
+        sched_for_range(&loop, begin, end);
+}
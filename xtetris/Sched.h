@@ -0,0 +1,108 @@
+/**
+* @file Sched.h
+* @author Albert Alibeaj
+* @brief Libreria che distribuisce piccoli compiti tra un gruppo di thread con il furto di lavoro
+ * (work stealing), condivisa da ricerca, simulazione e strumenti.
+ *
+ * Ogni thread ha una propria coda doppia (Chase-Lev): aggiunge e prende i propri compiti
+ * dal fondo senza lock, mentre i thread senza lavoro rubano dalla cima delle code degli altri.
+ * I compiti consegnati da un thread esterno passano da una coda comune protetta da un mutex.
+ * Un thread che non trova lavoro dopo alcuni giri si addormenta finché non arrivano nuovi compiti.
+ *
+ * I compiti sono raccolti in gruppi (fork/join): sched_spawn aggiunge un compito a un gruppo,
+ * sched_wait attende che tutti i compiti del gruppo siano finiti. Se chi attende è uno dei thread
+ * del gruppo, nel frattempo esegue altri compiti invece di restare fermo, quindi i compiti possono
+ * a loro volta dividersi in sotto-compiti. La memoria di compiti e gruppi è di chi li crea
+ * (di solito sullo stack) e deve restare valida fino alla fine di sched_wait
+*/
+
+#ifndef XTETRIS2_SCHED_H
+#define XTETRIS2_SCHED_H
+
+/** Thread massimi */
+#define SCHED_MAX_THREADS 256
+/** Compiti massimi nella coda di ogni thread (potenza di 2); oltre, i compiti vengono eseguiti subito */
+#define SCHED_DEQUE_SIZE 4096
+
+/** Tipo sched_group_t
+*   Gruppo di compiti da attendere insieme
+*/
+typedef struct SchedGroup
+{
+    int pending;                    /**< compiti consegnati e non ancora finiti */
+
+} sched_group_t;
+
+/** Tipo sched_task_t
+*   Compito da eseguire
+*/
+typedef struct SchedTask
+{
+    void (*fn)(void* arg);          /**< funzione da eseguire */
+    void* arg;                      /**< argomento della funzione */
+    sched_group_t* group;           /**< gruppo a cui appartiene il compito */
+    struct SchedTask* next;         /**< compito successivo nella coda comune */
+
+} sched_task_t;
+
+/**
+* Avvia i thread. Se sono già avviati non fa nulla
+ * @param threads numero di thread (da 1 a SCHED_MAX_THREADS)
+ * @return 0 se i thread sono stati avviati, -1 altrimenti: in quel caso nessun thread resta avviato
+ * e i compiti vengono eseguiti subito da chi li consegna
+*/
+int sched_start(int threads);
+
+/**
+* Ferma i thread, dopo che tutti i compiti consegnati sono finiti
+*/
+void sched_stop();
+
+/**
+* Numero di thread avviati
+ * @return thread, 0 se sched_start non è stato chiamato
+*/
+int sched_threads();
+
+/**
+* Indice del thread che esegue il chiamante, per usare dati propri di ogni thread
+ * (validi finché il compito non chiama sched_wait)
+ * @return indice da 0 a sched_threads() - 1, o -1 se il chiamante non è uno dei thread
+*/
+int sched_worker();
+
+/**
+* Inizializza un gruppo vuoto
+ * @param group gruppo da inizializzare
+*/
+void sched_group_init(sched_group_t* group);
+
+/**
+* Consegna un compito. Se i thread non sono avviati il compito viene eseguito subito
+ * @param group gruppo a cui aggiungere il compito
+ * @param task memoria del compito, valida fino alla fine di sched_wait sul gruppo
+ * @param fn funzione da eseguire
+ * @param arg argomento della funzione
+*/
+void sched_spawn(sched_group_t* group, sched_task_t* task, void (*fn)(void* arg), void* arg);
+
+/**
+* Attende che tutti i compiti di un gruppo siano finiti, eseguendo altri compiti nel frattempo
+ * se il chiamante è uno dei thread
+ * @param group gruppo da attendere
+*/
+void sched_wait(sched_group_t* group);
+
+/**
+* Esegue fn(arg, i) per ogni i da begin a end - 1 e attende la fine di tutte le chiamate.
+ * L'intervallo viene diviso a metà ricorsivamente fino a blocchi di grain indici, così i thread
+ * senza lavoro rubano le metà più grandi
+ * @param begin primo indice
+ * @param end indice successivo all'ultimo
+ * @param grain indici massimi eseguiti da un compito senza dividerlo
+ * @param fn funzione da eseguire
+ * @param arg argomento della funzione
+*/
+void sched_for(int begin, int end, int grain, void (*fn)(void* arg, int i), void* arg);
+
+#endif /*XTETRIS2_SCHED_H*/
@@ -0,0 +1,111 @@
+/**
+* @file Sim.c
+* @author Albert Alibeaj
+* @brief File di implementazione delle partite simulate
+*/
+
+#include <string.h>
+#include "Sim.h"
+
+int sim_move_code(placement_t p)
+{
+    return (p.id * 4 + p.rot) * FIELD_COLS + p.col;
+}
+
+placement_t sim_move_from_code(int code)
+{
+    placement_t p;
+
+    p.col = code % FIELD_COLS;
+    p.rot = code / FIELD_COLS % 4;
+    p.id = code / FIELD_COLS / 4;
+    return p;
+}
+
+void sim_play(sim_game_t* game, const tet_t tets[TET_TYPES], int players, const com_weights_t* weights,
+              double epsilon, unsigned long seed)
+{
+    game_state_t state;
+    tet_t own[TET_TYPES];
+    int player = 0, loser = -1, i;
+    int random_below = (int)(epsilon * 1000000);
+
+    /* Copia propria dei tetramini: le quantità cambiano a ogni mossa, le forme non vengono toccate */
+    memcpy(own, tets, sizeof(own));
+    state_init(&state, players, seed);
+    game->players = state.players;
+    game->count = 0;
+
+    for(;;)
+    {
+        sim_sample_t* s = &game->samples[game->count];
+        placements_t legal;
+        pack_position_t pos;
+        state_undo_t undo;
+        placement_t move;
+        int score;
+
+        state_to_tets(&state, own);
+        if(placements_gen(own, &legal) == 0)
+            break;
+
+        if(state_rand(&state) % 1000000 < random_below)
+            move = legal.moves[state_rand(&state) % legal.count];
+        else
+        {
+            double best = COM_LOST;
+            move = legal.moves[0];
+            for(i = 0; i < legal.count; i++)
+            {
+                int result[FIELD_ROWS][FIELD_COLS];
+                double value = com_evaluate(result, com_try_move(state.fields[player], own, legal.moves[i], result), weights);
+                if(value > best)
+                {
+                    best = value;
+                    move = legal.moves[i];
+                }
+            }
+        }
+
+        pack_from_state(&state, player, &pos);
+        pack_encode(&pos, 1, 0, s->position);
+        s->player = player;
+        s->legal_count = legal.count;
+        for(i = 0; i < legal.count; i++)
+            s->legal[i] = (unsigned short)sim_move_code(legal.moves[i]);
+        s->chosen = (unsigned short)sim_move_code(move);
+
+        score = state_make(&state, own, player, move, &undo);
+        s->score = score;
+        game->count++;
+
+        if(score < 0)
+        {
+            loser = player;
+            break;
+        }
+        player = (player + 1) % state.players;
+    }
+
+    game->scores[0] = state.scores[0];
+    game->scores[1] = state.scores[1];
+
+    /* Chi perde lascia la vittoria all'altro; a tetramini finiti vince il punteggio più alto */
+    if(loser >= 0)
+        game->winner = state.players > 1 ? 1 - loser : -1;
+    else if(state.players == 1 || state.scores[0] > state.scores[1])
+        game->winner = 0;
+    else if(state.scores[1] > state.scores[0])
+        game->winner = 1;
+    else
+        game->winner = -1;
+
+    for(i = 0; i < game->count; i++)
+    {
+        sim_sample_t* s = &game->samples[i];
+        if(game->winner < 0)
+            s->result = loser >= 0 ? -1 : 0;
+        else
+            s->result = s->player == game->winner ? 1 : -1;
+    }
+}
@@ -0,0 +1,78 @@
+/**
+* @file Sim.h
+* @author Albert Alibeaj
+* @brief Libreria che gioca partite complete senza grafica, con il computer per tutti i giocatori,
+ * e registra per ogni mossa la posizione, le mosse possibili, la mossa scelta e il suo esito.
+ * Le funzioni non usano dati globali e possono essere chiamate da più thread insieme
+*/
+
+#ifndef XTETRIS2_SIM_H
+#define XTETRIS2_SIM_H
+
+#include "Com.h"
+#include "Pack.h"
+#include "Placements.h"
+#include "State.h"
+
+/** Mosse massime di una partita: ogni mossa consuma un tetramino */
+#define SIM_MAX_MOVES (TET_TYPES * DEFAULT_TET_QUANTITY * STATE_PLAYERS)
+/** Codici di mossa distinti (vedi sim_move_code) */
+#define SIM_MOVE_CODES (TET_TYPES * 4 * FIELD_COLS)
+
+/** Tipo sim_sample_t
+*   Una mossa di una partita simulata, vista dal giocatore che la gioca
+*/
+typedef struct SimSample
+{
+    unsigned char position[PACK_LEN];       /**< posizione prima della mossa (Pack.h) */
+    int player;                             /**< indice del giocatore che muove (0 o 1) */
+    int legal_count;                        /**< mosse possibili */
+    unsigned short legal[PLACEMENTS_MAX];   /**< codici delle mosse possibili, in ordine crescente */
+    unsigned short chosen;                  /**< codice della mossa scelta */
+    int score;                              /**< punti guadagnati con la mossa (-1 se fa perdere) */
+    int result;                             /**< esito finale per chi muove: 1 vittoria, 0 pareggio, -1 sconfitta */
+
+} sim_sample_t;
+
+/** Tipo sim_game_t
+*   Partita simulata
+*/
+typedef struct SimGame
+{
+    unsigned long id;                       /**< numero della partita */
+    int players;                            /**< giocatori (1 o 2) */
+    int count;                              /**< mosse giocate */
+    int scores[STATE_PLAYERS];              /**< punteggi finali */
+    int winner;                             /**< indice del vincitore, -1 se nessuno */
+    sim_sample_t samples[SIM_MAX_MOVES];    /**< mosse giocate */
+
+} sim_game_t;
+
+/**
+* Codice compatto di una mossa, da 0 a SIM_MOVE_CODES - 1
+ * @param p mossa
+ * @return codice
+*/
+int sim_move_code(placement_t p);
+
+/**
+* Mossa corrispondente a un codice
+ * @param code codice restituito da sim_move_code
+ * @return mossa
+*/
+placement_t sim_move_from_code(int code);
+
+/**
+* Gioca una partita completa: a ogni turno il computer sceglie la mossa migliore con i pesi dati,
+ * oppure, con probabilità epsilon, una mossa a caso per variare le partite
+ * @param game partita da riempire
+ * @param tets tetramini da cui prendere le forme (non vengono modificati)
+ * @param players numero di giocatori (1 o 2)
+ * @param weights pesi della valutazione
+ * @param epsilon probabilità di una mossa casuale (tra 0 e 1)
+ * @param seed seme del generatore casuale della partita
+*/
+void sim_play(sim_game_t* game, const tet_t tets[TET_TYPES], int players, const com_weights_t* weights,
+              double epsilon, unsigned long seed);
+
+#endif /*XTETRIS2_SIM_H*/
@@ -0,0 +1,159 @@
+/**
+* @file State.c
+* @author Albert Alibeaj
+* @brief File di implementazione dello stato di una partita e dell'annullamento delle mosse
+*/
+
+#include <string.h>
+#include "State.h"
+#include "Features.h"
+#include "Moves.h"
+
+/**
+* Ripristina le righe salvate di un campo
+ * @param field campo da ripristinare
+ * @param undo righe salvate
+*/
+void field_restore(int field[FIELD_ROWS][FIELD_COLS], const field_undo_t* undo);
+
+int field_make(int field[FIELD_ROWS][FIELD_COLS], tet_t* tet, int column, int rotation, field_undo_t* undo)
+{
+    int top = 0, j;
+
+    /* L'inserimento (e la caduta delle righe eliminate) non tocca le righe sopra questa */
+    for(; top < FIELD_ROWS; top++)
+    {
+        int any = 0;
+        for(j = 0; j < FIELD_COLS; j++)
+            any |= field[top][j];
+        if(any)
+            break;
+    }
+    top -= TET_MAX_LEN;
+    if(top < 0)
+        top = 0;
+
+    undo->top = top;
+    undo->quantity = tet->quantity;
+    memcpy(undo->rows[top], field[top], sizeof(int) * FIELD_COLS * (FIELD_ROWS - top));
+
+    return insert(field, tet, column, rotation);
+}
+
+void field_restore(int field[FIELD_ROWS][FIELD_COLS], const field_undo_t* undo)
+{
+    memcpy(field[undo->top], undo->rows[undo->top], sizeof(int) * FIELD_COLS * (FIELD_ROWS - undo->top));
+}
+
+void field_unmake(int field[FIELD_ROWS][FIELD_COLS], tet_t* tet, const field_undo_t* undo)
+{
+    field_restore(field, undo);
+    tet->quantity = undo->quantity;
+}
+
+int attack_rows(int score)
+{
+    if(score == 6)
+        return 3;
+    if(score == 12)
+        return 4;
+    return 0;
+}
+
+void state_init(game_state_t* state, int players, unsigned long seed)
+{
+    int i;
+
+    memset(state, 0, sizeof(*state));
+    for(i = 0; i < STATE_PLAYERS; i++)
+        field_init(state->fields[i]);
+    for(i = 0; i < TET_TYPES; i++)
+        state->quantities[i] = DEFAULT_TET_QUANTITY * (players > 1 ? 2 : 1);
+
+    state->players = players > 1 ? 2 : 1;
+    state->rng = seed & 0xFFFFFFFFUL;
+}
+
+int state_make(game_state_t* state, const tet_t tets[TET_TYPES], int player, placement_t p, state_undo_t* undo)
+{
+    int shape[TET_MAX_LEN * TET_MAX_LEN];
+    tet_t tet = tets[p.id];
+    int score;
+
+    /* insert ruota la forma: si usa una copia del tetramino con una forma propria */
+    tet.shape = shape;
+    tet.quantity = state->quantities[p.id];
+
+    undo->player = player;
+    undo->id = p.id;
+    undo->rng = state->rng;
+    undo->attack = 0;
+
+    score = field_make(state->fields[player], &tet, p.col, p.rot, &undo->field);
+    undo->score = score;
+
+    state->quantities[p.id] = tet.quantity;
+    state->moves++;
+
+    if(score > 0)
+    {
+        state->scores[player] += score;
+
+        if(state->players > 1)
+        {
+            int (*opponent)[FIELD_COLS] = state->fields[1 - player];
+            int r, c;
+
+            undo->attack = attack_rows(score);
+            for(r = 0; r < undo->attack; r++)
+                for(c = 0; c < FIELD_COLS; c++)
+                    undo->attacked[r][c] = (signed char)opponent[FIELD_ROWS - 1 - r][c];
+            xor_rows(opponent, undo->attack);
+        }
+    }
+
+    return score;
+}
+
+void state_unmake(game_state_t* state, const state_undo_t* undo)
+{
+    int r, c;
+
+    if(undo->attack)
+    {
+        int (*opponent)[FIELD_COLS] = state->fields[1 - undo->player];
+        for(r = 0; r < undo->attack; r++)
+            for(c = 0; c < FIELD_COLS; c++)
+                opponent[FIELD_ROWS - 1 - r][c] = undo->attacked[r][c];
+    }
+
+    field_restore(state->fields[undo->player], &undo->field);
+    state->quantities[undo->id] = undo->field.quantity;
+    if(undo->score > 0)
+        state->scores[undo->player] -= undo->score;
+
+    state->moves--;
+    state->rng = undo->rng;
+}
+
+void state_to_tets(const game_state_t* state, tet_t tets[TET_TYPES])
+{
+    int i;
+    for(i = 0; i < TET_TYPES; i++)
+        tets[i].quantity = state->quantities[i];
+}
+
+int state_rand(game_state_t* state)
+{
+    /* xorshift a 32 bit: stesso risultato indipendentemente dalla dimensione di long */
+    unsigned long x = state->rng & 0xFFFFFFFFUL;
+
+    if(!x)
+        x = 2463534242UL;
+    x ^= (x << 13) & 0xFFFFFFFFUL;
+    x ^= x >> 17;
+    x ^= (x << 5) & 0xFFFFFFFFUL;
+
+    state->rng = x;
+    return (int)(x >> 1);
+}
@@ -0,0 +1,127 @@
+/**
+* @file State.h
+* @author Albert Alibeaj
+* @brief Libreria che raccoglie lo stato completo di una partita (campi, punteggi,
+ * quantità, generatore casuale) e permette di applicare una mossa e annullarla
+ * salvando solo le righe che la mossa può modificare
+*/
+
+#ifndef XTETRIS2_STATE_H
+#define XTETRIS2_STATE_H
+
+#include "Field.h"
+#include "Pieces.h"
+#include "Placements.h"
+
+/** Numero massimo di giocatori in una partita */
+#define STATE_PLAYERS 2
+
+/** Tipo field_undo_t
+*   Quanto serve per annullare un inserimento: le righe che l'inserimento può
+ *  modificare (dalla riga più alta occupata meno TET_MAX_LEN fino al fondo) e la quantità
+*/
+typedef struct FieldUndo
+{
+    int top;                                /**< prima riga salvata */
+    int quantity;                           /**< quantità del tetramino prima dell'inserimento */
+    int rows[FIELD_ROWS][FIELD_COLS];       /**< righe salvate (solo da top in giù sono valide) */
+
+} field_undo_t;
+
+/** Tipo game_state_t
+*   Stato completo di una partita, copiabile con un semplice assegnamento
+*/
+typedef struct GameState
+{
+    int fields[STATE_PLAYERS][FIELD_ROWS][FIELD_COLS];  /**< campi dei giocatori */
+    int scores[STATE_PLAYERS];                          /**< punteggi dei giocatori */
+    int quantities[TET_TYPES];                          /**< quantità condivise dei tetramini */
+    int players;                                        /**< giocatori in partita (1 o 2) */
+    int moves;                                          /**< mosse giocate finora */
+    unsigned long rng;                                  /**< stato del generatore casuale */
+
+} game_state_t;
+
+/** Tipo state_undo_t
+*   Quanto serve per annullare una mossa applicata con state_make
+*/
+typedef struct StateUndo
+{
+    field_undo_t field;                     /**< righe del campo del giocatore */
+    signed char attacked[4][FIELD_COLS];    /**< ultime righe dell'avversario prima dell'inversione */
+    int attack;                             /**< righe invertite all'avversario */
+    int player;                             /**< indice del giocatore che ha mosso */
+    int id;                                 /**< tetramino usato */
+    int score;                              /**< punti guadagnati */
+    unsigned long rng;                      /**< stato del generatore prima della mossa */
+
+} state_undo_t;
+
+/**
+* Inserisce un tetramino come insert, salvando prima quanto serve per annullare l'inserimento
+ * @param field campo in cui inserire il tetramino
+ * @param tet tetramino da inserire (la quantità viene decrementata)
+ * @param column colonna in cui inserire il tetramino
+ * @param rotation numero di rotazioni verso destra a partire dalla forma base
+ * @param undo dati da passare a field_unmake
+ * @return punti guadagnati dall'inserimento, -1 se la mossa fa perdere
+*/
+int field_make(int field[FIELD_ROWS][FIELD_COLS], tet_t* tet, int column, int rotation, field_undo_t* undo);
+
+/**
+* Annulla un inserimento fatto con field_make
+ * @param field campo da ripristinare
+ * @param tet tetramino di cui ripristinare la quantità
+ * @param undo dati salvati da field_make
+*/
+void field_unmake(int field[FIELD_ROWS][FIELD_COLS], tet_t* tet, const field_undo_t* undo);
+
+/**
+* Righe da invertire all'avversario in base ai punti guadagnati con una mossa
+ * @param score punti guadagnati con la mossa
+ * @return 3 se sono state eliminate 3 righe, 4 se ne sono state eliminate 4, 0 altrimenti
+*/
+int attack_rows(int score);
+
+/**
+* Inizializza lo stato di una nuova partita
+ * @param state stato da inizializzare
+ * @param players numero di giocatori (1 o 2; con 2 le quantità sono raddoppiate)
+ * @param seed seme del generatore casuale
+*/
+void state_init(game_state_t* state, int players, unsigned long seed);
+
+/**
+* Applica una mossa di un giocatore: inserimento, punteggio, quantità e, con due
+ * giocatori, inversione delle righe dell'avversario
+ * @param state stato da modificare
+ * @param tets tetramini da cui prendere le forme (non vengono modificati)
+ * @param player indice del giocatore (0 o 1)
+ * @param p mossa da applicare
+ * @param undo dati da passare a state_unmake
+ * @return punti guadagnati, -1 se la mossa fa perdere
+*/
+int state_make(game_state_t* state, const tet_t tets[TET_TYPES], int player, placement_t p, state_undo_t* undo);
+
+/**
+* Annulla una mossa applicata con state_make
+ * @param state stato da ripristinare
+ * @param undo dati salvati da state_make
+*/
+void state_unmake(game_state_t* state, const state_undo_t* undo);
+
+/**
+* Copia le quantità dello stato nei tetramini, per usare le funzioni che lavorano su tet_t
+ * @param state stato da cui leggere le quantità
+ * @param tets tetramini da aggiornare
+*/
+void state_to_tets(const game_state_t* state, tet_t tets[TET_TYPES]);
+
+/**
+* Numero pseudo-casuale dal generatore dello stato (riproducibile a partire dal seme)
+ * @param state stato che contiene il generatore
+ * @return numero tra 0 e 2^31 - 1
+*/
+int state_rand(game_state_t* state);
+
+#endif /*XTETRIS2_STATE_H*/
@@ -0,0 +1,206 @@
+/**
+* @file Strategy.c
+* @author Albert Alibeaj
+* @brief File di implementazione delle strategie del computer
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "Strategy.h"
+
+strategy_t strategy_game_bot;       /**< strategia del computer nel gioco, aperta da strategy_game_init */
+int strategy_game_loaded = 0;       /**< 1 se strategy_game_bot è stata aperta */
+
+/**
+* Controlla che una mossa ricevuta da un programma esterno si possa giocare
+ * @param tets tetramini disponibili
+ * @param move mossa ricevuta
+ * @return 1 se la mossa è valida, 0 altrimenti
+*/
+int strategy_valid(tet_t tets[TET_TYPES], placement_t move)
+{
+    return move.id >= 0 && move.id < TET_TYPES && tets[move.id].quantity > 0
+           && move.rot >= 0 && move.rot < 4 && move.col >= 0 && move.col < FIELD_COLS;
+}
+
+int strategy_open(strategy_t* s, const char* spec)
+{
+    memset(s, 0, sizeof(*s));
+    strncpy(s->name, spec, STRATEGY_NAME_LEN - 1);
+    s->kind = STRATEGY_WEIGHTS;
+
+    if(strcmp(spec, "default") == 0)
+        s->weights = com_default_weights();
+    else if(strcmp(spec, "greedy") == 0)
+        s->weights.w[0] = 1;
+    else if(strcmp(spec, "random") == 0)
+        s->kind = STRATEGY_RANDOM;
+    else if(strncmp(spec, "weights:", 8) == 0)
+        return com_weights_load(spec + 8, &s->weights);
+    else if(strncmp(spec, "net:", 4) == 0)
+    {
+        s->kind = STRATEGY_NET;
+        return net_load(&s->net, spec + 4);
+    }
+    else if(strncmp(spec, "lib:", 4) == 0)
+    {
+        /* Il percorso finisce al primo ':', il resto sono gli argomenti del bot */
+        char path[STRATEGY_NAME_LEN * 4];
+        const char* args = strchr(spec + 4, ':');
+        size_t len = args ? (size_t)(args - (spec + 4)) : strlen(spec + 4);
+
+        if(len == 0 || len >= sizeof(path))
+            return -1;
+        memcpy(path, spec + 4, len);
+        path[len] = '\0';
+
+        s->kind = STRATEGY_PLUGIN;
+        return plugin_open(&s->plugin, path, args ? args + 1 : "");
+    }
+    else if((strncmp(spec, "exec", 4) == 0 || strncmp(spec, "shm", 3) == 0) && strchr(spec, ':'))
+    {
+        int pipe = spec[0] == 'e';
+        char* end;
+        long timeout = strtol(spec + (pipe ? 4 : 3), &end, 10);
+
+        if(*end != ':' || timeout < 0 || !end[1])
+            return -1;
+
+        if(pipe)
+        {
+            s->kind = STRATEGY_PIPE;
+            s->pipe = (pipebot_t*)malloc(sizeof(pipebot_t));
+            if(!s->pipe || pipebot_open(s->pipe, end + 1, (int)timeout) != 0)
+            {
+                free(s->pipe);
+                s->pipe = NULL;
+                return -1;
+            }
+        }
+        else
+        {
+            s->kind = STRATEGY_RING;
+            s->ring = (ring_t*)malloc(sizeof(ring_t));
+            if(!s->ring || ring_open(s->ring, end + 1, (int)timeout) != 0)
+            {
+                free(s->ring);
+                s->ring = NULL;
+                return -1;
+            }
+        }
+    }
+    else
+        return -1;
+
+    return 0;
+}
+
+void strategy_close(strategy_t* s)
+{
+    if(s->kind == STRATEGY_NET)
+        net_free(&s->net);
+    if(s->kind == STRATEGY_PLUGIN)
+        plugin_close(&s->plugin);
+    if(s->kind == STRATEGY_PIPE && s->pipe)
+    {
+        pipebot_close(s->pipe);
+        free(s->pipe);
+        s->pipe = NULL;
+    }
+    if(s->kind == STRATEGY_RING && s->ring)
+    {
+        ring_close(s->ring);
+        free(s->ring);
+        s->ring = NULL;
+    }
+}
+
+int strategy_move(const strategy_t* s, const game_state_t* state, int player, tet_t tets[TET_TYPES], placement_t* move)
+{
+    strategy_request_t req;
+
+    strategy_request(s, state, player, tets, &req);
+    return strategy_reply(s, tets, &req, move);
+}
+
+void strategy_request(const strategy_t* s, const game_state_t* state, int player, tet_t tets[TET_TYPES], strategy_request_t* req)
+{
+    int (*field)[FIELD_COLS] = (int (*)[FIELD_COLS])state->fields[player];
+    placements_t legal;
+    unsigned long x;
+
+    req->id = 0;
+    req->found = placements_gen(tets, &legal) > 0;
+    if(!req->found)
+        return;
+
+    switch(s->kind)
+    {
+        case STRATEGY_NET:
+            com_best_move_net(field, tets, &s->net, &req->move);
+            break;
+
+        case STRATEGY_PLUGIN:
+            if(plugin_move(&s->plugin, state, player, tets, &req->move) != 0)
+                req->move = legal.moves[0];
+            break;
+
+        case STRATEGY_PIPE:
+            /* La risposta viene attesa in strategy_reply; se il bot non è raggiungibile l'ID è 0 */
+            req->id = pipebot_send(s->pipe, state, player);
+            req->move = legal.moves[0];
+            break;
+
+        case STRATEGY_RING:
+            if(ring_move(s->ring, state, player, &req->move) != 0 || !strategy_valid(tets, req->move))
+                req->move = legal.moves[0];
+            break;
+
+        case STRATEGY_RANDOM:
+            /* Mossa ricavata dal generatore e dal numero di mosse dello stato, senza modificarlo */
+            x = (state->rng ^ (unsigned long)state->moves * 2654435761UL) & 0xFFFFFFFFUL;
+            x ^= x >> 16;
+            x = (x * 0x45D9F3BUL) & 0xFFFFFFFFUL;
+            x ^= x >> 16;
+            req->move = legal.moves[x % (unsigned long)legal.count];
+            break;
+
+        default:
+            com_best_move(field, tets, &s->weights, &req->move);
+            break;
+    }
+}
+
+int strategy_reply(const strategy_t* s, tet_t tets[TET_TYPES], strategy_request_t* req, placement_t* move)
+{
+    placement_t answer;
+
+    if(!req->found)
+        return -1;
+
+    *move = req->move;
+    if(s->kind == STRATEGY_PIPE && req->id)
+    {
+        if(pipebot_wait(s->pipe, req->id, &answer) == 0 && strategy_valid(tets, answer))
+            *move = answer;
+        req->id = 0;
+    }
+
+    return 0;
+}
+
+int strategy_game_init()
+{
+    const char* spec = getenv("XTETRIS_BOT");
+
+    if(!spec || !*spec || strategy_open(&strategy_game_bot, spec) != 0)
+        return 0;
+
+    strategy_game_loaded = 1;
+    return 1;
+}
+
+const strategy_t* strategy_game()
+{
+    return strategy_game_loaded ? &strategy_game_bot : NULL;
+}
@@ -0,0 +1,132 @@
+/**
+* @file Strategy.h
+* @author Albert Alibeaj
+* @brief Libreria che raccoglie le strategie del computer con cui si possono giocare partite
+ * senza grafica (tornei, confronti), scelte con una stringa:
+ *  - <code>default</code>: valutazione lineare con i pesi predefiniti
+ *  - <code>weights:FILE</code>: valutazione lineare con i pesi di un file (com_weights_load)
+ *  - <code>net:FILE</code>: rete neurale di un file (Net.h)
+ *  - <code>greedy</code>: solo i punti della mossa, a parità la prima mossa
+ *  - <code>random</code>: una mossa a caso tra quelle possibili
+ *  - <code>lib:FILE[:argomenti]</code>: bot esterno caricato da una libreria condivisa (Bot.h, Plugin.h);
+ *    se il bot non sceglie una mossa valida si gioca la prima mossa possibile
+ *  - <code>exec[MS]:COMANDO</code>: programma esterno interrogato su standard input e output (PipeBot.h),
+ *    con tempo limite di MS millisecondi per mossa (predefinito PIPEBOT_TIMEOUT_MS); se non risponde
+ *    in tempo o la mossa non è valida si gioca la prima mossa possibile. Con strategy_request e
+ *    strategy_reply le posizioni di più partite vengono inviate in pipeline prima di attendere le risposte
+ *  - <code>shm[MS]:COMANDO</code>: come <code>exec</code>, ma posizioni e mosse passano da code
+ *    in memoria condivisa (Ring.h), con latenza di pochi microsecondi; le mosse vengono chieste una alla volta
+ *
+ * Una strategia aperta può scegliere mosse da più thread insieme
+*/
+
+#ifndef XTETRIS2_STRATEGY_H
+#define XTETRIS2_STRATEGY_H
+
+#include "Com.h"
+#include "Net.h"
+#include "PipeBot.h"
+#include "Ring.h"
+#include "Plugin.h"
+#include "State.h"
+
+/** Lunghezza massima del nome di una strategia */
+#define STRATEGY_NAME_LEN 64
+
+/** Tipi di strategia */
+typedef enum StrategyKind
+{
+    STRATEGY_WEIGHTS,   /**< valutazione lineare */
+    STRATEGY_NET,       /**< rete neurale */
+    STRATEGY_RANDOM,    /**< mossa a caso */
+    STRATEGY_PLUGIN,    /**< bot esterno nello stesso processo */
+    STRATEGY_PIPE,      /**< programma esterno su standard input e output */
+    STRATEGY_RING       /**< programma esterno in memoria condivisa */
+
+} strategy_kind_t;
+
+/** Tipo strategy_t
+*   Strategia aperta
+*/
+typedef struct Strategy
+{
+    char name[STRATEGY_NAME_LEN];   /**< nome (la stringa con cui è stata scelta) */
+    strategy_kind_t kind;           /**< tipo */
+    com_weights_t weights;          /**< pesi della valutazione lineare */
+    net_t net;                      /**< rete caricata */
+    plugin_t plugin;                /**< bot esterno caricato */
+    pipebot_t* pipe;                /**< programma esterno avviato con exec */
+    ring_t* ring;                   /**< programma esterno avviato con shm */
+
+} strategy_t;
+
+/** Tipo strategy_request_t
+*   Mossa chiesta con strategy_request e non ancora raccolta con strategy_reply
+*/
+typedef struct StrategyRequest
+{
+    unsigned long id;       /**< ID della richiesta al programma esterno (0 se la mossa è già scelta) */
+    int found;              /**< 0 se non ci sono mosse possibili */
+    placement_t move;       /**< mossa scelta, se id è 0 */
+
+} strategy_request_t;
+
+/**
+* Apre una strategia
+ * @param s strategia da inizializzare
+ * @param spec nome della strategia, con l'eventuale file dopo ':'
+ * @return 0 se la strategia è stata aperta, -1 se è sconosciuta o il file non è valido
+*/
+int strategy_open(strategy_t* s, const char* spec);
+
+/**
+* Chiude una strategia
+ * @param s strategia aperta
+*/
+void strategy_close(strategy_t* s);
+
+/**
+* Sceglie la mossa di un giocatore
+ * @param s strategia aperta
+ * @param state stato della partita (non viene modificato)
+ * @param player indice del giocatore che muove
+ * @param tets tetramini con le quantità dello stato (non vengono modificati)
+ * @param move mossa scelta
+ * @return 0 se è stata scelta una mossa, -1 se non ci sono mosse possibili
+*/
+int strategy_move(const strategy_t* s, const game_state_t* state, int player, tet_t tets[TET_TYPES], placement_t* move);
+
+/**
+* Chiede la mossa di un giocatore senza attenderla: un programma esterno con exec riceve la posizione
+ * e risponde mentre il chiamante prosegue, le altre strategie scelgono subito
+ * @param s strategia aperta
+ * @param state stato della partita (non viene modificato)
+ * @param player indice del giocatore che muove
+ * @param tets tetramini con le quantità dello stato (non vengono modificati)
+ * @param req richiesta da passare a strategy_reply
+*/
+void strategy_request(const strategy_t* s, const game_state_t* state, int player, tet_t tets[TET_TYPES], strategy_request_t* req);
+
+/**
+* Raccoglie la mossa chiesta con strategy_request
+ * @param s strategia della richiesta
+ * @param tets tetramini della richiesta, con le stesse quantità
+ * @param req richiesta in corso
+ * @param move mossa scelta
+ * @return 0 se è stata scelta una mossa, -1 se non ci sono mosse possibili
+*/
+int strategy_reply(const strategy_t* s, tet_t tets[TET_TYPES], strategy_request_t* req, placement_t* move);
+
+/**
+* Apre la strategia del computer nel gioco indicata dalla variabile d'ambiente XTETRIS_BOT
+ * @return 1 se la strategia è stata aperta, 0 se la variabile non è impostata o non è valida
+*/
+int strategy_game_init();
+
+/**
+* Strategia del computer nel gioco
+ * @return strategia aperta da strategy_game_init, NULL se il computer usa la sua ricerca
+*/
+const strategy_t* strategy_game();
+
+#endif /*XTETRIS2_STRATEGY_H*/
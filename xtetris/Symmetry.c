@@ -0,0 +1,204 @@
+/**
+* @file Symmetry.c
+* @author Albert Alibeaj
+* @brief File di implementazione della forma canonica delle posizioni rispetto alla simmetria orizzontale
+*/
+
+#include <string.h>
+#include "Symmetry.h"
+#include "Features.h"
+#include "Moves.h"
+
+/** Tetramino speculare di ogni tetramino, nell'ordine di tets_init */
+const int tet_mirror[TET_TYPES] = {0, 1, 3, 2, 4, 6, 5};
+
+/** Inversione dei bit di un gruppo di 5 colonne */
+const unsigned char rev5[32] = {
+    0, 16, 8, 24, 4, 20, 12, 28, 2, 18, 10, 26, 6, 22, 14, 30,
+    1, 17, 9, 25, 5, 21, 13, 29, 3, 19, 11, 27, 7, 23, 15, 31
+};
+
+/**
+* Specchia una maschera di riga da sinistra a destra
+ * @param row maschera da specchiare
+ * @return maschera specchiata
+*/
+unsigned int row_mirror(unsigned int row);
+
+/**
+* Calcola la forma di un tetramino ruotato, senza modificare il tetramino
+ * @param tet tetramino da ruotare
+ * @param rot numero di rotazioni verso destra
+ * @param shape array in cui scrivere la forma (almeno TET_MAX_LEN * TET_MAX_LEN)
+ * @return larghezza del tetramino ruotato
+*/
+int rotated_shape(const tet_t* tet, int rot, int* shape);
+
+unsigned int row_mirror(unsigned int row)
+{
+#if FIELD_COLS == 10
+    return ((unsigned int)rev5[row & 31u] << 5) | rev5[(row >> 5) & 31u];
+#else
+    unsigned int out = 0;
+    int j;
+    for(j = 0; j < FIELD_COLS; j++)
+        if(row & (1u << j))
+            out |= 1u << (FIELD_COLS - 1 - j);
+    return out;
+#endif
+}
+
+int position_canonical_rows(const unsigned int rows[FIELD_ROWS], const int quantities[TET_TYPES], position_key_t* key)
+{
+    position_key_t mirrored;
+    int i;
+
+    memset(key, 0, sizeof(*key));
+    memset(&mirrored, 0, sizeof(mirrored));
+
+    for(i = 0; i < FIELD_ROWS; i++)
+    {
+        key->rows[i] = rows[i];
+        mirrored.rows[i] = row_mirror(rows[i]);
+    }
+    for(i = 0; i < TET_TYPES; i++)
+    {
+        key->quantities[i] = quantities[i];
+        mirrored.quantities[tet_mirror[i]] = quantities[i];
+    }
+
+    /* Qualsiasi ordine va bene, purchè sia lo stesso per una posizione e la sua speculare */
+    if(memcmp(&mirrored, key, sizeof(*key)) < 0)
+    {
+        *key = mirrored;
+        return 1;
+    }
+    return 0;
+}
+
+int position_canonical(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], position_key_t* key)
+{
+    unsigned int rows[FIELD_ROWS];
+    int quantities[TET_TYPES];
+    int i;
+
+    field_rows(field, rows);
+    for(i = 0; i < TET_TYPES; i++)
+        quantities[i] = tets[i].quantity;
+
+    return position_canonical_rows(rows, quantities, key);
+}
+
+unsigned long position_hash(const position_key_t* key)
+{
+    unsigned long h = 2166136261UL;
+    int i;
+
+    for(i = 0; i < FIELD_ROWS; i++)
+    {
+        h = (h ^ key->rows[i]) * 0x5bd1e995UL;
+        h ^= h >> 15;
+    }
+    for(i = 0; i < TET_TYPES; i++)
+    {
+        h = (h ^ (unsigned long)key->quantities[i]) * 0x5bd1e995UL;
+        h ^= h >> 15;
+    }
+
+    h ^= h >> 13;
+    h *= 0x85ebca6bUL;
+    h ^= h >> 16;
+    return h;
+}
+
+int rotated_shape(const tet_t* tet, int rot, int* shape)
+{
+    tet_t tmp = *tet;
+    int i;
+
+    tmp.shape = shape;
+    for(i = 0; i < tet->shape_len * tet->shape_len; i++)
+        shape[i] = tet->base_shape[i];
+    rotate_dx(&tmp, rot);
+
+    return tet_width(tmp);
+}
+
+placement_t placement_mirror(tet_t tets[TET_TYPES], placement_t p)
+{
+    int shape[TET_MAX_LEN * TET_MAX_LEN], flipped[TET_MAX_LEN * TET_MAX_LEN];
+    int len = tets[p.id].shape_len;
+    int width = rotated_shape(&tets[p.id], p.rot, shape);
+    int r, c, rot;
+    placement_t out;
+
+    /* Forma ribaltata: resta allineata in basso a sinistra come dopo tet_adjust */
+    for(r = 0; r < len; r++)
+        for(c = 0; c < len; c++)
+            flipped[r * len + c] = c < width ? shape[r * len + (width - 1 - c)] != 0 : 0;
+
+    out.id = tet_mirror[p.id];
+    out.rot = 0;
+    out.col = FIELD_COLS - width - (p.col > FIELD_COLS - width ? FIELD_COLS - width : p.col);
+
+    for(rot = 0; rot < tets[out.id].rot_number; rot++)
+    {
+        int candidate[TET_MAX_LEN * TET_MAX_LEN];
+        int same = 1, i;
+
+        rotated_shape(&tets[out.id], rot, candidate);
+        for(i = 0; i < len * len && same; i++)
+            same = (candidate[i] != 0) == flipped[i];
+
+        if(same)
+        {
+            out.rot = rot;
+            break;
+        }
+    }
+
+    return out;
+}
+
+int placements_mirror_fold(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placements_t* moves, int weights[PLACEMENTS_MAX])
+{
+    unsigned int rows[FIELD_ROWS];
+    int i, j, kept = 0;
+
+    for(i = 0; i < moves->count; i++)
+        weights[i] = 1;
+
+    field_rows(field, rows);
+    for(i = 0; i < FIELD_ROWS; i++)
+        if(row_mirror(rows[i]) != rows[i])
+            return 0;
+    for(i = 0; i < TET_TYPES; i++)
+        if(tets[tet_mirror[i]].quantity != tets[i].quantity)
+            return 0;
+
+    /* Peso 0: mossa speculare di una mossa precedente, già contata due volte */
+    for(i = 0; i < moves->count; i++)
+    {
+        placement_t m;
+
+        if(weights[i] == 0)
+            continue;
+        m = placement_mirror(tets, moves->moves[i]);
+        for(j = i + 1; j < moves->count; j++)
+            if(weights[j] && moves->moves[j].id == m.id && moves->moves[j].rot == m.rot && moves->moves[j].col == m.col)
+            {
+                weights[i] = 2;
+                weights[j] = 0;
+                break;
+            }
+    }
+
+    for(i = 0; i < moves->count; i++)
+        if(weights[i])
+        {
+            moves->moves[kept] = moves->moves[i];
+            weights[kept++] = weights[i];
+        }
+    moves->count = kept;
+    return 1;
+}
@@ -0,0 +1,73 @@
+/**
+* @file Symmetry.h
+* @author Albert Alibeaj
+* @brief Libreria che sfrutta la simmetria orizzontale del gioco:
+ * un campo specchiato, con le quantità delle coppie speculari (J/L e S/Z) scambiate,
+ * è strategicamente equivalente all'originale. Le due posizioni hanno quindi
+ * la stessa forma canonica e possono essere cercate e salvate una volta sola
+*/
+
+#ifndef XTETRIS2_SYMMETRY_H
+#define XTETRIS2_SYMMETRY_H
+
+#include "Field.h"
+#include "Pieces.h"
+#include "Placements.h"
+
+/** Tipo position_key_t
+*   Forma canonica di una posizione: occupazione delle righe e quantità dei tetramini
+*/
+typedef struct PositionKey
+{
+    unsigned int rows[FIELD_ROWS];  /**< maschere di occupazione delle righe */
+    int quantities[TET_TYPES];      /**< quantità di ogni tetramino */
+
+} position_key_t;
+
+/**
+* Calcola la forma canonica di una posizione: tra la posizione e la sua
+ * speculare si sceglie sempre la stessa, così che entrambe abbiano la stessa chiave
+ * @param field campo della posizione
+ * @param tets tetramini con le quantità della posizione
+ * @param key chiave da riempire
+ * @return 1 se la forma canonica è quella specchiata, 0 altrimenti
+*/
+int position_canonical(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], position_key_t* key);
+
+/**
+* Calcola la forma canonica a partire dalle maschere delle righe
+ * @param rows maschere di occupazione delle righe
+ * @param quantities quantità di ogni tetramino
+ * @param key chiave da riempire
+ * @return 1 se la forma canonica è quella specchiata, 0 altrimenti
+*/
+int position_canonical_rows(const unsigned int rows[FIELD_ROWS], const int quantities[TET_TYPES], position_key_t* key);
+
+/**
+* Calcola l'hash di una chiave, da usare nelle tabelle delle posizioni già visitate
+ * @param key chiave di cui calcolare l'hash
+ * @return hash della chiave
+*/
+unsigned long position_hash(const position_key_t* key);
+
+/**
+* Traduce una mossa nella mossa equivalente sul campo specchiato
+ * (usata per riportare sul campo reale una mossa trovata nella forma canonica)
+ * @param tets tetramini (non vengono modificati)
+ * @param p mossa da specchiare
+ * @return mossa equivalente con il tetramino speculare
+*/
+placement_t placement_mirror(tet_t tets[TET_TYPES], placement_t p);
+
+/**
+* Se la posizione coincide con la sua speculare, le mosse di ogni coppia speculare portano a posizioni
+ * equivalenti: resta solo la prima mossa della coppia, con peso 2. Altrimenti le mosse restano tutte con peso 1
+ * @param field campo della posizione
+ * @param tets tetramini con le quantità della posizione
+ * @param moves mosse generate da placements_gen, ridotte sul posto
+ * @param weights posizioni equivalenti rappresentate da ogni mossa rimasta (1 o 2)
+ * @return 1 se le mosse sono state ripiegate, 0 altrimenti
+*/
+int placements_mirror_fold(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES], placements_t* moves, int weights[PLACEMENTS_MAX]);
+
+#endif /*XTETRIS2_SYMMETRY_H*/
@@ -0,0 +1,303 @@
+/**
+* @file Trace.c
+* @author Albert Alibeaj
+* @brief File di implementazione della traccia delle fasi della partita
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "Trace.h"
+#include "Clock.h"
+
+/** Numero massimo di thread tracciati */
+#define TRACE_THREADS 8
+/** Eventi di ogni buffer (potenza di 2); se il buffer è pieno gli eventi vengono scartati */
+#define TRACE_EVENTS 4096
+/** Millisecondi tra due svuotamenti dei buffer */
+#define TRACE_FLUSH_MS 100
+/** Byte accumulati prima di una scrittura sul file */
+#define TRACE_OUT_LEN 8192
+/** Lunghezza massima di un evento in JSON */
+#define TRACE_LINE_LEN 256
+
+/** Tipo trace_event_t
+*   Inizio o fine di una fase
+*/
+typedef struct TraceEvent
+{
+    const char* name;       /**< nome della fase */
+    char phase;             /**< 'B' inizio, 'E' fine */
+    double ts;              /**< istante in secondi dall'avvio della traccia */
+
+} trace_event_t;
+
+/** Tipo trace_buffer_t
+*   Buffer circolare di un thread: scrive solo il thread proprietario, legge solo il thread di scrittura
+*/
+typedef struct TraceBuffer
+{
+    trace_event_t events[TRACE_EVENTS];     /**< eventi */
+    unsigned long head;                     /**< eventi scritti dal thread proprietario */
+    unsigned long tail;                     /**< eventi letti dal thread di scrittura */
+    unsigned long dropped;                  /**< eventi scartati perchè il buffer era pieno */
+    const char* name;                       /**< nome del thread (NULL se non assegnato) */
+    int named;                              /**< 1 se il nome è già stato scritto nel file */
+
+} trace_buffer_t;
+
+int trace_enabled = 0;                      /**< 1 se la traccia è attiva */
+int trace_stopping;                         /**< 1 quando il thread di scrittura deve terminare */
+double trace_origin;                        /**< istante di avvio della traccia */
+int trace_fd;                               /**< file della traccia */
+char trace_out[TRACE_OUT_LEN];              /**< testo in attesa di essere scritto (solo thread di scrittura) */
+int trace_out_len;                          /**< byte in trace_out */
+int trace_first;                            /**< 1 finchè nel file non è stato scritto alcun evento */
+pthread_t trace_thread;                     /**< thread di scrittura */
+
+trace_buffer_t trace_buffers[TRACE_THREADS];    /**< un buffer per thread */
+int trace_buffers_used = 0;                     /**< buffer già assegnati */
+__thread int trace_slot = -1;                   /**< buffer del thread corrente (-1 se non assegnato) */
+
+/**
+* Buffer del thread corrente, assegnato al primo uso
+ * @return buffer, o NULL se i buffer sono finiti
+*/
+trace_buffer_t* trace_buffer();
+
+/**
+* Aggiunge un evento al buffer del thread corrente
+ * @param name nome della fase
+ * @param phase tipo di evento
+*/
+void trace_push(const char* name, char phase);
+
+/**
+* Aggiunge testo a quello da scrivere, scrivendo sul file quando serve spazio
+ * @param text testo da aggiungere
+*/
+void trace_emit(const char* text);
+
+/**
+* Scrive sul file il testo accumulato.
+ * Non si usa un FILE per non riscrivere dati a un'uscita anomala del processo
+*/
+void trace_write();
+
+/**
+* Svuota tutti i buffer nel file
+*/
+void trace_flush();
+
+/**
+* Funzione eseguita dal thread di scrittura: svuota periodicamente i buffer
+ * @param arg non usato
+ * @return sempre NULL
+*/
+void* trace_writer(void* arg);
+
+trace_buffer_t* trace_buffer()
+{
+    if(trace_slot < 0)
+    {
+        int slot = __atomic_fetch_add(&trace_buffers_used, 1, __ATOMIC_RELAXED);
+        if(slot >= TRACE_THREADS)
+            return NULL;
+        trace_slot = slot;
+    }
+
+    return &trace_buffers[trace_slot];
+}
+
+void trace_push(const char* name, char phase)
+{
+    trace_buffer_t* buf;
+    unsigned long head, tail;
+
+    if(!trace_enabled || !(buf = trace_buffer()))
+        return;
+
+    head = buf->head;
+    tail = __atomic_load_n(&buf->tail, __ATOMIC_ACQUIRE);
+    if(head - tail >= TRACE_EVENTS)
+    {
+        buf->dropped++;
+        return;
+    }
+
+    buf->events[head & (TRACE_EVENTS - 1)].name = name;
+    buf->events[head & (TRACE_EVENTS - 1)].phase = phase;
+    buf->events[head & (TRACE_EVENTS - 1)].ts = clock_now() - trace_origin;
+    __atomic_store_n(&buf->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void trace_begin(const char* name)
+{
+    trace_push(name, 'B');
+}
+
+void trace_end(const char* name)
+{
+    trace_push(name, 'E');
+}
+
+void trace_thread_name(const char* name)
+{
+    trace_buffer_t* buf;
+    int used = __atomic_load_n(&trace_buffers_used, __ATOMIC_RELAXED);
+    int slot;
+
+    if(!trace_enabled)
+        return;
+
+    /* I thread creati a ogni turno riprendono il buffer del thread precedente con lo stesso nome */
+    if(trace_slot < 0)
+        for(slot = 0; slot < used && slot < TRACE_THREADS; slot++)
+            if(__atomic_load_n(&trace_buffers[slot].name, __ATOMIC_ACQUIRE) == name)
+            {
+                trace_slot = slot;
+                return;
+            }
+
+    if(!(buf = trace_buffer()))
+        return;
+
+    __atomic_store_n(&buf->name, name, __ATOMIC_RELEASE);
+}
+
+void trace_write()
+{
+    int done = 0;
+
+    while(done < trace_out_len)
+    {
+        ssize_t n = write(trace_fd, trace_out + done, trace_out_len - done);
+        if(n <= 0)
+            break;
+        done += n;
+    }
+    trace_out_len = 0;
+}
+
+void trace_emit(const char* text)
+{
+    int len = strlen(text);
+
+    if(trace_out_len + len > TRACE_OUT_LEN)
+        trace_write();
+    memcpy(trace_out + trace_out_len, text, len);
+    trace_out_len += len;
+}
+
+void trace_flush()
+{
+    char line[TRACE_LINE_LEN];
+    int used = __atomic_load_n(&trace_buffers_used, __ATOMIC_RELAXED);
+    int slot;
+
+    if(used > TRACE_THREADS)
+        used = TRACE_THREADS;
+
+    for(slot = 0; slot < used; slot++)
+    {
+        trace_buffer_t* buf = &trace_buffers[slot];
+        unsigned long tail = buf->tail;
+        unsigned long head = __atomic_load_n(&buf->head, __ATOMIC_ACQUIRE);
+        const char* name = __atomic_load_n(&buf->name, __ATOMIC_ACQUIRE);
+
+        if(name && !buf->named)
+        {
+            sprintf(line, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%.64s\"}}",
+                    trace_first ? "\n" : ",\n", slot, name);
+            trace_emit(line);
+            trace_first = 0;
+            buf->named = 1;
+        }
+
+        for(; tail != head; tail++)
+        {
+            const trace_event_t* e = &buf->events[tail & (TRACE_EVENTS - 1)];
+
+            sprintf(line, "%s{\"name\":\"%.64s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+                    trace_first ? "\n" : ",\n", e->name, e->phase, slot, e->ts * 1e6);
+            trace_emit(line);
+            trace_first = 0;
+        }
+
+        __atomic_store_n(&buf->tail, tail, __ATOMIC_RELEASE);
+    }
+
+    trace_write();
+}
+
+void* trace_writer(void* arg)
+{
+    struct timespec wait;
+    (void)arg;
+
+    wait.tv_sec = 0;
+    wait.tv_nsec = TRACE_FLUSH_MS * 1000000L;
+
+    while(!__atomic_load_n(&trace_stopping, __ATOMIC_ACQUIRE))
+    {
+        nanosleep(&wait, NULL);
+        trace_flush();
+    }
+
+    return NULL;
+}
+
+void trace_init()
+{
+    const char* path = getenv("XTETRIS_TRACE");
+
+    if(trace_enabled || !path || !*path)
+        return;
+
+    trace_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(trace_fd < 0)
+        return;
+
+    trace_out_len = 0;
+    trace_emit("[");
+    trace_first = 1;
+    trace_origin = clock_now();
+    trace_stopping = 0;
+    trace_enabled = 1;
+
+    if(pthread_create(&trace_thread, NULL, trace_writer, NULL) != 0)
+    {
+        trace_enabled = 0;
+        close(trace_fd);
+        return;
+    }
+
+    trace_thread_name("gioco");
+}
+
+void trace_stop()
+{
+    unsigned long dropped = 0;
+    int slot;
+
+    if(!trace_enabled)
+        return;
+
+    trace_enabled = 0;
+    __atomic_store_n(&trace_stopping, 1, __ATOMIC_RELEASE);
+    pthread_join(trace_thread, NULL);
+    trace_flush();
+
+    for(slot = 0; slot < TRACE_THREADS; slot++)
+        dropped += trace_buffers[slot].dropped;
+    if(dropped)
+        fprintf(stderr, "xtetris: %lu eventi di traccia scartati (buffer pieni)\n", dropped);
+
+    trace_emit("\n]\n");
+    trace_write();
+    close(trace_fd);
+}
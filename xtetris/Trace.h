@@ -0,0 +1,43 @@
+/**
+* @file Trace.h
+* @author Albert Alibeaj
+* @brief Libreria che registra le fasi della partita nel formato JSON degli eventi di traccia
+ * di Chrome (chrome://tracing, Perfetto). Ogni thread scrive in un proprio buffer circolare
+ * senza lock; un thread separato svuota i buffer e scrive il file.
+ * La traccia è attiva solo se la variabile d'ambiente XTETRIS_TRACE contiene il file da scrivere
+*/
+
+#ifndef XTETRIS2_TRACE_H
+#define XTETRIS2_TRACE_H
+
+/**
+* Avvia la traccia se XTETRIS_TRACE è impostata, altrimenti non fa nulla
+*/
+void trace_init();
+
+/**
+* Scrive gli eventi rimasti, chiude il file e ferma il thread di scrittura
+*/
+void trace_stop();
+
+/**
+* Inizio di una fase del thread corrente. Le fasi possono essere annidate
+ * @param name nome della fase: deve essere una stringa costante
+*/
+void trace_begin(const char* name);
+
+/**
+* Fine della fase aperta più recente del thread corrente
+ * @param name nome della fase: deve essere una stringa costante
+*/
+void trace_end(const char* name);
+
+/**
+* Dà un nome al thread corrente, mostrato nella traccia. Un thread con lo stesso nome
+ * di uno già terminato ne riprende il buffer: due thread con lo stesso nome non devono
+ * essere attivi insieme
+ * @param name nome del thread: deve essere sempre la stessa stringa costante
+*/
+void trace_thread_name(const char* name);
+
+#endif /*XTETRIS2_TRACE_H*/
@@ -0,0 +1,108 @@
+/**
+* @file bot_lowest.c
+* @author Albert Alibeaj
+* @brief Bot esterno di esempio per l'interfaccia di Bot.h: tra le mosse possibili sceglie quella
+ * che lascia meno buchi e, a parità, il campo più basso e più punti.
+ *
+ * Viene compilato come libreria condivisa (libxtetris-bot-lowest) e si usa con la strategia
+ * <code>lib:./libxtetris-bot-lowest.so</code>, per esempio in <code>xtetris-tournament</code>
+ * o nel gioco con la variabile d'ambiente XTETRIS_BOT. Gli argomenti vengono ignorati.
+*/
+
+#include <stdlib.h>
+#include "Bot.h"
+
+/** Tipo bot_lowest_t
+*   Istanza del bot
+*/
+typedef struct BotLowest
+{
+    const xtetris_bot_host_t* host;     /**< funzioni del motore */
+
+} bot_lowest_t;
+
+/**
+* Conta i buchi (celle vuote sotto una piena) e somma le altezze delle colonne di un campo
+ * @param field campo da valutare
+ * @param height somma delle altezze delle colonne
+ * @return numero di buchi
+*/
+int bot_lowest_holes(int field[XTETRIS_BOT_ROWS][XTETRIS_BOT_COLS], int* height)
+{
+    int r, c, holes = 0;
+
+    *height = 0;
+    for(c = 0; c < XTETRIS_BOT_COLS; c++)
+    {
+        for(r = 0; r < XTETRIS_BOT_ROWS && !field[r][c]; r++)
+            ;
+        *height += XTETRIS_BOT_ROWS - r;
+        for(; r < XTETRIS_BOT_ROWS; r++)
+            holes += !field[r][c];
+    }
+    return holes;
+}
+
+int xtetris_bot_abi(void)
+{
+    return XTETRIS_BOT_ABI_VERSION;
+}
+
+int xtetris_bot_init(const xtetris_bot_host_t* host, const char* args, void** bot, int* flags)
+{
+    bot_lowest_t* b;
+
+    (void)args;
+    if(host->abi_version != XTETRIS_BOT_ABI_VERSION)
+        return -1;
+
+    b = (bot_lowest_t*)malloc(sizeof(bot_lowest_t));
+    if(!b)
+        return -1;
+    b->host = host;
+
+    /* Il bot non ha stato che cambia tra le mosse: può giocare su più thread insieme */
+    *flags = XTETRIS_BOT_REENTRANT;
+    *bot = b;
+    return 0;
+}
+
+int xtetris_bot_choose_move(void* bot, const xtetris_bot_position_t* pos, int player, xtetris_bot_move_t* move)
+{
+    const bot_lowest_t* b = (const bot_lowest_t*)bot;
+    xtetris_bot_move_t moves[XTETRIS_BOT_MAX_MOVES];
+    int after[XTETRIS_BOT_ROWS][XTETRIS_BOT_COLS];
+    long best = 0;
+    int count, i, found = 0;
+
+    count = b->host->legal_moves(pos, moves);
+    if(count == 0)
+        return -1;
+
+    *move = moves[0];
+    for(i = 0; i < count; i++)
+    {
+        int height, holes, score = b->host->try_move(pos, player, moves[i], after);
+        long value;
+
+        if(score < 0)
+            continue;
+
+        /* Meno buchi prima di tutto, poi altezza più bassa, poi più punti */
+        holes = bot_lowest_holes(after, &height);
+        value = -(long)holes * 100000L - (long)height * 100L + score;
+        if(!found || value > best)
+        {
+            best = value;
+            *move = moves[i];
+            found = 1;
+        }
+    }
+
+    return 0;
+}
+
+void xtetris_bot_free(void* bot)
+{
+    free(bot);
+}
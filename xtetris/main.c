@@ -10,7 +10,8 @@
  * di pezzi da scegliere. Puoi scegliere il pezzo che preferisci, sempre che il
  * pezzo sia disponibile.
  * Puoi giocare da solo, con un amico o contro il computer. Usa le frecce per muoverti
- * e il tasto INVIO per confermare
+ * e il tasto INVIO per confermare. Durante il tuo turno il tasto H mostra (o nasconde)
+ * dove andrebbe la mossa consigliata dal computer
 *
 * @section install_sec Installazione
  * Segui queste istruzioni per iniziare a giocare a X-Tetris
@@ -42,38 +43,152 @@
  *
  * <code>gcc -ansi -pedantic-errors -Wall -O3
  *  -L{ncurses_lib_path}
- *  main.c Field.c Pieces.c Moves.c Game.c GameGraphics.c MenuGraphics.c Player.c
- *  -lmenu -lncurses -oxtetris</code>
+ *  main.c Field.c Pieces.c Moves.c Features.c Placements.c State.c Profile.c Trace.c Clock.c Histogram.c Lan.c Latency.c EventLog.c Results.c Net.c Sched.c Com.c Plugin.c PipeBot.c Ring.c Strategy.c Ponder.c Hint.c Game.c GameGraphics.c MenuGraphics.c Player.c
+ *  -lmenu -lncurses -lm -ldl -pthread -oxtetris</code>
  *
  *  dove {ncurses_lib_path} è il percorso delle librerie da linkare (menu e ncurses).
  *  Cambia a seconda dell'installazione. Un esempio è <code>/opt/homebrew/opt/ncurses/lib</code>
  *
+ * Configurando CMake con <code>-DXTETRIS_PROFILE=ON</code> (o aggiungendo <code>-DXTETRIS_PROFILE</code> al comando)
+ * il gioco conta le chiamate e misura il tempo delle funzioni principali. I dati vengono aggiunti a
+ * <code>xtetris-profile.txt</code> (o al file indicato da XTETRIS_PROFILE_FILE) a fine partita
+ * e quando il processo riceve SIGUSR1.
+ *
+ * Impostando la variabile d'ambiente XTETRIS_TRACE con il nome di un file, le fasi di ogni turno
+ * (scelte, anteprima, inserimento, stampa, attesa dei tasti) vengono salvate in formato JSON,
+ * apribile con chrome://tracing o https://ui.perfetto.dev
+ *
+ * A fine partita viene mostrata la latenza dei tasti, cioè il tempo tra la lettura di un tasto
+ * e l'invio al terminale della schermata aggiornata (mediana, 99° e 99,9° percentile).
+ * Con la variabile d'ambiente XTETRIS_LATENCY_FILE l'istogramma completo viene aggiunto a quel file.
+ *
+ * Impostando XTETRIS_EVENT_LOG con il nome di un file, ogni evento delle partite (inizio, mosse,
+ * righe invertite all'avversario, fine) viene aggiunto a quel file in formato binario (vedi EventLog.h).
+ *
+ * Impostando XTETRIS_RESULTS con il nome di un file (ad esempio <code>xtetris-results.db</code>),
+ * a fine partita l'esito (modalità, punteggi, vincitore, mosse, durata e seme) viene aggiunto
+ * a quell'archivio; senza la variabile non viene salvato nulla.
+ *
+ * Impostando XTETRIS_NET con il nome di un file scritto da <code>xtetris-net</code> (vedi Net.h),
+ * il computer valuta le mosse con quella rete neurale invece che con i pesi predefiniti.
+ * Con XTETRIS_WEIGHTS il computer usa invece i pesi scritti da <code>xtetris-tune</code>.
+ * Con XTETRIS_BOT il computer gioca con una strategia di Strategy.h, per esempio
+ * <code>lib:./libxtetris-bot-lowest.so</code> per un bot esterno che implementa l'interfaccia di Bot.h,
+ * o <code>exec:./xtetris-pipebot</code> per un programma esterno che usa il protocollo di PipeBot.h
+ * (<code>shm:./xtetris-pipebot</code> per lo stesso programma in memoria condivisa, vedi Ring.h).
+ *
+ * Con CMake viene compilato anche <code>xtetris-perft</code>, che conta le posizioni
+ * raggiungibili fino a una certa profondità e misura la velocità del motore di gioco,
+ * e <code>xtetris-pty</code>, che avvia il gioco in un terminale virtuale, gli invia una sequenza
+ * di tasti e misura la latenza e i byte scritti per ogni tasto, e <code>xtetris-results</code>, che mostra
+ * la classifica di ogni modalità letta dall'archivio dei risultati. <code>xtetris-net</code> scrive
+ * una rete neurale per il computer e ne confronta la latenza per mossa con quella dei pesi,
+ * <code>xtetris-tune</code> cerca pesi migliori facendo giocare migliaia di partite su tutti i core
+ * e <code>xtetris-tournament</code> fa sfidare strategie diverse del computer e ne stima i punti Elo;
+ * <code>xtetris-pipebot</code> è un esempio di programma esterno che gioca come computer.
+ * Su Linux vengono compilati anche <code>xtetris-server</code>, che ospita migliaia di partite in rete
+ * insieme, e <code>xtetris-loadgen</code>, che lo mette sotto carico simulando i client.
+ *
+ * Due giochi possono sfidarsi in rete: chi ospita avvia <code>./xtetris -l :7000</code> (o
+ * <code>-l host:porta</code>, o il percorso di un socket Unix) e attende l'avversario, che si unisce con
+ * <code>./xtetris -c host:7000</code>. Chi ospita gioca per primo; ognuno invia all'altro solo le righe
+ * del proprio campo cambiate dalla mossa (vedi Lan.h). A fine partita viene mostrato il tempo
+ * di andata e ritorno delle mosse al posto della latenza dei tasti. Con <code>-c</code> ci si può collegare
+ * anche a <code>xtetris-server</code>, che accoppia i giocatori nell'ordine di arrivo.
+ *
  * @subsection final Installazione terminata
  * Ora il programma è pronto per essere lanciato. Digita <code>./xtetris</code> da terminale per iniziare.
 */
 
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
+#include <unistd.h>
 #include "Game.h"
 #include "MenuGraphics.h"
+#include "Profile.h"
+#include "Trace.h"
+#include "EventLog.h"
+#include "Com.h"
+#include "Strategy.h"
 
 /**
  * Programma principale, richiama il menu iniziale
  * e a seconda di cosa si sceglie, fa iniziare un certo tipo
  * di partita. Il processo si ripete ciclicamente finchè non si esce.
+ * Con <code>-l indirizzo</code> o <code>-c indirizzo</code> gioca invece una sola partita in rete.
+ * @param argc numero di argomenti
+ * @param argv argomenti
  * @return 0 se il programma termina correttamente
 */
-int main() {
+int main(int argc, char* argv[]) {
     const int SINGLEPLAYER_MODE = 0;
     const int MULTIPLAYER_MODE = 1;
     const int PLAYER_VS_COM_MODE = 2;
     const int EXIT_GAME = 3;
     int mode;
+    const char* host_address = NULL;
+    const char* join_address = NULL;
+    int opt;
 
-    all_graphics_init();
+    while((opt = getopt(argc, argv, "l:c:")) != -1)
+    {
+        if(opt == 'l')
+            host_address = optarg;
+        else if(opt == 'c')
+            join_address = optarg;
+        else
+        {
+            fprintf(stderr, "Uso: %s [-l indirizzo | -c indirizzo]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    PROFILE_INIT();
+    trace_init();
+    eventlog_init();
+    com_weights_init();
+    com_net_init();
+    strategy_game_init();
     srand((unsigned int)time(NULL));
 
+    /* Il collegamento si prepara prima della grafica, per poter scrivere sul terminale mentre si attende */
+    if(host_address || join_address)
+    {
+        int p1_field[FIELD_ROWS][FIELD_COLS];
+        int p2_field[FIELD_ROWS][FIELD_COLS];
+        tet_t tets[TET_TYPES];
+        unsigned long seed = (unsigned long)rand() & 0xFFFFFFFFUL;
+        int player = 1;
+        lan_t lan;
+
+        printf(host_address ? "In attesa dell'avversario su %s...\n" : "Collegamento a %s...\n",
+               host_address ? host_address : join_address);
+        fflush(stdout);
+        if(host_address ? lan_host(&lan, host_address, seed) : lan_join(&lan, join_address, &seed, &player))
+        {
+            fprintf(stderr, "Collegamento non riuscito\n");
+            lan_close(&lan);
+            return 1;
+        }
+
+        /* Lo stesso seme su entrambi i giochi */
+        srand((unsigned int)seed);
+        all_graphics_init();
+        eventlog_game_start(MULTIPLAYER_MODE);
+        lan_start_game(p1_field, p2_field, tets, &lan, player);
+        multi_end_game(tets);
+        lan_close(&lan);
+
+        all_graphics_term();
+        trace_stop();
+        eventlog_stop();
+        return 0;
+    }
+
+    all_graphics_init();
+
     do
     {
         mode = print_start_menu();
@@ -85,6 +200,7 @@ int main() {
 
             main_graphics_free();
 
+            eventlog_game_start(mode);
             single_start_game(field, tets);
             single_end_game(tets);
         }
@@ -97,6 +213,7 @@ int main() {
 
             main_graphics_free();
 
+            eventlog_game_start(mode);
             multi_start_game(p1_field, p2_field, tets, 0);
             multi_end_game(tets);
         }
@@ -108,6 +225,7 @@ int main() {
 
             main_graphics_free();
 
+            eventlog_game_start(mode);
             multi_start_game(p_field, com_field, tets, 1);
             multi_end_game(tets);
         }
@@ -115,6 +233,8 @@ int main() {
     } while (mode != EXIT_GAME);
 
     all_graphics_term();
+    trace_stop();
+    eventlog_stop();
 
     return 0;
 }
@@ -0,0 +1,104 @@
+/**
+* @file main_events.c
+* @author Albert Alibeaj
+* @brief Programma xtetris-events: stampa in chiaro il registro degli eventi scritto dal gioco (EventLog.h),
+ * un evento per riga, e controlla che i numeri degli eventi di ogni partita siano consecutivi.
+ *
+ * Uso: <code>xtetris-events [file]</code> (predefinito: XTETRIS_EVENT_LOG)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "EventLog.h"
+
+/** Nomi dei tipi di evento, nell'ordine di event_type_t */
+const char* event_names[] = {"?", "inizio", "mossa", "attacco", "fine"};
+/** Nomi dei motivi della fine, nell'ordine di event_end_t */
+const char* end_names[] = {"?", "tetramini finiti", "persa", "persa da entrambi", "uscita"};
+
+/**
+* Stampa un evento su una riga
+ * @param e evento decodificato
+*/
+void print_event(const event_record_t* e)
+{
+    char date[32];
+    time_t t = (time_t)(e->time_us / 1000000UL);
+
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    printf("%s.%06lu partita %lu #%-4lu %-8s", date, e->time_us % 1000000UL, e->game, e->seq,
+           e->type >= EVENT_GAME_START && e->type <= EVENT_GAME_OVER ? event_names[e->type] : event_names[0]);
+
+    switch(e->type)
+    {
+        case EVENT_GAME_START:
+            printf(" modalità %d, processo %ld\n", e->a, e->value);
+            break;
+        case EVENT_MOVE:
+            printf(" giocatore %d: tetramino %d rotazione %d colonna %d, %ld punti\n", e->player, e->a, e->b, e->c, e->value);
+            break;
+        case EVENT_ATTACK:
+            printf(" giocatore %d inverte %d righe\n", e->player, e->a);
+            break;
+        case EVENT_GAME_OVER:
+            printf(" %s, vincitore %d, uscito %d, %ld a %ld\n",
+                   e->a >= EVENT_END_PIECES && e->a <= EVENT_END_EXIT ? end_names[e->a] : end_names[0],
+                   e->player, e->b, e->value, e->value2);
+            break;
+        default:
+            printf(" tipo %d\n", e->type);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const char* path = argc > 1 ? argv[1] : getenv("XTETRIS_EVENT_LOG");
+    unsigned char record[EVENTLOG_RECORD_LEN];
+    char magic[8];
+    unsigned long count = 0, games = 0, gaps = 0, last_game = 0, next_seq = 0;
+    size_t n;
+    FILE* in;
+
+    if(argc > 2 || !path || !*path)
+    {
+        fprintf(stderr, "Uso: %s [file] (predefinito: XTETRIS_EVENT_LOG)\n", argv[0]);
+        return 2;
+    }
+
+    in = fopen(path, "rb");
+    if(!in || fread(magic, 1, sizeof(magic), in) != sizeof(magic) || memcmp(magic, EVENTLOG_MAGIC, sizeof(magic)) != 0)
+    {
+        fprintf(stderr, "%s non è un registro degli eventi\n", path);
+        if(in) fclose(in);
+        return 1;
+    }
+
+    while((n = fread(record, 1, sizeof(record), in)) == sizeof(record))
+    {
+        event_record_t e;
+
+        eventlog_decode(record, &e);
+        print_event(&e);
+
+        /* Ogni partita riparte da 0 (anche quando un altro avvio del gioco aggiunge in fondo); un salto vuol dire eventi persi */
+        if(count == 0 || e.game != last_game || e.seq == 0)
+        {
+            games++;
+            gaps += e.seq != 0;
+        }
+        else
+            gaps += e.seq != next_seq;
+        last_game = e.game;
+        next_seq = e.seq + 1;
+        count++;
+    }
+    fclose(in);
+
+    printf("%lu eventi, %lu partite, %lu salti nella numerazione\n", count, games, gaps);
+    if(n > 0)
+        printf("record finale incompleto: %lu byte\n", (unsigned long)n);
+
+    return n > 0 || gaps ? 1 : 0;
+}
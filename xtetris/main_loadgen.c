@@ -0,0 +1,377 @@
+/**
+* @file main_loadgen.c
+* @author Albert Alibeaj
+* @brief Programma xtetris-loadgen: genera carico per <code>xtetris-server</code> simulando molti client
+ * collegati insieme, che giocano partite complete con il protocollo di Lan.h e a fine partita si ricollegano.
+ *
+ * Uso: <code>xtetris-loadgen [-c indirizzo] [-n client] [-g partite] [-t thread] [-d secondi] [-w ms] [-b]</code>
+ *  - <code>-c</code> indirizzo del server (predefinito <code>localhost:7400</code>)
+ *  - <code>-n</code> client collegati insieme (predefiniti 100, cioè 50 partite in corso)
+ *  - <code>-g</code> partite da completare prima di fermarsi (predefinite 1000, 0 senza limite)
+ *  - <code>-t</code> thread, ognuno con il proprio epoll e la propria parte dei client (predefiniti 2)
+ *  - <code>-d</code> secondi dopo cui fermarsi comunque (predefinito 0, nessun limite)
+ *  - <code>-w</code> millisecondi di riflessione prima di ogni mossa, per simulare giocatori umani (predefinito 0)
+ *  - <code>-b</code> mosse scelte dal computer con i pesi predefiniti invece che a caso tra quelle possibili
+ *
+ * Ogni client tiene la propria copia della partita con Match.h e la aggiorna con le mosse proprie e con
+ * quelle inoltrate dal server. Alla fine vengono stampate le partite al secondo e il tempo di andata
+ * e ritorno delle mosse (dall'invio alla conferma del server)
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include "Clock.h"
+#include "Com.h"
+#include "Histogram.h"
+#include "Lan.h"
+#include "Match.h"
+
+/** Thread massimi */
+#define LOADGEN_MAX_THREADS 64
+/** Eventi letti da ogni chiamata a epoll_wait */
+#define LOADGEN_EVENTS 256
+
+/** Tipo client_t
+*   Client simulato
+*/
+typedef struct Client
+{
+    int fd;                         /**< socket (-1 se chiuso) */
+    int player;                     /**< indice del giocatore (0 o 1), -1 in attesa di LAN_HELLO */
+    match_t match;                  /**< copia della partita */
+    unsigned int next_seq;          /**< numero della prossima mossa inviata */
+    double sent[LAN_PENDING];       /**< istante di invio delle ultime mosse, per numero */
+    double due;                     /**< istante della prossima mossa (0 se non tocca al client) */
+    unsigned long rng;              /**< generatore delle mosse casuali */
+    unsigned char in[LAN_BUF];      /**< byte ricevuti non ancora elaborati */
+    int in_len;                     /**< byte validi in in */
+
+} client_t;
+
+/** Tipo loadgen_worker_t
+*   Thread che simula una parte dei client
+*/
+typedef struct LoadgenWorker
+{
+    pthread_t thread;               /**< thread */
+    int epoll_fd;                   /**< epoll dei socket dei client del thread */
+    client_t* clients;              /**< client del thread */
+    int count;                      /**< numero di client */
+    histogram_t rtt;                /**< andata e ritorno delle mosse, in nanosecondi */
+    unsigned long moves;            /**< mosse inviate */
+    unsigned long aborted;          /**< partite interrotte dal server o dall'avversario */
+
+} loadgen_worker_t;
+
+loadgen_worker_t loadgen_workers[LOADGEN_MAX_THREADS];  /**< thread dei client */
+const char* loadgen_address = "localhost:7400";         /**< indirizzo del server */
+unsigned long loadgen_target = 1000;                    /**< partite da completare (0 senza limite) */
+unsigned long loadgen_done;                             /**< partite completate, contate da entrambi i client (atomico) */
+int loadgen_stop;                                       /**< 1 quando i thread devono fermarsi (atomico) */
+int loadgen_think_ms;                                   /**< millisecondi di riflessione prima di ogni mossa */
+int loadgen_best;                                       /**< 1 se le mosse sono scelte dal computer */
+tet_t loadgen_tets[TET_TYPES];                          /**< tetramini condivisi dai thread (solo lettura) */
+
+/**
+* Corpo di un thread: collega i suoi client e li fa giocare finché non ci si ferma
+ * @param arg loadgen_worker_t del thread
+ * @return NULL
+*/
+void* loadgen_worker(void* arg);
+
+/**
+* Collega un client al server
+ * @param w thread del client
+ * @param c client
+ * @return 0 se il client è collegato, -1 altrimenti
+*/
+int loadgen_connect(loadgen_worker_t* w, client_t* c);
+
+/**
+* Chiude il collegamento di un client a fine partita e lo ricollega se non ci si deve fermare
+ * @param w thread del client
+ * @param c client
+*/
+void loadgen_close(loadgen_worker_t* w, client_t* c);
+
+/**
+* Legge i byte disponibili di un client ed elabora i messaggi completi
+ * @param w thread del client
+ * @param c client
+*/
+void loadgen_read(loadgen_worker_t* w, client_t* c);
+
+/**
+* Sceglie, applica e invia la mossa di un client
+ * @param w thread del client
+ * @param c client di turno
+*/
+void loadgen_move(loadgen_worker_t* w, client_t* c);
+
+/**
+* Invia un messaggio al server
+ * @param c client
+ * @param msg messaggio
+*/
+void loadgen_send(client_t* c, const lan_msg_t* msg);
+
+void* loadgen_worker(void* arg)
+{
+    loadgen_worker_t* w = (loadgen_worker_t*)arg;
+    struct epoll_event events[LOADGEN_EVENTS];
+    int i;
+
+    for(i = 0; i < w->count; i++)
+        if(loadgen_connect(w, &w->clients[i]) != 0)
+        {
+            fprintf(stderr, "Impossibile collegarsi a %s\n", loadgen_address);
+            __atomic_store_n(&loadgen_stop, 1, __ATOMIC_RELAXED);
+            break;
+        }
+
+    while(!__atomic_load_n(&loadgen_stop, __ATOMIC_RELAXED))
+    {
+        double now = clock_now(), next = now + 0.1;
+        int n;
+
+        /* Si attende al più fino alla prossima mossa da giocare */
+        for(i = 0; i < w->count; i++)
+            if(w->clients[i].due > 0 && w->clients[i].due < next)
+                next = w->clients[i].due;
+
+        n = epoll_wait(w->epoll_fd, events, LOADGEN_EVENTS, (int)((next - now) * 1000 + 0.999));
+        for(i = 0; i < n; i++)
+            loadgen_read(w, (client_t*)events[i].data.ptr);
+
+        now = clock_now();
+        for(i = 0; i < w->count; i++)
+            if(w->clients[i].due > 0 && w->clients[i].due <= now)
+                loadgen_move(w, &w->clients[i]);
+    }
+
+    for(i = 0; i < w->count; i++)
+        if(w->clients[i].fd >= 0)
+            close(w->clients[i].fd);
+    return NULL;
+}
+
+int loadgen_connect(loadgen_worker_t* w, client_t* c)
+{
+    struct epoll_event ev;
+
+    c->fd = lan_connect(loadgen_address);
+    c->player = -1;
+    c->due = 0;
+    c->in_len = 0;
+    if(c->fd < 0)
+        return -1;
+
+    fcntl(c->fd, F_SETFL, fcntl(c->fd, F_GETFL) | O_NONBLOCK);
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = c;
+    return epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, c->fd, &ev);
+}
+
+void loadgen_close(loadgen_worker_t* w, client_t* c)
+{
+    if(c->player >= 0 && c->match.reason && !c->match.exited)
+    {
+        if(__atomic_add_fetch(&loadgen_done, 1, __ATOMIC_RELAXED) >= 2 * loadgen_target && loadgen_target)
+            __atomic_store_n(&loadgen_stop, 1, __ATOMIC_RELAXED);
+    }
+    else
+        w->aborted++;
+
+    close(c->fd);
+    c->fd = -1;
+
+    /* Se il server non accetta più collegamenti non c'è altro da misurare */
+    if(!__atomic_load_n(&loadgen_stop, __ATOMIC_RELAXED) && loadgen_connect(w, c) != 0)
+        __atomic_store_n(&loadgen_stop, 1, __ATOMIC_RELAXED);
+}
+
+void loadgen_read(loadgen_worker_t* w, client_t* c)
+{
+    lan_msg_t msg, ack;
+    ssize_t n;
+    int used;
+
+    n = recv(c->fd, c->in + c->in_len, (size_t)(LAN_BUF - c->in_len), 0);
+    if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return;
+    if(n <= 0)
+    {
+        loadgen_close(w, c);
+        return;
+    }
+
+    c->in_len += (int)n;
+    while((used = lan_decode(c->in, c->in_len, &msg)) > 0)
+    {
+        c->in_len -= used;
+        memmove(c->in, c->in + used, (size_t)c->in_len);
+
+        if(msg.type == LAN_HELLO)
+        {
+            c->player = msg.player - 1;
+            match_init(&c->match, msg.seed);
+            c->rng = msg.seed * 2654435761UL + (unsigned long)c->player;
+        }
+        else if(msg.type == LAN_ACK)
+            histogram_record(&w->rtt, (unsigned long)((clock_now() - c->sent[msg.seq % LAN_PENDING]) * 1e9));
+        else if(msg.type == LAN_MOVE && c->player >= 0)
+        {
+            ack.type = LAN_ACK;
+            ack.seq = msg.seq;
+            loadgen_send(c, &ack);
+            if(match_move(&c->match, loadgen_tets, 1 - c->player, msg.move) == -2)
+                match_leave(&c->match, 1 - c->player);
+        }
+        else if(msg.type == LAN_BYE && c->player >= 0)
+            match_leave(&c->match, 1 - c->player);
+
+        if(c->player >= 0 && c->match.turn == c->player && c->due == 0)
+            c->due = clock_now() + loadgen_think_ms / 1e3;
+    }
+}
+
+void loadgen_move(loadgen_worker_t* w, client_t* c)
+{
+    int before[FIELD_ROWS][FIELD_COLS];
+    tet_t tets[TET_TYPES];
+    placements_t legal;
+    lan_msg_t msg;
+
+    c->due = 0;
+    memcpy(tets, loadgen_tets, sizeof(tets));
+    state_to_tets(&c->match.state, tets);
+    if(placements_gen(tets, &legal) == 0)
+        return;
+
+    if(loadgen_best)
+    {
+        com_weights_t weights = com_default_weights();
+        com_best_move(c->match.state.fields[c->player], tets, &weights, &msg.move);
+    }
+    else
+    {
+        c->rng = (c->rng * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+        msg.move = legal.moves[(c->rng >> 8) % (unsigned long)legal.count];
+    }
+
+    memcpy(before, c->match.state.fields[c->player], sizeof(before));
+    msg.type = LAN_MOVE;
+    msg.seq = c->next_seq++ & 0xFFFF;
+    msg.score = match_move(&c->match, loadgen_tets, c->player, msg.move);
+    lan_diff(&msg, before, c->match.state.fields[c->player]);
+
+    c->sent[msg.seq % LAN_PENDING] = clock_now();
+    loadgen_send(c, &msg);
+    w->moves++;
+}
+
+void loadgen_send(client_t* c, const lan_msg_t* msg)
+{
+    unsigned char frame[LAN_FRAME];
+    int len = lan_encode(msg, frame);
+
+    if(send(c->fd, frame, (size_t)len, MSG_NOSIGNAL) != len)
+        shutdown(c->fd, SHUT_RDWR);
+}
+
+int main(int argc, char* argv[])
+{
+    int clients = 100, threads = 2, opt, i;
+    double duration = 0, start, elapsed;
+    unsigned long moves = 0, aborted = 0, done;
+    histogram_t rtt;
+    struct rlimit limit;
+
+    while((opt = getopt(argc, argv, "c:n:g:t:d:w:b")) != -1)
+    {
+        if(opt == 'c')
+            loadgen_address = optarg;
+        else if(opt == 'n' && atoi(optarg) >= 2)
+            clients = atoi(optarg);
+        else if(opt == 'g' && atol(optarg) >= 0)
+            loadgen_target = (unsigned long)atol(optarg);
+        else if(opt == 't' && atoi(optarg) > 0 && atoi(optarg) <= LOADGEN_MAX_THREADS)
+            threads = atoi(optarg);
+        else if(opt == 'd' && atof(optarg) >= 0)
+            duration = atof(optarg);
+        else if(opt == 'w' && atoi(optarg) >= 0)
+            loadgen_think_ms = atoi(optarg);
+        else if(opt == 'b')
+            loadgen_best = 1;
+        else
+        {
+            fprintf(stderr, "Uso: %s [-c indirizzo] [-n client] [-g partite] [-t thread] [-d secondi] [-w ms] [-b]\n", argv[0]);
+            return 2;
+        }
+    }
+    if(threads > clients)
+        threads = clients;
+
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    tets_init(loadgen_tets, 1);
+    start = clock_now();
+    for(i = 0; i < threads; i++)
+    {
+        loadgen_worker_t* w = &loadgen_workers[i];
+
+        /* I client vengono divisi tra i thread in parti quasi uguali */
+        w->count = clients / threads + (i < clients % threads);
+        w->clients = (client_t*)calloc((size_t)w->count, sizeof(client_t));
+        w->epoll_fd = epoll_create(LOADGEN_EVENTS);
+        histogram_clear(&w->rtt);
+        if(!w->clients || w->epoll_fd < 0 || pthread_create(&w->thread, NULL, loadgen_worker, w) != 0)
+        {
+            fprintf(stderr, "Impossibile avviare i thread\n");
+            return 1;
+        }
+    }
+
+    while(!__atomic_load_n(&loadgen_stop, __ATOMIC_RELAXED))
+    {
+        usleep(10000);
+        if(duration > 0 && clock_now() - start >= duration)
+            __atomic_store_n(&loadgen_stop, 1, __ATOMIC_RELAXED);
+    }
+
+    histogram_clear(&rtt);
+    for(i = 0; i < threads; i++)
+    {
+        pthread_join(loadgen_workers[i].thread, NULL);
+        histogram_add(&rtt, &loadgen_workers[i].rtt);
+        moves += loadgen_workers[i].moves;
+        aborted += loadgen_workers[i].aborted;
+        close(loadgen_workers[i].epoll_fd);
+        free(loadgen_workers[i].clients);
+    }
+    elapsed = clock_now() - start;
+    done = loadgen_done / 2;
+
+    printf("%d client su %s: %lu partite in %.2f s (%.1f partite/s), %lu mosse (%.0f mosse/s), %lu interrotte\n",
+           clients, loadgen_address, done, elapsed, done / elapsed, moves, moves / elapsed, aborted);
+    if(rtt.total > 0)
+        printf("Andata e ritorno mossa us: p50 %.1f p99 %.1f p999 %.1f max %.1f\n",
+               histogram_percentile(&rtt, 50) / 1e3, histogram_percentile(&rtt, 99) / 1e3,
+               histogram_percentile(&rtt, 99.9) / 1e3, rtt.max / 1e3);
+
+    tets_free(loadgen_tets);
+    return 0;
+}
@@ -0,0 +1,156 @@
+/**
+* @file main_net.c
+* @author Albert Alibeaj
+* @brief Programma xtetris-net: scrive una rete neurale per il computer (Net.h) e ne misura
+ * la latenza per mossa rispetto alla valutazione lineare.
+ *
+ * Uso: <code>xtetris-net [-o file] [-H unità] [-n file] [-g partite] [-s seme] [-t thread]</code>
+ *  - <code>-o</code> scrive una rete che riproduce la valutazione lineare con i pesi predefiniti,
+ *    con <code>-H</code> unità nascoste (predefinite 32)
+ *  - <code>-n</code> rete da misurare (predefinita quella scritta con <code>-o</code>)
+ *  - <code>-g</code> partite a due giocatori su cui misurare ogni mossa (predefinite 20)
+ *  - <code>-t</code> con più di un thread misura anche la ricerca con i pesi divisa tra i thread
+ *    (com_best_move_parallel)
+ *
+ * Per ogni posizione la mossa viene cercata sia con i pesi sia con la rete; vengono stampati
+ * i percentili della latenza di ciascuna e quante volte le mosse coincidono
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "Clock.h"
+#include "Histogram.h"
+#include "Net.h"
+#include "Sched.h"
+#include "State.h"
+
+histogram_t linear_hist;    /**< latenza per mossa della valutazione lineare, in nanosecondi */
+histogram_t net_hist;       /**< latenza per mossa della rete, in nanosecondi */
+histogram_t split_hist;     /**< latenza per mossa della ricerca divisa tra i thread, in nanosecondi */
+
+/**
+* Stampa i percentili di una latenza
+ * @param name nome della valutazione
+ * @param h latenze registrate
+*/
+void print_latency(const char* name, const histogram_t* h)
+{
+    printf("%-8s mediana %6.1f us, 99%% %6.1f us, 99,9%% %6.1f us, massimo %6.1f us\n", name,
+           histogram_percentile(h, 50) / 1e3, histogram_percentile(h, 99) / 1e3,
+           histogram_percentile(h, 99.9) / 1e3, h->max / 1e3);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* output = NULL;
+    const char* input = NULL;
+    com_weights_t weights = com_default_weights();
+    tet_t tets[TET_TYPES];
+    net_t net;
+    unsigned long games = 20, seed = 1, g, moves = 0, same = 0, split_same = 0;
+    int hidden = 32, threads = 1, opt;
+
+    while((opt = getopt(argc, argv, "o:H:n:g:s:t:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'o': output = optarg; break;
+            case 'H': hidden = atoi(optarg); break;
+            case 'n': input = optarg; break;
+            case 'g': games = strtoul(optarg, NULL, 10); break;
+            case 's': seed = strtoul(optarg, NULL, 10); break;
+            case 't': threads = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Uso: %s [-o file] [-H unità] [-n file] [-g partite] [-s seme] [-t thread]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if(output)
+    {
+        if(net_write_linear(output, &weights, hidden) != 0)
+        {
+            fprintf(stderr, "%s: impossibile scrivere %s (unità nascoste da %d a %d)\n",
+                    argv[0], output, COM_WEIGHTS, NET_MAX_WIDTH);
+            return 1;
+        }
+        printf("rete lineare con %d unità nascoste scritta in %s\n", hidden, output);
+        if(!input)
+            input = output;
+    }
+    if(!input)
+        return 0;
+
+    if(net_load(&net, input) != 0)
+    {
+        fprintf(stderr, "%s: %s non è una rete valida\n", argv[0], input);
+        return 1;
+    }
+    printf("rete %s: %d strati, primo strato %s\n", input, net.layers, net_backend());
+
+    tets_init(tets, 1);
+    histogram_clear(&linear_hist);
+    histogram_clear(&net_hist);
+    histogram_clear(&split_hist);
+    if(threads > 1)
+        sched_start(threads);
+
+    for(g = 0; g < games; g++)
+    {
+        game_state_t state;
+        int player = 0;
+
+        state_init(&state, 2, seed + g);
+        for(;;)
+        {
+            placement_t by_weights, by_net, by_split;
+            state_undo_t undo;
+            double start;
+
+            state_to_tets(&state, tets);
+
+            com_use_net(NULL);
+            start = clock_now();
+            if(com_best_move(state.fields[player], tets, &weights, &by_weights) == COM_LOST)
+                break;
+            histogram_record(&linear_hist, (unsigned long)((clock_now() - start) * 1e9));
+
+            com_use_net(&net);
+            start = clock_now();
+            com_best_move(state.fields[player], tets, &weights, &by_net);
+            histogram_record(&net_hist, (unsigned long)((clock_now() - start) * 1e9));
+
+            com_use_net(NULL);
+            if(threads > 1)
+            {
+                start = clock_now();
+                com_best_move_parallel(state.fields[player], tets, &weights, &by_split);
+                histogram_record(&split_hist, (unsigned long)((clock_now() - start) * 1e9));
+                split_same += by_weights.id == by_split.id && by_weights.rot == by_split.rot && by_weights.col == by_split.col;
+            }
+
+            moves++;
+            same += by_weights.id == by_net.id && by_weights.rot == by_net.rot && by_weights.col == by_net.col;
+
+            if(state_make(&state, tets, player, by_weights, &undo) < 0)
+                break;
+            player = 1 - player;
+        }
+    }
+
+    sched_stop();
+    printf("%lu mosse, uguali con i pesi e con la rete: %lu (%.2f%%)\n",
+           moves, same, moves ? 100.0 * same / moves : 0.0);
+    print_latency("pesi", &linear_hist);
+    print_latency("rete", &net_hist);
+    if(threads > 1)
+    {
+        printf("divisa su %d thread, uguali con i pesi: %lu\n", threads, split_same);
+        print_latency("divisa", &split_hist);
+    }
+
+    tets_free(tets);
+    net_free(&net);
+    return 0;
+}
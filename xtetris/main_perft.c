@@ -0,0 +1,336 @@
+/**
+* @file main_perft.c
+* @author Albert Alibeaj
+* @brief Programma xtetris-perft: conta tutte le posizioni raggiungibili
+ * da un campo fino a una profondità N e misura le posizioni al secondo,
+ * prima su un solo thread e poi su tutti i core.
+ *
+ * Uso: <code>xtetris-perft [-d profondità] [-t thread] [-q quantità] [-f campo] [-H megabyte] [-v] [-b]</code>
+ *  - <code>-q</code> accetta un numero (uguale per tutti i tetramini) o sette numeri separati da virgole
+ *  - <code>-f</code> legge il campo da un file di testo: una riga per riga del campo, allineate in basso,
+ *    dove '.' o ' ' è una cella vuota e qualsiasi altro carattere è una cella piena
+ *  - <code>-H</code> usa una tabella delle posizioni già contate (per thread), in cui
+ *    le posizioni speculari occupano lo stesso elemento; ogni elemento conserva la posizione
+ *    completa, quindi una collisione dell'hash non può restituire il conteggio di un'altra posizione
+ *  - <code>-v</code> stampa il conteggio per ogni mossa iniziale
+ *  - <code>-b</code> misura il costo di una copia completa dello stato di gioco,
+ *    di una mossa applicata e annullata con state_make/state_unmake
+ *    e la velocità di codifica e decodifica delle posizioni compatte (Pack.h)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Clock.h"
+#include "Features.h"
+#include "Pack.h"
+#include "Perft.h"
+#include "Placements.h"
+#include "Sched.h"
+#include "State.h"
+
+/** Ripetizioni della misura del costo degli snapshot */
+#define SNAPSHOT_REPS 2000000
+
+/** Posizioni di ogni blocco codificato e decodificato dalla misura di Pack */
+#define PACK_BATCH 4096
+/** Blocchi codificati e decodificati dalla misura di Pack */
+#define PACK_REPS 2000
+
+game_state_t snapshots[16];     /**< copie dello stato usate dalla misura (globali per non essere eliminate dal compilatore) */
+
+/**
+* Legge le quantità dei tetramini dalla riga di comando
+ * @param arg argomento di -q
+ * @param tets tetramini di cui impostare la quantità
+ * @return 1 se l'argomento è valido, 0 altrimenti
+*/
+int parse_quantities(const char* arg, tet_t tets[TET_TYPES])
+{
+    int q[TET_TYPES];
+    int i, n;
+
+    n = sscanf(arg, "%d,%d,%d,%d,%d,%d,%d", &q[0], &q[1], &q[2], &q[3], &q[4], &q[5], &q[6]);
+    if(n == 1)
+        for(i = 1; i < TET_TYPES; i++)
+            q[i] = q[0];
+    else if(n != TET_TYPES)
+        return 0;
+
+    for(i = 0; i < TET_TYPES; i++)
+        tets[i].quantity = q[i];
+    return 1;
+}
+
+/**
+* Legge il campo di partenza da un file di testo
+ * @param path percorso del file
+ * @param field campo da riempire
+ * @return 1 se il file è stato letto, 0 altrimenti
+*/
+int read_field(const char* path, int field[FIELD_ROWS][FIELD_COLS])
+{
+    char lines[FIELD_ROWS][FIELD_COLS + 2];
+    char buffer[256];
+    int count = 0, i, j;
+    FILE* in = fopen(path, "r");
+
+    if(!in)
+        return 0;
+
+    /* Si tengono solo le ultime FIELD_ROWS righe del file */
+    while(fgets(buffer, sizeof(buffer), in))
+    {
+        if(count == FIELD_ROWS)
+        {
+            for(i = 1; i < FIELD_ROWS; i++)
+                strcpy(lines[i - 1], lines[i]);
+            count--;
+        }
+        sprintf(lines[count], "%.*s", FIELD_COLS, buffer);
+        count++;
+    }
+    fclose(in);
+
+    field_init(field);
+    for(i = 0; i < count; i++)
+    {
+        int row = FIELD_ROWS - count + i;
+        for(j = 0; j < FIELD_COLS && lines[i][j] && lines[i][j] != '\n'; j++)
+        {
+            char c = lines[i][j];
+            if(c != '.' && c != ' ')
+                field[row][j] = (c >= '1' && c <= '9') ? c - '0' : TET_TYPES + 2;
+        }
+    }
+    return 1;
+}
+
+/**
+* Misura il costo di copia e ripristino dello stato e di una mossa applicata e annullata
+ * @param field campo da usare per il giocatore 1
+ * @param tets tetramini con le quantità da usare
+*/
+void snapshot_bench(int field[FIELD_ROWS][FIELD_COLS], tet_t tets[TET_TYPES])
+{
+    game_state_t state;
+    state_undo_t undo;
+    placements_t moves;
+    double start, copy_time, make_time;
+    int i;
+
+    state_init(&state, 2, 1);
+    memcpy(state.fields[0], field, sizeof(state.fields[0]));
+    for(i = 0; i < TET_TYPES; i++)
+        state.quantities[i] = tets[i].quantity;
+    placements_gen(tets, &moves);
+    if(moves.count == 0)
+        return;
+
+    start = clock_now();
+    for(i = 0; i < SNAPSHOT_REPS; i++)
+    {
+        snapshots[i & 15] = state;
+        state = snapshots[(i + 8) & 15];
+    }
+    copy_time = clock_now() - start;
+
+    start = clock_now();
+    for(i = 0; i < SNAPSHOT_REPS; i++)
+    {
+        state_make(&state, tets, 0, moves.moves[i % moves.count], &undo);
+        state_unmake(&state, &undo);
+    }
+    make_time = clock_now() - start;
+
+    printf("snapshot completo (%lu byte): %.1f ns per copia + ripristino\n",
+           (unsigned long)sizeof(game_state_t), copy_time / SNAPSHOT_REPS * 1e9);
+    printf("state_make + state_unmake (%lu byte salvati al massimo): %.1f ns per mossa\n",
+           (unsigned long)sizeof(state_undo_t), make_time / SNAPSHOT_REPS * 1e9);
+}
+
+/**
+* Misura la velocità di codifica e decodifica di posizioni prese da partite casuali
+ * e controlla che la decodifica restituisca le stesse posizioni
+ * @param tets tetramini da usare
+*/
+void pack_bench(tet_t tets[TET_TYPES])
+{
+    pack_position_t* positions = (pack_position_t*)malloc(sizeof(pack_position_t) * PACK_BATCH);
+    pack_position_t* decoded = (pack_position_t*)malloc(sizeof(pack_position_t) * PACK_BATCH);
+    unsigned char* packed = (unsigned char*)malloc((size_t)PACK_MAX_LEN * PACK_BATCH);
+    game_state_t state;
+    placements_t moves;
+    double start, encode_time, decode_time;
+    size_t bytes = 0, colour_bytes;
+    int quantities[TET_TYPES];
+    int i, errors = 0;
+
+    for(i = 0; i < TET_TYPES; i++)
+        quantities[i] = tets[i].quantity;
+
+    /* Posizioni realistiche: partite a due giocatori con mosse casuali, ricominciate quando finiscono */
+    state_init(&state, 2, 1);
+    for(i = 0; i < PACK_BATCH; i++)
+    {
+        state_undo_t undo;
+        state_to_tets(&state, tets);
+        placements_gen(tets, &moves);
+        if(moves.count == 0 || state_make(&state, tets, i & 1, moves.moves[state_rand(&state) % moves.count], &undo) < 0)
+            state_init(&state, 2, (unsigned long)i + 1);
+        pack_from_state(&state, i & 1, &positions[i]);
+    }
+
+    start = clock_now();
+    for(i = 0; i < PACK_REPS; i++)
+        bytes = pack_encode(positions, PACK_BATCH, 0, packed);
+    encode_time = clock_now() - start;
+
+    start = clock_now();
+    for(i = 0; i < PACK_REPS; i++)
+        pack_decode(packed, PACK_BATCH, 0, decoded);
+    decode_time = clock_now() - start;
+
+    for(i = 0; i < PACK_BATCH; i++)
+        if(memcmp(positions[i].rows, decoded[i].rows, sizeof(positions[i].rows)) != 0 ||
+           memcmp(positions[i].quantities, decoded[i].quantities, sizeof(positions[i].quantities)) != 0 ||
+           memcmp(positions[i].scores, decoded[i].scores, sizeof(positions[i].scores)) != 0)
+            errors++;
+
+    colour_bytes = pack_encode(positions, PACK_BATCH, 1, packed);
+    pack_decode(packed, PACK_BATCH, 1, decoded);
+    for(i = 0; i < PACK_BATCH; i++)
+        if(memcmp(positions[i].colours, decoded[i].colours, sizeof(positions[i].colours)) != 0)
+            errors++;
+
+    printf("posizioni compatte: %lu byte (%lu con i colori, in media) invece di %lu\n",
+           (unsigned long)(bytes / PACK_BATCH), (unsigned long)(colour_bytes / PACK_BATCH),
+           (unsigned long)sizeof(int[FIELD_ROWS][FIELD_COLS]));
+    printf("codifica %.1f M posizioni/s, decodifica %.1f M posizioni/s, %d errori\n",
+           (double)PACK_REPS * PACK_BATCH / encode_time / 1e6,
+           (double)PACK_REPS * PACK_BATCH / decode_time / 1e6, errors);
+
+    for(i = 0; i < TET_TYPES; i++)
+        tets[i].quantity = quantities[i];
+    free(positions);
+    free(decoded);
+    free(packed);
+}
+
+/**
+* Stampa una riga di risultati
+ * @param label nome della misura
+ * @param stats contatori
+ * @param seconds tempo impiegato
+*/
+void print_stats(const char* label, const perft_stats_t* stats, double seconds)
+{
+    printf("%-10s posizioni %12lu  perse %10lu  con righe %10lu  %8.3f s  %10.0f pos/s\n",
+           label, stats->nodes, stats->lost, stats->cleared, seconds,
+           seconds > 0 ? stats->nodes / seconds : 0.0);
+}
+
+/**
+* Programma principale di xtetris-perft
+ * @param argc numero di argomenti
+ * @param argv argomenti
+ * @return 0 se i conteggi su uno e più thread coincidono, 1 altrimenti
+*/
+int main(int argc, char* argv[])
+{
+    int field[FIELD_ROWS][FIELD_COLS];
+    tet_t tets[TET_TYPES];
+    int depth = 3, threads = (int)sysconf(_SC_NPROCESSORS_ONLN), divide = 0, bench = 0;
+    unsigned long table_bytes = 0, hits;
+    perft_stats_t single, parallel;
+    double start, single_time, parallel_time;
+    int opt, i;
+
+    field_init(field);
+    tets_init(tets, 0);
+
+    while((opt = getopt(argc, argv, "d:t:q:f:H:vb")) != -1)
+    {
+        switch(opt)
+        {
+            case 'd': depth = atoi(optarg); break;
+            case 't': threads = atoi(optarg); break;
+            case 'q':
+                if(!parse_quantities(optarg, tets))
+                {
+                    fprintf(stderr, "Quantità non valide: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'f':
+                if(!read_field(optarg, field))
+                {
+                    fprintf(stderr, "Impossibile leggere il campo: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'H': table_bytes = strtoul(optarg, NULL, 10) << 20; break;
+            case 'v': divide = 1; break;
+            case 'b': bench = 1; break;
+            default:
+                fprintf(stderr, "Uso: %s [-d profondità] [-t thread] [-q quantità] [-f campo] [-H megabyte] [-v] [-b]\n", argv[0]);
+                return 1;
+        }
+    }
+    if(threads < 1)
+        threads = 1;
+
+    printf("profondità %d, quantità", depth);
+    for(i = 0; i < TET_TYPES; i++)
+        printf(" %d", tets[i].quantity);
+    printf(", caratteristiche %s\n", features_backend());
+
+    if(bench)
+    {
+        snapshot_bench(field, tets);
+        pack_bench(tets);
+    }
+
+    if(divide && depth > 0)
+    {
+        placements_t moves;
+        placements_gen(tets, &moves);
+        for(i = 0; i < moves.count; i++)
+        {
+            perft_stats_t sub;
+            perft_stats_clear(&sub);
+            perft_move(field, tets, moves.moves[i], depth, NULL, &sub);
+            printf("tet %d rot %d col %d: %lu\n", moves.moves[i].id, moves.moves[i].rot, moves.moves[i].col, sub.nodes);
+        }
+    }
+
+    perft_stats_clear(&single);
+    start = clock_now();
+    perft(field, tets, depth, &single);
+    single_time = clock_now() - start;
+    print_stats("1 thread", &single, single_time);
+
+    perft_stats_clear(&parallel);
+    start = clock_now();
+    sched_start(threads);
+    hits = perft_parallel(field, tets, depth, table_bytes, &parallel);
+    parallel_time = clock_now() - start;
+    {
+        char label[32];
+        sprintf(label, "%d thread", threads);
+        print_stats(label, &parallel, parallel_time);
+    }
+    if(table_bytes)
+        printf("sottoalberi ritrovati nella tabella: %lu\n", hits);
+
+    sched_stop();
+    tets_free(tets);
+
+    if(single.nodes != parallel.nodes || single.lost != parallel.lost || single.cleared != parallel.cleared)
+    {
+        fprintf(stderr, "ERRORE: i conteggi su uno e più thread non coincidono\n");
+        return 1;
+    }
+    return 0;
+}
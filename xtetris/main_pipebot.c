@@ -0,0 +1,142 @@
+/**
+* @file main_pipebot.c
+* @author Albert Alibeaj
+* @brief Programma xtetris-pipebot: bot esterno di esempio per il protocollo di PipeBot.h.
+ * Legge le posizioni dallo standard input e risponde con la mossa del computer, cercata con
+ * i pesi predefiniti o con quelli di un file.
+ *
+ * Uso: <code>xtetris-pipebot [-w pesi] [-f]</code>, di solito tramite la strategia
+ * <code>exec:./xtetris-pipebot</code> di <code>xtetris-tournament</code> o la variabile XTETRIS_BOT del gioco.
+ * Con <code>-f</code> risponde con la prima mossa possibile, senza ricerca: serve a misurare solo
+ * il costo del trasporto. Le risposte vengono scritte appena la posizione è stata letta, senza attendere le richieste successive
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "PipeBot.h"
+#include "Ring.h"
+#include "Com.h"
+
+int first_move = 0;     /**< 1 se si risponde con la prima mossa possibile (-f) */
+
+/**
+* Sceglie la mossa di una posizione
+ * @param state posizione
+ * @param player indice del giocatore che muove
+ * @param tets tetramini, a cui vengono assegnate le quantità della posizione
+ * @param weights pesi della ricerca
+ * @param move mossa scelta
+*/
+void choose(game_state_t* state, int player, tet_t tets[TET_TYPES], const com_weights_t* weights, placement_t* move)
+{
+    placements_t legal;
+
+    state_to_tets(state, tets);
+    if(!first_move)
+        com_best_move(state->fields[player], tets, weights, move);
+    else if(placements_gen(tets, &legal) > 0)
+        *move = legal.moves[0];
+}
+
+/**
+* Legge i campi di una riga position
+ * @param line riga ricevuta
+ * @param state stato da riempire
+ * @param id ID della richiesta
+ * @param player indice del giocatore che muove
+ * @return 0 se la riga è valida, -1 altrimenti
+*/
+int read_position(const char* line, game_state_t* state, unsigned long* id, int* player)
+{
+    int used, i, p, r, c;
+
+    memset(state, 0, sizeof(*state));
+    if(sscanf(line, "position %lu %d %d %d %d%n", id, player, &state->moves,
+              &state->scores[0], &state->scores[1], &used) != 5)
+        return -1;
+    line += used;
+
+    for(i = 0; i < TET_TYPES; i++)
+    {
+        if(sscanf(line, "%d%n", &state->quantities[i], &used) != 1)
+            return -1;
+        line += used;
+    }
+
+    for(p = 0; p < STATE_PLAYERS; p++)
+    {
+        while(*line == ' ')
+            line++;
+        for(r = 0; r < FIELD_ROWS; r++)
+            for(c = 0; c < FIELD_COLS; c++, line++)
+            {
+                if(*line != '0' && *line != '1')
+                    return -1;
+                state->fields[p][r][c] = *line == '1';
+            }
+    }
+
+    state->players = STATE_PLAYERS;
+    return *player >= 0 && *player < STATE_PLAYERS ? 0 : -1;
+}
+
+int main(int argc, char* argv[])
+{
+    com_weights_t weights = com_default_weights();
+    char line[PIPEBOT_LINE];
+    tet_t tets[TET_TYPES];
+    ring_t ring;
+    int opt;
+
+    while((opt = getopt(argc, argv, "w:f")) != -1)
+    {
+        if(opt == 'w' && com_weights_load(optarg, &weights) == 0)
+            continue;
+        if(opt == 'f')
+        {
+            first_move = 1;
+            continue;
+        }
+        fprintf(stderr, "Uso: %s [-w pesi] [-f]\n", argv[0]);
+        return 2;
+    }
+
+    tets_init(tets, 1);
+    if(ring_attach(&ring) == 0)
+    {
+        game_state_t state;
+        placement_t move;
+        unsigned int id;
+        int player;
+
+        while(ring_next(&ring, &id, &player, &state) == 0)
+        {
+            choose(&state, player, tets, &weights, &move);
+            ring_reply(&ring, id, move);
+        }
+        tets_free(tets);
+        return 0;
+    }
+
+    while(fgets(line, sizeof(line), stdin))
+    {
+        game_state_t state;
+        placement_t move;
+        unsigned long id;
+        int player;
+
+        if(strncmp(line, "quit", 4) == 0)
+            break;
+        if(read_position(line, &state, &id, &player) != 0)
+            continue;
+
+        choose(&state, player, tets, &weights, &move);
+        printf("%lu %d %d %d\n", id, move.id, move.rot, move.col);
+        fflush(stdout);
+    }
+
+    tets_free(tets);
+    return 0;
+}
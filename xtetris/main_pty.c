@@ -0,0 +1,391 @@
+/**
+* @file main_pty.c
+* @author Albert Alibeaj
+* @brief Programma xtetris-pty: avvia il gioco in un terminale virtuale (pty), gli invia
+ * una sequenza di tasti e misura per ogni tasto dopo quanto arriva la risposta,
+ * dopo quanto la schermata smette di cambiare e quanti byte vengono scritti.
+ *
+ * Uso: <code>xtetris-pty [-x gioco] [-r tasti_al_secondo] [-q ms_quiete] [-w ms_massimi] [-T terminale] [-f file] [-v] [tasti...]</code>
+ *  - i tasti sono parole separate da spazi (sulla riga di comando o nel file di -f):
+ *    <code>up down left right enter bs</code>, un singolo carattere (es. <code>h</code>),
+ *    <code>menu=single|multi|com|exit</code> per scegliere una voce del menu iniziale
+ *    e <code>wait=ms</code> per una pausa. <code>parola*N</code> ripete il tasto N volte
+ *  - <code>-r</code> limita la frequenza dei tasti; senza, ogni tasto parte appena la schermata è ferma
+ *  - <code>-q</code> millisecondi senza output dopo i quali la schermata è considerata ferma (predefinito 30)
+ *  - <code>-w</code> attesa massima della risposta a un tasto (predefinito 2000)
+ *  - <code>-T</code> terminale simulato (predefinito vt100, in cui Backspace arriva al gioco come 127)
+ *  - <code>-v</code> stampa una riga per ogni tasto
+ *
+ * Esempio: <code>xtetris-pty -x ./xtetris menu=single enter enter right*3 enter bs bs enter menu=exit</code>
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <pty.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <curses.h>
+#include <term.h>
+#include "Clock.h"
+#include "Histogram.h"
+
+/** Numero massimo di tasti in uno script */
+#define PTY_MAX_KEYS 4096
+/** Lunghezza massima della sequenza di byte di un tasto */
+#define PTY_KEY_LEN 16
+/** Righe del terminale simulato */
+#define PTY_ROWS 40
+/** Colonne del terminale simulato */
+#define PTY_COLS 120
+
+/** Tipo pty_key_t
+*   Tasto da inviare al gioco, o pausa
+*/
+typedef struct PtyKey
+{
+    char name[PTY_KEY_LEN];     /**< nome del tasto nello script */
+    char bytes[PTY_KEY_LEN];    /**< byte da scrivere sul terminale */
+    int len;                    /**< numero di byte (0 per una pausa) */
+    int wait_ms;                /**< durata della pausa */
+
+} pty_key_t;
+
+pty_key_t script[PTY_MAX_KEYS];     /**< tasti da inviare */
+int script_len = 0;                 /**< tasti nello script */
+
+/**
+* Sequenza inviata dal terminale per un tasto speciale, letta da terminfo
+ * @param cap nome della capacità terminfo (es. kcuu1)
+ * @param fallback sequenza da usare se il terminale non la definisce
+ * @param out sequenza da riempire
+*/
+void key_sequence(const char* cap, const char* fallback, char out[PTY_KEY_LEN])
+{
+    char* seq = tigetstr((char*)cap);
+
+    if(!seq || seq == (char*)-1)
+        seq = (char*)fallback;
+    sprintf(out, "%.*s", PTY_KEY_LEN - 1, seq);
+}
+
+/**
+* Aggiunge un tasto (o una pausa) allo script
+ * @param name nome del tasto nello script
+ * @param bytes byte da inviare (NULL per una pausa)
+ * @param wait_ms durata della pausa
+ * @return 1 se c'era spazio, 0 altrimenti
+*/
+int script_add(const char* name, const char* bytes, int wait_ms)
+{
+    pty_key_t* k;
+
+    if(script_len == PTY_MAX_KEYS)
+        return 0;
+
+    k = &script[script_len++];
+    sprintf(k->name, "%.*s", PTY_KEY_LEN - 1, name);
+    k->len = 0;
+    k->wait_ms = wait_ms;
+    if(bytes)
+    {
+        sprintf(k->bytes, "%.*s", PTY_KEY_LEN - 1, bytes);
+        k->len = strlen(k->bytes);
+    }
+    return 1;
+}
+
+/**
+* Interpreta una parola dello script
+ * @param word parola da interpretare
+ * @return 1 se la parola è valida, 0 altrimenti
+*/
+int script_word(const char* word)
+{
+    const char* menu_items[] = {"single", "multi", "com", "exit"};
+    char name[PTY_KEY_LEN];
+    char seq[PTY_KEY_LEN];
+    const char* star = strchr(word, '*');
+    int repeat = star ? atoi(star + 1) : 1;
+    int len = star ? (int)(star - word) : (int)strlen(word);
+    int i, r;
+
+    if(len <= 0 || len >= PTY_KEY_LEN || repeat < 1)
+        return 0;
+    memcpy(name, word, len);
+    name[len] = '\0';
+
+    for(r = 0; r < repeat; r++)
+    {
+        int ok = 1;
+
+        if(!strcmp(name, "up"))
+            key_sequence("kcuu1", "\033[A", seq);
+        else if(!strcmp(name, "down"))
+            key_sequence("kcud1", "\033[B", seq);
+        else if(!strcmp(name, "left"))
+            key_sequence("kcub1", "\033[D", seq);
+        else if(!strcmp(name, "right"))
+            key_sequence("kcuf1", "\033[C", seq);
+        else if(!strcmp(name, "enter"))
+            strcpy(seq, "\n");
+        else if(!strcmp(name, "bs"))
+            strcpy(seq, "\177");
+        else if(!strncmp(name, "wait=", 5))
+        {
+            if(!script_add(name, NULL, atoi(name + 5)))
+                return 0;
+            continue;
+        }
+        else if(!strncmp(name, "menu=", 5))
+        {
+            /* Il menu parte sempre dalla prima voce */
+            for(i = 0; i < 4 && strcmp(name + 5, menu_items[i]); i++);
+            if(i == 4)
+                return 0;
+            key_sequence("kcud1", "\033[B", seq);
+            while(i-- > 0 && ok)
+                ok = script_add("down", seq, 0);
+            ok = ok && script_add(name, "\n", 0);
+            if(!ok)
+                return 0;
+            continue;
+        }
+        else if(len == 1)
+            strcpy(seq, name);
+        else
+            return 0;
+
+        if(!ok || !script_add(name, seq, 0))
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+* Legge lo script da un file di testo
+ * @param path percorso del file
+ * @return 1 se il file è valido, 0 altrimenti
+*/
+int script_file(const char* path)
+{
+    char word[64];
+    FILE* in = fopen(path, "r");
+    int ok = 1;
+
+    if(!in)
+        return 0;
+    while(ok && fscanf(in, "%63s", word) == 1)
+        ok = script_word(word);
+    fclose(in);
+
+    return ok;
+}
+
+/**
+* Legge l'output del gioco finchè non resta fermo per quiet_ms o passano max_ms
+ * @param fd lato master del terminale virtuale
+ * @param start istante da cui misurare
+ * @param quiet_ms millisecondi senza output che indicano una schermata ferma
+ * @param max_ms attesa massima
+ * @param first istante del primo byte ricevuto (0 se nessuno)
+ * @param last istante dell'ultimo byte ricevuto (0 se nessuno)
+ * @return byte ricevuti, o -1 se il gioco ha chiuso il terminale
+*/
+long drain_output(int fd, double start, int quiet_ms, int max_ms, double* first, double* last)
+{
+    char buffer[65536];
+    long bytes = 0;
+
+    *first = *last = 0;
+    for(;;)
+    {
+        struct pollfd p;
+        double now = clock_now();
+        double deadline = *last > 0 ? *last + quiet_ms / 1000.0 : start + max_ms / 1000.0;
+        int timeout_ms, n;
+
+        if(deadline > start + max_ms / 1000.0)
+            deadline = start + max_ms / 1000.0;
+        if(now >= deadline)
+            return bytes;
+        timeout_ms = (int)((deadline - now) * 1000) + 1;
+
+        p.fd = fd;
+        p.events = POLLIN;
+        if(poll(&p, 1, timeout_ms) <= 0)
+            continue;
+
+        n = read(fd, buffer, sizeof(buffer));
+        if(n <= 0)
+            return bytes > 0 ? bytes : -1;
+
+        now = clock_now();
+        if(*first == 0)
+            *first = now;
+        *last = now;
+        bytes += n;
+    }
+}
+
+/**
+* Stampa i percentili di un istogramma in millisecondi
+ * @param label nome della misura
+ * @param h istogramma in microsecondi
+*/
+void print_histogram(const char* label, const histogram_t* h)
+{
+    printf("%-10s p50 %8.2f ms  p99 %8.2f ms  p999 %8.2f ms  max %8.2f ms\n", label,
+           histogram_percentile(h, 50) / 1000.0, histogram_percentile(h, 99) / 1000.0,
+           histogram_percentile(h, 99.9) / 1000.0, h->max / 1000.0);
+}
+
+/**
+* Programma principale: avvia il gioco, invia lo script e stampa le misure
+ * @param argc numero di argomenti
+ * @param argv argomenti
+ * @return 0 se tutti i tasti hanno avuto risposta, 1 altrimenti
+*/
+int main(int argc, char* argv[])
+{
+    const char* game = "./xtetris";
+    const char* term = "vt100";
+    const char* path = NULL;
+    double rate = 0, quiet_ms = 30, max_ms = 2000, first, last, start;
+    int verbose = 0, opt, master, status, i, err;
+    unsigned long silent = 0, max_bytes = 0, total_bytes = 0, sent = 0, keys = 0;
+    histogram_t response, settle;
+    struct winsize size;
+    pid_t pid;
+
+    while((opt = getopt(argc, argv, "x:r:q:w:T:f:v")) != -1)
+    {
+        switch(opt)
+        {
+            case 'x': game = optarg; break;
+            case 'r': rate = atof(optarg); break;
+            case 'q': quiet_ms = atof(optarg); break;
+            case 'w': max_ms = atof(optarg); break;
+            case 'T': term = optarg; break;
+            case 'f': path = optarg; break;
+            case 'v': verbose = 1; break;
+            default:
+                fprintf(stderr, "Uso: %s [-x gioco] [-r tasti_al_secondo] [-q ms_quiete] [-w ms_massimi] [-T terminale] [-f file] [-v] [tasti...]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if(setupterm((char*)term, 1, &err) != OK)
+    {
+        fprintf(stderr, "Terminale sconosciuto: %s\n", term);
+        return 1;
+    }
+    if(path && !script_file(path))
+    {
+        fprintf(stderr, "Script non valido: %s\n", path);
+        return 1;
+    }
+    for(i = optind; i < argc; i++)
+    {
+        if(!script_word(argv[i]))
+        {
+            fprintf(stderr, "Tasto non valido: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    memset(&size, 0, sizeof(size));
+    size.ws_row = PTY_ROWS;
+    size.ws_col = PTY_COLS;
+
+    pid = forkpty(&master, NULL, NULL, &size);
+    if(pid < 0)
+    {
+        perror("forkpty");
+        return 1;
+    }
+    if(pid == 0)
+    {
+        setenv("TERM", term, 1);
+        execl(game, game, (char*)NULL);
+        perror(game);
+        _exit(127);
+    }
+
+    /* Schermata iniziale */
+    drain_output(master, clock_now(), (int)quiet_ms, 5000, &first, &last);
+
+    histogram_clear(&response);
+    histogram_clear(&settle);
+    for(i = 0; i < script_len; i++)
+        keys += script[i].len > 0;
+
+    for(i = 0; i < script_len; i++)
+    {
+        const pty_key_t* k = &script[i];
+        long bytes;
+
+        if(!k->len)
+        {
+            drain_output(master, clock_now(), k->wait_ms, k->wait_ms, &first, &last);
+            continue;
+        }
+
+        start = clock_now();
+        if(write(master, k->bytes, k->len) != k->len)
+            break;
+        sent++;
+
+        bytes = drain_output(master, start, (int)quiet_ms, (int)max_ms, &first, &last);
+        if(bytes < 0)
+        {
+            if(verbose)
+                printf("%4d %-12s il gioco è terminato\n", i, k->name);
+            break;
+        }
+
+        if(first > 0)
+        {
+            histogram_record(&response, (unsigned long)((first - start) * 1e6));
+            histogram_record(&settle, (unsigned long)((last - start) * 1e6));
+        }
+        else
+            silent++;
+
+        total_bytes += bytes;
+        if((unsigned long)bytes > max_bytes)
+            max_bytes = bytes;
+
+        if(verbose)
+            printf("%4d %-12s risposta %8.2f ms  ferma %8.2f ms  %6ld byte\n", i, k->name,
+                   first > 0 ? (first - start) * 1000 : 0, first > 0 ? (last - start) * 1000 : 0, bytes);
+
+        /* Frequenza dei tasti limitata: si attende il turno del tasto successivo */
+        if(rate > 0)
+        {
+            double next = start + 1.0 / rate;
+            while(clock_now() < next)
+                drain_output(master, clock_now(), (int)((next - clock_now()) * 1000) + 1,
+                             (int)((next - clock_now()) * 1000) + 1, &first, &last);
+        }
+    }
+
+    /* Se lo script non fa uscire dal gioco, lo si termina */
+    drain_output(master, clock_now(), 200, 1000, &first, &last);
+    if(waitpid(pid, &status, WNOHANG) == 0)
+    {
+        kill(pid, SIGTERM);
+        waitpid(pid, &status, 0);
+    }
+    close(master);
+
+    printf("tasti inviati %lu, senza risposta %lu, byte per tasto: media %.0f max %lu\n",
+           sent, silent, sent ? (double)total_bytes / sent : 0.0, max_bytes);
+    print_histogram("risposta", &response);
+    print_histogram("ferma", &settle);
+
+    return silent || sent < keys ? 1 : 0;
+}
@@ -0,0 +1,187 @@
+/**
+* @file main_results.c
+* @author Albert Alibeaj
+* @brief Programma xtetris-results: mostra la classifica di ogni modalità letta dall'archivio dei risultati.
+ *
+ * Uso: <code>xtetris-results [-f archivio] [-m modalità] [-n numero] [-g partite] [-b]</code>
+ *  - <code>-f</code> archivio da leggere (predefinito: XTETRIS_RESULTS o xtetris-results.db)
+ *  - <code>-m</code> mostra solo una modalità (0 singleplayer, 1 multiplayer, 2 contro il computer)
+ *  - <code>-n</code> lunghezza della classifica (predefinita 10)
+ *  - <code>-g</code> aggiunge all'archivio delle partite inventate e ricostruisce l'indice,
+ *    per provare la classifica su archivi molto grandi
+ *  - <code>-b</code> misura il tempo medio di lettura della classifica
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "Clock.h"
+#include "Results.h"
+
+/** Modalità di gioco salvate nell'archivio */
+#define MODES 3
+/** Partite inventate scritte con un solo results_append */
+#define GENERATE_BLOCK 65536
+/** Durata minima della misura di -b, in secondi */
+#define BENCH_SECONDS 0.5
+
+/** Nomi delle modalità, nell'ordine dei loro numeri */
+const char* mode_names[MODES] = {"singleplayer", "multiplayer", "contro il computer"};
+
+/**
+* Aggiunge all'archivio delle partite inventate
+ * @param db archivio aperto in scrittura
+ * @param n numero di partite
+ * @return 0 se le partite sono state aggiunte, -1 altrimenti
+*/
+int generate(results_db_t* db, unsigned long n)
+{
+    game_result_t* block = (game_result_t*)calloc(GENERATE_BLOCK, sizeof(game_result_t));
+    unsigned long done = 0;
+    int i, ok = 0;
+
+    while(done < n && ok == 0)
+    {
+        int len = n - done < GENERATE_BLOCK ? (int)(n - done) : GENERATE_BLOCK;
+        for(i = 0; i < len; i++)
+        {
+            game_result_t* r = &block[i];
+            r->mode = rand() % MODES;
+            r->score1 = rand() % 400;
+            r->score2 = r->mode ? rand() % 400 : 0;
+            r->winner = r->score1 >= r->score2 ? 1 : 2;
+            r->reason = 1;
+            r->moves = 20 + rand() % 100;
+            r->duration_ms = 1000u * (unsigned int)(30 + rand() % 600);
+            r->seed = (unsigned int)rand();
+            r->time = (unsigned int)time(NULL);
+        }
+        ok = results_append(db, block, (unsigned long)len);
+        done += len;
+    }
+    free(block);
+
+    return ok == 0 ? results_reindex(db) : ok;
+}
+
+/**
+* Stampa la classifica di una modalità
+ * @param db archivio aperto
+ * @param mode modalità
+ * @param n lunghezza della classifica
+*/
+void print_top(results_db_t* db, int mode, int n)
+{
+    game_result_t* top = (game_result_t*)malloc(sizeof(game_result_t) * n);
+    int found = results_top(db, mode, top, n), i;
+
+    printf("Classifica %s\n", mode_names[mode]);
+    if(!found)
+        printf("  nessuna partita\n");
+    for(i = 0; i < found; i++)
+    {
+        char date[32];
+        time_t t = (time_t)top[i].time;
+
+        strftime(date, sizeof(date), "%Y-%m-%d %H:%M", localtime(&t));
+        if(mode == 0)
+            printf("%3d. %5d punti  %4d mosse %6.1f s  %s  seme %u\n", i + 1, top[i].score1,
+                   top[i].moves, top[i].duration_ms / 1000.0, date, top[i].seed);
+        else
+            printf("%3d. %5d punti  (%d a %d, vince %d)  %4d mosse %6.1f s  %s  seme %u\n", i + 1,
+                   results_score(&top[i]), top[i].score1, top[i].score2, top[i].winner,
+                   top[i].moves, top[i].duration_ms / 1000.0, date, top[i].seed);
+    }
+    free(top);
+}
+
+/**
+* Misura il tempo medio di una lettura della classifica
+ * @param db archivio aperto
+ * @param mode modalità
+ * @param n lunghezza della classifica
+*/
+void bench_top(results_db_t* db, int mode, int n)
+{
+    game_result_t* top = (game_result_t*)malloc(sizeof(game_result_t) * n);
+    unsigned long reps = 0;
+    double start = clock_now(), elapsed;
+
+    do
+    {
+        int i;
+        for(i = 0; i < 1000; i++)
+            results_top(db, mode, top, n);
+        reps += 1000;
+        elapsed = clock_now() - start;
+    }
+    while(elapsed < BENCH_SECONDS);
+
+    printf("Lettura dei primi %d (%s): %.2f us su %lu partite\n", n, mode_names[mode],
+           elapsed * 1e6 / reps, results_count(db));
+    free(top);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* path = getenv("XTETRIS_RESULTS");
+    results_db_t db;
+    unsigned long generated = 0;
+    int mode = -1, n = 10, bench = 0;
+    int opt, m;
+
+    if(!path || !*path)
+        path = RESULTS_DEFAULT_FILE;
+
+    while((opt = getopt(argc, argv, "f:m:n:g:b")) != -1)
+    {
+        switch(opt)
+        {
+            case 'f': path = optarg; break;
+            case 'm': mode = atoi(optarg); break;
+            case 'n': n = atoi(optarg); break;
+            case 'g': generated = strtoul(optarg, NULL, 10); break;
+            case 'b': bench = 1; break;
+            default:
+                fprintf(stderr, "Uso: %s [-f archivio] [-m modalità] [-n numero] [-g partite] [-b]\n", argv[0]);
+                return 2;
+        }
+    }
+    if(mode < -1 || mode >= MODES || n <= 0)
+    {
+        fprintf(stderr, "%s: modalità o lunghezza della classifica non valida\n", argv[0]);
+        return 2;
+    }
+
+    if(generated)
+    {
+        srand((unsigned int)time(NULL));
+        if(results_open(&db, path, 1) != 0 || generate(&db, generated) != 0)
+        {
+            fprintf(stderr, "%s: impossibile scrivere %s\n", argv[0], path);
+            return 1;
+        }
+        results_close(&db);
+    }
+
+    if(results_open(&db, path, 0) != 0)
+    {
+        fprintf(stderr, "%s: impossibile leggere %s\n", argv[0], path);
+        return 1;
+    }
+
+    printf("%lu partite in %s\n", results_count(&db), path);
+    for(m = 0; m < MODES; m++)
+    {
+        if(mode >= 0 && m != mode)
+            continue;
+        if(bench)
+            bench_top(&db, m, n);
+        else
+            print_top(&db, m, n);
+    }
+
+    results_close(&db);
+    return 0;
+}
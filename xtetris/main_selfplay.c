@@ -0,0 +1,187 @@
+/**
+* @file main_selfplay.c
+* @author Albert Alibeaj
+* @brief Programma xtetris-selfplay: fa giocare il computer contro sé stesso su più thread
+ * e salva ogni mossa (posizione, mosse possibili, mossa scelta, punti, esito finale)
+ * in un file a colonne compresso (vedi Export.h), oppure rilegge e controlla un file già scritto.
+ *
+ * Uso: <code>xtetris-selfplay [-g partite] [-t thread] [-p giocatori] [-e epsilon] [-s seme]
+ * [-z livello] [-c righe] [-q coda] [-o file] [-r file]</code>
+ *  - <code>-e</code> probabilità di una mossa casuale invece di quella del computer (predefinita 0.1)
+ *  - <code>-z</code> livello di compressione zlib (predefinito 1)
+ *  - <code>-c</code> righe di ogni blocco del file
+ *  - <code>-q</code> partite che possono restare in coda tra i simulatori e il thread di scrittura
+ *  - senza <code>-o</code> le partite vengono solo simulate, per confrontare la velocità
+ *  - <code>-r</code> rilegge un file, controlla ogni riga e ne stampa il riepilogo
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "Clock.h"
+#include "Export.h"
+#include "Sched.h"
+#include "Sim.h"
+
+tet_t sim_tets[TET_TYPES];          /**< tetramini condivisi dai simulatori (solo lettura) */
+com_weights_t sim_weights;          /**< pesi del computer */
+unsigned long sim_games;            /**< partite da giocare */
+unsigned long sim_seed;             /**< seme della prima partita */
+unsigned long sim_rows;             /**< mosse giocate da tutti i simulatori */
+int sim_players;                    /**< giocatori di ogni partita */
+double sim_epsilon;                 /**< probabilità di una mossa casuale */
+int sim_export;                     /**< 1 se le partite vanno esportate */
+
+/**
+* Compito di ogni partita, eseguito dai thread di Sched.h
+ * @param arg non usato
+ * @param id numero della partita
+*/
+void simulate(void* arg, int id)
+{
+    sim_game_t* game = (sim_game_t*)malloc(sizeof(sim_game_t));
+    (void)arg;
+
+    game->id = (unsigned long)id;
+    sim_play(game, sim_tets, sim_players, &sim_weights, sim_epsilon, sim_seed + id);
+    __atomic_fetch_add(&sim_rows, (unsigned long)game->count, __ATOMIC_RELAXED);
+
+    if(sim_export)
+        export_push(game);
+    else
+        free(game);
+}
+
+/**
+* Rilegge un file esportato e controlla che ogni riga sia coerente
+ * @param path file da leggere
+ * @return 0 se il file è valido, 1 altrimenti
+*/
+int verify(const char* path)
+{
+    FILE* in = fopen(path, "rb");
+    export_chunk_t chunk;
+    unsigned long rows = 0, chunks = 0, legal = 0, errors = 0, games = 0, last_game = 0;
+    long wins = 0, losses = 0;
+    int res;
+
+    if(!in || export_read_header(in) != 0)
+    {
+        fprintf(stderr, "%s non è un file esportato\n", path);
+        if(in) fclose(in);
+        return 1;
+    }
+
+    while((res = export_read_chunk(in, &chunk)) == 1)
+    {
+        unsigned long i, k;
+        for(i = 0; i < chunk.rows; i++)
+        {
+            int found = 0;
+            if(rows + i == 0 || chunk.game[i] != last_game)
+                games++;
+            last_game = chunk.game[i];
+
+            for(k = chunk.legal_start[i]; k < chunk.legal_start[i + 1]; k++)
+                found |= chunk.legal[k] == chunk.chosen[i];
+            if(!found || chunk.result[i] < -1 || chunk.result[i] > 1 || chunk.player[i] >= STATE_PLAYERS)
+                errors++;
+            wins += chunk.result[i] > 0;
+            losses += chunk.result[i] < 0;
+        }
+        rows += chunk.rows;
+        legal += chunk.legal_start[chunk.rows];
+        chunks++;
+        export_chunk_free(&chunk);
+    }
+    fclose(in);
+
+    printf("%lu blocchi, %lu partite, %lu mosse (%.1f possibili in media), esito per chi muove: %ld vinte %ld perse\n",
+           chunks, games, rows, rows ? (double)legal / rows : 0.0, wins, losses);
+    if(res < 0)
+        printf("file danneggiato dopo %lu blocchi\n", chunks);
+    printf("%lu righe non valide\n", errors);
+
+    return res < 0 || errors ? 1 : 0;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* output = NULL;
+    const char* input = NULL;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN), level = 1, queue = EXPORT_QUEUE;
+    unsigned long chunk_rows = EXPORT_CHUNK_ROWS;
+    export_stats_t stats;
+    double start, elapsed;
+    int opt;
+
+    sim_games = 100;
+    sim_players = 2;
+    sim_epsilon = 0.1;
+    sim_seed = 1;
+
+    while((opt = getopt(argc, argv, "g:t:p:e:s:z:c:q:o:r:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'g': sim_games = strtoul(optarg, NULL, 10); break;
+            case 't': threads = atoi(optarg); break;
+            case 'p': sim_players = atoi(optarg); break;
+            case 'e': sim_epsilon = atof(optarg); break;
+            case 's': sim_seed = strtoul(optarg, NULL, 10); break;
+            case 'z': level = atoi(optarg); break;
+            case 'c': chunk_rows = strtoul(optarg, NULL, 10); break;
+            case 'q': queue = atoi(optarg); break;
+            case 'o': output = optarg; break;
+            case 'r': input = optarg; break;
+            default:
+                fprintf(stderr, "Uso: %s [-g partite] [-t thread] [-p giocatori] [-e epsilon] [-s seme] "
+                                "[-z livello] [-c righe] [-q coda] [-o file] [-r file]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    if(input)
+        return verify(input);
+
+    if(threads < 1)
+        threads = 1;
+    tets_init(sim_tets, sim_players > 1);
+    sim_weights = com_default_weights();
+    sim_export = output != NULL;
+    if(sim_export && export_open(output, level, chunk_rows, queue) != 0)
+    {
+        fprintf(stderr, "%s: impossibile scrivere %s\n", argv[0], output);
+        return 1;
+    }
+
+    sched_start(threads);
+    start = clock_now();
+    sched_for(0, (int)sim_games, 1, simulate, NULL);
+    elapsed = clock_now() - start;
+    sched_stop();
+
+    printf("%lu partite, %lu mosse su %d thread in %.2f s: %.0f mosse/s\n",
+           sim_games, sim_rows, threads, elapsed, sim_rows / elapsed);
+
+    if(sim_export)
+    {
+        int failed = export_close(&stats);
+        double total = clock_now() - start;
+
+        printf("%lu blocchi, %.2f MB di colonne, %.2f MB scritti (%.1f byte per mossa, rapporto %.1f)\n",
+               stats.chunks, stats.raw_bytes / 1e6, stats.file_bytes / 1e6,
+               stats.rows ? stats.file_bytes / stats.rows : 0.0, stats.file_bytes ? stats.raw_bytes / stats.file_bytes : 0.0);
+        printf("scrittura: %.2f s di lavoro, %.2f s oltre la simulazione; simulatori in attesa della coda: %.3f s\n",
+               stats.writer_seconds, total - elapsed, stats.wait_seconds);
+        if(failed)
+        {
+            fprintf(stderr, "%s: errore durante la scrittura di %s\n", argv[0], output);
+            return 1;
+        }
+    }
+
+    tets_free(sim_tets);
+    return 0;
+}
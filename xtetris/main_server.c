@@ -0,0 +1,557 @@
+/**
+* @file main_server.c
+* @author Albert Alibeaj
+* @brief Programma xtetris-server: ospita molte partite in rete insieme, senza grafica, con il protocollo
+ * di Lan.h. I client si collegano come con <code>xtetris -c indirizzo</code> e vengono accoppiati
+ * nell'ordine di arrivo; il server arbitra ogni partita con Match.h e inoltra le mosse all'avversario.
+ *
+ * Uso: <code>xtetris-server [-l indirizzo] [-t thread] [-i secondi] [-d secondi]</code>
+ *  - <code>-l</code> indirizzo su cui ascoltare (predefinito <code>:7400</code>)
+ *  - <code>-t</code> thread che servono le partite, ognuno con il proprio epoll (predefiniti 2)
+ *  - <code>-i</code> secondi tra una riga di statistiche e la successiva (predefinito 1)
+ *  - <code>-d</code> secondi dopo cui il server si ferma (predefinito 0, fino a Ctrl-C)
+ *
+ * Ogni partita appartiene a un solo thread, che la fa avanzare una mossa alla volta quando arriva
+ * un messaggio: nessuna partita tiene occupato un thread in attesa di un giocatore, e i thread non
+ * condividono partite. Le mosse non valide o fuori turno chiudono la partita con LAN_BYE.
+ *
+ * Le statistiche riportano le partite concluse al secondo, le mosse al secondo, le partite in corso
+ * e la latenza di ogni mossa nel server (dalla lettura del messaggio all'invio all'avversario).
+ * Il carico si può generare con <code>xtetris-loadgen</code>
+*/
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include "Clock.h"
+#include "Histogram.h"
+#include "Lan.h"
+#include "Match.h"
+
+/** Thread predefiniti */
+#define SERVER_THREADS 2
+/** Thread massimi */
+#define SERVER_MAX_THREADS 64
+/** Eventi letti da ogni chiamata a epoll_wait */
+#define SERVER_EVENTS 256
+
+struct Game;
+
+/** Tipo conn_t
+*   Collegamento con un client
+*/
+typedef struct Conn
+{
+    int fd;                         /**< socket (-1 se chiuso) */
+    struct Game* game;              /**< partita del client */
+    int player;                     /**< indice del giocatore (0 o 1) */
+    int closing;                    /**< 1 se la partita è finita e si attende che il client chiuda */
+    unsigned int next_seq;          /**< numero della prossima mossa inoltrata al client */
+    unsigned char in[LAN_BUF];      /**< byte ricevuti non ancora elaborati */
+    int in_len;                     /**< byte validi in in */
+
+} conn_t;
+
+/** Tipo game_t
+*   Partita ospitata
+*/
+typedef struct Game
+{
+    match_t match;                  /**< stato della partita */
+    conn_t conns[STATE_PLAYERS];    /**< collegamenti dei giocatori */
+    int open;                       /**< collegamenti ancora aperti */
+    int counted;                    /**< 1 se la partita è già stata contata tra le concluse */
+
+} game_t;
+
+/** Tipo worker_t
+*   Thread che serve una parte delle partite
+*/
+typedef struct Worker
+{
+    pthread_t thread;               /**< thread */
+    int epoll_fd;                   /**< epoll dei socket delle partite del thread */
+    pthread_mutex_t lock;           /**< protegge latency, letto dal thread principale a ogni riga */
+    histogram_t latency;            /**< latenza delle mosse dall'ultima riga, in nanosecondi */
+    unsigned long matches;          /**< partite concluse (atomico) */
+    unsigned long moves;            /**< mosse inoltrate (atomico) */
+    unsigned long active;           /**< partite in corso (atomico) */
+
+} worker_t;
+
+worker_t workers[SERVER_MAX_THREADS];   /**< thread delle partite */
+int worker_count = SERVER_THREADS;      /**< numero di thread */
+tet_t server_tets[TET_TYPES];           /**< tetramini condivisi dai thread (solo lettura) */
+volatile sig_atomic_t server_stop;      /**< 1 quando il server deve fermarsi */
+
+/**
+* Gestore di SIGINT e SIGTERM: chiede ai thread di fermarsi
+ * @param sig segnale ricevuto
+*/
+void server_signal(int sig);
+
+/**
+* Corpo di un thread: attende i messaggi delle sue partite e le fa avanzare
+ * @param arg worker_t del thread
+ * @return NULL
+*/
+void* server_worker(void* arg);
+
+/**
+* Legge i byte disponibili di un client ed elabora i messaggi completi
+ * @param w thread della partita
+ * @param c collegamento pronto
+ * @param start istante in cui epoll ha segnalato il socket
+*/
+void server_read(worker_t* w, conn_t* c, double start);
+
+/**
+* Elabora un messaggio di un client
+ * @param w thread della partita
+ * @param c collegamento che lo ha inviato
+ * @param msg messaggio
+ * @param start istante in cui epoll ha segnalato il socket
+*/
+void server_handle(worker_t* w, conn_t* c, const lan_msg_t* msg, double start);
+
+/**
+* Invia un messaggio a un client. Il socket non blocca: un client che non legge viene chiuso
+ * @param c collegamento
+ * @param msg messaggio
+*/
+void server_send(conn_t* c, const lan_msg_t* msg);
+
+/**
+* Chiude la partita: i client ricevono la fine della trasmissione e vengono chiusi quando rispondono
+ * @param w thread della partita
+ * @param g partita
+*/
+void server_finish(worker_t* w, game_t* g);
+
+/**
+* Chiude il collegamento con un client; se la partita era in corso, l'avversario riceve LAN_BYE
+ * @param w thread della partita
+ * @param c collegamento
+*/
+void server_drop(worker_t* w, conn_t* c);
+
+/**
+* Controlla, senza attendere, se il client in attesa dell'avversario è ancora collegato.
+ * Prima di LAN_HELLO il client non invia nulla: un socket leggibile è chiuso, ha un errore
+ * o appartiene a un client che non rispetta il protocollo
+ * @param fd socket del client in attesa
+ * @return 1 se il collegamento è aperto, 0 altrimenti
+*/
+int server_alive(int fd);
+
+/**
+* Chiude il client in attesa dell'avversario, se si è scollegato
+ * @param waiting partita in attesa del secondo giocatore (aggiornata)
+*/
+void server_check_waiting(game_t** waiting);
+
+/**
+* Accoppia un nuovo client con quello in attesa e assegna la partita a un thread
+ * @param fd socket del nuovo client
+ * @param waiting partita in attesa del secondo giocatore (aggiornata)
+ * @param next thread a cui assegnare la prossima partita (aggiornato)
+*/
+void server_accept(int fd, game_t** waiting, int* next);
+
+/**
+* Stampa una riga di statistiche e azzera la latenza dell'intervallo
+ * @param elapsed secondi dall'avvio
+ * @param seconds secondi dall'ultima riga
+ * @param prev_matches partite concluse all'ultima riga (aggiornate)
+ * @param prev_moves mosse all'ultima riga (aggiornate)
+ * @param total latenza di tutte le mosse (aggiornata)
+*/
+void server_report(double elapsed, double seconds, unsigned long* prev_matches, unsigned long* prev_moves, histogram_t* total);
+
+void server_signal(int sig)
+{
+    (void)sig;
+    server_stop = 1;
+}
+
+void* server_worker(void* arg)
+{
+    worker_t* w = (worker_t*)arg;
+    struct epoll_event events[SERVER_EVENTS];
+
+    while(!server_stop)
+    {
+        int n = epoll_wait(w->epoll_fd, events, SERVER_EVENTS, 100), i;
+        double start = clock_now();
+
+        for(i = 0; i < n; i++)
+            server_read(w, (conn_t*)events[i].data.ptr, start);
+    }
+    return NULL;
+}
+
+void server_read(worker_t* w, conn_t* c, double start)
+{
+    lan_msg_t msg;
+    ssize_t n;
+    int used;
+
+    n = recv(c->fd, c->in + c->in_len, (size_t)(LAN_BUF - c->in_len), 0);
+    if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return;
+    if(n <= 0)
+    {
+        server_drop(w, c);
+        return;
+    }
+
+    /* A partita finita si attende solo che il client chiuda */
+    if(c->closing)
+        return;
+
+    c->in_len += (int)n;
+    while(c->fd >= 0 && !c->closing && (used = lan_decode(c->in, c->in_len, &msg)) != 0)
+    {
+        if(used < 0)
+        {
+            match_leave(&c->game->match, c->player);
+            server_finish(w, c->game);
+            return;
+        }
+        c->in_len -= used;
+        memmove(c->in, c->in + used, (size_t)c->in_len);
+        server_handle(w, c, &msg, start);
+    }
+}
+
+void server_handle(worker_t* w, conn_t* c, const lan_msg_t* msg, double start)
+{
+    game_t* g = c->game;
+    conn_t* other = &g->conns[1 - c->player];
+    int before[FIELD_ROWS][FIELD_COLS];
+    lan_msg_t out;
+    int score;
+
+    if(msg->type == LAN_BYE)
+    {
+        match_leave(&g->match, c->player);
+        server_send(other, msg);
+        server_finish(w, g);
+        return;
+    }
+    if(msg->type != LAN_MOVE)
+        return;
+
+    /* Il campo del server è quello che conta: il client riceve la conferma, l'avversario le righe cambiate */
+    memcpy(before, g->match.state.fields[c->player], sizeof(before));
+    score = match_move(&g->match, server_tets, c->player, msg->move);
+    if(score == -2)
+    {
+        match_leave(&g->match, c->player);
+        out.type = LAN_BYE;
+        server_send(c, &out);
+        server_send(other, &out);
+        server_finish(w, g);
+        return;
+    }
+
+    out.type = LAN_ACK;
+    out.seq = msg->seq;
+    server_send(c, &out);
+
+    out.type = LAN_MOVE;
+    out.seq = other->next_seq++ & 0xFFFF;
+    out.move = msg->move;
+    out.score = score;
+    lan_diff(&out, before, g->match.state.fields[c->player]);
+    server_send(other, &out);
+
+    pthread_mutex_lock(&w->lock);
+    histogram_record(&w->latency, (unsigned long)((clock_now() - start) * 1e9));
+    pthread_mutex_unlock(&w->lock);
+    __atomic_add_fetch(&w->moves, 1, __ATOMIC_RELAXED);
+
+    if(g->match.reason)
+        server_finish(w, g);
+}
+
+void server_send(conn_t* c, const lan_msg_t* msg)
+{
+    unsigned char frame[LAN_FRAME];
+    int len;
+
+    if(c->fd < 0 || c->closing)
+        return;
+    len = lan_encode(msg, frame);
+    if(send(c->fd, frame, (size_t)len, MSG_NOSIGNAL) != len)
+        shutdown(c->fd, SHUT_RDWR);
+}
+
+void server_finish(worker_t* w, game_t* g)
+{
+    int i;
+
+    if(!g->counted)
+    {
+        g->counted = 1;
+        __atomic_add_fetch(&w->matches, 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&w->active, 1, __ATOMIC_RELAXED);
+    }
+
+    for(i = 0; i < STATE_PLAYERS; i++)
+        if(g->conns[i].fd >= 0 && !g->conns[i].closing)
+        {
+            g->conns[i].closing = 1;
+            shutdown(g->conns[i].fd, SHUT_WR);
+        }
+}
+
+void server_drop(worker_t* w, conn_t* c)
+{
+    game_t* g = c->game;
+
+    if(!g->match.reason)
+    {
+        lan_msg_t bye;
+
+        match_leave(&g->match, c->player);
+        bye.type = LAN_BYE;
+        server_send(&g->conns[1 - c->player], &bye);
+    }
+    server_finish(w, g);
+
+    close(c->fd);
+    c->fd = -1;
+    if(--g->open == 0)
+        free(g);
+}
+
+int server_alive(int fd)
+{
+    unsigned char byte;
+    ssize_t n = recv(fd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+
+    return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+}
+
+void server_check_waiting(game_t** waiting)
+{
+    if(*waiting && !server_alive((*waiting)->conns[0].fd))
+    {
+        close((*waiting)->conns[0].fd);
+        free(*waiting);
+        *waiting = NULL;
+    }
+}
+
+void server_accept(int fd, game_t** waiting, int* next)
+{
+    game_t* g;
+    struct epoll_event ev;
+    lan_msg_t hello;
+    worker_t* w;
+    int one = 1, i;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    /* Chi si è scollegato mentre attendeva lascia il posto al nuovo client */
+    server_check_waiting(waiting);
+    g = *waiting;
+    if(!g)
+    {
+        g = (game_t*)calloc(1, sizeof(game_t));
+        if(!g)
+        {
+            close(fd);
+            return;
+        }
+        g->conns[0].fd = fd;
+        g->conns[1].fd = -1;
+        *waiting = g;
+        return;
+    }
+
+    *waiting = NULL;
+    g->conns[1].fd = fd;
+    g->open = STATE_PLAYERS;
+    match_init(&g->match, (unsigned long)rand());
+
+    w = &workers[*next];
+    *next = (*next + 1) % worker_count;
+    __atomic_add_fetch(&w->active, 1, __ATOMIC_RELAXED);
+
+    /* Le risposte dei client arrivano solo dopo LAN_HELLO: il thread della partita trova i collegamenti già pronti */
+    hello.type = LAN_HELLO;
+    hello.version = LAN_VERSION;
+    hello.seed = g->match.state.rng;
+    for(i = 0; i < STATE_PLAYERS; i++)
+    {
+        g->conns[i].game = g;
+        g->conns[i].player = i;
+        hello.player = i + 1;
+        server_send(&g->conns[i], &hello);
+    }
+    for(i = 0; i < STATE_PLAYERS; i++)
+    {
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = &g->conns[i];
+        epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, g->conns[i].fd, &ev);
+    }
+}
+
+void server_report(double elapsed, double seconds, unsigned long* prev_matches, unsigned long* prev_moves, histogram_t* total)
+{
+    histogram_t interval;
+    unsigned long matches = 0, moves = 0, active = 0;
+    int i;
+
+    histogram_clear(&interval);
+    for(i = 0; i < worker_count; i++)
+    {
+        pthread_mutex_lock(&workers[i].lock);
+        histogram_add(&interval, &workers[i].latency);
+        histogram_clear(&workers[i].latency);
+        pthread_mutex_unlock(&workers[i].lock);
+
+        matches += __atomic_load_n(&workers[i].matches, __ATOMIC_RELAXED);
+        moves += __atomic_load_n(&workers[i].moves, __ATOMIC_RELAXED);
+        active += __atomic_load_n(&workers[i].active, __ATOMIC_RELAXED);
+    }
+    histogram_add(total, &interval);
+
+    printf("%7.1f s  partite/s %8.1f  mosse/s %9.1f  in corso %6lu  latenza mossa us: p50 %.1f p99 %.1f max %.1f\n",
+           elapsed, (matches - *prev_matches) / seconds, (moves - *prev_moves) / seconds, active,
+           histogram_percentile(&interval, 50) / 1e3, histogram_percentile(&interval, 99) / 1e3, interval.max / 1e3);
+    fflush(stdout);
+
+    *prev_matches = matches;
+    *prev_moves = moves;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* address = ":7400";
+    double interval = 1, duration = 0, start, last;
+    unsigned long prev_matches = 0, prev_moves = 0;
+    histogram_t total;
+    game_t* waiting = NULL;
+    struct rlimit limit;
+    int listen_fd, next = 0, opt, i;
+
+    while((opt = getopt(argc, argv, "l:t:i:d:")) != -1)
+    {
+        if(opt == 'l')
+            address = optarg;
+        else if(opt == 't' && atoi(optarg) > 0 && atoi(optarg) <= SERVER_MAX_THREADS)
+            worker_count = atoi(optarg);
+        else if(opt == 'i' && atof(optarg) > 0)
+            interval = atof(optarg);
+        else if(opt == 'd' && atof(optarg) >= 0)
+            duration = atof(optarg);
+        else
+        {
+            fprintf(stderr, "Uso: %s [-l indirizzo] [-t thread] [-i secondi] [-d secondi]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    /* Ogni partita usa due descrittori */
+    if(getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    listen_fd = lan_listen(address);
+    if(listen_fd < 0)
+    {
+        fprintf(stderr, "Impossibile ascoltare su %s\n", address);
+        return 1;
+    }
+
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, server_signal);
+    signal(SIGTERM, server_signal);
+    srand((unsigned int)time(NULL));
+    tets_init(server_tets, 1);
+    histogram_clear(&total);
+
+    for(i = 0; i < worker_count; i++)
+    {
+        histogram_clear(&workers[i].latency);
+        pthread_mutex_init(&workers[i].lock, NULL);
+        workers[i].epoll_fd = epoll_create(SERVER_EVENTS);
+        if(workers[i].epoll_fd < 0 || pthread_create(&workers[i].thread, NULL, server_worker, &workers[i]) != 0)
+        {
+            fprintf(stderr, "Impossibile avviare i thread\n");
+            return 1;
+        }
+    }
+
+    printf("In ascolto su %s con %d thread\n", address, worker_count);
+    fflush(stdout);
+
+    start = last = clock_now();
+    while(!server_stop && (duration <= 0 || clock_now() - start < duration))
+    {
+        struct pollfd pfd[2];
+        double now;
+        double until = duration > 0 && start + duration < last + interval ? start + duration : last + interval;
+        int wait_ms = (int)((until - clock_now()) * 1000) + 1;
+
+        /* Si controlla anche il client in attesa, per chiuderlo appena si scollega */
+        pfd[0].fd = listen_fd;
+        pfd[0].events = POLLIN;
+        pfd[1].fd = waiting ? waiting->conns[0].fd : -1;
+        pfd[1].events = POLLIN;
+        pfd[0].revents = pfd[1].revents = 0;
+        if(poll(pfd, 2, wait_ms > 0 ? wait_ms : 0) > 0)
+        {
+            /* Si accettano tutti i collegamenti in coda prima di tornare ad attendere */
+            int fd;
+            if(pfd[1].revents)
+                server_check_waiting(&waiting);
+            while(pfd[0].revents && (fd = accept(listen_fd, NULL, NULL)) >= 0)
+                server_accept(fd, &waiting, &next);
+        }
+
+        now = clock_now();
+        if(now - last >= interval)
+        {
+            server_report(now - start, now - last, &prev_matches, &prev_moves, &total);
+            last = now;
+        }
+    }
+
+    server_stop = 1;
+    for(i = 0; i < worker_count; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    /* Ultima riga per quanto successo dopo la precedente */
+    if(clock_now() - last > 0.01)
+        server_report(clock_now() - start, clock_now() - last, &prev_matches, &prev_moves, &total);
+
+    printf("Totale: %lu partite, %lu mosse in %.1f s; latenza mossa us: p50 %.1f p99 %.1f p999 %.1f max %.1f\n",
+           prev_matches, prev_moves, clock_now() - start,
+           histogram_percentile(&total, 50) / 1e3, histogram_percentile(&total, 99) / 1e3,
+           histogram_percentile(&total, 99.9) / 1e3, total.max / 1e3);
+
+    close(listen_fd);
+    tets_free(server_tets);
+    return 0;
+}
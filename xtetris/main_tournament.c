@@ -0,0 +1,472 @@
+/**
+* @file main_tournament.c
+* @author Albert Alibeaj
+* @brief Programma xtetris-tournament: fa giocare ogni coppia di strategie del computer (Strategy.h)
+ * con le regole della partita contro il computer e stima la forza di ciascuna in punti Elo.
+ *
+ * Uso: <code>xtetris-tournament [-g partite] [-t thread] [-p pipeline] [-r aperture] [-s seme] strategia strategia...</code>
+ *  - <code>-g</code> partite di ogni coppia (predefinite 100): ogni seme viene giocato due volte,
+ *    scambiando chi inizia
+ *  - <code>-p</code> partite giocate insieme da ogni thread (predefinite TOURNAMENT_PIPELINE): a ogni giro
+ *    il thread chiede una mossa per ciascuna e solo dopo ne attende le risposte, così un programma
+ *    esterno con exec ha in pipeline più posizioni per thread (al più PIPEBOT_SLOTS in tutto)
+ *  - <code>-r</code> mosse casuali giocate all'inizio di ogni partita da ciascun giocatore,
+ *    per rendere diverse partite altrimenti identiche (predefinite 3)
+ *
+ * Regole come in multi_start_game: tetramini condivisi, a ogni giro muove prima un giocatore e poi
+ * l'altro (anche se il primo ha appena perso), chi elimina 3 o 4 righe inverte altrettante righe
+ * dell'avversario. Perde chi non riesce a inserire un tetramino, se perdono entrambi nello stesso
+ * giro è pareggio; a tetramini finiti vince il punteggio più alto.
+ *
+ * I punti Elo sono la stima di massima verosimiglianza del modello di Bradley-Terry (un pareggio
+ * vale mezza vittoria), con media 0 e intervallo di confidenza al 95% ricavato dalla matrice
+ * di informazione di Fisher
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "Clock.h"
+#include "Sched.h"
+#include "Strategy.h"
+
+/** Strategie massime di un torneo */
+#define TOURNAMENT_MAX 32
+/** Iterazioni massime della stima dei punti Elo */
+#define TOURNAMENT_ITERATIONS 10000
+/** Partite giocate insieme da ogni thread, se non indicato con -p */
+#define TOURNAMENT_PIPELINE 4
+/** Partite massime giocate insieme da ogni thread */
+#define TOURNAMENT_MAX_PIPELINE 16
+
+/** Tipo match_t
+*   Partita del torneo
+*/
+typedef struct Match
+{
+    int a;                  /**< strategia che inizia */
+    int b;                  /**< strategia che muove per seconda */
+    unsigned long seed;     /**< seme della partita */
+    int result;             /**< esito per a: 2 vittoria, 1 pareggio, 0 sconfitta */
+    int moves;              /**< mosse giocate */
+
+} match_t;
+
+/** Tipo match_run_t
+*   Partita in corso su un thread, insieme alle altre dello stesso gruppo
+*/
+typedef struct MatchRun
+{
+    match_t* match;             /**< partita giocata */
+    game_state_t state;         /**< stato della partita */
+    tet_t own[TET_TYPES];       /**< tetramini con le quantità dello stato */
+    int lost[2];                /**< 1 se il giocatore non è riuscito a inserire un tetramino */
+    int out;                    /**< 1 se i tetramini sono finiti */
+    int turn;                   /**< giocatore che muove (0 o 1) */
+    int asked;                  /**< 1 se la mossa è stata chiesta alla strategia e va raccolta */
+    strategy_request_t req;     /**< mossa chiesta alla strategia */
+    double spent;               /**< secondi spesi dal thread per la mossa chiesta */
+
+} match_run_t;
+
+strategy_t players[TOURNAMENT_MAX];     /**< strategie in gara */
+int player_count;                       /**< numero di strategie */
+unsigned long move_ns[TOURNAMENT_MAX];  /**< tempo totale speso da ogni strategia per scegliere, in nanosecondi */
+unsigned long move_count[TOURNAMENT_MAX]; /**< mosse scelte da ogni strategia */
+tet_t match_tets[TET_TYPES];            /**< tetramini condivisi dai thread (solo lettura) */
+match_t* matches;                       /**< partite del torneo */
+int match_count;                        /**< numero di partite */
+int pipeline;                           /**< partite giocate insieme da ogni thread */
+int opening;                            /**< mosse casuali iniziali di ogni giocatore */
+
+/**
+* Gioca una mossa di una partita e passa il turno. Come in multi_start_game, a ogni giro
+ * muovono entrambi i giocatori anche se il primo ha appena perso
+ * @param r partita in corso
+ * @param move mossa del giocatore di turno
+*/
+void match_apply(match_run_t* r, placement_t move)
+{
+    state_undo_t undo;
+
+    if(state_make(&r->state, r->own, r->turn, move, &undo) < 0)
+        r->lost[r->turn] = 1;
+    r->turn = !r->turn;
+}
+
+/**
+* Controlla se una partita è finita
+ * @param r partita in corso
+ * @return 1 se la partita è finita, 0 altrimenti
+*/
+int match_over(const match_run_t* r)
+{
+    return r->out || (r->turn == 0 && (r->lost[0] || r->lost[1]));
+}
+
+/**
+* Chiede la mossa del giocatore di turno senza attenderla. Le mosse casuali di apertura
+ * vengono giocate subito
+ * @param r partita in corso
+*/
+void match_ask(match_run_t* r)
+{
+    const match_t* m = r->match;
+    placements_t legal;
+    double start;
+
+    state_to_tets(&r->state, r->own);
+    if(placements_gen(r->own, &legal) == 0)
+    {
+        r->out = 1;
+        return;
+    }
+
+    if(r->state.moves < opening * 2)
+    {
+        match_apply(r, legal.moves[state_rand(&r->state) % legal.count]);
+        return;
+    }
+
+    start = clock_now();
+    strategy_request(&players[r->turn ? m->b : m->a], &r->state, r->turn, r->own, &r->req);
+    r->spent = clock_now() - start;
+    r->asked = 1;
+}
+
+/**
+* Raccoglie la mossa chiesta con match_ask e la gioca
+ * @param r partita in corso
+*/
+void match_answer(match_run_t* r)
+{
+    const match_t* m = r->match;
+    int id = r->turn ? m->b : m->a;
+    placement_t move;
+    double start = clock_now();
+
+    strategy_reply(&players[id], r->own, &r->req, &move);
+    r->spent += clock_now() - start;
+    r->asked = 0;
+
+    /* Conta solo il tempo speso dal thread: l'attesa di un bot in pipeline si sovrappone alle altre partite */
+    __atomic_fetch_add(&move_ns[id], (unsigned long)(r->spent * 1e9), __ATOMIC_RELAXED);
+    __atomic_fetch_add(&move_count[id], 1UL, __ATOMIC_RELAXED);
+    match_apply(r, move);
+}
+
+/**
+* Compito eseguito dai thread di Sched.h: gioca insieme un gruppo di pipeline partite.
+ * A ogni giro chiede una mossa per ogni partita in corso e poi raccoglie le risposte nello stesso ordine
+ * @param arg non usato
+ * @param i indice del gruppo
+*/
+void play_matches(void* arg, int i)
+{
+    match_run_t runs[TOURNAMENT_MAX_PIPELINE];
+    int first = i * pipeline, n = match_count - first < pipeline ? match_count - first : pipeline;
+    int active = n, k;
+    (void)arg;
+
+    for(k = 0; k < n; k++)
+    {
+        match_run_t* r = &runs[k];
+        r->match = &matches[first + k];
+        memcpy(r->own, match_tets, sizeof(r->own));
+        state_init(&r->state, 2, r->match->seed);
+        r->lost[0] = r->lost[1] = 0;
+        r->out = 0;
+        r->turn = 0;
+        r->asked = 0;
+    }
+
+    while(active > 0)
+    {
+        for(k = 0; k < n; k++)
+            if(!match_over(&runs[k]))
+                match_ask(&runs[k]);
+        active = 0;
+        for(k = 0; k < n; k++)
+        {
+            if(runs[k].asked)
+                match_answer(&runs[k]);
+            active += !match_over(&runs[k]);
+        }
+    }
+
+    for(k = 0; k < n; k++)
+    {
+        const match_run_t* r = &runs[k];
+        match_t* m = r->match;
+
+        m->moves = r->state.moves;
+        if(r->lost[0] != r->lost[1])
+            m->result = r->lost[0] ? 0 : 2;
+        else if(r->lost[0] || r->state.scores[0] == r->state.scores[1])
+            m->result = 1;
+        else
+            m->result = r->state.scores[0] > r->state.scores[1] ? 2 : 0;
+    }
+}
+
+/**
+* Inverte una matrice simmetrica definita positiva con l'eliminazione di Gauss-Jordan
+ * @param n dimensione
+ * @param m matrice n x n, sostituita dalla sua inversa
+ * @return 0 se la matrice è stata invertita, -1 se è singolare
+*/
+int invert(int n, double m[TOURNAMENT_MAX][TOURNAMENT_MAX])
+{
+    double inv[TOURNAMENT_MAX][TOURNAMENT_MAX];
+    int i, j, k;
+
+    for(i = 0; i < n; i++)
+        for(j = 0; j < n; j++)
+            inv[i][j] = i == j;
+
+    for(k = 0; k < n; k++)
+    {
+        double pivot = m[k][k];
+        if(fabs(pivot) < 1e-12)
+            return -1;
+        for(j = 0; j < n; j++)
+        {
+            m[k][j] /= pivot;
+            inv[k][j] /= pivot;
+        }
+        for(i = 0; i < n; i++)
+            if(i != k)
+            {
+                double f = m[i][k];
+                for(j = 0; j < n; j++)
+                {
+                    m[i][j] -= f * m[k][j];
+                    inv[i][j] -= f * inv[k][j];
+                }
+            }
+    }
+
+    memcpy(m, inv, sizeof(inv));
+    return 0;
+}
+
+/**
+* Stima i punti Elo con l'algoritmo MM di Hunter per il modello di Bradley-Terry
+ * @param wins mezze vittorie di i contro j (una vittoria vale 2, un pareggio 1)
+ * @param games partite tra i e j
+ * @param elo punti stimati (media 0)
+ * @param ci semiampiezza dell'intervallo di confidenza al 95% (0 se non stimabile)
+*/
+void estimate(unsigned long wins[TOURNAMENT_MAX][TOURNAMENT_MAX], unsigned long games[TOURNAMENT_MAX][TOURNAMENT_MAX],
+              double elo[TOURNAMENT_MAX], double ci[TOURNAMENT_MAX])
+{
+    const double scale = 400.0 / log(10.0);
+    double gamma[TOURNAMENT_MAX], info[TOURNAMENT_MAX][TOURNAMENT_MAX], mean = 0;
+    int n = player_count, it, i, j;
+
+    for(i = 0; i < n; i++)
+        gamma[i] = 1;
+
+    for(it = 0; it < TOURNAMENT_ITERATIONS; it++)
+    {
+        double change = 0, log_mean = 0;
+
+        for(i = 0; i < n; i++)
+        {
+            /* Mezzo pareggio in più contro un avversario virtuale: nessuno va a più o meno infinito */
+            double w = 0.5, d = 1.0 / (gamma[i] + 1), next;
+            for(j = 0; j < n; j++)
+                if(j != i)
+                {
+                    w += wins[i][j] / 2.0;
+                    d += games[i][j] / (gamma[i] + gamma[j]);
+                }
+            next = w / d;
+            change += fabs(log(next / gamma[i]));
+            gamma[i] = next;
+        }
+        for(i = 0; i < n; i++)
+            log_mean += log(gamma[i]) / n;
+        for(i = 0; i < n; i++)
+            gamma[i] /= exp(log_mean);
+        if(change < 1e-10)
+            break;
+    }
+
+    /* Informazione di Fisher in unità naturali: è singolare (conta solo la differenza tra i punti),
+     * quindi si inverte I + 11'/n e si toglie 1/n, ottenendo la covarianza con media fissata a 0 */
+    for(i = 0; i < n; i++)
+        for(j = 0; j < n; j++)
+            info[i][j] = 1.0 / n;
+    for(i = 0; i < n; i++)
+        for(j = 0; j < n; j++)
+            if(j != i)
+            {
+                double p = gamma[i] / (gamma[i] + gamma[j]);
+                double v = games[i][j] * p * (1 - p);
+                info[i][i] += v;
+                info[i][j] -= v;
+            }
+
+    for(i = 0; i < n; i++)
+        mean += log(gamma[i]) / n;
+    if(invert(n, info) != 0)
+        memset(info, 0, sizeof(info));
+    for(i = 0; i < n; i++)
+    {
+        elo[i] = (log(gamma[i]) - mean) * scale;
+        ci[i] = info[i][i] > 1.0 / n ? 1.96 * sqrt(info[i][i] - 1.0 / n) * scale : 0;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned long wins[TOURNAMENT_MAX][TOURNAMENT_MAX], games[TOURNAMENT_MAX][TOURNAMENT_MAX];
+    double elo[TOURNAMENT_MAX], ci[TOURNAMENT_MAX], start, elapsed;
+    unsigned long seed = 1, total_moves = 0;
+    int per_pair = 100, threads = (int)sysconf(_SC_NPROCESSORS_ONLN), count = 0, order[TOURNAMENT_MAX];
+    int opt, i, j, k, reported = 0;
+
+    opening = 3;
+    pipeline = TOURNAMENT_PIPELINE;
+    while((opt = getopt(argc, argv, "g:t:p:r:s:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'g': per_pair = atoi(optarg); break;
+            case 't': threads = atoi(optarg); break;
+            case 'p': pipeline = atoi(optarg); break;
+            case 'r': opening = atoi(optarg); break;
+            case 's': seed = strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "Uso: %s [-g partite] [-t thread] [-p pipeline] [-r aperture] [-s seme] strategia strategia...\n", argv[0]);
+                return 2;
+        }
+    }
+
+    player_count = argc - optind;
+    if(player_count < 2 || player_count > TOURNAMENT_MAX)
+    {
+        fprintf(stderr, "%s: servono da 2 a %d strategie (default, greedy, random, weights:FILE, net:FILE, lib:FILE, exec:COMANDO, shm:COMANDO)\n",
+                argv[0], TOURNAMENT_MAX);
+        return 2;
+    }
+    for(i = 0; i < player_count; i++)
+        if(strategy_open(&players[i], argv[optind + i]) != 0)
+        {
+            fprintf(stderr, "%s: strategia non valida: %s\n", argv[0], argv[optind + i]);
+            return 1;
+        }
+    if(per_pair < 2)
+        per_pair = 2;
+    per_pair -= per_pair % 2;
+
+    /* Ogni seme viene giocato due volte da ogni coppia, scambiando chi inizia */
+    matches = (match_t*)malloc(sizeof(match_t) * per_pair * player_count * (player_count - 1) / 2);
+    for(i = 0; i < player_count; i++)
+        for(j = i + 1; j < player_count; j++)
+            for(k = 0; k < per_pair; k++)
+            {
+                matches[count].a = k % 2 ? j : i;
+                matches[count].b = k % 2 ? i : j;
+                matches[count].seed = seed + k / 2;
+                count++;
+            }
+
+    /* Un thread che invia più richieste di quanti slot restano al bot si bloccherebbe su sé stesso */
+    if(threads < 1)
+        threads = 1;
+    if(pipeline > TOURNAMENT_MAX_PIPELINE)
+        pipeline = TOURNAMENT_MAX_PIPELINE;
+    if(pipeline > PIPEBOT_SLOTS / threads)
+        pipeline = PIPEBOT_SLOTS / threads;
+    if(pipeline < 1)
+        pipeline = 1;
+    match_count = count;
+
+    tets_init(match_tets, 1);
+    sched_start(threads);
+    start = clock_now();
+    sched_for(0, (count + pipeline - 1) / pipeline, 1, play_matches, NULL);
+    elapsed = clock_now() - start;
+    sched_stop();
+
+    memset(wins, 0, sizeof(wins));
+    memset(games, 0, sizeof(games));
+    for(k = 0; k < count; k++)
+    {
+        const match_t* m = &matches[k];
+        wins[m->a][m->b] += m->result;
+        wins[m->b][m->a] += 2 - m->result;
+        games[m->a][m->b]++;
+        games[m->b][m->a]++;
+        total_moves += m->moves;
+    }
+    estimate(wins, games, elo, ci);
+
+    printf("%d partite, %lu mosse su %d thread (%d partite insieme per thread) in %.2f s: %.1f partite/s, %.0f mosse/s\n\n",
+           count, total_moves, sched_threads() > 0 ? sched_threads() : threads, pipeline, elapsed,
+           count / elapsed, total_moves / elapsed);
+
+    for(i = 0; i < player_count; i++)
+        order[i] = i;
+    for(i = 1; i < player_count; i++)
+        for(j = i; j > 0 && elo[order[j]] > elo[order[j - 1]]; j--)
+        {
+            int t = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = t;
+        }
+
+    printf("%-4s %-32s %8s %8s %8s %10s\n", "", "strategia", "Elo", "+/-", "punti", "us/mossa");
+    for(i = 0; i < player_count; i++)
+    {
+        int p = order[i];
+        unsigned long w = 0, g = 0;
+        for(j = 0; j < player_count; j++)
+        {
+            w += wins[p][j];
+            g += games[p][j];
+        }
+        printf("%-4d %-32s %8.1f %8.1f %7.1f%% %10.1f\n", i + 1, players[p].name, elo[p], ci[p],
+               g ? 50.0 * w / g : 0.0, move_count[p] ? move_ns[p] / 1e3 / move_count[p] : 0.0);
+    }
+
+    printf("\n");
+    for(i = 0; i < player_count; i++)
+        for(j = i + 1; j < player_count; j++)
+        {
+            unsigned long win = 0, draw = 0, loss = 0;
+            for(k = 0; k < count; k++)
+            {
+                const match_t* m = &matches[k];
+                int r;
+                if(!((m->a == i && m->b == j) || (m->a == j && m->b == i)))
+                    continue;
+                r = m->a == i ? m->result : 2 - m->result;
+                win += r == 2;
+                draw += r == 1;
+                loss += r == 0;
+            }
+            printf("%s - %s: +%lu =%lu -%lu\n", players[i].name, players[j].name, win, draw, loss);
+        }
+
+    for(i = 0; i < player_count; i++)
+        if(players[i].kind == STRATEGY_PIPE || players[i].kind == STRATEGY_RING)
+        {
+            if(!reported++)
+                printf("\n");
+            if(players[i].kind == STRATEGY_PIPE)
+                pipebot_report(players[i].pipe, players[i].name, stdout);
+            else
+                ring_report(players[i].ring, players[i].name, stdout);
+        }
+
+    for(i = 0; i < player_count; i++)
+        strategy_close(&players[i]);
+    tets_free(match_tets);
+    free(matches);
+    return 0;
+}
@@ -0,0 +1,457 @@
+/**
+* @file main_tune.c
+* @author Albert Alibeaj
+* @brief Programma xtetris-tune: cerca i pesi della valutazione del computer con un algoritmo genetico.
+ * Ogni generazione fa giocare a ogni candidato le stesse partite (stessi semi, diversi a ogni
+ * generazione), divise in blocchi distribuiti su tutti i core (Sched.h); i migliori passano
+ * invariati alla generazione successiva, gli altri nascono da incroci e mutazioni.
+ *
+ * Uso: <code>xtetris-tune [-n generazioni] [-P popolazione] [-g partite] [-b blocco] [-t thread]
+ * [-p giocatori] [-r aperture] [-s seme] [-c checkpoint] [-o file]</code>
+ *  - <code>-g</code> partite giocate da ogni candidato in ogni generazione (predefinite 200)
+ *  - <code>-b</code> partite di ogni compito assegnato a un thread (predefinite 4)
+ *  - <code>-p 1</code>: il candidato gioca da solo e vale il punteggio medio;
+ *    <code>-p 2</code> (predefinito): gioca contro i pesi predefiniti, un turno per parte alternando chi inizia,
+ *    e vale la differenza media di punti più TUNE_WIN_BONUS per ogni vittoria (meno per ogni sconfitta)
+ *  - <code>-r</code> mosse casuali giocate all'inizio di ogni partita da ciascun giocatore,
+ *    per rendere diverse partite altrimenti identiche (predefinite 3)
+ *  - <code>-c</code> file in cui salvare lo stato dopo ogni generazione; se esiste già la ricerca riprende da lì
+ *  - <code>-o</code> file dei pesi migliori, riscritto dopo ogni generazione (predefinito xtetris-weights.txt),
+ *    da usare in partita con XTETRIS_WEIGHTS
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "Clock.h"
+#include "Com.h"
+#include "Sched.h"
+#include "State.h"
+
+/** Intestazione del file di checkpoint */
+#define TUNE_MAGIC "XTETRIS_TUNE 1"
+/** Valore di una vittoria (con due giocatori), in punti */
+#define TUNE_WIN_BONUS 10
+/** Candidati di ogni torneo di selezione */
+#define TUNE_TOURNAMENT 3
+/** Riduzione della mutazione a ogni generazione */
+#define TUNE_SIGMA_DECAY 0.95
+/** Mutazione minima */
+#define TUNE_SIGMA_MIN 0.02
+
+tet_t tune_tets[TET_TYPES];         /**< tetramini condivisi dai thread (solo lettura) */
+com_weights_t tune_reference;       /**< pesi dell'avversario con due giocatori */
+com_weights_t* tune_population;     /**< candidati della generazione */
+double* tune_fitness;               /**< valore di ogni candidato */
+double* tune_block_fitness;         /**< somma dei valori di ogni compito */
+int tune_size;                      /**< candidati di ogni generazione */
+int tune_games;                     /**< partite di ogni candidato */
+int tune_block;                     /**< partite di ogni compito */
+int tune_blocks;                    /**< compiti di ogni candidato */
+int tune_players;                   /**< giocatori di ogni partita */
+int tune_opening;                   /**< mosse casuali iniziali di ogni giocatore */
+unsigned long tune_seed;            /**< seme della prima partita della generazione */
+unsigned long tune_rng;             /**< generatore dell'algoritmo genetico */
+
+/**
+* Numero pseudo-casuale dell'algoritmo genetico (xorshift a 32 bit)
+ * @return numero tra 0 e 2^32 - 1
+*/
+unsigned long tune_rand()
+{
+    unsigned long x = tune_rng & 0xFFFFFFFFUL;
+
+    if(!x)
+        x = 2463534242UL;
+    x ^= (x << 13) & 0xFFFFFFFFUL;
+    x ^= x >> 17;
+    x ^= (x << 5) & 0xFFFFFFFFUL;
+    tune_rng = x;
+
+    return x;
+}
+
+/**
+* Numero casuale uniforme
+ * @return numero in [0, 1)
+*/
+double tune_uniform()
+{
+    return tune_rand() / 4294967296.0;
+}
+
+/**
+* Numero casuale con distribuzione normale standard (Box-Muller)
+ * @return numero casuale
+*/
+double tune_gauss()
+{
+    double u = 1.0 - tune_uniform(), v = tune_uniform();
+    return sqrt(-2.0 * log(u)) * cos(2.0 * 3.14159265358979323846 * v);
+}
+
+/**
+* Lunghezza di un vettore di pesi
+ * @param w pesi
+ * @return norma euclidea
+*/
+double tune_norm(const com_weights_t* w)
+{
+    double sum = 0;
+    int i;
+
+    for(i = 0; i < COM_WEIGHTS; i++)
+        sum += w->w[i] * w->w[i];
+
+    return sqrt(sum);
+}
+
+/**
+* Riporta i pesi alla lunghezza di quelli predefiniti: la valutazione sceglie le stesse mosse
+ * con pesi moltiplicati per una costante positiva, quindi conta solo la direzione
+ * @param w pesi da normalizzare
+*/
+void tune_normalize(com_weights_t* w)
+{
+    com_weights_t d = com_default_weights();
+    double n = tune_norm(w), target = tune_norm(&d);
+    int i;
+
+    if(n == 0)
+    {
+        *w = d;
+        return;
+    }
+    for(i = 0; i < COM_WEIGHTS; i++)
+        w->w[i] *= target / n;
+}
+
+/**
+* Gioca una partita con un candidato
+ * @param weights pesi del candidato
+ * @param seed seme della partita
+ * @return valore della partita per il candidato
+*/
+double tune_play(const com_weights_t* weights, unsigned long seed)
+{
+    game_state_t state;
+    tet_t own[TET_TYPES];
+    int me = tune_players > 1 ? (int)(seed & 1) : 0;
+    int player = 0, loser = -1, moves = 0;
+
+    memcpy(own, tune_tets, sizeof(own));
+    state_init(&state, tune_players, seed);
+
+    for(;;)
+    {
+        placements_t legal;
+        state_undo_t undo;
+        placement_t move;
+
+        state_to_tets(&state, own);
+        if(placements_gen(own, &legal) == 0)
+            break;
+
+        if(moves < tune_opening * state.players)
+            move = legal.moves[state_rand(&state) % legal.count];
+        else
+            com_best_move(state.fields[player], own, player == me ? weights : &tune_reference, &move);
+
+        moves++;
+        if(state_make(&state, own, player, move, &undo) < 0)
+        {
+            loser = player;
+            break;
+        }
+        player = (player + 1) % state.players;
+    }
+
+    if(state.players == 1)
+        return state.scores[0];
+
+    /* Chi perde lascia la vittoria all'altro; a tetramini finiti vince il punteggio più alto */
+    if(loser < 0 && state.scores[me] != state.scores[1 - me])
+        loser = state.scores[me] > state.scores[1 - me] ? 1 - me : me;
+
+    return state.scores[me] - state.scores[1 - me] + (loser < 0 ? 0 : loser == me ? -TUNE_WIN_BONUS : TUNE_WIN_BONUS);
+}
+
+/**
+* Compito eseguito dai thread di Sched.h: un blocco di partite di un candidato
+ * @param arg non usato
+ * @param task indice del compito (candidato * tune_blocks + blocco)
+*/
+void tune_task(void* arg, int task)
+{
+    int candidate = task / tune_blocks, block = task % tune_blocks, i, last;
+    double sum = 0;
+    (void)arg;
+
+    last = (block + 1) * tune_block < tune_games ? (block + 1) * tune_block : tune_games;
+    for(i = block * tune_block; i < last; i++)
+        sum += tune_play(&tune_population[candidate], tune_seed + i);
+
+    tune_block_fitness[task] = sum;
+}
+
+/**
+* Valuta tutti i candidati della generazione su tutti i thread
+*/
+void tune_evaluate()
+{
+    int i, b;
+
+    sched_for(0, tune_size * tune_blocks, 1, tune_task, NULL);
+
+    for(i = 0; i < tune_size; i++)
+    {
+        double sum = 0;
+        for(b = 0; b < tune_blocks; b++)
+            sum += tune_block_fitness[i * tune_blocks + b];
+        tune_fitness[i] = sum / tune_games;
+    }
+}
+
+/**
+* Sceglie un genitore con un torneo tra TUNE_TOURNAMENT candidati a caso
+ * @return indice del candidato scelto
+*/
+int tune_select()
+{
+    int best = (int)(tune_rand() % tune_size), i;
+
+    for(i = 1; i < TUNE_TOURNAMENT; i++)
+    {
+        int c = (int)(tune_rand() % tune_size);
+        if(tune_fitness[c] > tune_fitness[best])
+            best = c;
+    }
+
+    return best;
+}
+
+/**
+* Crea la generazione successiva: i migliori restano, gli altri sono figli di due genitori
+ * (miscela casuale dei pesi) con una mutazione normale di ampiezza sigma
+ * @param order indici dei candidati dal migliore al peggiore
+ * @param sigma ampiezza della mutazione, relativa alla lunghezza dei pesi
+*/
+void tune_breed(const int* order, double sigma)
+{
+    com_weights_t* next = (com_weights_t*)malloc(sizeof(com_weights_t) * tune_size);
+    com_weights_t d = com_default_weights();
+    double step = sigma * tune_norm(&d) / sqrt((double)COM_WEIGHTS);
+    int elite = tune_size / 8 > 0 ? tune_size / 8 : 1, c, i;
+
+    for(c = 0; c < elite; c++)
+        next[c] = tune_population[order[c]];
+
+    for(c = elite; c < tune_size; c++)
+    {
+        const com_weights_t* a = &tune_population[tune_select()];
+        const com_weights_t* b = &tune_population[tune_select()];
+
+        for(i = 0; i < COM_WEIGHTS; i++)
+        {
+            double u = tune_uniform() * 1.5 - 0.25;
+            next[c].w[i] = a->w[i] + u * (b->w[i] - a->w[i]) + step * tune_gauss();
+        }
+        tune_normalize(&next[c]);
+    }
+
+    memcpy(tune_population, next, sizeof(com_weights_t) * tune_size);
+    free(next);
+}
+
+/**
+* Salva lo stato della ricerca, scrivendo prima un file temporaneo per non lasciare checkpoint a metà
+ * @param path file del checkpoint
+ * @param generation generazioni completate
+ * @param sigma ampiezza della mutazione
+ * @return 0 se il file è stato scritto, -1 altrimenti
+*/
+int tune_checkpoint_save(const char* path, int generation, double sigma)
+{
+    char tmp[4096];
+    FILE* out;
+    int c, i, ok;
+
+    sprintf(tmp, "%.4000s.tmp", path);
+    out = fopen(tmp, "w");
+    if(!out)
+        return -1;
+
+    fprintf(out, "%s\ngeneration %d\nsigma %.17g\nrng %lu\nseed %lu\npopulation %d\n",
+            TUNE_MAGIC, generation, sigma, tune_rng, tune_seed, tune_size);
+    for(c = 0; c < tune_size; c++)
+        for(i = 0; i < COM_WEIGHTS; i++)
+            fprintf(out, "%.17g%c", tune_population[c].w[i], i == COM_WEIGHTS - 1 ? '\n' : ' ');
+
+    ok = ferror(out) ? -1 : 0;
+    if(fclose(out) != 0 || ok != 0 || rename(tmp, path) != 0)
+    {
+        remove(tmp);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+* Riprende la ricerca da un checkpoint
+ * @param path file del checkpoint
+ * @param generation generazioni completate
+ * @param sigma ampiezza della mutazione
+ * @return 0 se il checkpoint è stato letto, -1 se manca o non è valido
+*/
+int tune_checkpoint_load(const char* path, int* generation, double* sigma)
+{
+    FILE* in = fopen(path, "r");
+    char magic[32];
+    int size, c, i, ok;
+
+    if(!in)
+        return -1;
+
+    ok = fgets(magic, sizeof(magic), in) && strncmp(magic, TUNE_MAGIC, strlen(TUNE_MAGIC)) == 0
+         && fscanf(in, " generation %d sigma %lf rng %lu seed %lu population %d",
+                   generation, sigma, &tune_rng, &tune_seed, &size) == 5 && size > 0;
+    if(ok)
+    {
+        tune_size = size;
+        tune_population = (com_weights_t*)realloc(tune_population, sizeof(com_weights_t) * size);
+        for(c = 0; c < size && ok; c++)
+            for(i = 0; i < COM_WEIGHTS && ok; i++)
+                ok = fscanf(in, "%lf", &tune_population[c].w[i]) == 1;
+    }
+    fclose(in);
+
+    return ok ? 0 : -1;
+}
+
+/**
+* Confronta due candidati per valore decrescente (per qsort)
+ * @param a indice del primo candidato
+ * @param b indice del secondo candidato
+ * @return negativo se a vale di più
+*/
+int tune_compare(const void* a, const void* b)
+{
+    double fa = tune_fitness[*(const int*)a], fb = tune_fitness[*(const int*)b];
+    return fa > fb ? -1 : fa < fb ? 1 : *(const int*)a - *(const int*)b;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* checkpoint = NULL;
+    const char* output = "xtetris-weights.txt";
+    int generations = 20, threads = (int)sysconf(_SC_NPROCESSORS_ONLN), generation = 0;
+    double sigma = 0.3;
+    int* order;
+    int opt, c, i;
+
+    tune_size = 32;
+    tune_games = 200;
+    tune_block = 4;
+    tune_players = 2;
+    tune_opening = 3;
+    tune_seed = 1;
+
+    while((opt = getopt(argc, argv, "n:P:g:b:t:p:r:s:c:o:")) != -1)
+    {
+        switch(opt)
+        {
+            case 'n': generations = atoi(optarg); break;
+            case 'P': tune_size = atoi(optarg); break;
+            case 'g': tune_games = atoi(optarg); break;
+            case 'b': tune_block = atoi(optarg); break;
+            case 't': threads = atoi(optarg); break;
+            case 'p': tune_players = atoi(optarg) > 1 ? 2 : 1; break;
+            case 'r': tune_opening = atoi(optarg); break;
+            case 's': tune_seed = strtoul(optarg, NULL, 10); break;
+            case 'c': checkpoint = optarg; break;
+            case 'o': output = optarg; break;
+            default:
+                fprintf(stderr, "Uso: %s [-n generazioni] [-P popolazione] [-g partite] [-b blocco] [-t thread] "
+                                "[-p giocatori] [-r aperture] [-s seme] [-c checkpoint] [-o file]\n", argv[0]);
+                return 2;
+        }
+    }
+    if(threads < 1) threads = 1;
+    if(tune_size < 2) tune_size = 2;
+    if(tune_games < 1) tune_games = 1;
+    if(tune_block < 1) tune_block = 1;
+
+    tets_init(tune_tets, tune_players > 1);
+    tune_reference = com_default_weights();
+    tune_rng = tune_seed;
+    tune_population = (com_weights_t*)malloc(sizeof(com_weights_t) * tune_size);
+
+    if(checkpoint && tune_checkpoint_load(checkpoint, &generation, &sigma) == 0)
+        printf("ripresa da %s: generazione %d, %d candidati\n", checkpoint, generation, tune_size);
+    else
+    {
+        /* Il primo candidato sono i pesi predefiniti, gli altri loro mutazioni */
+        com_weights_t d = com_default_weights();
+        double step = sigma * tune_norm(&d) / sqrt((double)COM_WEIGHTS);
+
+        for(c = 0; c < tune_size; c++)
+        {
+            for(i = 0; i < COM_WEIGHTS; i++)
+                tune_population[c].w[i] = d.w[i] + (c ? step * tune_gauss() : 0);
+            tune_normalize(&tune_population[c]);
+        }
+    }
+
+    tune_blocks = (tune_games + tune_block - 1) / tune_block;
+    tune_fitness = (double*)malloc(sizeof(double) * tune_size);
+    tune_block_fitness = (double*)malloc(sizeof(double) * tune_size * tune_blocks);
+    order = (int*)malloc(sizeof(int) * tune_size);
+
+    printf("%d candidati x %d partite a %d giocator%s, %d thread\n",
+           tune_size, tune_games, tune_players, tune_players > 1 ? "i" : "e", threads);
+
+    sched_start(threads);
+    for(; generation < generations; generation++)
+    {
+        double start = clock_now(), elapsed, mean = 0;
+
+        tune_evaluate();
+        elapsed = clock_now() - start;
+
+        for(c = 0; c < tune_size; c++)
+        {
+            order[c] = c;
+            mean += tune_fitness[c] / tune_size;
+        }
+        qsort(order, tune_size, sizeof(int), tune_compare);
+
+        printf("generazione %3d: migliore %8.3f, media %8.3f, %.0f partite/s\n", generation + 1,
+               tune_fitness[order[0]], mean, (double)tune_size * tune_games / elapsed);
+        fflush(stdout);
+
+        if(com_weights_save(output, &tune_population[order[0]]) != 0)
+        {
+            fprintf(stderr, "%s: impossibile scrivere %s\n", argv[0], output);
+            return 1;
+        }
+
+        /* Semi nuovi a ogni generazione: i candidati non si adattano a un insieme fisso di partite */
+        tune_breed(order, sigma);
+        tune_seed += (unsigned long)tune_games;
+        sigma = sigma * TUNE_SIGMA_DECAY > TUNE_SIGMA_MIN ? sigma * TUNE_SIGMA_DECAY : TUNE_SIGMA_MIN;
+
+        if(checkpoint && tune_checkpoint_save(checkpoint, generation + 1, sigma) != 0)
+            fprintf(stderr, "%s: impossibile scrivere %s\n", argv[0], checkpoint);
+    }
+
+    sched_stop();
+    tets_free(tune_tets);
+    free(tune_population);
+    free(tune_fitness);
+    free(tune_block_fitness);
+    free(order);
+    return 0;
+}